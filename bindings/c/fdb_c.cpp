@@ -439,6 +439,14 @@ FDBFuture* fdb_transaction_get_v13( FDBTransaction* tr, uint8_t const* key_name,
 	return fdb_transaction_get_impl( tr, key_name, key_name_length, 0 );
 }
 
+extern "C" DLLEXPORT
+FDBFuture* fdb_transaction_get_multi( FDBTransaction* tr, FDBKey const* keys, int key_count,
+									  fdb_bool_t snapshot ) {
+	// FDBKey has the same layout as KeyRef
+	return (FDBFuture*)
+		( TXN(tr)->getValues( VectorRef<KeyRef>( (KeyRef*)keys, key_count ), snapshot ).extractPtr() );
+}
+
 FDBFuture* fdb_transaction_get_key_impl( FDBTransaction* tr, uint8_t const* key_name,
 										 int key_name_length, fdb_bool_t or_equal,
 										 int offset, fdb_bool_t snapshot ) {
@@ -289,6 +289,10 @@ extern "C" {
                                        int end_key_name_length,
                                        FDBConflictRangeType type);
 
+    DLLEXPORT WARN_UNUSED_RESULT FDBFuture*
+    fdb_transaction_get_multi( FDBTransaction* tr, FDBKey const* keys, int key_count,
+                               fdb_bool_t snapshot );
+
     DLLEXPORT WARN_UNUSED_RESULT FDBFuture*
     fdb_transaction_get_estimated_range_size_bytes( FDBTransaction* tr, uint8_t const* begin_key_name,
         int begin_key_name_length, uint8_t const* end_key_name, int end_key_name_length);
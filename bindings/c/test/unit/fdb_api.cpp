@@ -155,6 +155,17 @@ ValueFuture Transaction::get(std::string_view key, fdb_bool_t snapshot) {
                                          key.size(), snapshot));
 }
 
+KeyValueArrayFuture Transaction::get_multi(const std::vector<std::string>& keys,
+                                           fdb_bool_t snapshot) {
+  std::vector<FDBKey> fdb_keys;
+  for (const auto& key : keys) {
+    fdb_keys.push_back(FDBKey{ (const uint8_t*)key.data(), (int)key.size() });
+  }
+  return KeyValueArrayFuture(fdb_transaction_get_multi(tr_, fdb_keys.data(),
+                                                       fdb_keys.size(),
+                                                       snapshot));
+}
+
 KeyFuture Transaction::get_key(const uint8_t* key_name, int key_name_length,
                                fdb_bool_t or_equal, int offset,
                                fdb_bool_t snapshot) {
@@ -44,6 +44,7 @@
 
 #include <string>
 #include <string_view>
+#include <vector>
 
 namespace fdb {
 
@@ -193,6 +194,11 @@ class Transaction final {
   // Returns a future which will be set to the value of `key` in the database.
   ValueFuture get(std::string_view key, fdb_bool_t snapshot);
 
+  // Returns a future which will be set to the keys in `keys` which are present
+  // in the database, with their values, in the order they were given.
+  KeyValueArrayFuture get_multi(const std::vector<std::string>& keys,
+                                fdb_bool_t snapshot);
+
   // Returns a future which will be set to the key in the database matching the
   // passed key selector.
   KeyFuture get_key(const uint8_t* key_name, int key_name_length,
@@ -934,6 +934,48 @@ TEST_CASE("fdb_transaction_get_range FDB_STREAMING_MODE_EXACT") {
   }
 }
 
+TEST_CASE("fdb_transaction_get_multi") {
+  std::map<std::string, std::string> data =
+      create_data({ { "a", "1" }, { "b", "2" }, { "c", "3" }, { "d", "4" } });
+  insert_data(db, data);
+
+  fdb::Transaction tr(db);
+  while (1) {
+    // Unwritten keys are read from the database, written keys from the
+    // transaction, and keys which are not present are left out.
+    tr.set(key("e"), "5");
+    tr.clear(key("d"));
+    fdb::KeyValueArrayFuture f1 = tr.get_multi(
+        { key("c"), key("x"), key("a"), key("e"), key("d"), key("c") },
+        /* snapshot */ false);
+
+    fdb_error_t err = wait_future(f1);
+    if (err) {
+      fdb::EmptyFuture f2 = tr.on_error(err);
+      fdb_check(wait_future(f2));
+      continue;
+    }
+
+    FDBKeyValue const *out_kv;
+    int out_count;
+    int out_more;
+    fdb_check(f1.get(&out_kv, &out_count, &out_more));
+
+    std::vector<std::pair<std::string, std::string>> expected = {
+      { key("c"), "3" }, { key("a"), "1" }, { key("e"), "5" }, { key("c"), "3" }
+    };
+    CHECK(!out_more);
+    CHECK(out_count == expected.size());
+    for (int i = 0; i < out_count && i < expected.size(); ++i) {
+      std::string k((const char *)out_kv[i].key, out_kv[i].key_length);
+      std::string v((const char *)out_kv[i].value, out_kv[i].value_length);
+      CHECK(k.compare(expected[i].first) == 0);
+      CHECK(v.compare(expected[i].second) == 0);
+    }
+    break;
+  }
+}
+
 TEST_CASE("fdb_transaction_clear") {
   insert_data(db, create_data({ { "foo", "bar" } }));
 
@@ -318,7 +318,10 @@ public:
 	Counter transactionPhysicalReadsCompleted;
 	Counter transactionGetKeyRequests;
 	Counter transactionGetValueRequests;
+	Counter transactionGetValuesRequests;
 	Counter transactionGetRangeRequests;
+	Counter transactionGetRangeStreamRequests;
+	Counter transactionGetMappedRangeRequests;
 	Counter transactionWatchRequests;
 	Counter transactionGetAddressesForKeyRequests;
 	Counter transactionBytesRead;
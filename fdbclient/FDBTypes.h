@@ -642,6 +642,8 @@ KeyRangeWith<Val> keyRangeWith( const KeyRangeRef& range, const Val& value ) {
 	return KeyRangeWith<Val>(range, value);
 }
 
+struct MappedKeyValueRef;
+
 struct GetRangeLimits {
 	enum { ROW_LIMIT_UNLIMITED = -1, BYTE_LIMIT_UNLIMITED = -1 };
 
@@ -655,6 +657,7 @@ struct GetRangeLimits {
 
 	void decrement( VectorRef<KeyValueRef> const& data );
 	void decrement( KeyValueRef const& data );
+	void decrement( MappedKeyValueRef const& data ); // Charges the mapped key and value as well as the pair
 
 	// True if either the row or byte limit has been reached
 	bool isReached();
@@ -704,6 +707,43 @@ struct Traceable<RangeResultRef> : std::true_type {
 	}
 };
 
+// A key-value pair read by a mapped range read, along with the key which the mapper built from it and, when that key
+// could be read, its value
+struct MappedKeyValueRef {
+	KeyValueRef kv;
+	KeyRef mappedKey;
+	Optional<ValueRef> mappedValue;
+	bool mappedLocal;  // False if mappedKey was not readable where kv was read, so mappedValue has not been filled in
+
+	MappedKeyValueRef() : mappedLocal(false) {}
+	MappedKeyValueRef( const KeyValueRef& kv, const KeyRef& mappedKey ) : kv(kv), mappedKey(mappedKey), mappedLocal(false) {}
+	MappedKeyValueRef( Arena& a, const MappedKeyValueRef& copyFrom )
+	  : kv(a, copyFrom.kv), mappedKey(a, copyFrom.mappedKey),
+	    mappedValue(copyFrom.mappedValue.present() ? Optional<ValueRef>(ValueRef(a, copyFrom.mappedValue.get())) : Optional<ValueRef>()),
+	    mappedLocal(copyFrom.mappedLocal) {}
+
+	int expectedSize() const {
+		return kv.expectedSize() + mappedKey.expectedSize() + (mappedValue.present() ? mappedValue.get().expectedSize() : 0);
+	}
+
+	template <class Ar>
+	void serialize( Ar& ar ) {
+		serializer(ar, kv, mappedKey, mappedValue, mappedLocal);
+	}
+};
+
+struct MappedRangeResultRef : VectorRef<MappedKeyValueRef> {
+	bool more;  // True if (but not necessarily only if) values remain in the *key* range requested (possibly beyond the limits requested)
+
+	MappedRangeResultRef() : more(false) {}
+	MappedRangeResultRef( Arena& p, const MappedRangeResultRef& toCopy ) : VectorRef<MappedKeyValueRef>( p, toCopy ), more( toCopy.more ) {}
+
+	template <class Ar>
+	void serialize( Ar& ar ) {
+		serializer(ar, ((VectorRef<MappedKeyValueRef>&)*this), more);
+	}
+};
+
 struct KeyValueStoreType {
 	constexpr static FileIdentifier file_identifier = 6560359;
 	// These enumerated values are stored in the database configuration, so should NEVER be changed.
@@ -79,6 +79,7 @@ public:
 	int LOCATION_CACHE_EVICTION_SIZE_SIM;
 
 	int GET_RANGE_SHARD_LIMIT;
+	int GET_VALUES_BATCH_SIZE; // Maximum number of keys sent to a storage server in one GetValuesRequest
 	int WARM_RANGE_SHARD_LIMIT;
 	int STORAGE_METRICS_SHARD_LIMIT;
 	int SHARD_COUNT_LIMIT;
@@ -75,6 +75,25 @@ ThreadFuture<Optional<Value>> DLTransaction::get(const KeyRef& key, bool snapsho
 	});
 }
 
+ThreadFuture<Standalone<RangeResultRef>> DLTransaction::getValues(const VectorRef<KeyRef>& keys, bool snapshot) {
+	if (!api->transactionGetMulti) {
+		return unsupported_operation();
+	}
+	// KeyRef has the same layout as FDBKey
+	FdbCApi::FDBFuture *f = api->transactionGetMulti(tr, (const FdbCApi::FDBKey*)keys.begin(), keys.size(), snapshot);
+
+	return toThreadFuture<Standalone<RangeResultRef>>(api, f, [](FdbCApi::FDBFuture *f, FdbCApi *api) {
+		const FdbCApi::FDBKeyValue *kvs;
+		int count;
+		FdbCApi::fdb_bool_t more;
+		FdbCApi::fdb_error_t error = api->futureGetKeyValueArray(f, &kvs, &count, &more);
+		ASSERT(!error);
+
+		// The memory for this is stored in the FDBFuture and is released when the future gets destroyed
+		return Standalone<RangeResultRef>(RangeResultRef(VectorRef<KeyValueRef>((KeyValueRef*)kvs, count), more), Arena());
+	});
+}
+
 ThreadFuture<Key> DLTransaction::getKey(const KeySelectorRef& key, bool snapshot) {
 	FdbCApi::FDBFuture *f = api->transactionGetKey(tr, key.getKey().begin(), key.getKey().size(), key.orEqual, key.offset, snapshot);
 
@@ -372,6 +391,7 @@ void DLApi::init() {
 	loadClientFunction(&api->transactionSetReadVersion, lib, fdbCPath, "fdb_transaction_set_read_version");
 	loadClientFunction(&api->transactionGetReadVersion, lib, fdbCPath, "fdb_transaction_get_read_version");
 	loadClientFunction(&api->transactionGet, lib, fdbCPath, "fdb_transaction_get");
+	loadClientFunction(&api->transactionGetMulti, lib, fdbCPath, "fdb_transaction_get_multi", headerVersion >= 700);
 	loadClientFunction(&api->transactionGetKey, lib, fdbCPath, "fdb_transaction_get_key");
 	loadClientFunction(&api->transactionGetAddressesForKey, lib, fdbCPath, "fdb_transaction_get_addresses_for_key");
 	loadClientFunction(&api->transactionGetRange, lib, fdbCPath, "fdb_transaction_get_range");
@@ -589,6 +609,12 @@ ThreadFuture<Optional<Value>> MultiVersionTransaction::get(const KeyRef& key, bo
 	return abortableFuture(f, tr.onChange);
 }
 
+ThreadFuture<Standalone<RangeResultRef>> MultiVersionTransaction::getValues(const VectorRef<KeyRef>& keys, bool snapshot) {
+	auto tr = getTransaction();
+	auto f = tr.transaction ? tr.transaction->getValues(keys, snapshot) : ThreadFuture<Standalone<RangeResultRef>>(Never());
+	return abortableFuture(f, tr.onChange);
+}
+
 ThreadFuture<Key> MultiVersionTransaction::getKey(const KeySelectorRef& key, bool snapshot) {
 	auto tr = getTransaction();
 	auto f = tr.transaction ? tr.transaction->getKey(key, snapshot) : ThreadFuture<Key>(Never());
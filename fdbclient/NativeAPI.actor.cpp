@@ -22,6 +22,7 @@
 
 #include <algorithm>
 #include <iterator>
+#include <numeric>
 #include <regex>
 #include <unordered_set>
 #include <tuple>
@@ -859,7 +860,10 @@ DatabaseContext::DatabaseContext(Reference<AsyncVar<Reference<ClusterConnectionF
     transactionLogicalReads("LogicalUncachedReads", cc), transactionPhysicalReads("PhysicalReadRequests", cc),
     transactionPhysicalReadsCompleted("PhysicalReadRequestsCompleted", cc),
     transactionGetKeyRequests("GetKeyRequests", cc), transactionGetValueRequests("GetValueRequests", cc),
-    transactionGetRangeRequests("GetRangeRequests", cc), transactionWatchRequests("WatchRequests", cc),
+    transactionGetValuesRequests("GetValuesRequests", cc),
+    transactionGetRangeRequests("GetRangeRequests", cc),
+    transactionGetRangeStreamRequests("GetRangeStreamRequests", cc),
+    transactionGetMappedRangeRequests("GetMappedRangeRequests", cc), transactionWatchRequests("WatchRequests", cc),
     transactionGetAddressesForKeyRequests("GetAddressesForKeyRequests", cc), transactionBytesRead("BytesRead", cc),
     transactionKeysRead("KeysRead", cc), transactionMetadataVersionReads("MetadataVersionReads", cc),
     transactionCommittedMutations("CommittedMutations", cc),
@@ -1044,7 +1048,10 @@ DatabaseContext::DatabaseContext(const Error& err)
     transactionLogicalReads("LogicalUncachedReads", cc), transactionPhysicalReads("PhysicalReadRequests", cc),
     transactionPhysicalReadsCompleted("PhysicalReadRequestsCompleted", cc),
     transactionGetKeyRequests("GetKeyRequests", cc), transactionGetValueRequests("GetValueRequests", cc),
-    transactionGetRangeRequests("GetRangeRequests", cc), transactionWatchRequests("WatchRequests", cc),
+    transactionGetValuesRequests("GetValuesRequests", cc),
+    transactionGetRangeRequests("GetRangeRequests", cc),
+    transactionGetRangeStreamRequests("GetRangeStreamRequests", cc),
+    transactionGetMappedRangeRequests("GetMappedRangeRequests", cc), transactionWatchRequests("WatchRequests", cc),
     transactionGetAddressesForKeyRequests("GetAddressesForKeyRequests", cc), transactionBytesRead("BytesRead", cc),
     transactionKeysRead("KeysRead", cc), transactionMetadataVersionReads("MetadataVersionReads", cc),
     transactionCommittedMutations("CommittedMutations", cc),
@@ -1703,6 +1710,12 @@ void GetRangeLimits::decrement( KeyValueRef const& data ) {
 	if (bytes != GetRangeLimits::BYTE_LIMIT_UNLIMITED) bytes = std::max(0, bytes - (int)8 - (int)data.expectedSize());
 }
 
+void GetRangeLimits::decrement( MappedKeyValueRef const& data ) {
+	minRows = std::max(0, minRows - 1);
+	if (rows != GetRangeLimits::ROW_LIMIT_UNLIMITED) rows--;
+	if (bytes != GetRangeLimits::BYTE_LIMIT_UNLIMITED) bytes = std::max(0, bytes - (int)8 - (int)data.expectedSize());
+}
+
 // True if either the row or byte limit has been reached
 bool GetRangeLimits::isReached() {
 	return rows == 0 || (bytes == 0 && minRows == 0);
@@ -2052,6 +2065,120 @@ ACTOR Future<Optional<Value>> getValue( Future<Version> version, Key key, Databa
 	}
 }
 
+// Reads the values of many keys, sending the keys of each shard to its storage servers together in GetValuesRequests
+// of up to GET_VALUES_BATCH_SIZE keys.  Returns the keys which are present, with their values, in the order of keys.
+ACTOR Future<Standalone<RangeResultRef>> getValues(Future<Version> version, Standalone<VectorRef<KeyRef>> keys,
+                                                   Database cx, TransactionInfo info, TagSet tags) {
+	state Version ver = wait( version );
+	state Span span("NAPI:getValues"_loc, info.spanID);
+	cx->validateVersion(ver);
+
+	state Standalone<RangeResultRef> output;
+	state std::vector<Optional<ValueRef>> values(keys.size());
+	state Optional<UID> getValuesID = Optional<UID>();
+	if( info.debugID.present() ) {
+		getValuesID = nondeterministicRandom()->randomUniqueID();
+		g_traceBatch.addAttach("GetValuesAttachID", info.debugID.get().first(), getValuesID.get().first());
+	}
+
+	// The keys still to be read, as indices into keys sorted by key so that the keys of a shard are adjacent
+	state std::vector<int> remaining(keys.size());
+	std::iota(remaining.begin(), remaining.end(), 0);
+	std::sort(remaining.begin(), remaining.end(), [&](int a, int b) { return keys[a] < keys[b]; });
+
+	loop {
+		state std::vector<std::pair<Reference<LocationInfo>, std::vector<int>>> batches;
+		state int i = 0;
+		batches.clear();
+		while (i < remaining.size()) {
+			state pair<KeyRange, Reference<LocationInfo>> ssi =
+			    wait(getKeyLocation(cx, keys[remaining[i]], &StorageServerInterface::getValues, info));
+			batches.emplace_back(ssi.second, std::vector<int>());
+			for (; i < remaining.size() && ssi.first.contains(keys[remaining[i]]); i++) {
+				if (batches.back().second.size() >= CLIENT_KNOBS->GET_VALUES_BATCH_SIZE) {
+					batches.emplace_back(ssi.second, std::vector<int>());
+				}
+				batches.back().second.push_back(remaining[i]);
+			}
+		}
+
+		if( info.debugID.present() )
+			g_traceBatch.addEvent("GetValueDebug", getValuesID.get().first(), "NativeAPI.getValues.Before");
+
+		state std::vector<Future<ErrorOr<GetValuesReply>>> replies;
+		state double startTimeD = now();
+		replies.clear();
+		for (auto& batch : batches) {
+			Arena arena;
+			VectorRef<KeyRef> batchKeys;
+			arena.dependsOn(keys.arena());
+			batchKeys.reserve(arena, batch.second.size());
+			for (int k : batch.second) {
+				batchKeys.push_back(arena, keys[k]);
+			}
+
+			++cx->transactionPhysicalReads;
+			replies.push_back(errorOr(loadBalance(
+			    cx.getPtr(), batch.first, &StorageServerInterface::getValues,
+			    GetValuesRequest(span.context, batchKeys, ver, cx->sampleReadTags() ? tags : Optional<TagSet>(),
+			                     getValuesID, arena),
+			    TaskPriority::DefaultPromiseEndpoint, false, cx->enableLocalityLoadBalance ? &cx->queueModel : nullptr)));
+		}
+
+		choose {
+			when(wait(cx->connectionFileChanged())) { throw transaction_too_old(); }
+			when(wait(waitForAll(replies))) {}
+		}
+		cx->transactionPhysicalReadsCompleted += replies.size();
+		cx->readLatencies.addSample(now() - startTimeD);
+
+		if( info.debugID.present() )
+			g_traceBatch.addEvent("GetValueDebug", getValuesID.get().first(), "NativeAPI.getValues.After");
+
+		// Keep the keys of any batch which has to be retried, which are still in key order
+		remaining.clear();
+		for (int b = 0; b < batches.size(); b++) {
+			const std::vector<int>& batch = batches[b].second;
+			if (replies[b].get().isError()) {
+				Error e = replies[b].get().getError();
+				if (e.code() == error_code_wrong_shard_server || e.code() == error_code_all_alternatives_failed ||
+				    (e.code() == error_code_transaction_too_old && ver == latestVersion)) {
+					cx->invalidateCache(keys[batch.front()]);
+					remaining.insert(remaining.end(), batch.begin(), batch.end());
+					continue;
+				}
+				throw e;
+			}
+
+			// The reply holds the keys which are present in the order they were requested
+			const GetValuesReply& reply = replies[b].get().get();
+			output.arena().dependsOn(reply.arena);
+			int d = 0;
+			for (int k : batch) {
+				if (d < reply.data.size() && reply.data[d].key == keys[k]) {
+					values[k] = reply.data[d].value;
+					cx->transactionBytesRead += reply.data[d].value.size();
+					d++;
+				}
+			}
+			cx->transactionKeysRead += batch.size();
+		}
+
+		if (remaining.empty()) {
+			break;
+		}
+		wait(delay(CLIENT_KNOBS->WRONG_SHARD_SERVER_DELAY, info.taskID));
+	}
+
+	output.arena().dependsOn(keys.arena());
+	for (int k = 0; k < keys.size(); k++) {
+		if (values[k].present()) {
+			output.push_back(output.arena(), KeyValueRef(keys[k], values[k].get()));
+		}
+	}
+	return output;
+}
+
 ACTOR Future<Key> getKey( Database cx, KeySelector k, Future<Version> version, TransactionInfo info, TagSet tags ) {
 	wait(success(version));
 
@@ -2354,7 +2481,8 @@ ACTOR Future<Void> watchValueMap(Future<Version> version, Key key, Optional<Valu
 	return Void();
 }
 
-void transformRangeLimits(GetRangeLimits limits, bool reverse, GetKeyValuesRequest &req) {
+template <class Request>
+void transformRangeLimits(GetRangeLimits limits, bool reverse, Request &req) {
 	if(limits.bytes != 0) {
 		if(!limits.hasRowLimit())
 			req.limit = CLIENT_KNOBS->REPLY_BYTE_LIMIT; // Can't get more than this many rows anyway
@@ -2851,6 +2979,273 @@ ACTOR Future<Standalone<RangeResultRef>> getRange( Database cx, Reference<Transa
 	}
 }
 
+ACTOR Future<Void> getRangeStream( PromiseStream<Standalone<RangeResultRef>> results, Database cx, Future<Version> fVersion,
+	KeySelector begin, KeySelector end, GetRangeLimits limits, Promise<std::pair<Key, Key>> conflictRange, bool snapshot, bool reverse,
+	TransactionInfo info, TagSet tags )
+{
+	state Span span("NAPI:getRangeStream"_loc, info.spanID);
+	state Key lastKey;
+	state int64_t bytes = 0;
+	state int64_t keysRead = 0;
+
+	try {
+		state Version version = wait( fVersion );
+		cx->validateVersion(version);
+
+		Future<Key> fb = resolveKey(cx, begin, version, info, tags);
+		state Future<Key> fe = resolveKey(cx, end, version, info, tags);
+		state Key beginKey = wait(fb);
+		state Key endKey = wait(fe);
+		state KeyRange keys = KeyRangeRef(std::min(beginKey, endKey), endKey);
+
+		while( !keys.empty() && !limits.isReached() ) {
+			state vector< pair<KeyRange, Reference<LocationInfo>> > locations = wait( getKeyRangeLocations( cx, keys, CLIENT_KNOBS->GET_RANGE_SHARD_LIMIT, reverse, &StorageServerInterface::getKeyValuesStream, info ) );
+			ASSERT( locations.size() );
+			state int shard = 0;
+			while( shard < locations.size() && !limits.isReached() ) {
+				state KeyRange range = locations[shard].first;
+				state int useIdx = deterministicRandom()->randomInt(0, std::max(1, locations[shard].second->countBest()));
+
+				GetKeyValuesStreamRequest req;
+				req.version = version;
+				req.begin = firstGreaterOrEqual( range.begin );
+				req.end = firstGreaterOrEqual( range.end );
+				req.spanContext = span.context;
+				// The storage server splits the reply into fragments itself, so the whole of the remaining limits can be requested
+				req.limit = limits.hasRowLimit() ? limits.rows : std::numeric_limits<int>::max();
+				if( reverse )
+					req.limit = -req.limit;
+				req.limitBytes = limits.hasByteLimit() ? limits.bytes : std::numeric_limits<int>::max();
+				req.tags = cx->sampleReadTags() ? tags : Optional<TagSet>();
+				req.debugID = info.debugID;
+
+				try {
+					if( info.debugID.present() )
+						g_traceBatch.addEvent("TransactionDebug", info.debugID.get().first(), "NativeAPI.getRangeStream.Before");
+					++cx->transactionPhysicalReads;
+					state ReplyPromiseStream<GetKeyValuesStreamReply> replyStream = locations[shard].second->get(useIdx, &StorageServerInterface::getKeyValuesStream).getReplyStream(req);
+					loop {
+						state GetKeyValuesStreamReply rep;
+						try {
+							choose {
+								when(wait(cx->connectionFileChanged())) { throw transaction_too_old(); }
+								when(GetKeyValuesStreamReply _rep = waitNext(replyStream.getFuture())) { rep = _rep; }
+							}
+						} catch (Error& e) {
+							if (e.code() == error_code_end_of_stream) {
+								break;
+							}
+							throw e;
+						}
+						if( !rep.data.size() ) {
+							continue;
+						}
+
+						if( limits.hasRowLimit() && rep.data.size() > limits.rows ) {
+							rep.data.resize(rep.arena, limits.rows);
+						}
+						limits.decrement( rep.data );
+						lastKey = Key(rep.data.back().key);
+						bytes += rep.data.expectedSize();
+						keysRead += rep.data.size();
+
+						// Continue from just past the last key delivered if this shard has to be retried
+						if( reverse )
+							range = KeyRangeRef( range.begin, lastKey );
+						else
+							range = KeyRangeRef( keyAfter( lastKey ), range.end );
+						results.send( Standalone<RangeResultRef>( RangeResultRef( rep.data, !range.empty() || limits.isReached() ), rep.arena ) );
+
+						if( limits.isReached() ) {
+							break;
+						}
+					}
+					++cx->transactionPhysicalReadsCompleted;
+					if( info.debugID.present() )
+						g_traceBatch.addEvent("TransactionDebug", info.debugID.get().first(), "NativeAPI.getRangeStream.After");
+
+					if( reverse )
+						keys = KeyRangeRef( keys.begin, locations[shard].first.begin );
+					else
+						keys = KeyRangeRef( locations[shard].first.end, keys.end );
+					++shard;
+				} catch (Error& e) {
+					++cx->transactionPhysicalReadsCompleted;
+					if (e.code() != error_code_wrong_shard_server && e.code() != error_code_all_alternatives_failed &&
+					    e.code() != error_code_connection_failed && e.code() != error_code_broken_promise) {
+						throw e;
+					}
+					// Resume from the last key delivered, after refreshing the location cache
+					if( reverse )
+						keys = KeyRangeRef( keys.begin, range.end );
+					else
+						keys = KeyRangeRef( range.begin, keys.end );
+
+					cx->invalidateCache( keys );
+					wait( delay(CLIENT_KNOBS->WRONG_SHARD_SERVER_DELAY, info.taskID ));
+					break;
+				}
+			}
+		}
+
+		cx->transactionBytesRead += bytes;
+		cx->transactionKeysRead += keysRead;
+
+		if( !snapshot ) {
+			// The conflict range covers the keys examined to resolve the selectors, clipped to the last key delivered
+			// when the limits stopped the read early
+			Key rangeBegin = std::min(Key(begin.getKey(), begin.arena()), beginKey);
+			Key rangeEnd = std::max(Key(end.getKey(), end.arena()), endKey);
+			if( limits.isReached() ) {
+				if( reverse )
+					rangeBegin = lastKey;
+				else
+					rangeEnd = keyAfter( lastKey );
+			}
+			conflictRange.send(std::make_pair(rangeBegin, std::max(rangeBegin, rangeEnd)));
+		}
+		results.sendError(end_of_stream());
+	} catch (Error& e) {
+		if(conflictRange.canBeSet()) {
+			conflictRange.send(std::make_pair(Key(), Key()));
+		}
+		if (e.code() == error_code_actor_cancelled) {
+			throw e;
+		}
+		results.sendError(e);
+	}
+	return Void();
+}
+
+// Reads keys a shard at a time, reading the mapped values which the storage servers did not have with getValues
+ACTOR Future<Standalone<MappedRangeResultRef>> getMappedRange( Database cx, Future<Version> fVersion, KeyRange keys, Key mapper,
+	GetRangeLimits limits, Promise<std::pair<Key, Key>> conflictRange, Promise<Standalone<VectorRef<KeyRef>>> conflictKeys,
+	bool snapshot, bool reverse, TransactionInfo info, TagSet tags )
+{
+	state Span span("NAPI:getMappedRange"_loc, info.spanID);
+	state Standalone<MappedRangeResultRef> output;
+	state KeyRange remaining = keys; // The part of keys which has not been read yet
+
+	try {
+		state Version version = wait( fVersion );
+		cx->validateVersion(version);
+
+		loop {
+			state pair<KeyRange, Reference<LocationInfo>> location = wait( getKeyLocation( cx, reverse ? remaining.end : remaining.begin, &StorageServerInterface::getMappedKeyValues, info, reverse ) );
+			state KeyRange range = remaining & location.first;
+			state GetMappedKeyValuesRequest req;
+
+			req.arena.dependsOn(range.arena());
+			req.arena.dependsOn(mapper.arena());
+			req.keys = range;
+			req.mapper = mapper;
+			req.version = version;
+			transformRangeLimits(limits, reverse, req);
+			req.tags = cx->sampleReadTags() ? tags : Optional<TagSet>();
+			req.debugID = info.debugID;
+			req.spanContext = span.context;
+
+			state GetMappedKeyValuesReply rep;
+			try {
+				if( info.debugID.present() )
+					g_traceBatch.addEvent("TransactionDebug", info.debugID.get().first(), "NativeAPI.getMappedRange.Before");
+				++cx->transactionPhysicalReads;
+				GetMappedKeyValuesReply _rep =
+				    wait(loadBalance(cx.getPtr(), location.second, &StorageServerInterface::getMappedKeyValues, req,
+				                     TaskPriority::DefaultPromiseEndpoint, false,
+				                     cx->enableLocalityLoadBalance ? &cx->queueModel : nullptr));
+				rep = _rep;
+				++cx->transactionPhysicalReadsCompleted;
+			} catch (Error& e) {
+				++cx->transactionPhysicalReadsCompleted;
+				if (e.code() != error_code_wrong_shard_server && e.code() != error_code_all_alternatives_failed) {
+					throw;
+				}
+				cx->invalidateCache( reverse ? remaining.end : remaining.begin, reverse );
+				wait( delay(CLIENT_KNOBS->WRONG_SHARD_SERVER_DELAY, info.taskID) );
+				continue;
+			}
+
+			if( info.debugID.present() )
+				g_traceBatch.addEvent("TransactionDebug", info.debugID.get().first(), "NativeAPI.getMappedRange.After");
+			ASSERT( !rep.more || rep.data.size() );
+
+			// Read the mapped keys which are not on the storage server which read the range.  getValues returns the keys
+			// which are present in the order they were requested.
+			state Standalone<VectorRef<KeyRef>> remoteKeys;
+			remoteKeys.arena().dependsOn(rep.arena);
+			for (const auto& m : rep.data) {
+				if (!m.mappedLocal)
+					remoteKeys.push_back(remoteKeys.arena(), m.mappedKey);
+			}
+			if (remoteKeys.size()) {
+				TEST(true); // Mapped range read has mapped keys on other storage servers
+				Standalone<RangeResultRef> remoteValues = wait( getValues(version, remoteKeys, cx, info, tags) );
+				rep.arena.dependsOn(remoteValues.arena());
+				int v = 0;
+				for (auto& m : rep.data) {
+					if (!m.mappedLocal && v < remoteValues.size() && remoteValues[v].key == m.mappedKey) {
+						m.mappedValue = remoteValues[v++].value;
+					}
+				}
+			}
+
+			output.arena().dependsOn(rep.arena);
+			output.append(output.arena(), rep.data.begin(), rep.data.size());
+			for (const auto& m : rep.data) {
+				limits.decrement(m);
+			}
+
+			if( rep.more ) {
+				if( reverse )
+					remaining = KeyRangeRef( remaining.begin, rep.data.back().kv.key );
+				else
+					remaining = KeyRangeRef( keyAfter( rep.data.back().kv.key ), remaining.end );
+			} else {
+				if( reverse )
+					remaining = KeyRangeRef( remaining.begin, range.begin );
+				else
+					remaining = KeyRangeRef( range.end, remaining.end );
+			}
+
+			if( remaining.empty() || limits.isReached() || limits.hasSatisfiedMinRows() ) {
+				output.more = !remaining.empty();
+				break;
+			}
+		}
+
+		int64_t bytes = 0;
+		for (const auto& m : output) {
+			bytes += m.expectedSize();
+		}
+		cx->transactionBytesRead += bytes;
+		cx->transactionKeysRead += output.size();
+
+		if( !snapshot ) {
+			// The index conflict range stops where the limits stopped the read; the mapped keys are point reads
+			conflictRange.send(reverse ? std::make_pair(Key(remaining.end), Key(keys.end))
+			                           : std::make_pair(Key(keys.begin), Key(remaining.begin)));
+			Standalone<VectorRef<KeyRef>> mappedKeys;
+			mappedKeys.arena().dependsOn(output.arena());
+			for (const auto& m : output) {
+				// There are no keys larger than the key size limit, so reading one cannot conflict with anything
+				if (m.mappedKey.size() <= (m.mappedKey.startsWith(systemKeys.begin) ? CLIENT_KNOBS->SYSTEM_KEY_SIZE_LIMIT : CLIENT_KNOBS->KEY_SIZE_LIMIT))
+					mappedKeys.push_back(mappedKeys.arena(), m.mappedKey);
+			}
+			conflictKeys.send(mappedKeys);
+		}
+		return output;
+	} catch (Error& e) {
+		if(conflictRange.canBeSet()) {
+			conflictRange.send(std::make_pair(Key(), Key()));
+		}
+		if(conflictKeys.canBeSet()) {
+			conflictKeys.send(Standalone<VectorRef<KeyRef>>());
+		}
+		throw;
+	}
+}
+
 Future<Standalone<RangeResultRef>> getRange( Database const& cx, Future<Version> const& fVersion, KeySelector const& begin, KeySelector const& end,
 	GetRangeLimits const& limits, bool const& reverse, TransactionInfo const& info, TagSet const& tags )
 {
@@ -2919,6 +3314,7 @@ void Transaction::operator=(Transaction&& r) noexcept {
 	readVersion = std::move(r.readVersion);
 	metadataVersion = std::move(r.metadataVersion);
 	extraConflictRanges = std::move(r.extraConflictRanges);
+	extraConflictKeys = std::move(r.extraConflictKeys);
 	commitResult = std::move(r.commitResult);
 	committing = std::move(r.committing);
 	options = std::move(r.options);
@@ -2999,6 +3395,30 @@ Future<Optional<Value>> Transaction::get( const Key& key, bool snapshot ) {
 	return getValue( ver, key, cx, info, trLogInfo, options.readTags );
 }
 
+Future<Standalone<RangeResultRef>> Transaction::getValues( Standalone<VectorRef<KeyRef>> const& keys, bool snapshot ) {
+	cx->transactionLogicalReads += keys.size();
+	++cx->transactionGetValuesRequests;
+
+	Standalone<VectorRef<KeyRef>> readKeys;
+	readKeys.arena().dependsOn(keys.arena());
+	for (const KeyRef& key : keys) {
+		ASSERT(key != metadataVersionKey);
+		//There are no keys in the database with size greater than KEY_SIZE_LIMIT
+		if(key.size() > (key.startsWith(systemKeys.begin) ? CLIENT_KNOBS->SYSTEM_KEY_SIZE_LIMIT : CLIENT_KNOBS->KEY_SIZE_LIMIT))
+			continue;
+
+		readKeys.push_back(readKeys.arena(), key);
+		if( !snapshot )
+			tr.transaction.read_conflict_ranges.push_back(tr.arena, singleKeyRange(key, tr.arena));
+	}
+
+	auto ver = getReadVersion();
+	if (readKeys.empty()) {
+		return map(ver, [](Version) { return Standalone<RangeResultRef>(); });
+	}
+	return getValues( ver, readKeys, cx, info, options.readTags );
+}
+
 void Watch::setWatch(Future<Void> watchFuture) {
 	this->watchFuture = watchFuture;
 
@@ -3174,6 +3594,81 @@ Future< Standalone<RangeResultRef> > Transaction::getRange(
 	return getRange( begin, end, GetRangeLimits( limit ), snapshot, reverse );
 }
 
+Future<Void> Transaction::getRangeStream(
+	const PromiseStream<Standalone<RangeResultRef>>& results,
+	const KeySelector& begin,
+	const KeySelector& end,
+	GetRangeLimits limits,
+	bool snapshot,
+	bool reverse )
+{
+	++cx->transactionLogicalReads;
+	++cx->transactionGetRangeStreamRequests;
+
+	if( limits.isReached() ) {
+		results.sendError(end_of_stream());
+		return Void();
+	}
+
+	if( !limits.isValid() )
+		return range_limits_invalid();
+
+	ASSERT(limits.rows != 0);
+
+	KeySelector b = begin;
+	if( b.orEqual ) {
+		TEST(true); // Native stream begin orEqual==true
+		b.removeOrEqual(b.arena());
+	}
+
+	KeySelector e = end;
+	if( e.orEqual ) {
+		TEST(true); // Native stream end orEqual==true
+		e.removeOrEqual(e.arena());
+	}
+
+	if( b.offset >= e.offset && b.getKey() >= e.getKey() ) {
+		TEST(true); // Native stream range inverted
+		results.sendError(end_of_stream());
+		return Void();
+	}
+
+	Promise<std::pair<Key, Key>> conflictRange;
+	if(!snapshot) {
+		extraConflictRanges.push_back( conflictRange.getFuture() );
+	}
+
+	return ::getRangeStream(results, cx, getReadVersion(), b, e, limits, conflictRange, snapshot, reverse, info, options.readTags);
+}
+
+Future<Standalone<MappedRangeResultRef>> Transaction::getMappedRange(
+	const KeyRange& keys,
+	const Key& mapper,
+	GetRangeLimits limits,
+	bool snapshot,
+	bool reverse )
+{
+	++cx->transactionLogicalReads;
+	++cx->transactionGetMappedRangeRequests;
+
+	if( limits.isReached() || keys.empty() )
+		return Standalone<MappedRangeResultRef>();
+
+	if( !limits.isValid() )
+		return range_limits_invalid();
+
+	ASSERT(limits.rows != 0);
+
+	Promise<std::pair<Key, Key>> conflictRange;
+	Promise<Standalone<VectorRef<KeyRef>>> conflictKeys;
+	if(!snapshot) {
+		extraConflictRanges.push_back( conflictRange.getFuture() );
+		extraConflictKeys.push_back( conflictKeys.getFuture() );
+	}
+
+	return ::getMappedRange(cx, getReadVersion(), keys, mapper, limits, conflictRange, conflictKeys, snapshot, reverse, info, options.readTags);
+}
+
 void Transaction::addReadConflictRange( KeyRangeRef const& keys ) {
 	ASSERT( !keys.empty() );
 
@@ -3391,6 +3886,7 @@ void Transaction::reset() {
 	readVersion = Future<Version>();
 	metadataVersion = Promise<Optional<Key>>();
 	extraConflictRanges.clear();
+	extraConflictKeys.clear();
 	versionstampPromise = Promise<Standalone<StringRef>>();
 	commitResult = Promise<Void>();
 	committing = Future<Void>();
@@ -3840,6 +4336,10 @@ Future<Void> Transaction::commitMutations() {
 			if (extraConflictRanges[i].isReady() && extraConflictRanges[i].get().first < extraConflictRanges[i].get().second )
 				tr.transaction.read_conflict_ranges.emplace_back(tr.arena, extraConflictRanges[i].get().first,
 				                                                 extraConflictRanges[i].get().second);
+		for(int i=0; i<extraConflictKeys.size(); i++)
+			if (extraConflictKeys[i].isReady() && !extraConflictKeys[i].isError())
+				for(const KeyRef& key : extraConflictKeys[i].get())
+					tr.transaction.read_conflict_ranges.push_back(tr.arena, singleKeyRange(key, tr.arena));
 
 		if( !options.causalWriteRisky && !intersects( tr.transaction.write_conflict_ranges, tr.transaction.read_conflict_ranges ).present() )
 			makeSelfConflicting();
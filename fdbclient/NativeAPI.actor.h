@@ -234,6 +234,10 @@ public:
 	Optional<Version> getCachedReadVersion();
 
 	[[nodiscard]] Future<Optional<Value>> get(const Key& key, bool snapshot = false);
+	// Reads many keys with one request per shard rather than one per key, returning the keys which are present with
+	// their values in the order they were given.  The keys must not include metadataVersionKey.
+	[[nodiscard]] Future<Standalone<RangeResultRef>> getValues(Standalone<VectorRef<KeyRef>> const& keys,
+	                                                           bool snapshot = false);
 	[[nodiscard]] Future<Void> watch(Reference<Watch> watch);
 	[[nodiscard]] Future<Key> getKey(const KeySelector& key, bool snapshot = false);
 	//Future< Optional<KeyValue> > get( const KeySelectorRef& key );
@@ -253,6 +257,24 @@ public:
 		                KeySelector(firstGreaterOrEqual(keys.end), keys.arena()), limits, snapshot, reverse);
 	}
 
+	// Streams the results of a range read into `results` as a series of fragments read from the storage servers,
+	// ending the stream with end_of_stream (or the first error encountered)
+	[[nodiscard]] Future<Void> getRangeStream(const PromiseStream<Standalone<RangeResultRef>>& results,
+	                                          const KeySelector& begin, const KeySelector& end, GetRangeLimits limits,
+	                                          bool snapshot = false, bool reverse = false);
+	[[nodiscard]] Future<Void> getRangeStream(const PromiseStream<Standalone<RangeResultRef>>& results,
+	                                          const KeyRange& keys, GetRangeLimits limits, bool snapshot = false,
+	                                          bool reverse = false) {
+		return getRangeStream(results, KeySelector(firstGreaterOrEqual(keys.begin), keys.arena()),
+		                      KeySelector(firstGreaterOrEqual(keys.end), keys.arena()), limits, snapshot, reverse);
+	}
+
+	// Reads the key-value pairs in keys along with, for each of them, the key built from it by mapper (a packed Tuple, see
+	// GetMappedKeyValuesRequest) and that key's value.  The storage servers read the mapped keys which they have themselves.
+	[[nodiscard]] Future<Standalone<MappedRangeResultRef>> getMappedRange(const KeyRange& keys, const Key& mapper,
+	                                                                      GetRangeLimits limits, bool snapshot = false,
+	                                                                      bool reverse = false);
+
 	[[nodiscard]] Future<Standalone<VectorRef<const char*>>> getAddressesForKey(const Key& key);
 
 	void enableCheckWrites();
@@ -344,6 +366,7 @@ private:
 	Future<Version> readVersion;
 	Promise<Optional<Value>> metadataVersion;
 	vector<Future<std::pair<Key, Key>>> extraConflictRanges;
+	vector<Future<Standalone<VectorRef<KeyRef>>>> extraConflictKeys; // Point reads whose keys are known only after reading
 	Promise<Void> commitResult;
 	Future<Void> committing;
 };
@@ -949,6 +949,96 @@ public:
 		return result;
 	}
 
+	// Adds to uncached the keys which can be read from the database but whose values are not known to the iterator
+	template <class Iter>
+	static void findUncachedKeys( ReadYourWritesTransaction* ryw, Iter it, VectorRef<KeyRef> keys, Standalone<VectorRef<KeyRef>>& uncached ) {
+		KeyRef maxKey = ryw->getMaxReadKey();
+		for (const KeyRef& key : keys) {
+			if (key >= maxKey || key == metadataVersionKey)
+				continue;
+			it.skip(key);
+			if (!it.is_kv() && !it.is_empty_range())
+				uncached.push_back(uncached.arena(), key);
+		}
+	}
+
+	// Reads many keys.  The keys whose values are not already known are read from the database together with one
+	// Transaction::getValues() and added to the snapshot cache, after which every key is read as by get(), so that
+	// writes, conflict ranges and special keys are handled exactly as they would be for individual reads.
+	ACTOR static Future<Standalone<RangeResultRef>> getValues( ReadYourWritesTransaction* ryw, Standalone<VectorRef<KeyRef>> keys, bool snapshot ) {
+		state Standalone<VectorRef<KeyRef>> batch;
+		state std::vector<Future<Optional<Value>>> reads;
+		state Standalone<RangeResultRef> result;
+		batch.arena().dependsOn(keys.arena());
+
+		if (ryw->options.readYourWritesDisabled) {
+			state std::vector<Future<Optional<Value>>> unbatched;
+			reads.resize(keys.size());
+			for (int k = 0; k < keys.size(); k++) {
+				if (keys[k] < ryw->getMaxReadKey() && keys[k] != metadataVersionKey) {
+					batch.push_back(batch.arena(), keys[k]);
+				} else {
+					reads[k] = ryw->get(keys[k], snapshot);
+					unbatched.push_back(reads[k]);
+				}
+			}
+
+			state Standalone<RangeResultRef> batched;
+			choose {
+				when(wait(store(batched, ryw->tr.getValues(batch, snapshot)) && waitForAll(unbatched))) {}
+				when(wait(ryw->resetPromise.getFuture())) { throw internal_error(); }
+			}
+
+			result.arena().dependsOn(batched.arena());
+			int d = 0;
+			for (int k = 0; k < keys.size(); k++) {
+				if (reads[k].isValid()) {
+					if (reads[k].get().present())
+						result.push_back_deep(result.arena(), KeyValueRef(keys[k], reads[k].get().get()));
+				} else if (d < batched.size() && batched[d].key == keys[k]) {
+					result.push_back(result.arena(), batched[d++]);
+				}
+			}
+			return result;
+		}
+
+		if (snapshot && ryw->options.snapshotRywEnabled <= 0) {
+			findUncachedKeys(ryw, SnapshotCache::iterator(&ryw->cache, &ryw->writes), keys, batch);
+		} else {
+			findUncachedKeys(ryw, RYWIterator(&ryw->cache, &ryw->writes), keys, batch);
+		}
+
+		if (batch.size()) {
+			choose {
+				when(Standalone<RangeResultRef> values = wait(ryw->tr.getValues(batch, true))) {
+					int d = 0;
+					for (const KeyRef& key : batch) {
+						KeyRef k( ryw->arena, key );
+						if (d < values.size() && values[d].key == key) {
+							if( ryw->cache.insert( k, values[d].value ) )
+								ryw->arena.dependsOn( values.arena() );
+							d++;
+						} else {
+							ryw->cache.insert( k, Optional<ValueRef>() );
+						}
+					}
+				}
+				when(wait(ryw->resetPromise.getFuture())) { throw internal_error(); }
+			}
+		}
+
+		for (const KeyRef& key : keys) {
+			reads.push_back(ryw->get(key, snapshot));
+		}
+		wait(waitForAll(reads));
+
+		for (int k = 0; k < keys.size(); k++) {
+			if (reads[k].get().present())
+				result.push_back_deep(result.arena(), KeyValueRef(keys[k], reads[k].get().get()));
+		}
+		return result;
+	}
+
 	static void triggerWatches(ReadYourWritesTransaction *ryw, KeyRangeRef range, Optional<ValueRef> val, bool valueKnown = true) {
 		for(auto it = ryw->watchMap.lower_bound(range.begin); it != ryw->watchMap.end() && it->key < range.end; ) {
 			auto itCopy = it;
@@ -1403,6 +1493,21 @@ Future<int64_t> ReadYourWritesTransaction::getEstimatedRangeSizeBytes(const KeyR
 	return map(waitOrError(tr.getStorageMetrics(keys, -1), resetPromise.getFuture()), [](const StorageMetrics& m) { return m.bytes; });
 }
 
+Future<Standalone<RangeResultRef>> ReadYourWritesTransaction::getValues( Standalone<VectorRef<KeyRef>> const& keys, bool snapshot ) {
+	TEST(true); // ReadYourWritesTransaction::getValues
+
+	if(checkUsedDuringCommit()) {
+		return used_during_commit();
+	}
+
+	if( resetPromise.isSet() )
+		return resetPromise.getFuture().getError();
+
+	Future<Standalone<RangeResultRef>> result = RYWImpl::getValues( this, keys, snapshot );
+	reading.add( success( result ) );
+	return result;
+}
+
 Future<Standalone<VectorRef<KeyRef>>> ReadYourWritesTransaction::getRangeSplitPoints(const KeyRange& range,
                                                                                      int64_t chunkSize) {
 	if (checkUsedDuringCommit()) {
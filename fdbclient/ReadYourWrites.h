@@ -75,6 +75,7 @@ public:
 	Future<Version> getReadVersion();
 	Optional<Version> getCachedReadVersion() { return tr.getCachedReadVersion(); }
 	Future< Optional<Value> > get( const Key& key, bool snapshot = false );
+	Future< Standalone<RangeResultRef> > getValues( Standalone<VectorRef<KeyRef>> const& keys, bool snapshot = false );
 	Future< Key > getKey( const KeySelector& key, bool snapshot = false );
 	Future< Standalone<RangeResultRef> > getRange( const KeySelector& begin, const KeySelector& end, int limit, bool snapshot = false, bool reverse = false );
 	Future< Standalone<RangeResultRef> > getRange( KeySelector begin, KeySelector end, GetRangeLimits limits, bool snapshot = false, bool reverse = false );
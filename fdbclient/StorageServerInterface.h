@@ -73,6 +73,14 @@ struct StorageServerInterface {
 	RequestStream<struct WatchValueRequest> watchValue;
 	RequestStream<struct ReadHotSubRangeRequest> getReadHotRanges;
 	RequestStream<struct SplitRangeRequest> getRangeSplitPoints;
+	RequestStream<struct GetKeyValuesStreamRequest> getKeyValuesStream;
+
+	// Throws a wrong_shard_server if any of the keys in the request is not served by this server
+	RequestStream<struct GetValuesRequest> getValues;
+
+	// Throws a wrong_shard_server if the range in the request is not entirely served by this server.  Mapped keys which
+	// this server does not serve are returned unread rather than failing the request.
+	RequestStream<struct GetMappedKeyValuesRequest> getMappedKeyValues;
 
 	explicit StorageServerInterface(UID uid) : uniqueID( uid ) {}
 	StorageServerInterface() : uniqueID( deterministicRandom()->randomUniqueID() ) {}
@@ -101,6 +109,9 @@ struct StorageServerInterface {
 				watchValue = RequestStream<struct WatchValueRequest>( getValue.getEndpoint().getAdjustedEndpoint(10) );
 				getReadHotRanges = RequestStream<struct ReadHotSubRangeRequest>( getValue.getEndpoint().getAdjustedEndpoint(11) );
 				getRangeSplitPoints = RequestStream<struct SplitRangeRequest>(getValue.getEndpoint().getAdjustedEndpoint(12));
+				getKeyValuesStream = RequestStream<struct GetKeyValuesStreamRequest>(getValue.getEndpoint().getAdjustedEndpoint(13));
+				getValues = RequestStream<struct GetValuesRequest>(getValue.getEndpoint().getAdjustedEndpoint(14));
+				getMappedKeyValues = RequestStream<struct GetMappedKeyValuesRequest>(getValue.getEndpoint().getAdjustedEndpoint(15));
 			}
 		} else {
 			ASSERT(Ar::isDeserializing);
@@ -129,6 +140,9 @@ struct StorageServerInterface {
 		streams.push_back(watchValue.getReceiver());
 		streams.push_back(getReadHotRanges.getReceiver());
 		streams.push_back(getRangeSplitPoints.getReceiver());
+		streams.push_back(getKeyValuesStream.getReceiver(TaskPriority::LoadBalancedEndpoint));
+		streams.push_back(getValues.getReceiver(TaskPriority::LoadBalancedEndpoint));
+		streams.push_back(getMappedKeyValues.getReceiver(TaskPriority::LoadBalancedEndpoint));
 		FlowTransport::transport().addEndpoints(streams);
 	}
 };
@@ -190,6 +204,42 @@ struct GetValueRequest : TimedRequest {
 	}
 };
 
+// The values of the keys in a GetValuesRequest which are present, in the order of the request's keys
+struct GetValuesReply : public LoadBalancedReply {
+	constexpr static FileIdentifier file_identifier = 9403562;
+	Arena arena;
+	VectorRef<KeyValueRef, VecSerStrategy::String> data;
+	bool cached;
+
+	GetValuesReply() : cached(false) {}
+
+	template <class Ar>
+	void serialize( Ar& ar ) {
+		serializer(ar, LoadBalancedReply::penalty, LoadBalancedReply::error, data, cached, arena);
+	}
+};
+
+struct GetValuesRequest : TimedRequest {
+	constexpr static FileIdentifier file_identifier = 5720198;
+	SpanID spanContext;
+	Arena arena;
+	VectorRef<KeyRef> keys;
+	Version version;
+	Optional<TagSet> tags;
+	Optional<UID> debugID;
+	ReplyPromise<GetValuesReply> reply;
+
+	GetValuesRequest(){}
+	GetValuesRequest(SpanID spanContext, VectorRef<KeyRef> keys, Version ver, Optional<TagSet> tags,
+	                 Optional<UID> debugID, Arena& arena)
+	  : spanContext(spanContext), arena(arena), keys(keys), version(ver), tags(tags), debugID(debugID) {}
+
+	template <class Ar>
+	void serialize( Ar& ar ) {
+		serializer(ar, keys, version, tags, debugID, reply, spanContext, arena);
+	}
+};
+
 struct WatchValueReply {
 	constexpr static FileIdentifier file_identifier = 3;
 
@@ -260,6 +310,83 @@ struct GetKeyValuesRequest : TimedRequest {
 	}
 };
 
+struct GetMappedKeyValuesReply : public LoadBalancedReply {
+	constexpr static FileIdentifier file_identifier = 3187624;
+	Arena arena;
+	VectorRef<MappedKeyValueRef> data;
+	Version version; // useful when latestVersion was requested
+	bool more;
+	bool cached = false;
+
+	GetMappedKeyValuesReply() : version(invalidVersion), more(false), cached(false) {}
+
+	template <class Ar>
+	void serialize( Ar& ar ) {
+		serializer(ar, LoadBalancedReply::penalty, LoadBalancedReply::error, data, version, more, cached, arena);
+	}
+};
+
+// Reads the key-value pairs in keys, as GetKeyValuesRequest does, and for each one also reads the key built from it by
+// the mapper.  The mapper is a packed Tuple whose string elements "{K[n]}" and "{V[n]}" are replaced by the n-th element
+// of the key or value read (which must themselves be packed Tuples); every other element is copied as it is.
+struct GetMappedKeyValuesRequest : TimedRequest {
+	constexpr static FileIdentifier file_identifier = 9814273;
+	SpanID spanContext;
+	Arena arena;
+	KeyRangeRef keys;
+	KeyRef mapper;
+	Version version;		// or latestVersion
+	int limit, limitBytes;	// limits on the key-value pairs read from keys; a negative limit reads in reverse
+	Optional<TagSet> tags;
+	Optional<UID> debugID;
+	ReplyPromise<GetMappedKeyValuesReply> reply;
+
+	GetMappedKeyValuesRequest() {}
+	template <class Ar>
+	void serialize( Ar& ar ) {
+		serializer(ar, keys, mapper, version, limit, limitBytes, tags, debugID, reply, spanContext, arena);
+	}
+};
+
+struct GetKeyValuesStreamReply : public ReplyPromiseStreamReply {
+	constexpr static FileIdentifier file_identifier = 2536515;
+	Arena arena;
+	VectorRef<KeyValueRef, VecSerStrategy::String> data;
+	Version version; // useful when latestVersion was requested
+	bool more;
+	bool cached = false;
+
+	GetKeyValuesStreamReply() : version(invalidVersion), more(false), cached(false) {}
+	GetKeyValuesStreamReply(GetKeyValuesReply r)
+	  : arena(r.arena), data(r.data), version(r.version), more(r.more), cached(r.cached) {}
+
+	int expectedSize() const { return sizeof(GetKeyValuesStreamReply) + data.expectedSize(); }
+
+	template <class Ar>
+	void serialize(Ar& ar) {
+		serializer(ar, ReplyPromiseStreamReply::acknowledgeToken, data, version, more, cached, arena);
+	}
+};
+
+struct GetKeyValuesStreamRequest {
+	constexpr static FileIdentifier file_identifier = 13357963;
+	SpanID spanContext;
+	Arena arena;
+	KeySelectorRef begin, end;
+	Version version; // or latestVersion
+	int limit, limitBytes;
+	bool isFetchKeys;
+	Optional<TagSet> tags;
+	Optional<UID> debugID;
+	ReplyPromiseStream<GetKeyValuesStreamReply> reply;
+
+	GetKeyValuesStreamRequest() : isFetchKeys(false) {}
+	template <class Ar>
+	void serialize(Ar& ar) {
+		serializer(ar, begin, end, version, limit, limitBytes, isFetchKeys, tags, debugID, reply, spanContext, arena);
+	}
+};
+
 struct GetKeyReply : public LoadBalancedReply {
 	constexpr static FileIdentifier file_identifier = 11226513;
 	KeySelector sel;
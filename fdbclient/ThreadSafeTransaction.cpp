@@ -170,6 +170,17 @@ ThreadFuture< Optional<Value> > ThreadSafeTransaction::get( const KeyRef& key, b
 		} );
 }
 
+ThreadFuture< Standalone<RangeResultRef> > ThreadSafeTransaction::getValues( const VectorRef<KeyRef>& keys, bool snapshot ) {
+	Standalone<VectorRef<KeyRef>> k;
+	k.append_deep(k.arena(), keys.begin(), keys.size());
+
+	ReadYourWritesTransaction *tr = this->tr;
+	return onMainThread( [tr, k, snapshot]() -> Future< Standalone<RangeResultRef> > {
+			tr->checkDeferredError();
+			return tr->getValues(k, snapshot);
+		} );
+}
+
 ThreadFuture< Key > ThreadSafeTransaction::getKey( const KeySelectorRef& key, bool snapshot ) {
 	KeySelector k = key;
 
@@ -64,6 +64,7 @@ public:
 	ThreadFuture<Version> getReadVersion() override;
 
 	ThreadFuture< Optional<Value> > get( const KeyRef& key, bool snapshot = false ) override;
+	ThreadFuture< Standalone<RangeResultRef> > getValues( const VectorRef<KeyRef>& keys, bool snapshot = false ) override;
 	ThreadFuture< Key > getKey( const KeySelectorRef& key, bool snapshot = false ) override;
 	ThreadFuture< Standalone<RangeResultRef> > getRange( const KeySelectorRef& begin, const KeySelectorRef& end, int limit, bool snapshot = false, bool reverse = false ) override;
 	ThreadFuture< Standalone<RangeResultRef> > getRange( const KeySelectorRef& begin, const KeySelectorRef& end, GetRangeLimits limits, bool snapshot = false, bool reverse = false ) override;
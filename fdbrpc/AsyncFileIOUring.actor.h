@@ -0,0 +1,699 @@
+/*
+ * AsyncFileIOUring.actor.h
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2018 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define HAVE_IO_URING 1
+
+// When actually compiled (NO_INTELLISENSE), include the generated version of this file.  In intellisense use the source version.
+#if defined(NO_INTELLISENSE) && !defined(FLOW_ASYNCFILEIOURING_ACTOR_G_H)
+	#define FLOW_ASYNCFILEIOURING_ACTOR_G_H
+	#include "fdbrpc/AsyncFileIOUring.actor.g.h"
+#elif !defined(FLOW_ASYNCFILEIOURING_ACTOR_H)
+	#define FLOW_ASYNCFILEIOURING_ACTOR_H
+
+#include "fdbrpc/IAsyncFile.h"
+#include "fdbrpc/AsyncFileEIO.actor.h"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include "fdbrpc/linux_io_uring.h"
+#include "flow/Knobs.h"
+#include "flow/UnitTest.h"
+#include "flow/genericactors.actor.h"
+#include "flow/actorcompiler.h"  // This must be the last #include.
+
+// An IAsyncFile which does its reads, writes and syncs through an io_uring owned by the network thread.
+// I/Os queued during a run loop iteration are submitted together with one io_uring_enter() from the run cycle
+// function, and completions are reaped from the shared completion ring at the start of every iteration without a
+// system call.  The reactor's eventfd is registered with the ring only so that completions can wake an idle run loop.
+// Unlike AsyncFileKAIO, files need not be opened with O_DIRECT, and sync() is also done through the ring.
+class AsyncFileIOUring final : public IAsyncFile, public ReferenceCounted<AsyncFileIOUring> {
+public:
+	static Future<Reference<IAsyncFile>> open( std::string filename, int flags, int mode, void* ignore ) {
+		ASSERT( isEnabled() );
+
+		if (flags & OPEN_LOCK)
+			mode |= 02000;  // Enable mandatory locking for this file if it is supported by the filesystem
+
+		std::string open_filename = filename;
+		if (flags & OPEN_ATOMIC_WRITE_AND_CREATE) {
+			ASSERT( (flags & OPEN_CREATE) && (flags & OPEN_READWRITE) && !(flags & OPEN_EXCLUSIVE) );
+			open_filename = filename + ".part";
+		}
+
+		int fd = ::open( open_filename.c_str(), openFlags(flags), mode );
+		if (fd<0) {
+			Error e = errno==ENOENT ? file_not_found() : io_error();
+			TraceEvent("AsyncFileIOUringOpenFailed")
+				.error(e).detail("Filename", filename).detailf("Flags", "%x", flags)
+				.detailf("OSFlags", "%x", openFlags(flags)).detailf("Mode", "0%o", mode).GetLastError();
+			return e;
+		}
+
+		Reference<AsyncFileIOUring> r(new AsyncFileIOUring( fd, flags, filename ));
+		TraceEvent("AsyncFileIOUringOpen")
+			.detail("Filename", filename)
+			.detail("Flags", flags)
+			.detail("Mode", mode)
+			.detail("Fd", fd)
+			.detail("RegisteredFile", r->fixedIndex);
+
+		if (flags & OPEN_LOCK) {
+			// Acquire a "write" lock for the entire file
+			flock lockDesc;
+			lockDesc.l_type = F_WRLCK;
+			lockDesc.l_whence = SEEK_SET;
+			lockDesc.l_start = 0;
+			lockDesc.l_len = 0;
+			lockDesc.l_pid = 0;
+			if (fcntl(fd, F_SETLK, &lockDesc) == -1) {
+				TraceEvent(SevError, "UnableToLockFile").detail("Filename", filename).GetLastError();
+				return io_error();
+			}
+		}
+
+		struct stat buf;
+		if (fstat( fd, &buf )) {
+			TraceEvent("AsyncFileIOUringFStatError").detail("Fd",fd).detail("Filename", filename).GetLastError();
+			return io_error();
+		}
+
+		r->lastFileSize = r->nextFileSize = buf.st_size;
+		return Reference<IAsyncFile>(std::move(r));
+	}
+
+	// Sets up the ring and makes AsyncFileIOUring::launch the run cycle function.  Returns false, leaving io_uring
+	// disabled, if the kernel does not support it.
+	static bool init( Reference<IEventFD> ev, double ioTimeout ) {
+		ASSERT( !g_network->isSimulated() );
+		if (!ctx.ring.init(FLOW_KNOBS->IO_URING_QUEUE_DEPTH)) {
+			TraceEvent(SevWarnAlways, "IOUringUnavailable").GetLastError();
+			return false;
+		}
+
+		int evfd = ev->getFD();
+		if (io_uring_register(ctx.ring.fd, IORING_REGISTER_EVENTFD, &evfd, 1) < 0) {
+			TraceEvent(SevWarnAlways, "IOUringUnavailable").detail("Reason", "RegisterEventFD").GetLastError();
+			ctx.ring.close();
+			return false;
+		}
+
+		// Registered files save the kernel from looking up and reference counting the file for every I/O.  Slots
+		// start out empty and are filled in as files are opened.
+		ctx.fixedFiles.assign(FLOW_KNOBS->IO_URING_REGISTERED_FILES, -1);
+		if (ctx.fixedFiles.size() &&
+		    io_uring_register(ctx.ring.fd, IORING_REGISTER_FILES, ctx.fixedFiles.data(), ctx.fixedFiles.size()) < 0) {
+			TraceEvent(SevWarn, "IOUringRegisterFilesFailed").GetLastError();
+			ctx.fixedFiles.clear();
+		}
+
+		ctx.countSubmit.init(LiteralStringRef("AsyncFile.CountIOUringSubmit"));
+		ctx.countCollect.init(LiteralStringRef("AsyncFile.CountIOUringCollect"));
+		setTimeout(ioTimeout);
+		poll(ev);
+
+		g_network->setGlobal(INetwork::enRunCycleFunc, (flowGlobalType) &AsyncFileIOUring::launch);
+
+		TraceEvent("IOUringInit").detail("Entries", ctx.ring.entries).detail("RegisteredFiles", ctx.fixedFiles.size());
+		return true;
+	}
+
+	static bool isEnabled() { return ctx.ring.fd >= 0; }
+	static void setTimeout(double ioTimeout) { ctx.setIOTimeout(ioTimeout); }
+
+	void addref() override { ReferenceCounted<AsyncFileIOUring>::addref(); }
+	void delref() override { ReferenceCounted<AsyncFileIOUring>::delref(); }
+
+	Future<int> read(void* data, int length, int64_t offset) override {
+		++countFileLogicalReads;
+		++countLogicalReads;
+
+		if(failed) {
+			return io_timeout();
+		}
+
+		IOBlock *io = new IOBlock(IORING_OP_READV, this);
+		io->iov.iov_base = data;
+		io->iov.iov_len = length;
+		io->offset = offset;
+
+		enqueue(io);
+		return io->result.getFuture();
+	}
+	Future<Void> write(void const* data, int length, int64_t offset) override {
+		++countFileLogicalWrites;
+		++countLogicalWrites;
+
+		if(failed) {
+			return io_timeout();
+		}
+
+		IOBlock *io = new IOBlock(IORING_OP_WRITEV, this);
+		io->iov.iov_base = (void*)data;
+		io->iov.iov_len = length;
+		io->offset = offset;
+
+		nextFileSize = std::max( nextFileSize, offset+length );
+
+		enqueue(io);
+		return success(io->result.getFuture());
+	}
+#ifndef FALLOC_FL_ZERO_RANGE
+#define FALLOC_FL_ZERO_RANGE 0x10
+#endif
+	Future<Void> zeroRange(int64_t offset, int64_t length) override {
+		bool success = false;
+		if (ctx.fallocateZeroSupported) {
+			int rc = fallocate( fd, FALLOC_FL_ZERO_RANGE, offset, length );
+			if (rc == EOPNOTSUPP) {
+				ctx.fallocateZeroSupported = false;
+			}
+			if (rc == 0) {
+				success = true;
+			}
+		}
+		return success ? Void() : IAsyncFile::zeroRange(offset, length);
+	}
+	Future<Void> truncate(int64_t size) override {
+		++countFileLogicalWrites;
+		++countLogicalWrites;
+
+		if(failed) {
+			return io_timeout();
+		}
+
+		int result = -1;
+		bool completed = false;
+
+		if( ctx.fallocateSupported && size >= lastFileSize ) {
+			result = fallocate( fd, 0, 0, size);
+			if (result != 0) {
+				int fallocateErrCode = errno;
+				TraceEvent("AsyncFileIOUringAllocateError").detail("Fd",fd).detail("Filename", filename).detail("Size", size).GetLastError();
+				if ( fallocateErrCode == EOPNOTSUPP ) {
+					// Mark fallocate as unsupported. Try again with truncate.
+					ctx.fallocateSupported = false;
+				} else {
+					return io_error();
+				}
+			} else {
+				completed = true;
+			}
+		}
+		if ( !completed )
+			result = ftruncate(fd, size);
+
+		if(result != 0) {
+			TraceEvent("AsyncFileIOUringTruncateError").detail("Fd",fd).detail("Filename", filename).GetLastError();
+			return io_error();
+		}
+
+		lastFileSize = nextFileSize = size;
+
+		return Void();
+	}
+
+	Future<Void> sync() override {
+		++countFileLogicalWrites;
+		++countLogicalWrites;
+
+		if(failed) {
+			return io_timeout();
+		}
+
+		// Like AsyncFileKAIO, this covers the writes which have completed, not ones which are still queued
+		IOBlock *io = new IOBlock(IORING_OP_FSYNC, this);
+		io->fsyncFlags = IORING_FSYNC_DATASYNC;
+
+		enqueue(io);
+		Future<Void> fsync = success(io->result.getFuture());
+
+		if (flags & OPEN_ATOMIC_WRITE_AND_CREATE) {
+			flags &= ~OPEN_ATOMIC_WRITE_AND_CREATE;
+
+			return AsyncFileEIO::waitAndAtomicRename( fsync, filename+".part", filename );
+		}
+
+		return fsync;
+	}
+	Future<int64_t> size() const override { return nextFileSize; }
+	int64_t debugFD() const override { return fd; }
+	std::string getFilename() const override { return filename; }
+	~AsyncFileIOUring() override {
+		if (fixedIndex >= 0) {
+			unregisterFile(fixedIndex);
+		}
+		close(fd);
+	}
+
+	// Reaps completions, then prepares as many queued I/Os as the ring has room for and submits them all at once.
+	// Sqes the kernel did not accept last time are submitted again even if nothing new was prepared.
+	static void launch() {
+		reap();
+
+		double begin = timer_monotonic();
+		bool prepared = false;
+		while (!ctx.queue.empty() && ctx.outstanding < ctx.ring.entries) {
+			io_uring_sqe* sqe = ctx.ring.getSqe();
+			if (!sqe) break;
+
+			if (!prepared && !ctx.outstanding) ctx.ioStallBegin = begin;
+			prepared = true;
+
+			IOBlock* io = ctx.queue.top();
+			ctx.queue.pop();
+			io->startTime = now();
+
+			if(ctx.ioTimeout > 0) {
+				ctx.appendToRequestList(io);
+			}
+
+			if (io->opcode == IORING_OP_WRITEV && io->owner->lastFileSize != io->owner->nextFileSize) {
+				io->owner->truncate(io->owner->nextFileSize);
+			}
+
+			io->prepare(sqe);
+			++ctx.outstanding;
+		}
+
+		// Submits nothing, without a system call, if there are no prepared sqes
+		int rc = ctx.ring.submit();
+		if (rc == -EAGAIN || rc == -EBUSY) {
+			// Prepared sqes the kernel did not accept stay in the submission ring and are submitted next time
+			TEST(true); // io_uring submission deferred
+		} else if (rc < 0) {
+			// The kernel consumed none of the prepared sqes and never will, so fail their I/Os now
+			TraceEvent(SevWarnAlways, "IOUringSubmitError").detail("Errno", -rc);
+			ctx.ring.unprepare([rc](io_uring_sqe* sqe) {
+				IOBlock* io = (IOBlock*)sqe->user_data;
+				if(ctx.ioTimeout > 0) {
+					ctx.removeFromRequestList(io);
+				}
+				--ctx.outstanding;
+				io->setResult(rc);
+			});
+		}
+		if (!prepared && rc == 0) {
+			return;
+		}
+		++ctx.countSubmit;
+
+		double elapsed = timer_monotonic() - begin;
+		g_network->networkInfo.metrics.secSquaredSubmit += elapsed*elapsed/2;
+	}
+
+	bool failed;
+private:
+	int fd, flags;
+	int fixedIndex;  // Index of fd in the ring's registered files, or -1
+	int64_t lastFileSize, nextFileSize;
+	std::string filename;
+	Int64MetricHandle countFileLogicalWrites;
+	Int64MetricHandle countFileLogicalReads;
+
+	Int64MetricHandle countLogicalWrites;
+	Int64MetricHandle countLogicalReads;
+
+	struct IOBlock : FastAllocated<IOBlock> {
+		uint8_t opcode;
+		iovec iov;
+		int64_t offset;
+		uint32_t fsyncFlags;
+		Promise<int> result;
+		Reference<AsyncFileIOUring> owner;
+		int64_t prio;
+		IOBlock *prev;
+		IOBlock *next;
+		double startTime;
+
+		struct indirect_order_by_priority { bool operator () ( IOBlock* a, IOBlock* b ) { return a->prio < b->prio; } };
+
+		IOBlock(uint8_t opcode, AsyncFileIOUring* owner)
+		  : opcode(opcode), offset(0), fsyncFlags(0), owner(Reference<AsyncFileIOUring>::addRef(owner)), prev(nullptr),
+		    next(nullptr), startTime(0) {
+			iov.iov_base = nullptr;
+			iov.iov_len = 0;
+		}
+
+		TaskPriority getTask() const { return static_cast<TaskPriority>((prio>>32)+1); }
+
+		void prepare(io_uring_sqe* sqe) {
+			sqe->opcode = opcode;
+			if (owner->fixedIndex >= 0) {
+				sqe->fd = owner->fixedIndex;
+				sqe->flags |= IOSQE_FIXED_FILE;
+			} else {
+				sqe->fd = owner->fd;
+			}
+			if (opcode == IORING_OP_FSYNC) {
+				sqe->fsync_flags = fsyncFlags;
+			} else {
+				sqe->addr = (uint64_t)&iov;
+				sqe->len = 1;
+				sqe->off = offset;
+			}
+			sqe->user_data = (uint64_t)this;
+		}
+
+		ACTOR static void deliver( Promise<int> result, bool failed, int r, TaskPriority task ) {
+			wait( delay(0, task) );
+			if (failed) result.sendError(io_timeout());
+			else if (r < 0) result.sendError(io_error());
+			else result.send(r);
+		}
+
+		void setResult( int r ) {
+			if (r<0) {
+				errno = -r;
+				TraceEvent("AsyncFileIOUringIOError").GetLastError().detail("Fd", owner->fd).detail("Op", opcode)
+					.detail("Nbytes", iov.iov_len).detail("Offset", offset).detail("Ptr", int64_t(iov.iov_base))
+					.detail("Filename", owner->filename);
+			}
+			deliver( result, owner->failed, r, getTask() );
+			delete this;
+		}
+
+		void timeout(bool warnOnly) {
+			TraceEvent(SevWarnAlways, "AsyncFileIOUringTimeout").detail("Fd", owner->fd).detail("Op", opcode)
+				.detail("Nbytes", iov.iov_len).detail("Offset", offset).detail("Ptr", int64_t(iov.iov_base))
+				.detail("Filename", owner->filename);
+			g_network->setGlobal(INetwork::enASIOTimedOut, (flowGlobalType)true);
+
+			if(!warnOnly)
+				owner->failed = true;
+		}
+	};
+
+	struct Context {
+		linux_io_uring ring;
+		std::vector<int> fixedFiles;  // fd registered in each slot, or -1
+		int outstanding;
+		double ioStallBegin;
+		bool fallocateSupported;
+		bool fallocateZeroSupported;
+		std::priority_queue<IOBlock*, std::vector<IOBlock*>, IOBlock::indirect_order_by_priority> queue;
+		Int64MetricHandle countSubmit;
+		Int64MetricHandle countCollect;
+
+		double ioTimeout;
+		bool timeoutWarnOnly;
+		IOBlock *submittedRequestList;
+
+		uint32_t opsIssued;
+		Context() : outstanding(0), ioStallBegin(0), fallocateSupported(true), fallocateZeroSupported(true), submittedRequestList(nullptr), opsIssued(0) {
+			setIOTimeout(0);
+		}
+
+		void setIOTimeout(double timeout) {
+			ioTimeout = fabs(timeout);
+			timeoutWarnOnly = timeout < 0;
+		}
+
+		void appendToRequestList(IOBlock *io) {
+			ASSERT(!io->next && !io->prev);
+
+			if(submittedRequestList) {
+				io->prev = submittedRequestList->prev;
+				io->prev->next = io;
+
+				submittedRequestList->prev = io;
+				io->next = submittedRequestList;
+			}
+			else {
+				submittedRequestList = io;
+				io->next = io->prev = io;
+			}
+		}
+
+		void removeFromRequestList(IOBlock *io) {
+			if(io->next == nullptr) {
+				ASSERT(io->prev == nullptr);
+				return;
+			}
+
+			ASSERT(io->prev != nullptr);
+
+			if(io == io->next) {
+				ASSERT(io == submittedRequestList && io == io->prev);
+				submittedRequestList = nullptr;
+			}
+			else {
+				io->next->prev = io->prev;
+				io->prev->next = io->next;
+
+				if(submittedRequestList == io) {
+					submittedRequestList = io->next;
+				}
+			}
+
+			io->next = io->prev = nullptr;
+		}
+	};
+	static Context ctx;
+
+	explicit AsyncFileIOUring(int fd, int flags, std::string const& filename)
+	  : fd(fd), flags(flags), fixedIndex(registerFile(fd)), filename(filename), failed(false) {
+		countFileLogicalWrites.init(LiteralStringRef("AsyncFile.CountFileLogicalWrites"), filename);
+		countFileLogicalReads.init( LiteralStringRef("AsyncFile.CountFileLogicalReads"), filename);
+		countLogicalWrites.init(LiteralStringRef("AsyncFile.CountLogicalWrites"));
+		countLogicalReads.init( LiteralStringRef("AsyncFile.CountLogicalReads"));
+	}
+
+	// Returns the registered file slot now holding fd, or -1 if there is none free
+	static int registerFile(int fd) {
+		for (int i = 0; i < ctx.fixedFiles.size(); ++i) {
+			if (ctx.fixedFiles[i] == -1) {
+				io_uring_files_update update;
+				memset(&update, 0, sizeof(update));
+				update.offset = i;
+				update.fds = (uint64_t)&fd;
+				if (io_uring_register(ctx.ring.fd, IORING_REGISTER_FILES_UPDATE, &update, 1) != 1) {
+					return -1;
+				}
+				ctx.fixedFiles[i] = fd;
+				return i;
+			}
+		}
+		return -1;
+	}
+
+	static void unregisterFile(int index) {
+		int fd = -1;
+		io_uring_files_update update;
+		memset(&update, 0, sizeof(update));
+		update.offset = index;
+		update.fds = (uint64_t)&fd;
+		io_uring_register(ctx.ring.fd, IORING_REGISTER_FILES_UPDATE, &update, 1);
+		ctx.fixedFiles[index] = -1;
+	}
+
+	void enqueue( IOBlock* io ) {
+		if (flags & OPEN_UNBUFFERED) {
+			ASSERT( int64_t(io->iov.iov_base) % 4096 == 0 && io->offset % 4096 == 0 && io->iov.iov_len % 4096 == 0 );
+		}
+
+		io->prio = (int64_t(g_network->getCurrentTask())<<32) - (++ctx.opsIssued);
+		ctx.queue.push(io);
+	}
+
+	static int openFlags(int flags) {
+		int oflags = O_CLOEXEC;
+		ASSERT( bool(flags & OPEN_READONLY) != bool(flags & OPEN_READWRITE) );  // readonly xor readwrite
+		if( flags & OPEN_UNBUFFERED ) oflags |= O_DIRECT;
+		if( flags & OPEN_EXCLUSIVE ) oflags |= O_EXCL;
+		if( flags & OPEN_CREATE )    oflags |= O_CREAT;
+		if( flags & OPEN_READONLY )  oflags |= O_RDONLY;
+		if( flags & OPEN_READWRITE ) oflags |= O_RDWR;
+		if( flags & OPEN_ATOMIC_WRITE_AND_CREATE ) oflags |= O_TRUNC;
+		return oflags;
+	}
+
+	static void reap() {
+		int n = ctx.ring.reap([](io_uring_cqe* cqe) {
+			IOBlock* io = (IOBlock*)cqe->user_data;
+			if(ctx.ioTimeout > 0) {
+				ctx.removeFromRequestList(io);
+			}
+			io->setResult(cqe->res);
+		});
+
+		if (n) {
+			++ctx.countCollect;
+			double t = timer_monotonic();
+			double elapsed = t - ctx.ioStallBegin;
+			ctx.ioStallBegin = t;
+			g_network->networkInfo.metrics.secSquaredDiskStall += elapsed*elapsed/2;
+			ctx.outstanding -= n;
+		}
+
+		if(ctx.ioTimeout > 0) {
+			double currentTime = now();
+			while(ctx.submittedRequestList && currentTime - ctx.submittedRequestList->startTime > ctx.ioTimeout) {
+				ctx.submittedRequestList->timeout(ctx.timeoutWarnOnly);
+				ctx.removeFromRequestList(ctx.submittedRequestList);
+			}
+		}
+	}
+
+	// Wakes up the run loop when completions arrive while it is idle
+	ACTOR static void poll( Reference<IEventFD> ev ) {
+		loop {
+			wait(success(ev->read()));
+			wait(delay(0, TaskPriority::DiskIOComplete));
+			reap();
+		}
+	}
+};
+
+TEST_CASE("/fdbrpc/AsyncFileIOUring/ReadWrite") {
+	// This test does nothing in simulation or when io_uring is not enabled
+	if (!g_network->isSimulated() && AsyncFileIOUring::isEnabled()) {
+		state Reference<IAsyncFile> f;
+		state void* buf = FastAllocator<4096>::allocate();
+		state void* readBuf = FastAllocator<4096>::allocate();
+		try {
+			Reference<IAsyncFile> f_ = wait(AsyncFileIOUring::open(
+			    "/tmp/__IO_URING_TEST_FILE__",
+			    IAsyncFile::OPEN_UNBUFFERED | IAsyncFile::OPEN_READWRITE | IAsyncFile::OPEN_CREATE, 0666, nullptr));
+			f = f_;
+
+			state int i;
+			state std::vector<Future<Void>> writes;
+			for (i = 0; i < 64; ++i) {
+				memset(buf, i, 4096);
+				writes.push_back(f->write(buf, 4096, i * 4096));
+				// Each write must be issued before buf is reused
+				wait(writes.back());
+			}
+			wait(f->sync());
+
+			for (i = 0; i < 64; ++i) {
+				int n = wait(f->read(readBuf, 4096, i * 4096));
+				ASSERT(n == 4096);
+				ASSERT(((uint8_t*)readBuf)[0] == i && ((uint8_t*)readBuf)[4095] == i);
+			}
+			int64_t size = wait(f->size());
+			ASSERT(size == 64 * 4096);
+		} catch (Error& e) {
+			state Error err = e;
+			FastAllocator<4096>::release(buf);
+			FastAllocator<4096>::release(readBuf);
+			if(f) {
+				wait(AsyncFileEIO::deleteFile(f->getFilename(), true));
+			}
+			throw err;
+		}
+
+		FastAllocator<4096>::release(buf);
+		FastAllocator<4096>::release(readBuf);
+		wait(AsyncFileEIO::deleteFile(f->getFilename(), true));
+	}
+
+	return Void();
+}
+
+TEST_CASE("/fdbrpc/AsyncFileIOUring/Ring") {
+	// Drives a ring of its own rather than the network thread's, so this runs wherever the kernel supports io_uring,
+	// in simulation and with ENABLE_IO_URING off
+	linux_io_uring ring;
+	if (!ring.init(4)) {
+		return Void();
+	}
+	int fd = ::open("/tmp", O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+	if (fd < 0) {
+		return Void();
+	}
+
+	std::vector<std::string> bufs;
+	std::vector<iovec> iovs(ring.entries);
+	for (int i = 0; i < ring.entries; i++) {
+		bufs.push_back(std::string(64, 'a' + i));
+	}
+	auto prepareAll = [&](uint8_t opcode) {
+		for (int i = 0; i < ring.entries; i++) {
+			io_uring_sqe* sqe = ring.getSqe();
+			ASSERT(sqe);
+			iovs[i].iov_base = &bufs[i][0];
+			iovs[i].iov_len = bufs[i].size();
+			sqe->opcode = opcode;
+			sqe->fd = fd;
+			sqe->addr = (uint64_t)&iovs[i];
+			sqe->len = 1;
+			sqe->off = i * 64;
+			sqe->user_data = i;
+		}
+		// The ring is full until the kernel consumes some of them
+		ASSERT(!ring.getSqe());
+	};
+	auto submitAndReap = [&]() {
+		int submitted = 0;
+		while (submitted < ring.entries) {
+			int rc = ring.submit();
+			ASSERT(rc >= 0 || rc == -EAGAIN || rc == -EBUSY);
+			submitted += std::max(rc, 0);
+		}
+		int reaped = 0;
+		while (reaped < ring.entries) {
+			ASSERT(ring.waitForCompletions(1) == 0);
+			reaped += ring.reap([&](io_uring_cqe* cqe) {
+				ASSERT(cqe->user_data < ring.entries && cqe->res == 64);
+			});
+		}
+	};
+
+	// Sqes which were never submitted can be taken back and prepared again
+	prepareAll(IORING_OP_WRITEV);
+	std::vector<uint64_t> taken;
+	ASSERT(ring.unprepare([&](io_uring_sqe* sqe) { taken.push_back(sqe->user_data); }) == ring.entries);
+	for (int i = 0; i < ring.entries; i++) {
+		ASSERT(taken[i] == i);
+	}
+
+	prepareAll(IORING_OP_WRITEV);
+	submitAndReap();
+
+	for (auto& b : bufs) {
+		b = std::string(b.size(), 0);
+	}
+	prepareAll(IORING_OP_READV);
+	submitAndReap();
+	for (int i = 0; i < ring.entries; i++) {
+		ASSERT(bufs[i] == std::string(64, 'a' + i));
+	}
+
+	// When submission fails outright, nothing prepared was consumed and all of it can be taken back
+	int ringFd = ring.fd;
+	ring.fd = -1;
+	prepareAll(IORING_OP_READV);
+	ASSERT(ring.submit() == -EBADF);
+	ASSERT(ring.unprepare([](io_uring_sqe*) {}) == ring.entries);
+	ring.fd = ringFd;
+	ASSERT(ring.getSqe());
+
+	::close(fd);
+	return Void();
+}
+
+AsyncFileIOUring::Context AsyncFileIOUring::ctx;
+
+#include "flow/unactorcompiler.h"
+#endif
+#endif
@@ -0,0 +1,403 @@
+/*
+ * AsyncFileStriped.actor.h
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2020 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+// When actually compiled (NO_INTELLISENSE), include the generated version of this file.  In intellisense use the source version.
+#if defined(NO_INTELLISENSE) && !defined(FDBRPC_ASYNCFILESTRIPED_ACTOR_G_H)
+	#define FDBRPC_ASYNCFILESTRIPED_ACTOR_G_H
+	#include "fdbrpc/AsyncFileStriped.actor.g.h"
+#elif !defined(FDBRPC_ASYNCFILESTRIPED_ACTOR_H)
+	#define FDBRPC_ASYNCFILESTRIPED_ACTOR_H
+
+#include "flow/flow.h"
+#include "flow/UnitTest.h"
+#include "flow/crc32c.h"
+#include "fdbrpc/IAsyncFile.h"
+#include "flow/actorcompiler.h"  // This must be the last #include.
+
+// A file whose contents are striped round robin, in units of stripeBytes, across several other files, so that a large
+// read or write goes to all of them (and to the devices they are on) in parallel.  Unit k of the file is unit k / N of
+// stripe k % N.  The first HEADER_BYTES of the first stripe hold a header naming the others, so a striped file can be
+// opened again from its first stripe alone; its contents start after the header.
+class AsyncFileStriped final : public IAsyncFile, public ReferenceCounted<AsyncFileStriped> {
+public:
+	static constexpr int HEADER_BYTES = 4096;
+	static constexpr uint64_t HEADER_MAGIC = 0x3144455049525453ULL;  // "STRIPED1"
+
+	AsyncFileStriped(std::vector<Reference<IAsyncFile>> stripes, std::vector<std::string> otherNames, int stripeBytes)
+	  : stripes(std::move(stripes)), otherNames(std::move(otherNames)), stripeBytes(stripeBytes) {
+		ASSERT(this->stripes.size() > 0 && this->stripes.size() == this->otherNames.size() + 1 && stripeBytes > 0);
+	}
+
+	void addref() override { ReferenceCounted<AsyncFileStriped>::addref(); }
+	void delref() override { ReferenceCounted<AsyncFileStriped>::delref(); }
+
+	// The part of a range of the file that is in one stripe
+	struct Extent {
+		int stripe;
+		int64_t stripeOffset;
+		int rangeOffset;  // From the beginning of the range
+		int length;
+	};
+
+	static std::vector<Extent> extents(int stripeCount, int stripeBytes, int length, int64_t offset) {
+		std::vector<Extent> result;
+		int done = 0;
+		while (done < length) {
+			int64_t unit = (offset + done) / stripeBytes;
+			int inUnit = (offset + done) % stripeBytes;
+			int n = std::min(length - done, stripeBytes - inUnit);
+			result.push_back(Extent{ int(unit % stripeCount), (unit / stripeCount) * stripeBytes + inUnit, done, n });
+			done += n;
+		}
+		return result;
+	}
+
+	// The size of the given stripe of a file of the given size
+	static int64_t stripeSize(int stripeCount, int stripeBytes, int stripe, int64_t size) {
+		int64_t units = size / stripeBytes;
+		int64_t result = (units / stripeCount + (stripe < units % stripeCount ? 1 : 0)) * stripeBytes;
+		if (stripe == units % stripeCount) result += size % stripeBytes;
+		return result;
+	}
+
+	// The size of the file with the given stripe sizes.  If they disagree, for instance because a truncate was
+	// interrupted, this is the largest size that every stripe is consistent with.
+	static int64_t fileSize(int stripeBytes, std::vector<int64_t> const& stripeSizes) {
+		const int stripeCount = stripeSizes.size();
+		int64_t size = std::numeric_limits<int64_t>::max();
+		for (int i = 0; i < stripeCount; i++) {
+			int64_t units = stripeSizes[i] / stripeBytes;
+			size = std::min(size, (i + units * stripeCount) * stripeBytes + stripeSizes[i] % stripeBytes);
+		}
+		return size;
+	}
+
+	// Where an extent is in its stripe, past the header of the first
+	static int64_t offsetInStripe(Extent const& e) { return e.stripeOffset + (e.stripe == 0 ? HEADER_BYTES : 0); }
+
+	ACTOR static Future<int> read_impl(Reference<AsyncFileStriped> self, uint8_t* data, int length, int64_t offset) {
+		state std::vector<Extent> parts = extents(self->stripes.size(), self->stripeBytes, length, offset);
+		state std::vector<Future<int>> reads;
+		reads.reserve(parts.size());
+		for (const Extent& e : parts) {
+			reads.push_back(self->stripes[e.stripe]->read(data + e.rangeOffset, e.length, offsetInStripe(e)));
+		}
+		wait(waitForAll(reads));
+
+		// Everything up to the first short read was read
+		int bytesRead = 0;
+		for (int i = 0; i < parts.size(); i++) {
+			bytesRead += reads[i].get();
+			if (reads[i].get() < parts[i].length) break;
+		}
+		return bytesRead;
+	}
+
+	Future<int> read(void* data, int length, int64_t offset) override {
+		return read_impl(Reference<AsyncFileStriped>::addRef(this), (uint8_t*)data, length, offset);
+	}
+
+	Future<Void> write(void const* data, int length, int64_t offset) override {
+		std::vector<Future<Void>> writes;
+		for (const Extent& e : extents(stripes.size(), stripeBytes, length, offset)) {
+			writes.push_back(stripes[e.stripe]->write((uint8_t const*)data + e.rangeOffset, e.length, offsetInStripe(e)));
+		}
+		return waitForAll(writes);
+	}
+
+	Future<Void> truncate(int64_t size) override {
+		std::vector<Future<Void>> truncates;
+		for (int i = 0; i < stripes.size(); i++) {
+			truncates.push_back(stripes[i]->truncate(stripeSize(stripes.size(), stripeBytes, i, size) + (i == 0 ? HEADER_BYTES : 0)));
+		}
+		return waitForAll(truncates);
+	}
+
+	Future<Void> sync() override {
+		std::vector<Future<Void>> syncs;
+		for (auto& f : stripes) syncs.push_back(f->sync());
+		return waitForAll(syncs);
+	}
+
+	Future<Void> flush() override {
+		std::vector<Future<Void>> flushes;
+		for (auto& f : stripes) flushes.push_back(f->flush());
+		return waitForAll(flushes);
+	}
+
+	ACTOR static Future<int64_t> size_impl(Reference<AsyncFileStriped> self) {
+		std::vector<Future<int64_t>> sizes;
+		for (auto& f : self->stripes) sizes.push_back(f->size());
+		std::vector<int64_t> stripeSizes = wait(getAll(sizes));
+		stripeSizes[0] = std::max<int64_t>(0, stripeSizes[0] - HEADER_BYTES);
+		return fileSize(self->stripeBytes, stripeSizes);
+	}
+
+	Future<int64_t> size() const override {
+		return size_impl(Reference<AsyncFileStriped>::addRef(const_cast<AsyncFileStriped*>(this)));
+	}
+
+	std::string getFilename() const override { return stripes[0]->getFilename(); }
+	int64_t debugFD() const override { return stripes[0]->debugFD(); }
+
+	int stripeCount() const { return stripes.size(); }
+
+	// The names of the files the stripes are in, the first first
+	std::vector<std::string> stripeFilenames() const {
+		std::vector<std::string> names{ stripes[0]->getFilename() };
+		names.insert(names.end(), otherNames.begin(), otherNames.end());
+		return names;
+	}
+
+	struct Header {
+		int stripeBytes;
+		std::vector<std::string> otherNames;
+	};
+
+	// A header is HEADER_MAGIC, the length of the rest and a checksum of it, and then the rest: a format version, the
+	// stripe size and the names of the stripes after the first.  Returns an empty string if it does not fit.
+	static Standalone<StringRef> encodeHeader(Header const& header) {
+		BinaryWriter wr(Unversioned());
+		wr << uint32_t(1) << header.stripeBytes << uint32_t(header.otherNames.size());
+		for (const std::string& name : header.otherNames) wr << name;
+		const Standalone<StringRef> rest = wr.toValue();
+		if (16 + rest.size() > HEADER_BYTES) return Standalone<StringRef>();
+
+		Standalone<StringRef> result = makeAlignedString(HEADER_BYTES, HEADER_BYTES);
+		uint8_t* p = mutateString(result);
+		memset(p, 0, HEADER_BYTES);
+		const uint64_t magic = HEADER_MAGIC;
+		const uint32_t length = rest.size();
+		const uint32_t checksum = crc32c_append(0xfdbeefdb, rest.begin(), rest.size());
+		memcpy(p, &magic, 8);
+		memcpy(p + 8, &length, 4);
+		memcpy(p + 12, &checksum, 4);
+		memcpy(p + 16, rest.begin(), rest.size());
+		return result;
+	}
+
+	// Returns nothing if the data read from the beginning of a file is not a header, which means the file is not
+	// striped.  Throws io_error() for a header that is damaged.
+	static Optional<Header> decodeHeader(StringRef data, std::string const& filename) {
+		if (data.size() < 16) return Optional<Header>();
+		uint64_t magic;
+		memcpy(&magic, data.begin(), 8);
+		if (magic != HEADER_MAGIC) return Optional<Header>();
+
+		uint32_t length, checksum;
+		memcpy(&length, data.begin() + 8, 4);
+		memcpy(&checksum, data.begin() + 12, 4);
+		if (16 + int64_t(length) > data.size() || crc32c_append(0xfdbeefdb, data.begin() + 16, length) != checksum) {
+			TraceEvent(SevWarnAlways, "AsyncFileStripedBadHeader").detail("Filename", filename);
+			throw io_error();
+		}
+
+		Header header;
+		uint32_t version, count;
+		BinaryReader rd(data.substr(16, length), Unversioned());
+		rd >> version >> header.stripeBytes >> count;
+		if (version != 1 || header.stripeBytes <= 0) {
+			TraceEvent(SevWarnAlways, "AsyncFileStripedUnknownHeader").detail("Filename", filename).detail("Version", version);
+			throw io_error();
+		}
+		header.otherNames.resize(count);
+		for (std::string& name : header.otherNames) rd >> name;
+		return header;
+	}
+
+	// Stripes a new file, whose first stripe is open, across further files with the given names, which are created with
+	// the given flags.  Those are synced before the header is written, so that by the time the first stripe is durable
+	// every stripe exists.
+	ACTOR static Future<Reference<IAsyncFile>> create(Reference<IAsyncFile> first, std::vector<std::string> otherNames,
+	                                                  int stripeBytes, int64_t flags, int64_t mode) {
+		state Standalone<StringRef> header = encodeHeader(Header{ stripeBytes, otherNames });
+		if (!header.size()) {
+			TraceEvent(SevWarnAlways, "AsyncFileStripedHeaderTooLarge")
+			    .detail("Filename", first->getFilename())
+			    .detail("Stripes", otherNames.size() + 1);
+			throw io_error();
+		}
+
+		state std::vector<Future<Reference<IAsyncFile>>> opens;
+		for (const std::string& name : otherNames) opens.push_back(IAsyncFileSystem::filesystem()->open(name, flags, mode));
+		state std::vector<Reference<IAsyncFile>> files = wait(getAll(opens));
+		std::vector<Future<Void>> syncs;
+		for (auto& f : files) syncs.push_back(f->sync());
+		wait(waitForAll(syncs));
+		wait(first->write(header.begin(), HEADER_BYTES, 0));
+
+		files.insert(files.begin(), first);
+		return Reference<IAsyncFile>(new AsyncFileStriped(std::move(files), std::move(otherNames), stripeBytes));
+	}
+
+	// Opens the file whose first stripe is open, opening the other stripes with the given flags.  A file without a
+	// header is not striped and is returned as it is.  A stripe named in the header that cannot be opened is an error:
+	// reading the file without it would lose whatever was written to it.
+	ACTOR static Future<Reference<IAsyncFile>> open(Reference<IAsyncFile> first, int64_t flags) {
+		state Standalone<StringRef> buffer = makeAlignedString(HEADER_BYTES, HEADER_BYTES);
+		int bytesRead = wait(first->read(mutateString(buffer), HEADER_BYTES, 0));
+		state Optional<Header> header = decodeHeader(buffer.substr(0, bytesRead), first->getFilename());
+		if (!header.present()) return first;
+
+		state std::vector<Future<Reference<IAsyncFile>>> opens;
+		for (const std::string& name : header.get().otherNames) {
+			opens.push_back(IAsyncFileSystem::filesystem()->open(name, flags, 0));
+		}
+		wait(waitForAllReady(opens));
+
+		std::vector<Reference<IAsyncFile>> files{ first };
+		for (int i = 0; i < opens.size(); i++) {
+			if (opens[i].isError()) {
+				TraceEvent(SevWarnAlways, "AsyncFileStripedOpenStripeFailed")
+				    .error(opens[i].getError())
+				    .detail("Filename", first->getFilename())
+				    .detail("Stripe", header.get().otherNames[i]);
+				throw io_error();
+			}
+			files.push_back(opens[i].get());
+		}
+		return Reference<IAsyncFile>(
+		    new AsyncFileStriped(std::move(files), header.get().otherNames, header.get().stripeBytes));
+	}
+
+private:
+	std::vector<Reference<IAsyncFile>> stripes;
+	std::vector<std::string> otherNames;
+	int stripeBytes;
+};
+
+TEST_CASE("/fdbrpc/AsyncFileStriped/Layout") {
+	for (int i = 0; i < 1000; i++) {
+		const int stripeCount = deterministicRandom()->randomInt(1, 6);
+		const int stripeBytes = deterministicRandom()->randomInt(1, 5) * 4096;
+		const int64_t size = deterministicRandom()->randomInt64(0, 100 * stripeBytes);
+		std::vector<int64_t> stripeSizes;
+		int64_t total = 0;
+		for (int s = 0; s < stripeCount; s++) {
+			stripeSizes.push_back(AsyncFileStriped::stripeSize(stripeCount, stripeBytes, s, size));
+			total += stripeSizes.back();
+		}
+		ASSERT(total == size);
+		ASSERT(AsyncFileStriped::fileSize(stripeBytes, stripeSizes) == size);
+
+		// Every byte of a range lands in exactly one place within the stripes of a file that covers it
+		const int length = deterministicRandom()->randomInt(0, 10 * stripeBytes);
+		const int64_t offset = deterministicRandom()->randomInt64(0, 10 * stripeBytes);
+		int covered = 0;
+		for (const auto& e : AsyncFileStriped::extents(stripeCount, stripeBytes, length, offset)) {
+			ASSERT(e.rangeOffset == covered && e.length > 0);
+			ASSERT(e.stripeOffset + e.length <=
+			       AsyncFileStriped::stripeSize(stripeCount, stripeBytes, e.stripe, offset + length));
+			covered += e.length;
+		}
+		ASSERT(covered == length);
+	}
+	return Void();
+}
+
+TEST_CASE("/fdbrpc/AsyncFileStriped/ReadWrite") {
+	state std::string firstName = "unittest_striped";
+	state int stripeCount = deterministicRandom()->randomInt(2, 5);
+	state int stripeBytes = deterministicRandom()->randomInt(1, 5) * 4096;
+	state std::vector<std::string> otherNames;
+	for (int s = 1; s < stripeCount; s++) otherNames.push_back(firstName + format(".stripe%d", s));
+	state int64_t createFlags = IAsyncFile::OPEN_ATOMIC_WRITE_AND_CREATE | IAsyncFile::OPEN_CREATE |
+	                            IAsyncFile::OPEN_READWRITE | IAsyncFile::OPEN_UNCACHED;
+	state int64_t openFlags = IAsyncFile::OPEN_READWRITE | IAsyncFile::OPEN_UNCACHED;
+
+	state Reference<IAsyncFile> f = wait(IAsyncFileSystem::filesystem()->open(firstName, createFlags, 0600));
+	wait(store(f, AsyncFileStriped::create(f, otherNames, stripeBytes, createFlags, 0600)));
+	wait(f->sync());
+
+	// Random truncates, writes within the file (which is how a DiskQueue uses it) and reads, checked against a string
+	state std::string model;
+	state int i;
+	for (i = 0; i < 200; i++) {
+		state int op = deterministicRandom()->randomInt(0, 3);
+		state int64_t offset = deterministicRandom()->randomInt64(0, model.size() + stripeBytes + 1);
+		state int length = deterministicRandom()->randomInt(0, 3 * stripeBytes);
+		if (op == 0) {
+			const int64_t size = deterministicRandom()->randomInt64(0, 6 * stripeCount * stripeBytes);
+			wait(f->truncate(size));
+			model.resize(size, '\0');
+		} else if (op == 1) {
+			offset = std::min<int64_t>(offset, model.size());
+			length = std::min<int64_t>(length, model.size() - offset);
+			state Standalone<StringRef> data = StringRef(deterministicRandom()->randomAlphaNumeric(length));
+			wait(f->write(data.begin(), length, offset));
+			model.replace(offset, length, data.toString());
+		} else {
+			state Standalone<StringRef> buffer = makeString(length);
+			int bytesRead = wait(f->read(mutateString(buffer), length, offset));
+			const int expected = std::max<int64_t>(0, std::min<int64_t>(length, int64_t(model.size()) - offset));
+			ASSERT(bytesRead == expected);
+			ASSERT(buffer.substr(0, bytesRead) == StringRef(model).substr(std::min<int64_t>(offset, model.size()), expected));
+		}
+		int64_t size = wait(f->size());
+		ASSERT(size == model.size());
+	}
+	wait(f->sync());
+	f.clear();
+
+	// The header is enough to open the file again
+	wait(store(f, IAsyncFileSystem::filesystem()->open(firstName, openFlags, 0)));
+	wait(store(f, AsyncFileStriped::open(f, openFlags)));
+	ASSERT(dynamic_cast<AsyncFileStriped*>(f.getPtr()) != nullptr);
+	ASSERT(dynamic_cast<AsyncFileStriped*>(f.getPtr())->stripeCount() == stripeCount);
+	state Standalone<StringRef> contents = makeString(model.size());
+	int bytesRead = wait(f->read(mutateString(contents), model.size(), 0));
+	ASSERT(bytesRead == model.size() && contents == StringRef(model));
+	f.clear();
+
+	// But not without all of the stripes
+	state int missing = deterministicRandom()->randomInt(0, otherNames.size());
+	wait(IAsyncFileSystem::filesystem()->deleteFile(otherNames[missing], true));
+	state bool failed = false;
+	try {
+		wait(store(f, IAsyncFileSystem::filesystem()->open(firstName, openFlags, 0)));
+		wait(store(f, AsyncFileStriped::open(f, openFlags)));
+	} catch (Error& e) {
+		if (e.code() != error_code_io_error) throw;
+		failed = true;
+	}
+	ASSERT(failed);
+	f.clear();
+
+	// A file without a header is not striped
+	state std::string plainName = firstName + ".plain";
+	wait(store(f, IAsyncFileSystem::filesystem()->open(plainName, createFlags, 0600)));
+	wait(f->write(model.data(), std::min<int>(model.size(), 10000), 0));
+	wait(f->sync());
+	Reference<IAsyncFile> plain = wait(AsyncFileStriped::open(f, openFlags));
+	ASSERT(plain.getPtr() == f.getPtr());
+	f.clear();
+
+	wait(IAsyncFileSystem::filesystem()->deleteFile(plainName, true));
+	wait(IAsyncFileSystem::filesystem()->deleteFile(firstName, true));
+	for (i = 0; i < otherNames.size(); i++) {
+		if (i != missing) wait(IAsyncFileSystem::filesystem()->deleteFile(otherNames[i], true));
+	}
+	return Void();
+}
+
+#include "flow/unactorcompiler.h"
+#endif
@@ -42,6 +42,9 @@
 #include "flow/ObjectSerializer.h"
 #include "flow/ProtocolVersion.h"
 #include "flow/UnitTest.h"
+#ifdef HAS_LZ4
+#include <lz4.h>
+#endif
 #include "flow/actorcompiler.h"  // This must be the last #include.
 
 static NetworkAddressList g_currentDeliveryPeerAddress = NetworkAddressList();
@@ -49,6 +52,10 @@ static NetworkAddressList g_currentDeliveryPeerAddress = NetworkAddressList();
 constexpr UID WLTOKEN_ENDPOINT_NOT_FOUND(-1, 0);
 constexpr UID WLTOKEN_PING_PACKET(-1, 1);
 constexpr int PACKET_LEN_WIDTH = sizeof(uint32_t);
+// A length word with this bit set starts an LZ4 frame holding a batch of whole packets:
+// { uint32 COMPRESSED_BATCH_FLAG | compressedLen, uint32 rawLen, compressed bytes }
+constexpr uint32_t COMPRESSED_BATCH_FLAG = 0x80000000u;
+constexpr int COMPRESSED_BATCH_HEADER_SIZE = 2 * sizeof(uint32_t);
 const uint64_t TOKEN_STREAM_FLAG = 1;
 
 class EndpointMap : NonCopyable {
@@ -221,6 +228,7 @@ public:
 
 	void initMetrics() {
 		bytesSent.init(LiteralStringRef("Net2.BytesSent"));
+		bytesSavedByCompression.init(LiteralStringRef("Net2.BytesSavedByCompression"));
 		countPacketsReceived.init(LiteralStringRef("Net2.CountPacketsReceived"));
 		countPacketsGenerated.init(LiteralStringRef("Net2.CountPacketsGenerated"));
 		countConnEstablished.init(LiteralStringRef("Net2.CountConnEstablished"));
@@ -248,6 +256,7 @@ public:
 	PingReceiver pingReceiver{ endpoints };
 
 	Int64MetricHandle bytesSent;
+	Int64MetricHandle bytesSavedByCompression;
 	Int64MetricHandle countPacketsReceived;
 	Int64MetricHandle countPacketsGenerated;
 	Int64MetricHandle countConnEstablished;
@@ -350,7 +359,8 @@ struct ConnectPacket {
 	uint32_t canonicalRemoteIp4;
 
 	enum ConnectPacketFlags {
-		  FLAG_IPV6 = 1
+		  FLAG_IPV6 = 1,
+		  FLAG_COMPRESSION_LZ4 = 2  // The sender can decode LZ4 batches; older peers ignore this bit
 	};
 	uint16_t flags;
 	uint8_t canonicalRemoteIp6[16];
@@ -381,6 +391,8 @@ struct ConnectPacket {
 
 	bool isIPv6() const { return flags & FLAG_IPV6; }
 
+	bool acceptsCompression() const { return flags & FLAG_COMPRESSION_LZ4; }
+
 	uint32_t totalPacketSize() const { return connectPacketLength + sizeof(connectPacketLength); }
 
 	template <class Ar>
@@ -492,8 +504,168 @@ ACTOR Future<Void> connectionMonitor( Reference<Peer> peer ) {
 	}
 }
 
+static int64_t unsentBytes(UnsentPacketQueue const& unsent) {
+	int64_t bytes = 0;
+	for (SendBuffer* b = unsent.getUnsent(); b; b = b->next) bytes += b->bytes_unsent();
+	return bytes;
+}
+
+#ifdef HAS_LZ4
+// Copies the first `bytes` unsent bytes of the chain starting at b to dst
+static void copyUnsent(SendBuffer* b, uint8_t* dst, int64_t bytes) {
+	for (; bytes; b = b->next) {
+		int n = std::min<int64_t>(b->bytes_unsent(), bytes);
+		memcpy(dst, b->data() + b->bytes_sent, n);
+		dst += n;
+		bytes -= n;
+	}
+}
+#endif
+
+#ifdef HAS_LZ4
+// Replaces a batch of whole packets at the front of unsent, whose packet headers are headerSize bytes, by a single LZ4
+// frame, and returns the number of bytes at the front of unsent to send before choosing again.  Neither the batch nor
+// its frame is ever larger than PACKET_LIMIT, which the receiver enforces, so a first packet too large to batch is
+// sent as it is, without being copied.
+static int64_t compressUnsentBatch(UnsentPacketQueue& unsent, int64_t total, int headerSize, int64_t& bytesSaved) {
+	if (total < headerSize) return total;
+
+	uint32_t firstLen;
+	copyUnsent(unsent.getUnsent(), (uint8_t*)&firstLen, sizeof(firstLen));
+	const int64_t limit = std::min<int64_t>(
+	    total, std::min<int64_t>(FLOW_KNOBS->NETWORK_COMPRESSION_BATCH_BYTES, FLOW_KNOBS->PACKET_LIMIT));
+	if (headerSize + (int64_t)firstLen > limit) {
+		return std::min<int64_t>(total, headerSize + (int64_t)firstLen);
+	}
+
+	// A batch always ends on a packet boundary
+	Arena arena;
+	uint8_t* raw = new (arena) uint8_t[limit];
+	copyUnsent(unsent.getUnsent(), raw, limit);
+	int64_t n = 0;
+	while (n + headerSize <= limit) {
+		int64_t next = n + headerSize + *(uint32_t*)(raw + n);
+		if (next > limit) break;
+		n = next;
+	}
+	ASSERT(n > 0);
+	if (n < FLOW_KNOBS->NETWORK_COMPRESSION_MIN_BYTES) return n;
+
+	const int bound = LZ4_compressBound(n);
+	PacketBuffer* pb = PacketBuffer::create(COMPRESSED_BATCH_HEADER_SIZE + bound);
+	const int compressedLen =
+	    LZ4_compress_default((const char*)raw, (char*)pb->data() + COMPRESSED_BATCH_HEADER_SIZE, n, bound);
+	if (compressedLen <= 0 || COMPRESSED_BATCH_HEADER_SIZE + compressedLen >= n) {
+		// Incompressible; send the batch as it is
+		pb->delref();
+		return n;
+	}
+	((uint32_t*)pb->data())[0] = COMPRESSED_BATCH_FLAG | compressedLen;
+	((uint32_t*)pb->data())[1] = n;
+	pb->bytes_written = COMPRESSED_BATCH_HEADER_SIZE + compressedLen;
+
+	// The raw packets leave the unsent queue as if they had been sent; reliable packets keep their own references
+	unsent.sent(n);
+	unsent.prependWriteBuffer(pb, pb);
+	bytesSaved += n - pb->bytes_written;
+	return pb->bytes_written;
+}
+#endif
+
+// Decides how many bytes at the front of the unsent queue connectionWriter sends before choosing again.  If the peer
+// accepts compression and enough is queued, a batch of whole packets is replaced in the queue by a single LZ4 frame.
+static int64_t commitUnsentBatch(Peer* peer) {
+	int64_t total = unsentBytes(peer->unsent);
+#ifdef HAS_LZ4
+	if (peer->peerAcceptsCompression && FLOW_KNOBS->ENABLE_NETWORK_COMPRESSION &&
+	    total >= FLOW_KNOBS->NETWORK_COMPRESSION_MIN_BYTES) {
+		const int headerSize = PACKET_LEN_WIDTH + (peer->destination.isTLS() ? 0 : sizeof(uint32_t));
+		int64_t bytesSaved = 0;
+		int64_t n = compressUnsentBatch(peer->unsent, total, headerSize, bytesSaved);
+		peer->transport->bytesSavedByCompression += bytesSaved;
+		return n;
+	}
+#endif
+	return total;
+}
+
+#ifdef HAS_LZ4
+TEST_CASE("/fdbrpc/FlowTransport/CompressedBatch") {
+	const int headerSize = PACKET_LEN_WIDTH + sizeof(uint32_t);
+	const int64_t batchBytes =
+	    std::min<int64_t>(FLOW_KNOBS->NETWORK_COMPRESSION_BATCH_BYTES, FLOW_KNOBS->PACKET_LIMIT);
+
+	UnsentPacketQueue unsent;
+	PacketBuffer* pb = unsent.getWriteBuffer();
+	std::string queued;
+	auto queuePacket = [&](uint32_t len) {
+		std::string packet((const char*)&len, sizeof(len));
+		packet.append(sizeof(uint32_t), 'c'); // The checksum, which is not checked here
+		for (uint32_t i = 0; i < len; i++) {
+			packet.push_back("abcd"[i / 16 % 4]);
+		}
+		queued += packet;
+		for (size_t off = 0; off < packet.size();) {
+			if (!pb->bytes_unwritten()) {
+				pb->next = PacketBuffer::create();
+				pb = pb->nextPacketBuffer();
+				unsent.setWriteBuffer(pb);
+			}
+			int n = std::min<size_t>(pb->bytes_unwritten(), packet.size() - off);
+			memcpy(pb->data() + pb->bytes_written, packet.data() + off, n);
+			pb->bytes_written += n;
+			off += n;
+		}
+	};
+
+	// A first packet too large for a batch is sent as it is, and then batches of the rest are sent
+	queuePacket(batchBytes);
+	for (int i = 0; i < 50; i++) {
+		queuePacket(deterministicRandom()->randomInt(0, 20000));
+	}
+
+	std::string received;
+	int64_t bytesSaved = 0;
+	bool first = true;
+	while (!unsent.empty()) {
+		int64_t n = compressUnsentBatch(unsent, unsentBytes(unsent), headerSize, bytesSaved);
+		ASSERT(n > 0 && n <= FLOW_KNOBS->PACKET_LIMIT + headerSize);
+		if (first) {
+			ASSERT(n == headerSize + batchBytes && bytesSaved == 0);
+			first = false;
+		}
+
+		std::string wire(n, 0);
+		copyUnsent(unsent.getUnsent(), (uint8_t*)&wire[0], n);
+		unsent.sent(n);
+
+		// What scanPackets does with a frame
+		const uint32_t word = *(const uint32_t*)wire.data();
+		if (word & COMPRESSED_BATCH_FLAG) {
+			const uint32_t batchLen = word & ~COMPRESSED_BATCH_FLAG;
+			const uint32_t rawLen = *(const uint32_t*)(wire.data() + PACKET_LEN_WIDTH);
+			ASSERT(COMPRESSED_BATCH_HEADER_SIZE + batchLen == n && rawLen <= batchBytes);
+			std::string raw(rawLen, 0);
+			ASSERT(LZ4_decompress_safe(wire.data() + COMPRESSED_BATCH_HEADER_SIZE, &raw[0], batchLen, rawLen) ==
+			       rawLen);
+			received += raw;
+		} else {
+			received += wire;
+		}
+	}
+	ASSERT(received == queued);
+	// With the default knobs the batches of repetitive packets are compressed
+	ASSERT(bytesSaved > 0 || batchBytes < (1 << 20) || FLOW_KNOBS->NETWORK_COMPRESSION_MIN_BYTES > 4096);
+
+	return Void();
+}
+#endif
+
 ACTOR Future<Void> connectionWriter( Reference<Peer> self, Reference<IConnection> conn ) {
 	state double lastWriteTime = now();
+	// Bytes at the front of unsent that must be written before the next batch is chosen.  This starts with the
+	// ConnectPacket and whatever was queued before the connection was made, which are never compressed.
+	state int64_t committedBytes = unsentBytes(self->unsent);
 	loop {
 		//wait( delay(0, TaskPriority::WriteSocket) );
 		wait( delayJittered(std::max<double>(FLOW_KNOBS->MIN_COALESCE_DELAY, FLOW_KNOBS->MAX_COALESCE_DELAY - (now() - lastWriteTime)), TaskPriority::WriteSocket) );
@@ -504,19 +676,26 @@ ACTOR Future<Void> connectionWriter( Reference<Peer> self, Reference<IConnection
 		loop {
 			lastWriteTime = now();
 
-			int sent = conn->write(self->unsent.getUnsent(), /* limit= */ FLOW_KNOBS->MAX_PACKET_SEND_BYTES);
+			if (!committedBytes) {
+				committedBytes = commitUnsentBatch(self.getPtr());
+			}
+			int sent = conn->write(self->unsent.getUnsent(),
+			                       /* limit= */ std::min<int64_t>(FLOW_KNOBS->MAX_PACKET_SEND_BYTES, committedBytes));
 			if (sent) {
 				self->bytesSent += sent;
 				self->transport->bytesSent += sent;
 				self->unsent.sent(sent);
+				committedBytes -= sent;
 			}
 
 			if (self->unsent.empty()) {
 				break;
 			}
 
-			TEST(true); // We didn't write everything, so apparently the write buffer is full.  Wait for it to be nonfull.
-			wait( conn->onWritable() );
+			if (committedBytes || sent == FLOW_KNOBS->MAX_PACKET_SEND_BYTES) {
+				TEST(true); // We didn't write everything, so apparently the write buffer is full.  Wait for it to be nonfull.
+				wait( conn->onWritable() );
+			}
 			wait( yield(TaskPriority::WriteSocket) );
 		}
 
@@ -632,6 +811,7 @@ ACTOR Future<Void> connectionKeeper( Reference<Peer> self,
 							TraceEvent("ConnectionExchangingConnectPacket", conn->getDebugID())
 							    .suppressFor(1.0)
 							    .detail("PeerAddr", self->destination);
+							self->peerAcceptsCompression = false;
 							self->prependConnectPacket();
 							reader = connectionReader(self->transport, conn, self, Promise<Reference<Peer>>());
 						}
@@ -768,7 +948,8 @@ ACTOR Future<Void> connectionKeeper( Reference<Peer> self,
 
 Peer::Peer(TransportData* transport, NetworkAddress const& destination)
   : transport(transport), destination(destination), outgoingConnectionIdle(true), lastConnectTime(0.0),
-    reconnectionDelay(FLOW_KNOBS->INITIAL_RECONNECTION_TIME), compatible(true), outstandingReplies(0),
+    reconnectionDelay(FLOW_KNOBS->INITIAL_RECONNECTION_TIME), compatible(true), peerAcceptsCompression(false),
+    outstandingReplies(0),
     incompatibleProtocolVersionNewer(false), peerReferences(-1), bytesReceived(0), lastDataPacketSentTime(now()),
     pingLatencies(destination.isPublic() ? FLOW_KNOBS->PING_SAMPLE_AMOUNT : 1), lastLoggedBytesReceived(0),
     bytesSent(0), lastLoggedBytesSent(0), lastLoggedTime(0.0), connectOutgoingCount(0), connectIncomingCount(0),
@@ -801,6 +982,9 @@ void Peer::prependConnectPacket() {
 	pkt.protocolVersion = g_network->protocolVersion();
 	pkt.protocolVersion.addObjectSerializerFlag();
 	pkt.connectionId = transport->transportId;
+#ifdef HAS_LZ4
+	pkt.flags |= ConnectPacket::FLAG_COMPRESSION_LZ4;
+#endif
 
 	PacketBuffer* pb_first = PacketBuffer::create();
 	PacketWriter wr( pb_first, nullptr, Unversioned() );
@@ -920,7 +1104,8 @@ ACTOR static void deliver(TransportData* self, Endpoint destination, ArenaReader
 }
 
 static void scanPackets(TransportData* transport, uint8_t*& unprocessed_begin, const uint8_t* e, Arena& arena,
-                        NetworkAddress const& peerAddress, ProtocolVersion peerProtocolVersion) {
+                        NetworkAddress const& peerAddress, ProtocolVersion peerProtocolVersion,
+                        bool inCompressedBatch = false) {
 	// Find each complete packet in the given byte range and queue a ready task to deliver it.
 	// Remove the complete packets from the range by increasing unprocessed_begin.
 	// There won't be more than 64K of data plus one packet, so this shouldn't take a long time.
@@ -930,6 +1115,44 @@ static void scanPackets(TransportData* transport, uint8_t*& unprocessed_begin, c
 	loop {
 		uint32_t packetLen, packetChecksum;
 
+#ifdef HAS_LZ4
+		// An LZ4 frame of whole packets, which we only receive if our ConnectPacket advertised FLAG_COMPRESSION_LZ4.
+		// Frames never nest, so inside one the flag bit fails the PACKET_LIMIT check below.
+		if (!inCompressedBatch && e - p >= PACKET_LEN_WIDTH && (*(uint32_t*)p & COMPRESSED_BATCH_FLAG)) {
+			if (e - p < COMPRESSED_BATCH_HEADER_SIZE) break;
+			const uint32_t batchLen = *(uint32_t*)p & ~COMPRESSED_BATCH_FLAG;
+			const uint32_t rawLen = *(uint32_t*)(p + PACKET_LEN_WIDTH);
+			if (batchLen > FLOW_KNOBS->PACKET_LIMIT || rawLen > FLOW_KNOBS->PACKET_LIMIT) {
+				TraceEvent(SevError, "PacketLimitExceeded")
+				    .detail("FromPeer", peerAddress.toString())
+				    .detail("Length", (int)batchLen)
+				    .detail("UncompressedLength", (int)rawLen);
+				throw platform_error();
+			}
+			if (e - p - COMPRESSED_BATCH_HEADER_SIZE < batchLen) break;
+
+			Arena batchArena;
+			uint8_t* raw = new (batchArena) uint8_t[rawLen];
+			const int rawBytes =
+			    LZ4_decompress_safe((const char*)p + COMPRESSED_BATCH_HEADER_SIZE, (char*)raw, batchLen, rawLen);
+			uint8_t* rawBegin = raw;
+			if (rawBytes == (int)rawLen) {
+				scanPackets(transport, rawBegin, raw + rawLen, batchArena, peerAddress, peerProtocolVersion, true);
+			}
+			if (rawBegin != raw + rawLen) {
+				TraceEvent(SevWarnAlways, "CompressedBatchCorrupt")
+				    .detail("FromPeer", peerAddress.toString())
+				    .detail("Length", (int)batchLen)
+				    .detail("UncompressedLength", (int)rawLen)
+				    .detail("DecompressedLength", rawBytes);
+				throw checksum_failed();
+			}
+
+			unprocessed_begin = p = p + COMPRESSED_BATCH_HEADER_SIZE + batchLen;
+			continue;
+		}
+#endif
+
 		//Retrieve packet length and checksum
 		if (checksumEnabled) {
 			if (e-p < sizeof(uint32_t) * 2) break;
@@ -1023,6 +1246,17 @@ static int getNewBufferSize(const uint8_t* begin, const uint8_t* end, const Netw
 		return FLOW_KNOBS->MIN_PACKET_BUFFER_BYTES;
 	}
 	const uint32_t packetLen = *(uint32_t*)begin;
+#ifdef HAS_LZ4
+	if (packetLen & COMPRESSED_BATCH_FLAG) {
+		const uint32_t batchLen = packetLen & ~COMPRESSED_BATCH_FLAG;
+		if (batchLen > FLOW_KNOBS->PACKET_LIMIT) {
+			TraceEvent(SevError, "PacketLimitExceeded").detail("FromPeer", peerAddress.toString()).detail("Length", (int)batchLen);
+			throw platform_error();
+		}
+		return std::max<uint32_t>(FLOW_KNOBS->MIN_PACKET_BUFFER_BYTES,
+		                          batchLen + COMPRESSED_BATCH_HEADER_SIZE + sizeof(uint32_t));
+	}
+#endif
 	if (packetLen > FLOW_KNOBS->PACKET_LIMIT) {
 		TraceEvent(SevError, "PacketLimitExceeded").detail("FromPeer", peerAddress.toString()).detail("Length", (int)packetLen);
 		throw platform_error();
@@ -1152,6 +1386,7 @@ ACTOR static Future<Void> connectionReader(
 							    .detail("PeerAddr", NetworkAddress(pkt.canonicalRemoteIp(), pkt.canonicalRemotePort));
 							peer->compatible = compatible;
 							peer->incompatibleProtocolVersionNewer = incompatibleProtocolVersionNewer;
+							peer->peerAcceptsCompression = compatible && pkt.acceptsCompression();
 							if (!compatible) {
 								peer->transport->numIncompatibleConnections++;
 								incompatiblePeerCounted = true;
@@ -1167,6 +1402,7 @@ ACTOR static Future<Void> connectionReader(
 							peer = transport->getOrOpenPeer(peerAddress, false);
 							peer->compatible = compatible;
 							peer->incompatibleProtocolVersionNewer = incompatibleProtocolVersionNewer;
+							peer->peerAcceptsCompression = compatible && pkt.acceptsCompression();
 							if (!compatible) {
 								peer->transport->numIncompatibleConnections++;
 								incompatiblePeerCounted = true;
@@ -1450,6 +1686,7 @@ static ReliablePacket* sendPacket(TransportData* self, Reference<Peer> peer, ISe
 	PacketBuffer* checksumPb = pb;
 
 	PacketWriter wr(pb,rp,AssumeVersion(g_network->protocolVersion()));  // SOMEDAY: Can we downgrade to talk to older peers?
+	wr.setZeroCopyMinBytes(FLOW_KNOBS->ZERO_COPY_SEND_MIN_BYTES);
 
 	// Reserve some space for packet length and checksum, write them after serializing data
 	SplitBuffer packetInfoBuffer;
@@ -146,6 +146,7 @@ struct Peer : public ReferenceCounted<Peer> {
 	AsyncTrigger resetPing;
 	AsyncTrigger resetConnection;
 	bool compatible;
+	bool peerAcceptsCompression;  // The current connection's ConnectPacket advertised that the peer can decode LZ4 batches
 	bool outgoingConnectionIdle;  // We don't actually have a connection open and aren't trying to open one because we don't have anything to send
 	double lastConnectTime;
 	double reconnectionDelay;
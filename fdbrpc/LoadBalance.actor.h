@@ -206,6 +206,7 @@ Future< REPLY_TYPE(Request) > loadBalance(
 		double bestTime = 1e9;  // The latency to the server with the least outstanding requests.
 		double nextTime = 1e9;
 		int badServers = 0;
+		std::vector<int> candidates;  // Healthy alternatives considered, for LOAD_BALANCE_ADAPTIVE
 
 		for(int i=0; i<alternatives->size(); i++) {
 			// countBest(): the number of alternatives in the same locality (i.e., DC by default) as alternatives[0].
@@ -228,6 +229,8 @@ Future< REPLY_TYPE(Request) > loadBalance(
 						// penalty value is 1.0), consider this server as bad.
 						// penalty is sent from server.
 						++badServers;
+					} else {
+						candidates.push_back(i);
 					}
 
 					if(thisMetric < bestMetric) {
@@ -273,9 +276,31 @@ Future< REPLY_TYPE(Request) > loadBalance(
 			}
 		}
 
+		QueueData* bestData = nullptr;
+		if(FLOW_KNOBS->LOAD_BALANCE_ADAPTIVE && candidates.size() >= 2) {
+			// Of two healthy alternatives chosen at random, send to the one with the lower recent tail latency scaled by
+			// its outstanding requests, and keep the other for the second request.  Unlike always picking the least
+			// loaded alternative, this keeps a replica with one slow disk from drawing every request whenever its
+			// queue briefly looks shortest.
+			int a = deterministicRandom()->randomInt(0, candidates.size());
+			int b = deterministicRandom()->randomInt(0, candidates.size() - 1);
+			if(b >= a) b++;
+			auto& qa = model->getMeasurement(alternatives->get( candidates[a], channel ).getEndpoint().token.first());
+			auto& qb = model->getMeasurement(alternatives->get( candidates[b], channel ).getEndpoint().token.first());
+			bool bFirst = qb.adaptiveScore() < qa.adaptiveScore();
+			bestAlt = candidates[bFirst ? b : a];
+			nextAlt = candidates[bFirst ? a : b];
+			bestData = bFirst ? &qb : &qa;
+			bestTime = bestData->latency;
+			nextTime = (bFirst ? qa : qb).latency;
+		}
+
 		if(nextTime < 1e9) {
 			// Decide when to send the request to the second best choice.
-			if(bestTime > FLOW_KNOBS->INSTANT_SECOND_REQUEST_MULTIPLIER*(model->secondMultiplier*(nextTime) + FLOW_KNOBS->BASE_SECOND_REQUEST_TIME)) {
+			if(bestData && bestData->hasLatencyPercentiles()) {
+				// Hedge once the request has taken longer than most recent requests to the same server did
+				secondDelay = delay( model->secondMultiplier*bestData->latencies.percentile(FLOW_KNOBS->LOAD_BALANCE_HEDGE_PERCENTILE) );
+			} else if(bestTime > FLOW_KNOBS->INSTANT_SECOND_REQUEST_MULTIPLIER*(model->secondMultiplier*(nextTime) + FLOW_KNOBS->BASE_SECOND_REQUEST_TIME)) {
 				secondDelay = Void();
 			} else {
 				secondDelay = delay( model->secondMultiplier*nextTime + FLOW_KNOBS->BASE_SECOND_REQUEST_TIME );
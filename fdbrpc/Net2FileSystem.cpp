@@ -35,6 +35,7 @@
 #include "fdbrpc/AsyncFileEIO.actor.h"
 #include "fdbrpc/AsyncFileWinASIO.actor.h"
 #include "fdbrpc/AsyncFileKAIO.actor.h"
+#include "fdbrpc/AsyncFileIOUring.actor.h"
 #include "flow/AsioReactor.h"
 #include "flow/Platform.h"
 #include "fdbrpc/AsyncFileWriteChecker.h"
@@ -62,6 +63,13 @@ Future<Reference<class IAsyncFile>> Net2FileSystem::open(const std::string& file
 	// cases, DISABLE_POSIX_KERNEL_AIO knob can be enabled to fallback to EIO instead
 	// of Kernel AIO. And EIO_USE_ODIRECT can be used to turn on or off O_DIRECT within
 	// EIO.
+	// When io_uring is enabled it replaces Kernel AIO, and since it does not need O_DIRECT it is also used for
+	// buffered files.
+#ifdef HAVE_IO_URING
+	if (!(flags & IAsyncFile::OPEN_NO_AIO) && AsyncFileIOUring::isEnabled())
+		f = AsyncFileIOUring::open(filename, flags, mode, nullptr);
+	else
+#endif
 	if ((flags & IAsyncFile::OPEN_UNBUFFERED) && !(flags & IAsyncFile::OPEN_NO_AIO) &&
 	    !FLOW_KNOBS->DISABLE_POSIX_KERNEL_AIO)
 		f = AsyncFileKAIO::open(filename, flags, mode, nullptr);
@@ -89,7 +97,13 @@ void Net2FileSystem::newFileSystem(double ioTimeout, const std::string& fileSyst
 Net2FileSystem::Net2FileSystem(double ioTimeout, const std::string& fileSystemPath) {
 	Net2AsyncFile::init();
 #ifdef __linux__
-	if (!FLOW_KNOBS->DISABLE_POSIX_KERNEL_AIO)
+	// io_uring and Kernel AIO share the reactor's eventfd and the run cycle function, so at most one is initialized
+	bool ioUring = false;
+#ifdef HAVE_IO_URING
+	if (FLOW_KNOBS->ENABLE_IO_URING)
+		ioUring = AsyncFileIOUring::init( Reference<IEventFD>(N2::ASIOReactor::getEventFD()), ioTimeout );
+#endif
+	if (!ioUring && !FLOW_KNOBS->DISABLE_POSIX_KERNEL_AIO)
 		AsyncFileKAIO::init( Reference<IEventFD>(N2::ASIOReactor::getEventFD()), ioTimeout );
 
 	if (fileSystemPath.empty()) {
@@ -20,6 +20,7 @@
 
 #include "fdbrpc/QueueModel.h"
 #include "fdbrpc/LoadBalance.h"
+#include "flow/UnitTest.h"
 
 void QueueModel::endRequest( uint64_t id, double latency, double penalty, double delta, bool clean, bool futureVersion ) {
 	auto& d = data[id];
@@ -29,6 +30,7 @@ void QueueModel::endRequest( uint64_t id, double latency, double penalty, double
 
 	if(clean) {
 		d.latency = latency;
+		d.latencies.addSample(latency, now());
 	} else {
 		d.latency = std::max(d.latency, latency);
 	}
@@ -75,6 +77,33 @@ Optional<BasicLoadBalancedReply> getBasicLoadBalancedReply(const void*) {
 	return Optional<BasicLoadBalancedReply>();
 }
 
+TEST_CASE("/fdbrpc/QueueModel/LatencyHistogram") {
+	LatencyHistogram h(5.0);
+	ASSERT(h.percentile(0.99) == 0);
+
+	// 98% of requests take 1-2ms, and the rest 100ms
+	for (int i = 0; i < 980; i++) {
+		h.addSample(0.001 + deterministicRandom()->random01() * 0.001, 0);
+	}
+	for (int i = 0; i < 20; i++) {
+		h.addSample(0.1, 0);
+	}
+	double p50 = h.percentile(0.5);
+	ASSERT(p50 >= 0.0015 && p50 <= 0.0015 * 1.2);
+	double p95 = h.percentile(0.95);
+	ASSERT(p95 >= 0.0019 && p95 <= 0.002 * 1.2);
+	double p99 = h.percentile(0.99);
+	ASSERT(p99 >= 0.1 && p99 <= 0.1 * 1.2);
+
+	// A minute (twelve half lives) later the slow samples are forgotten
+	for (int i = 0; i < 100; i++) {
+		h.addSample(0.001, 60.0);
+	}
+	ASSERT(h.count() < 101);
+	ASSERT(h.percentile(0.99) <= 0.001 * 1.2);
+	return Void();
+}
+
 /*
 void QueueModel::addMeasurement( uint64_t id, QueueDetails qd ){
 	if (data[new_index].count(id))
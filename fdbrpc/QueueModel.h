@@ -27,6 +27,62 @@
 #include "flow/Knobs.h"
 #include "flow/ActorCollection.h"
 
+#include <cmath>
+
+// A histogram of request latencies in which older samples count for less, halving in weight every halfLife seconds,
+// so that its percentiles follow a server whose latency changes.  Buckets are spaced four to a doubling from 100us,
+// which keeps a percentile within 19% of the true value.
+class LatencyHistogram {
+public:
+	static constexpr int BUCKETS = 64;
+
+	explicit LatencyHistogram(double halfLife) : halfLife(halfLife), total(0), decayedAt(0) {
+		std::fill(weights, weights + BUCKETS, 0.0);
+	}
+
+	void addSample(double latency, double t) {
+		decay(t);
+		weights[bucket(latency)] += 1.0;
+		total += 1.0;
+	}
+
+	// The decayed number of samples
+	double count() const { return total; }
+
+	// An upper bound on the p'th fraction of latencies, or 0 if there are no samples
+	double percentile(double p) const {
+		double target = p * total;
+		double sum = 0;
+		for (int b = 0; b < BUCKETS; b++) {
+			sum += weights[b];
+			if (sum >= target && sum > 0) return upperBound(b);
+		}
+		return total > 0 ? upperBound(BUCKETS - 1) : 0;
+	}
+
+	static double upperBound(int b) { return 100e-6 * std::exp2((b + 1) / 4.0); }
+
+private:
+	double halfLife;
+	double weights[BUCKETS];
+	double total;
+	double decayedAt;
+
+	static int bucket(double latency) {
+		if (latency <= 100e-6) return 0;
+		return std::min(BUCKETS - 1, std::max(0, (int)std::ceil(4 * std::log2(latency / 100e-6)) - 1));
+	}
+
+	void decay(double t) {
+		// Decaying every bucket on each sample would be wasteful; a sixteenth of a half life is close enough
+		if (t - decayedAt < halfLife / 16) return;
+		double factor = std::exp2(-(t - decayedAt) / halfLife);
+		for (auto& w : weights) w *= factor;
+		total *= factor;
+		decayedAt = t;
+	}
+};
+
 // The data structure used for the client-side load balancing algorithm to
 // decide which storage server to read data from. Conceptually, it tracks the
 // number of outstanding requests the current client sent to each storage
@@ -59,9 +115,29 @@ struct QueueData {
 	// hasn't returned a valid result, increase above `futureVersionBackoff`
 	// to increase the future backoff amount.
 	double increaseBackoffTime;
+
+	// Recent client perceived latencies of successful requests to this
+	// storage server, which LOAD_BALANCE_ADAPTIVE balances and hedges on.
+	LatencyHistogram latencies;
+
 	QueueData()
 	  : latency(0.001), penalty(1.0), smoothOutstanding(FLOW_KNOBS->QUEUE_MODEL_SMOOTHING_AMOUNT), failedUntil(0),
-	    futureVersionBackoff(FLOW_KNOBS->FUTURE_VERSION_INITIAL_BACKOFF), increaseBackoffTime(0) {}
+	    futureVersionBackoff(FLOW_KNOBS->FUTURE_VERSION_INITIAL_BACKOFF), increaseBackoffTime(0),
+	    latencies(FLOW_KNOBS->LOAD_BALANCE_LATENCY_HALF_LIFE) {}
+
+	// Whether there are enough recent samples for percentiles of `latencies` to mean anything
+	bool hasLatencyPercentiles() const {
+		return latencies.count() >= FLOW_KNOBS->LOAD_BALANCE_MIN_LATENCY_SAMPLES;
+	}
+
+	// The expected cost of sending one more request here: the tail latency
+	// (or the last latency, until there are enough samples) scaled by the
+	// requests already outstanding.
+	double adaptiveScore() {
+		double tail = hasLatencyPercentiles() ? latencies.percentile(FLOW_KNOBS->LOAD_BALANCE_SELECTION_PERCENTILE)
+		                                      : latency;
+		return tail * (1.0 + smoothOutstanding.smoothTotal());
+	}
 };
 
 typedef double TimeEstimate;
@@ -66,6 +66,17 @@ struct FlowReceiver : public NetworkMessageReceiver {
 		endpoint = e;
 	}
 
+	// Makes this a remote endpoint when the remote address is only learned after construction
+	void setRemoteEndpoint(Endpoint const& remoteEndpoint) {
+		ASSERT(!endpoint.isValid());
+		m_isLocalEndpoint = false;
+		endpoint = remoteEndpoint;
+		FlowTransport::transport().addPeerReference(endpoint, m_stream);
+	}
+
+	// Returns the endpoint without creating a local one if none exists yet
+	const Endpoint& getRawEndpoint() const { return endpoint; }
+
 	void setPeerCompatibilityPolicy(const PeerCompatibilityPolicy& policy) { peerCompatibilityPolicy_ = policy; }
 
 	PeerCompatibilityPolicy peerCompatibilityPolicy() const override {
@@ -242,6 +253,301 @@ struct NetNotifiedQueue final : NotifiedQueue<T>, FlowReceiver, FastAllocated<Ne
 	bool isStream() const override { return true; }
 };
 
+struct AcknowledgementReply {
+	constexpr static FileIdentifier file_identifier = 15581889;
+	int64_t bytes;
+
+	AcknowledgementReply() : bytes(0) {}
+	explicit AcknowledgementReply(int64_t bytes) : bytes(bytes) {}
+
+	template <class Ar>
+	void serialize(Ar& ar) {
+		serializer(ar, bytes);
+	}
+};
+
+// Flow control state for a ReplyPromiseStream. On the sending side this is a local endpoint which receives the
+// number of bytes consumed so far by the receiver; on the receiving side it is the remote endpoint those
+// acknowledgements are sent to.
+struct AcknowledgementReceiver final : FlowReceiver, FastAllocated<AcknowledgementReceiver> {
+	using FastAllocated<AcknowledgementReceiver>::operator new;
+	using FastAllocated<AcknowledgementReceiver>::operator delete;
+
+	int64_t bytesSent;
+	int64_t bytesAcknowledged;
+	int64_t bytesLimit;
+	Promise<Void> ready;
+	Future<Void> failures;
+
+	AcknowledgementReceiver() : bytesSent(0), bytesAcknowledged(0), bytesLimit(std::numeric_limits<int64_t>::max()) {}
+
+	// Returns when fewer than bytesLimit sent bytes have not been acknowledged
+	Future<Void> onReady() {
+		if (ready.isSet() && ready.getFuture().isError()) {
+			return ready.getFuture();
+		}
+		if (bytesSent - bytesAcknowledged < bytesLimit) {
+			return Void();
+		}
+		if (ready.isSet()) {
+			ready = Promise<Void>();
+		}
+		return failures.isValid() ? ready.getFuture() || failures : ready.getFuture();
+	}
+
+	void acknowledge(int64_t bytes) {
+		ASSERT(bytes >= bytesAcknowledged);
+		bytesAcknowledged = bytes;
+		if (!ready.isSet() && bytesSent - bytesAcknowledged < bytesLimit) {
+			// Sending to the promise can destroy this receiver, so hold a local copy
+			Promise<Void> hold = ready;
+			hold.send(Void());
+		}
+	}
+
+	void sendError(Error const& e) {
+		if (ready.isSet()) {
+			if (ready.getFuture().isError()) return;
+			ready = Promise<Void>();
+		}
+		Promise<Void> hold = ready;
+		hold.sendError(e);
+	}
+
+	void receive(ArenaObjectReader& reader) override {
+		ErrorOr<AcknowledgementReply> message;
+		reader.deserialize(message);
+		if (message.isError()) {
+			// The receiving side sends operation_obsolete when it abandons the stream
+			sendError(message.getError());
+		} else {
+			acknowledge(message.get().bytes);
+		}
+	}
+	bool isStream() const override { return true; }
+};
+
+// Base class of the reply type of a ReplyPromiseStream. The first reply sent on a stream carries the token of the
+// sender's AcknowledgementReceiver.
+struct ReplyPromiseStreamReply {
+	Optional<UID> acknowledgeToken;
+	ReplyPromiseStreamReply() {}
+};
+
+template <class T>
+struct NetNotifiedQueueWithAcknowledgements final : NotifiedQueue<T>,
+                                                    FlowReceiver,
+                                                    FastAllocated<NetNotifiedQueueWithAcknowledgements<T>> {
+	using FastAllocated<NetNotifiedQueueWithAcknowledgements<T>>::operator new;
+	using FastAllocated<NetNotifiedQueueWithAcknowledgements<T>>::operator delete;
+
+	AcknowledgementReceiver acknowledgements;
+	Promise<Void> closed; // Set on the receiving side once no more messages are expected or the consumer went away
+	bool sentError = false;
+
+	NetNotifiedQueueWithAcknowledgements(int futures, int promises) : NotifiedQueue<T>(futures, promises) {}
+	NetNotifiedQueueWithAcknowledgements(int futures, int promises, const Endpoint& remoteEndpoint)
+	  : NotifiedQueue<T>(futures, promises), FlowReceiver(remoteEndpoint, false) {
+		// The sending side gives up on the stream once the receiver is disconnected or has destroyed its endpoint
+		acknowledgements.failures =
+		    tagError<Void>(IFailureMonitor::failureMonitor().onStateChanged(remoteEndpoint), operation_obsolete());
+	}
+
+	~NetNotifiedQueueWithAcknowledgements() {
+		if (isRemoteEndpoint() && !sentError) {
+			// The sender went away without finishing the stream
+			FlowTransport::transport().sendUnreliable(SerializeSource<ErrorOr<EnsureTable<T>>>(broken_promise()),
+			                                          getEndpoint(TaskPriority::ReadSocket), false);
+		}
+		if (acknowledgements.isRemoteEndpoint() && !this->error.isValid()) {
+			// The receiver went away before the end of the stream; tell the sender to stop
+			FlowTransport::transport().sendUnreliable(
+			    SerializeSource<ErrorOr<AcknowledgementReply>>(operation_obsolete()),
+			    acknowledgements.getEndpoint(TaskPriority::ReadSocket), false);
+		}
+	}
+
+	void close() {
+		if (!closed.isSet()) {
+			// Sending to the promise can destroy this queue, so hold a local copy
+			Promise<Void> hold = closed;
+			hold.send(Void());
+		}
+	}
+
+	void acknowledge(int64_t bytes) {
+		int64_t total = acknowledgements.bytesAcknowledged + bytes;
+		if (acknowledgements.isRemoteEndpoint()) {
+			acknowledgements.bytesAcknowledged = total;
+			FlowTransport::transport().sendUnreliable(
+			    SerializeSource<ErrorOr<AcknowledgementReply>>(AcknowledgementReply(total)),
+			    acknowledgements.getEndpoint(TaskPriority::ReadSocket), false);
+		} else {
+			acknowledgements.acknowledge(total);
+		}
+	}
+
+	void destroy() override { delete this; }
+	void cancel() override { close(); }
+	void receive(ArenaObjectReader& reader) override {
+		this->addPromiseRef();
+		ErrorOr<EnsureTable<T>> message;
+		reader.deserialize(message);
+		if (message.isError()) {
+			this->sendError(message.getError());
+			close();
+		} else {
+			T& reply = message.get().asUnderlyingType();
+			if (reply.acknowledgeToken.present() && !acknowledgements.getRawEndpoint().isValid()) {
+				acknowledgements.setRemoteEndpoint(
+				    FlowTransport::transport().loadedEndpoint(reply.acknowledgeToken.get()));
+			}
+			if (this->shouldFireImmediately()) {
+				// The reply goes straight to a waiting consumer and will never be popped
+				acknowledge(reply.expectedSize());
+			}
+			this->send(std::move(reply));
+		}
+		this->delPromiseRef();
+	}
+	T pop() override {
+		T reply = NotifiedQueue<T>::pop();
+		acknowledge(reply.expectedSize());
+		return reply;
+	}
+	bool isStream() const override { return true; }
+};
+
+template <class T>
+class ReplyPromiseStream {
+public:
+	// stream.send( reply )
+	//   Unreliable in-order delivery: replies are delivered in the order they were sent until the first failure.
+	//   Senders should wait on onReady() between replies so that at most setByteLimit() bytes are outstanding.
+	void send(const T& value) const {
+		if (queue->isRemoteEndpoint()) {
+			if (!queue->acknowledgements.getRawEndpoint().isValid()) {
+				// The first reply tells the receiver where to send its acknowledgements
+				T first = value;
+				first.acknowledgeToken = queue->acknowledgements.getEndpoint(TaskPriority::ReadSocket).token;
+				sendRemote(first);
+			} else {
+				sendRemote(value);
+			}
+		} else {
+			queue->acknowledgements.bytesSent += value.expectedSize();
+			queue->send(value);
+		}
+	}
+
+	// Ends the stream; end_of_stream() is the conventional error for a stream that completed normally
+	template <class E>
+	void sendError(const E& exc) const {
+		if (queue->isRemoteEndpoint()) {
+			if (!queue->sentError) {
+				queue->sentError = true;
+				FlowTransport::transport().sendUnreliable(SerializeSource<ErrorOr<EnsureTable<T>>>(exc),
+				                                          getEndpoint(), false);
+			}
+		} else {
+			queue->sendError(exc);
+			queue->close();
+		}
+	}
+
+	FutureStream<T> getFuture() const {
+		queue->addFutureRef();
+		return FutureStream<T>(queue);
+	}
+
+	// Limits the number of bytes which may be sent but not yet consumed by the receiver
+	void setByteLimit(int64_t byteLimit) const { queue->acknowledgements.bytesLimit = byteLimit; }
+
+	// Returns when the receiver has consumed enough of the stream to allow more replies to be sent.
+	// Throws operation_obsolete if the receiver abandoned the stream or became unreachable.
+	Future<Void> onReady() const { return queue->acknowledgements.onReady(); }
+
+	// Returns when the receiving side does not expect any more replies
+	Future<Void> onClosed() const { return queue->closed.getFuture(); }
+
+	ReplyPromiseStream() : queue(new NetNotifiedQueueWithAcknowledgements<T>(0, 1)) {}
+	explicit ReplyPromiseStream(const Endpoint& endpoint)
+	  : queue(new NetNotifiedQueueWithAcknowledgements<T>(0, 1, endpoint)) {}
+	ReplyPromiseStream(const ReplyPromiseStream& rhs) : queue(rhs.queue) { queue->addPromiseRef(); }
+	ReplyPromiseStream(ReplyPromiseStream&& rhs) noexcept : queue(rhs.queue) { rhs.queue = nullptr; }
+	void operator=(const ReplyPromiseStream& rhs) {
+		rhs.queue->addPromiseRef();
+		if (queue) queue->delPromiseRef();
+		queue = rhs.queue;
+	}
+	void operator=(ReplyPromiseStream&& rhs) noexcept {
+		if (queue != rhs.queue) {
+			if (queue) queue->delPromiseRef();
+			queue = rhs.queue;
+			rhs.queue = nullptr;
+		}
+	}
+	~ReplyPromiseStream() {
+		if (queue) queue->delPromiseRef();
+	}
+
+	// The endpoints of a ReplyPromiseStream are created at TaskPriority::ReadSocket, so that deliveries are never
+	// delayed and reordered behind each other
+	const Endpoint& getEndpoint(TaskPriority taskID = TaskPriority::ReadSocket) const {
+		return queue->getEndpoint(taskID);
+	}
+
+	bool operator==(const ReplyPromiseStream<T>& rhs) const { return queue == rhs.queue; }
+	bool isEmpty() const { return !queue->isReady(); }
+	void reset() { *this = ReplyPromiseStream<T>(); }
+
+private:
+	void sendRemote(const T& value) const {
+		queue->acknowledgements.bytesSent += value.expectedSize();
+		FlowTransport::transport().sendUnreliable(SerializeSource<ErrorOr<EnsureTable<T>>>(value), getEndpoint(),
+		                                          false);
+	}
+
+	NetNotifiedQueueWithAcknowledgements<T>* queue;
+};
+
+template <class Ar, class T>
+void save(Ar& ar, const ReplyPromiseStream<T>& value) {
+	auto const& ep = value.getEndpoint().token;
+	ar << ep;
+}
+
+template <class Ar, class T>
+void load(Ar& ar, ReplyPromiseStream<T>& value) {
+	UID token;
+	ar >> token;
+	Endpoint endpoint = FlowTransport::transport().loadedEndpoint(token);
+	value = ReplyPromiseStream<T>(endpoint);
+}
+
+template <class T>
+struct serializable_traits<ReplyPromiseStream<T>> : std::true_type {
+	template <class Archiver>
+	static void serialize(Archiver& ar, ReplyPromiseStream<T>& p) {
+		if constexpr (Archiver::isDeserializing) {
+			UID token;
+			serializer(ar, token);
+			auto endpoint = FlowTransport::transport().loadedEndpoint(token);
+			p = ReplyPromiseStream<T>(endpoint);
+		} else {
+			const auto& ep = p.getEndpoint().token;
+			serializer(ar, ep);
+		}
+	}
+};
+
+template <class Request>
+decltype(std::declval<Request>().reply) const& getReplyPromiseStream(Request const& r) {
+	return r.reply;
+}
+
+#define REPLYSTREAM_TYPE(RequestType) decltype(getReplyPromiseStream(std::declval<RequestType>()).getFuture().pop())
+
 template <class T>
 class RequestStream {
 public:
@@ -332,6 +638,25 @@ public:
 		}
 	}
 
+	// stream.getReplyStream( request )
+	//   Unreliable at most once delivery of the request, followed by in-order delivery of any number of replies.
+	//   The returned stream ends with end_of_stream() when the replier finishes it, or with another error if
+	//   the replier fails or communication is lost.
+	template <class X>
+	ReplyPromiseStream<REPLYSTREAM_TYPE(X)> getReplyStream(const X& value) const {
+		auto& p = getReplyPromiseStream(value);
+		if (queue->isRemoteEndpoint()) {
+			Future<Void> disc =
+			    makeDependent<T>(IFailureMonitor::failureMonitor()).onDisconnectOrFailure(getEndpoint());
+			Reference<Peer> peer =
+			    FlowTransport::transport().sendUnreliable(SerializeSource<T>(value), getEndpoint(), true);
+			endStreamOnDisconnect(disc, p, peer);
+		} else {
+			send(value);
+		}
+		return p;
+	}
+
 	// stream.getReplyUnlessFailedFor( request, double sustainedFailureDuration, double sustainedFailureSlope )
 	//   Reliable at least once delivery: Like getReply, delivers request at least once and returns one of the replies. However, if
 	//     the failure detector considers the endpoint failed permanently or for the given amount of time, returns failure instead.
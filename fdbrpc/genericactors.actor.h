@@ -221,6 +221,16 @@ Future<ErrorOr<X>> waitValueOrSignal( Future<X> value, Future<Void> signal, Endp
 	}
 }
 
+// Implements getReplyStream: ends the stream with an error if the replier becomes unreachable before finishing it
+ACTOR template <class T>
+void endStreamOnDisconnect(Future<Void> signal, ReplyPromiseStream<T> stream, Reference<Peer> peer = Reference<Peer>()) {
+	state PeerHolder holder = PeerHolder(peer);
+	choose {
+		when(wait(signal)) { stream.sendError(connection_failed()); }
+		when(wait(stream.onClosed())) {}
+	}
+}
+
 ACTOR template <class T> 
 Future<T> sendCanceler( ReplyPromise<T> reply, ReliablePacket* send, Endpoint endpoint ) {
 	try {
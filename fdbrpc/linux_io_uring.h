@@ -0,0 +1,178 @@
+/*
+ * linux_io_uring.h
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2018 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+// io_uring system calls and a minimal ring, in the spirit of linux_kaio.h, so that no liburing is needed
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+#ifndef __NR_io_uring_setup
+#define __NR_io_uring_setup 425
+#endif
+#ifndef __NR_io_uring_enter
+#define __NR_io_uring_enter 426
+#endif
+#ifndef __NR_io_uring_register
+#define __NR_io_uring_register 427
+#endif
+
+static int io_uring_setup(unsigned entries, io_uring_params* p) { return syscall( __NR_io_uring_setup, entries, p ); }
+static int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) { return syscall( __NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0 ); }
+static int io_uring_register(int fd, unsigned opcode, const void* arg, unsigned nr_args) { return syscall( __NR_io_uring_register, fd, opcode, arg, nr_args ); }
+
+// The submission and completion rings shared with the kernel.  Only the network thread uses a linux_io_uring.
+struct linux_io_uring {
+	int fd;
+
+	unsigned* sqHead;
+	unsigned* sqTail;
+	unsigned sqMask;
+	unsigned* sqArray;
+	io_uring_sqe* sqes;
+	unsigned sqLocalTail;  // Tail of the sqes prepared but not yet published to the kernel
+
+	unsigned* cqHead;
+	unsigned* cqTail;
+	unsigned cqMask;
+	io_uring_cqe* cqes;
+
+	void* sqRing;
+	size_t sqRingSize;
+	void* cqRing;
+	size_t cqRingSize;
+	size_t sqesSize;
+	unsigned entries;
+
+	linux_io_uring()
+	  : fd(-1), sqes((io_uring_sqe*)MAP_FAILED), sqLocalTail(0), sqRing(MAP_FAILED), cqRing(MAP_FAILED), entries(0) {}
+	~linux_io_uring() { close(); }
+
+	// Returns false, with errno set, if the kernel does not support io_uring
+	bool init(unsigned requestedEntries) {
+		io_uring_params p;
+		memset(&p, 0, sizeof(p));
+		fd = io_uring_setup(requestedEntries, &p);
+		if (fd < 0) return false;
+
+		entries = p.sq_entries;
+		sqRingSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+		cqRingSize = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+		sqesSize = p.sq_entries * sizeof(io_uring_sqe);
+
+		sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+		cqRing = mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+		sqes = (io_uring_sqe*)mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+		if (sqRing == MAP_FAILED || cqRing == MAP_FAILED || sqes == MAP_FAILED) {
+			close();
+			return false;
+		}
+
+		uint8_t* sq = (uint8_t*)sqRing;
+		sqHead = (unsigned*)(sq + p.sq_off.head);
+		sqTail = (unsigned*)(sq + p.sq_off.tail);
+		sqMask = *(unsigned*)(sq + p.sq_off.ring_mask);
+		sqArray = (unsigned*)(sq + p.sq_off.array);
+		sqLocalTail = *sqTail;
+
+		uint8_t* cq = (uint8_t*)cqRing;
+		cqHead = (unsigned*)(cq + p.cq_off.head);
+		cqTail = (unsigned*)(cq + p.cq_off.tail);
+		cqMask = *(unsigned*)(cq + p.cq_off.ring_mask);
+		cqes = (io_uring_cqe*)(cq + p.cq_off.cqes);
+		return true;
+	}
+
+	void close() {
+		if (sqes != MAP_FAILED) munmap(sqes, sqesSize);
+		if (cqRing != MAP_FAILED) munmap(cqRing, cqRingSize);
+		if (sqRing != MAP_FAILED) munmap(sqRing, sqRingSize);
+		sqes = (io_uring_sqe*)MAP_FAILED;
+		sqRing = cqRing = MAP_FAILED;
+		if (fd >= 0) ::close(fd);
+		fd = -1;
+	}
+
+	// Returns a zeroed sqe to fill in, or nullptr if the submission ring is full
+	io_uring_sqe* getSqe() {
+		unsigned head = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+		if (sqLocalTail - head >= entries) return nullptr;
+		unsigned index = sqLocalTail & sqMask;
+		io_uring_sqe* sqe = &sqes[index];
+		sqArray[index] = index;
+		++sqLocalTail;
+		memset(sqe, 0, sizeof(*sqe));
+		return sqe;
+	}
+
+	// Publishes the prepared sqes and submits them, along with any the kernel did not accept last time, with a single
+	// system call.  Returns the number submitted, or -errno.
+	int submit() {
+		__atomic_store_n(sqTail, sqLocalTail, __ATOMIC_RELEASE);
+		unsigned toSubmit = sqLocalTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+		if (!toSubmit) return 0;
+		int rc;
+		do {
+			rc = io_uring_enter(fd, toSubmit, 0, 0);
+		} while (rc < 0 && errno == EINTR);
+		return rc < 0 ? -errno : rc;
+	}
+
+	// Takes back the sqes which have been prepared but not yet consumed by the kernel, calling f(sqe) for each of them.
+	// After submit() fails outright the kernel has consumed none of them, and never will.  Returns the number taken.
+	template <class F>
+	int unprepare(F const& f) {
+		unsigned head = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+		int n = 0;
+		for (unsigned i = head; i != sqLocalTail; ++i, ++n) {
+			f(&sqes[i & sqMask]);
+		}
+		sqLocalTail = head;
+		__atomic_store_n(sqTail, sqLocalTail, __ATOMIC_RELEASE);
+		return n;
+	}
+
+	// Blocks until there are at least minComplete completions in the ring.  Returns 0, or -errno.
+	int waitForCompletions(unsigned minComplete) {
+		int rc;
+		do {
+			rc = io_uring_enter(fd, 0, minComplete, IORING_ENTER_GETEVENTS);
+		} while (rc < 0 && errno == EINTR);
+		return rc < 0 ? -errno : 0;
+	}
+
+	// Calls f(cqe) for each completion in the ring without making a system call.  Returns the number reaped.
+	template <class F>
+	int reap(F const& f) {
+		unsigned head = *cqHead;
+		unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+		int n = 0;
+		for (; head != tail; ++head, ++n) {
+			f(&cqes[head & cqMask]);
+		}
+		__atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+		return n;
+	}
+};
@@ -28,7 +28,9 @@
 #include "fdbclient/CommitTransaction.h"
 
 struct ConflictSet;
-ConflictSet* newConflictSet();
+// With threadCount > 1, large batches are checked on up to threadCount threads, each given at least minRangesPerThread
+// conflict ranges; write conflict ranges are applied to disjoint key partitions of the version history.
+ConflictSet* newConflictSet(int threadCount = 1, int minRangesPerThread = 1);
 void clearConflictSet(ConflictSet*, Version);
 void destroyConflictSet(ConflictSet*);
 
@@ -20,6 +20,7 @@
 
 #include "fdbserver/IDiskQueue.h"
 #include "fdbrpc/IAsyncFile.h"
+#include "fdbrpc/AsyncFileStriped.actor.h"
 #include "fdbserver/Knobs.h"
 #include "fdbrpc/simulator.h"
 #include "flow/crc32c.h"
@@ -127,6 +128,48 @@ private:
 	}
 };
 
+// A queue file is striped across DISK_QUEUE_STRIPES files (see AsyncFileStriped) when the queue is created.  The first
+// stripe has the name of the queue file itself, so a queue with one stripe is laid out as it always was.  Stripe i is
+// created in the (i-1)th of DISK_QUEUE_STRIPE_FOLDERS, round robin, or beside the first stripe if there are none.  The
+// header of a striped queue file records where its stripes are, so an existing queue is opened from them wherever the
+// folders now point.
+static const int DISK_QUEUE_STRIPE_BYTES = 64<<10;  // Part of the on disk format of a striped queue
+
+static std::string stripeFilename( std::string const& filename, int stripe ) {
+	if (stripe == 0) return filename;
+	std::string name = filename + format(".stripe%d", stripe);
+
+	std::vector<std::string> folders;
+	const std::string& knob = SERVER_KNOBS->DISK_QUEUE_STRIPE_FOLDERS;
+	for (size_t begin = 0; begin < knob.size();) {
+		size_t end = std::min(knob.find(',', begin), knob.size());
+		if (end > begin) folders.push_back(knob.substr(begin, end - begin));
+		begin = end + 1;
+	}
+	if (folders.empty()) return name;
+	return joinPath(folders[(stripe - 1) % folders.size()], ::basename(name));
+}
+
+// Stripes a new queue file, whose first stripe is open, across the given number of files
+static Future<Reference<IAsyncFile>> createStripes( std::string const& filename, Reference<IAsyncFile> first, int stripes, int64_t flags, int64_t mode ) {
+	if (stripes == 1) return first;
+
+	std::vector<std::string> otherNames;
+	for (int i = 1; i < stripes; i++) otherNames.push_back( stripeFilename(filename, i) );
+	return AsyncFileStriped::create( first, otherNames, DISK_QUEUE_STRIPE_BYTES, flags, mode );
+}
+
+// The files that a queue file is stored in
+static std::vector<std::string> queueFilenames( Reference<IAsyncFile> const& f ) {
+	if (auto striped = dynamic_cast<AsyncFileStriped*>(f.getPtr())) return striped->stripeFilenames();
+	return { f->getFilename() };
+}
+
+static int stripeCount( Reference<IAsyncFile> const& f ) {
+	auto striped = dynamic_cast<AsyncFileStriped*>(f.getPtr());
+	return striped ? striped->stripeCount() : 1;
+}
+
 // We use a Tracked instead of a Reference when the shutdown/destructor code would need to wait() on pending file operations (e.g., read).
 template <typename T>
 class Tracked {
@@ -219,10 +262,25 @@ public:
 	void close() { shutdown(this, false); }
 
 	StorageBytes getStorageBytes() const {
-		int64_t free;
-		int64_t total;
+		// Striped files may be spread over several devices, and the queue can only grow while all of them have room,
+		// so report the one with the least free space
+		std::set<std::string> folders = { parentDirectory(basename) };
+		for (int i = 0; i < 2; i++) {
+			if (!files[i].f) continue;
+			for (const std::string& name : queueFilenames(files[i].f)) folders.insert(parentDirectory(name));
+		}
 
-		g_network->getDiskBytes(parentDirectory(basename), free, total);
+		int64_t free = std::numeric_limits<int64_t>::max();
+		int64_t total = 0;
+		for (const std::string& folder : folders) {
+			int64_t folderFree;
+			int64_t folderTotal;
+			g_network->getDiskBytes(folder, folderFree, folderTotal);
+			if (folderFree < free) {
+				free = folderFree;
+				total = folderTotal;
+			}
+		}
 
 		return StorageBytes(free, total, files[0].size + files[1].size, free); // TODO: we could potentially do better in the available field by accounting for the unused pages at the end of the file
 	}
@@ -298,8 +356,13 @@ public:
 	ACTOR static Future<Reference<IAsyncFile>> replaceFile(Reference<IAsyncFile> toReplace) {
 		incrementalTruncate( toReplace );
 
-		Reference<IAsyncFile> _replacement = wait( IAsyncFileSystem::filesystem()->open( toReplace->getFilename(), IAsyncFile::OPEN_ATOMIC_WRITE_AND_CREATE | IAsyncFile::OPEN_CREATE | IAsyncFile::OPEN_READWRITE | IAsyncFile::OPEN_UNCACHED | IAsyncFile::OPEN_UNBUFFERED | IAsyncFile::OPEN_LOCK, 0600 ) );
-		state Reference<IAsyncFile> replacement = _replacement;
+		// The replacement is striped across the same files
+		state std::vector<std::string> names = queueFilenames( toReplace );
+		state int64_t flags = IAsyncFile::OPEN_ATOMIC_WRITE_AND_CREATE | IAsyncFile::OPEN_CREATE | IAsyncFile::OPEN_READWRITE | IAsyncFile::OPEN_UNCACHED | IAsyncFile::OPEN_UNBUFFERED | IAsyncFile::OPEN_LOCK;
+		state Reference<IAsyncFile> replacement = wait( IAsyncFileSystem::filesystem()->open( names[0], flags, 0600 ) );
+		if (names.size() > 1) {
+			wait( store( replacement, AsyncFileStriped::create( replacement, std::vector<std::string>(names.begin() + 1, names.end()), DISK_QUEUE_STRIPE_BYTES, flags, 0600 ) ) );
+		}
 		wait( replacement->sync() );
 
 		return replacement;
@@ -490,20 +553,52 @@ public:
 		// open the queue!
 
 		if (!fs[0].isError() && !fs[1].isError()) {
-			// Both files were opened OK: success
+			// Both files were opened OK: success.  Open whatever they are striped across, all of which must be there.
+			const int64_t stripeFlags = IAsyncFile::OPEN_READWRITE | IAsyncFile::OPEN_UNCACHED | IAsyncFile::OPEN_UNBUFFERED | IAsyncFile::OPEN_LOCK;
+			for (int i = 0; i < 2; i++)
+				fs[i] = AsyncFileStriped::open( fs[i].get(), stripeFlags );
+			try {
+				wait( waitForAll(fs) );
+			} catch (Error& e) {
+				if (e.code() == error_code_actor_cancelled) throw;
+				TraceEvent(SevError, "DiskQueueMissingStripe", self->dbgid).error(e)
+					.detail("File0", self->filename(0))
+					.detail("File1", self->filename(1));
+				throw;
+			}
+
+			const int stripes = stripeCount(fs[0].get());
+			if (stripeCount(fs[1].get()) != stripes) {
+				TraceEvent(SevError, "DiskQueueStripeMismatch", self->dbgid)
+					.detail("File0", self->filename(0))
+					.detail("File0Stripes", stripes)
+					.detail("File1Stripes", stripeCount(fs[1].get()));
+				throw io_error();
+			}
+			if (stripes != SERVER_KNOBS->DISK_QUEUE_STRIPES) {
+				TraceEvent(SevWarn, "DiskQueueExistingStripes", self->dbgid)
+					.detail("File0", self->filename(0))
+					.detail("Stripes", stripes)
+					.detail("ConfiguredStripes", SERVER_KNOBS->DISK_QUEUE_STRIPES);
+			}
 		} else if ( fs[0].isError() && fs[0].getError().code() == error_code_file_not_found &&
 					fs[1].isError() && fs[1].getError().code() == error_code_file_not_found )
 		{
 			// Neither file was found: we can create a new queue
 			// OPEN_ATOMIC_WRITE_AND_CREATE defers creation (using a .part file) until the calls to sync() below
-			TraceEvent("DiskQueueCreate").detail("File0", self->filename(0));
+			state int newStripes = std::max(1, SERVER_KNOBS->DISK_QUEUE_STRIPES);
+			TraceEvent("DiskQueueCreate").detail("File0", self->filename(0)).detail("Stripes", newStripes);
+			state int64_t createFlags = IAsyncFile::OPEN_ATOMIC_WRITE_AND_CREATE | IAsyncFile::OPEN_CREATE | IAsyncFile::OPEN_READWRITE | IAsyncFile::OPEN_UNCACHED | IAsyncFile::OPEN_UNBUFFERED | IAsyncFile::OPEN_LOCK;
 			for(int i=0; i<2; i++)
-				fs[i] = IAsyncFileSystem::filesystem()->open( self->filename(i), IAsyncFile::OPEN_ATOMIC_WRITE_AND_CREATE | IAsyncFile::OPEN_CREATE | IAsyncFile::OPEN_READWRITE | IAsyncFile::OPEN_UNCACHED | IAsyncFile::OPEN_UNBUFFERED | IAsyncFile::OPEN_LOCK, 0600 );
+				fs[i] = IAsyncFileSystem::filesystem()->open( self->filename(i), createFlags, 0600 );
 
 			// Any error here is fatal
 			wait( waitForAll(fs) );
 
-			// sync on each file to actually create it will be done below
+			// The stripes after the first are synced as they are created, and the first by the sync below
+			for (int i = 0; i < 2; i++)
+				fs[i] = createStripes( self->filename(i), fs[i].get(), newStripes, createFlags, 0600 );
+			wait( waitForAll(fs) );
 		} else {
 			// One file had a more serious error or one file is present and the other is not.  Die.
 			if (!fs[0].isError() || (fs[1].isError() && fs[1].getError().code() != error_code_file_not_found))
@@ -537,15 +632,21 @@ public:
 			// tLog, instead of DiskQueue, hold the future of the pending operations.
 			wait( self->onSafeToDestruct() );
 
-			for(int i=0; i<2; i++)
+			// The files to delete, first stripes first, and whether each delete must be durable
+			state std::vector<std::pair<std::string, bool>> toDelete;
+			for(int i=0; i<2; i++) {
+				for (const std::string& name : self->files[i].f ? queueFilenames(self->files[i].f) : std::vector<std::string>{ self->filename(i) })
+					toDelete.emplace_back(name, i == 1);
 				self->files[i].f.clear();
+			}
 
 			if (deleteFiles) {
 				TraceEvent("DiskQueueShutdownDeleting", self->dbgid)
 					.detail("File0", self->filename(0))
 					.detail("File1", self->filename(1));
-				wait( IAsyncFileSystem::filesystem()->incrementalDeleteFile( self->filename(0), false ) );
-				wait( IAsyncFileSystem::filesystem()->incrementalDeleteFile( self->filename(1), true ) );
+				state int d;
+				for (d = 0; d < toDelete.size(); d++)
+					wait( IAsyncFileSystem::filesystem()->incrementalDeleteFile( toDelete[d].first, toDelete[d].second ) );
 			}
 			TraceEvent("DiskQueueShutdownComplete", self->dbgid)
 				.detail("DeleteFiles", deleteFiles)
@@ -786,7 +887,8 @@ public:
 	// FIXME: Is setting lastCommittedSeq to -1 instead of 0 necessary?
 	DiskQueue( std::string basename, std::string fileExtension, UID dbgid, DiskQueueVersion diskQueueVersion, int64_t fileSizeWarningLimit )
 		: rawQueue( new RawDiskQueue_TwoFiles(basename, fileExtension, dbgid, fileSizeWarningLimit) ), dbgid(dbgid), diskQueueVersion(diskQueueVersion), anyPopped(false), nextPageSeq(0), poppedSeq(0), lastPoppedSeq(0),
-		  nextReadLocation(-1), readBufPage(nullptr), readBufPos(0), pushed_page_buffer(nullptr), recovered(false), initialized(false), lastCommittedSeq(-1), warnAlwaysForMemory(true)
+		  nextReadLocation(-1), readBufPage(nullptr), readBufPos(0), pushed_page_buffer(nullptr), recovered(false), initialized(false), lastCommittedSeq(-1), warnAlwaysForMemory(true),
+		  groupCommitInFlight(false), staged_page_buffer(nullptr), stagedPoppedPages(0), stagedCommits(0)
 	{
 	}
 
@@ -861,13 +963,15 @@ public:
 		backPage().zeroPad();
 		backPage().updateHash();
 
-		// Warn users that we pushed too many pages. 8000 is an arbitrary value.
-		if( pushedPageCount() >= 8000 ) {
+		// Warn users that we pushed too many pages. 8000 is an arbitrary value.  Pages staged behind a group commit in
+		// flight are held in memory too.
+		if( pushedPageCount() + stagedPageCount() >= 8000 ) {
 			TraceEvent( warnAlwaysForMemory ? SevWarnAlways : SevWarn, "DiskQueueMemoryWarning", dbgid)
 				.suppressFor(1.0)
 				.detail("PushedPages", pushedPageCount())
+				.detail("StagedPages", stagedPageCount())
 				.detail("NextPageSeq", nextPageSeq)
-				.detail("Details", format("%d pages", pushedPageCount()))
+				.detail("Details", format("%d pages", pushedPageCount() + stagedPageCount()))
 				.detail("File0Name", rawQueue->files[0].dbgFilename);
 			if(g_network->isSimulated())
 				warnAlwaysForMemory = false;
@@ -878,9 +982,24 @@ public:
 			.detail("RawFile0Name", rawQueue->files[0].dbgFilename);*/
 
 		lastCommittedSeq = backPage().endSeq();
-		auto f = rawQueue->pushAndCommit( pushed_page_buffer->ref(), pushed_page_buffer, poppedSeq/sizeof(Page) - lastPoppedSeq/sizeof(Page) );
+		uint64_t poppedPages = poppedSeq/sizeof(Page) - lastPoppedSeq/sizeof(Page);
 		lastPoppedSeq = poppedSeq;
+
+		if (groupCommitInFlight) {
+			// Another group is being written and synced; join the next group, which is written and synced as one
+			// when it finishes.
+			TEST(true);  // DiskQueue commit joined a group
+			stagePages(pushed_page_buffer, poppedPages);
+			pushed_page_buffer = 0;
+			return stagedCommitted.getFuture();
+		}
+
+		auto f = rawQueue->pushAndCommit( pushed_page_buffer->ref(), pushed_page_buffer, poppedPages );
 		pushed_page_buffer = 0;
+		if (SERVER_KNOBS->DISK_QUEUE_GROUP_COMMIT) {
+			groupCommitInFlight = true;
+			commitStagedGroups(this, f);
+		}
 		return f;
 	}
 
@@ -1043,6 +1162,59 @@ private:
 		}
 	}
 
+	// Appends the committed pages in `pages` to the group that will be committed after the one in flight
+	void stagePages(StringBuffer* pages, uint64_t poppedPages) {
+		if (!staged_page_buffer) {
+			staged_page_buffer = pages;
+		} else {
+			staged_page_buffer->alignReserve( sizeof(Page), staged_page_buffer->size() + pages->size() );
+			staged_page_buffer->append( pages->ref() );
+			delete pages;
+		}
+		stagedPoppedPages += poppedPages;
+		stagedCommits++;
+	}
+
+	// Commits the groups staged behind inFlight, one at a time, so that the raw queue does at most one write and one
+	// sync for all of the commits that arrive while the previous group is being made durable.  Groups are committed,
+	// and so their waiters released, in the order their commits were made.
+	ACTOR static void commitStagedGroups(DiskQueue* self, Future<Void> inFlight) {
+		state TrackMe trackme(self);
+		state Promise<Void> committed;  // The waiters of the group in flight, other than the first group's caller
+		loop {
+			try {
+				wait( inFlight );
+				committed.send(Void());
+			} catch (Error& e) {
+				committed.sendError(e);
+				if (self->staged_page_buffer) {
+					self->stagedCommitted.sendError(e);
+					self->stagedCommitted = Promise<Void>();
+					delete self->staged_page_buffer;
+					self->staged_page_buffer = nullptr;
+					self->stagedPoppedPages = 0;
+					self->stagedCommits = 0;
+				}
+				self->groupCommitInFlight = false;
+				return;
+			}
+
+			if (!self->staged_page_buffer) {
+				self->groupCommitInFlight = false;
+				return;
+			}
+
+			StringBuffer* pages = self->staged_page_buffer;
+			committed = self->stagedCommitted;
+			self->stagedCommitted = Promise<Void>();
+			self->staged_page_buffer = nullptr;
+			TEST(self->stagedCommits > 1);  // DiskQueue group of several commits
+			inFlight = self->rawQueue->pushAndCommit( pages->ref(), pages, self->stagedPoppedPages );
+			self->stagedPoppedPages = 0;
+			self->stagedCommits = 0;
+		}
+	}
+
 	ACTOR static void verifyCommit(DiskQueue* self, Future<Void> commitSynced, StringBuffer* buffer, loc_t start, loc_t end) {
 		state TrackMe trackme(self);
 		try {
@@ -1377,6 +1549,15 @@ private:
 	}
 	Page const& backPage() const { return ((Page*)pushed_page_buffer->ref().end())[-1]; }
 	int pushedPageCount() const { return pushed_page_buffer ? pushed_page_buffer->size() / sizeof(Page) : 0; }
+	int stagedPageCount() const { return staged_page_buffer ? staged_page_buffer->size() / sizeof(Page) : 0; }
+
+	// Group commit state.  While groupCommitInFlight, committed pages are staged in staged_page_buffer and their
+	// committers wait on stagedCommitted.
+	bool groupCommitInFlight;
+	StringBuffer* staged_page_buffer;
+	uint64_t stagedPoppedPages;
+	int stagedCommits;
+	Promise<Void> stagedCommitted;
 
 	// Recovery state
 	bool recovered;
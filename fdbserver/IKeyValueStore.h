@@ -42,14 +42,26 @@ public:
 	virtual void clear(KeyRangeRef range, const Arena* arena = nullptr) = 0;
 	virtual Future<Void> commit(bool sequential = false) = 0;  // returns when prior sets and clears are (atomically) durable
 
-	virtual Future<Optional<Value>> readValue( KeyRef key, Optional<UID> debugID = Optional<UID>() ) = 0;
+	// Tells the engine who is asking for a read so that background work can be queued and limited separately from
+	// latency sensitive client reads.
+	//   EAGER  - reads the storage server needs before it can apply a mutation batch (e.g. clear range ends, atomic ops)
+	//   FETCH  - bulk reads made while moving data (fetchKeys) or otherwise copying shards
+	//   LOW    - background scans such as consistency checks
+	//   NORMAL - client reads
+	enum class ReadType { EAGER, FETCH, LOW, NORMAL };
+
+	virtual Future<Optional<Value>> readValue( KeyRef key, ReadType type = ReadType::NORMAL, Optional<UID> debugID = Optional<UID>() ) = 0;
 
 	// Like readValue(), but returns only the first maxLength bytes of the value if it is longer
-	virtual Future<Optional<Value>> readValuePrefix( KeyRef key, int maxLength, Optional<UID> debugID = Optional<UID>() ) = 0;
+	virtual Future<Optional<Value>> readValuePrefix( KeyRef key, int maxLength, ReadType type = ReadType::NORMAL, Optional<UID> debugID = Optional<UID>() ) = 0;
 
 	// If rowLimit>=0, reads first rows sorted ascending, otherwise reads last rows sorted descending
 	// The total size of the returned value (less the last entry) will be less than byteLimit
-	virtual Future<Standalone<RangeResultRef>> readRange( KeyRangeRef keys, int rowLimit = 1<<30, int byteLimit = 1<<30 ) = 0;
+	virtual Future<Standalone<RangeResultRef>> readRange( KeyRangeRef keys, int rowLimit = 1<<30, int byteLimit = 1<<30, ReadType type = ReadType::NORMAL ) = 0;
+
+	// Tells the engine how far, in versions, its owner's durable version trails the owner's latest version. Engines may
+	// use it to give background maintenance less I/O while the owner is falling behind.
+	virtual void setDurabilityLag(Version lag) {}
 
 	// To debug MEMORY_RADIXTREE type ONLY
 	// Returns (1) how many key & value pairs have been inserted (2) how many nodes have been created (3) how many
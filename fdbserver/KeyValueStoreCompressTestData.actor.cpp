@@ -56,34 +56,36 @@ struct KeyValueStoreCompressTestData final : IKeyValueStore {
 	void clear(KeyRangeRef range, const Arena* arena = nullptr) override { store->clear(range, arena); }
 	Future<Void> commit(bool sequential = false) override { return store->commit(sequential); }
 
-	Future<Optional<Value>> readValue(KeyRef key, Optional<UID> debugID = Optional<UID>()) override {
-		return doReadValue(store, key, debugID);
+	Future<Optional<Value>> readValue(KeyRef key, ReadType type = ReadType::NORMAL,
+	                                  Optional<UID> debugID = Optional<UID>()) override {
+		return doReadValue(store, key, type, debugID);
 	}
 
 	// Note that readValuePrefix doesn't do anything in this implementation of IKeyValueStore, so the "atomic bomb" problem is still
 	// present if you are using this storage interface, but this storage interface is not used by customers ever. However, if you want
 	// to try to test malicious atomic op workloads with compressed values for some reason, you will need to fix this.
-	Future<Optional<Value>> readValuePrefix(KeyRef key, int maxLength,
+	Future<Optional<Value>> readValuePrefix(KeyRef key, int maxLength, ReadType type = ReadType::NORMAL,
 	                                        Optional<UID> debugID = Optional<UID>()) override {
-		return doReadValuePrefix( store, key, maxLength, debugID );
+		return doReadValuePrefix( store, key, maxLength, type, debugID );
 	}
 
 	// If rowLimit>=0, reads first rows sorted ascending, otherwise reads last rows sorted descending
 	// The total size of the returned value (less the last entry) will be less than byteLimit
-	Future<Standalone<RangeResultRef>> readRange(KeyRangeRef keys, int rowLimit = 1 << 30,
-	                                             int byteLimit = 1 << 30) override {
-		return doReadRange(store, keys, rowLimit, byteLimit);
+	Future<Standalone<RangeResultRef>> readRange(KeyRangeRef keys, int rowLimit = 1 << 30, int byteLimit = 1 << 30,
+	                                             ReadType type = ReadType::NORMAL) override {
+		return doReadRange(store, keys, rowLimit, byteLimit, type);
 	}
 
 private:
-	ACTOR static Future<Optional<Value>> doReadValue(IKeyValueStore* store, Key key, Optional<UID> debugID) {
-		Optional<Value> v = wait(store->readValue(key, debugID));
+	ACTOR static Future<Optional<Value>> doReadValue(IKeyValueStore* store, Key key, ReadType type,
+	                                                 Optional<UID> debugID) {
+		Optional<Value> v = wait(store->readValue(key, type, debugID));
 		if (!v.present()) return v;
 		return unpack(v.get());
 	}
 
-	ACTOR static Future<Optional<Value>> doReadValuePrefix( IKeyValueStore* store, Key key, int maxLength, Optional<UID> debugID ) {
-		Optional<Value> v = wait( doReadValue(store, key, debugID) );
+	ACTOR static Future<Optional<Value>> doReadValuePrefix( IKeyValueStore* store, Key key, int maxLength, ReadType type, Optional<UID> debugID ) {
+		Optional<Value> v = wait( doReadValue(store, key, type, debugID) );
 		if (!v.present()) return v;
 		if (maxLength < v.get().size()) {
 			return v.get().substr(0, maxLength);
@@ -92,8 +94,8 @@ private:
 			return v;
 		}
 	}
-	ACTOR Future<Standalone<RangeResultRef>> doReadRange( IKeyValueStore* store, KeyRangeRef keys, int rowLimit, int byteLimit ) {
-		Standalone<RangeResultRef> _vs = wait( store->readRange(keys, rowLimit, byteLimit) );
+	ACTOR Future<Standalone<RangeResultRef>> doReadRange( IKeyValueStore* store, KeyRangeRef keys, int rowLimit, int byteLimit, ReadType type ) {
+		Standalone<RangeResultRef> _vs = wait( store->readRange(keys, rowLimit, byteLimit, type) );
 		Standalone<RangeResultRef> vs = _vs; // Get rid of implicit const& from wait statement
 		Arena& a = vs.arena();
 		for(int i=0; i<vs.size(); i++)
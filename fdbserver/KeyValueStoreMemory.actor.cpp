@@ -26,12 +26,114 @@
 #include "fdbserver/IKeyValueStore.h"
 #include "fdbserver/RadixTree.h"
 #include "flow/ActorCollection.h"
+#include "flow/IThreadPool.h"
+#include "flow/UnitTest.h"
 #include "flow/actorcompiler.h"  // This must be the last #include.
 
 #define OP_DISK_OVERHEAD (sizeof(OpHeader) + 1)
 
 extern bool noUnseed;
 
+// A snapshot chunk logs a run of consecutive snapshot items as one OpSnapshotChunk.  The op's first parameter is the
+// last key of the run, which is all recovery needs before the chunk is decoded, and the second is the items.  Each item
+// is three varints (bytes shared with the previous key, then the lengths of the rest of the key and of the value)
+// followed by the rest of the key and the value.  Chunks share nothing with each other, so recovery can decode them
+// on several threads at once.
+typedef std::vector<std::pair<KeyValueMapPair, uint64_t>> SnapshotChunkItems;
+
+struct SnapshotChunkWriter {
+	std::string items;
+	std::string lastKey;
+	int count = 0;
+
+	bool empty() const { return !count; }
+	StringRef lastKeyRef() const { return StringRef((const uint8_t*)lastKey.data(), lastKey.size()); }
+
+	// Returns the number of bytes added to the chunk
+	int add(StringRef key, StringRef value) {
+		size_t before = items.size();
+		int prefix = count ? commonPrefixLength(lastKeyRef(), key) : 0;
+		appendVarint(prefix);
+		appendVarint(key.size() - prefix);
+		appendVarint(value.size());
+		items.append((const char*)key.begin() + prefix, key.size() - prefix);
+		items.append((const char*)value.begin(), value.size());
+		lastKey.assign((const char*)key.begin(), key.size());
+		++count;
+		return items.size() - before;
+	}
+
+	void reset() {
+		items.clear();
+		lastKey.clear();
+		count = 0;
+	}
+
+private:
+	void appendVarint(uint32_t v) {
+		while (v >= 0x80) {
+			items.push_back((char)(v | 0x80));
+			v >>= 7;
+		}
+		items.push_back((char)v);
+	}
+};
+
+static uint32_t readSnapshotChunkVarint(const uint8_t*& p, const uint8_t* end) {
+	uint32_t v = 0;
+	for (int shift = 0;; shift += 7) {
+		ASSERT(p < end && shift < 32);
+		uint8_t b = *p++;
+		v |= uint32_t(b & 0x7f) << shift;
+		if (!(b & 0x80)) return v;
+	}
+}
+
+// Decodes the items of a snapshot chunk into pairs ready to insert into a container.  Called on a recovery thread.
+static void decodeSnapshotChunk(StringRef chunk, int elementBytes, SnapshotChunkItems& out) {
+	std::string key;
+	const uint8_t* p = chunk.begin();
+	const uint8_t* end = chunk.end();
+	while (p < end) {
+		uint32_t prefix = readSnapshotChunkVarint(p, end);
+		uint32_t suffix = readSnapshotChunkVarint(p, end);
+		uint32_t valueSize = readSnapshotChunkVarint(p, end);
+		ASSERT(prefix <= key.size() && (int64_t)suffix + valueSize <= end - p);
+		key.resize(prefix);
+		key.append((const char*)p, suffix);
+		p += suffix;
+		KeyValueMapPair pair(StringRef((const uint8_t*)key.data(), key.size()), StringRef(p, valueSize));
+		p += valueSize;
+		uint64_t metric = pair.arena.getSize() + elementBytes;
+		out.emplace_back(std::move(pair), metric);
+	}
+}
+
+struct SnapshotChunkDecoder final : IThreadPoolReceiver {
+	void init() override {}
+
+	struct Decode final : TypedAction<SnapshotChunkDecoder, Decode> {
+		// The chunk is copied so that the log's arenas are never touched off the network thread
+		Decode(StringRef chunk, int elementBytes) : chunk(chunk.toString()), elementBytes(elementBytes) {}
+		double getTimeEstimate() const override { return 0.001; }
+
+		std::string chunk;
+		int elementBytes;
+		// A shared_ptr, rather than the items themselves, so that no arena reference count is touched by both threads
+		ThreadReturnPromise<std::shared_ptr<SnapshotChunkItems>> result;
+	};
+
+	void action(Decode& d) {
+		try {
+			auto items = std::make_shared<SnapshotChunkItems>();
+			decodeSnapshotChunk(StringRef(d.chunk), d.elementBytes, *items);
+			d.result.send(items);
+		} catch (Error& e) {
+			d.result.sendError(e);
+		}
+	}
+};
+
 template <typename Container>
 class KeyValueStoreMemory final : public IKeyValueStore, NonCopyable {
 public:
@@ -184,7 +286,9 @@ public:
 		return c;
 	}
 
-	Future<Optional<Value>> readValue(KeyRef key, Optional<UID> debugID = Optional<UID>()) override {
+	// The memory engine answers every read inline, so the read type is ignored
+	Future<Optional<Value>> readValue(KeyRef key, ReadType type = ReadType::NORMAL,
+	                                  Optional<UID> debugID = Optional<UID>()) override {
 		if (recovering.isError()) throw recovering.getError();
 		if (!recovering.isReady()) return waitAndReadValue(this, key);
 
@@ -193,7 +297,7 @@ public:
 		return Optional<Value>(it.getValue());
 	}
 
-	Future<Optional<Value>> readValuePrefix(KeyRef key, int maxLength,
+	Future<Optional<Value>> readValuePrefix(KeyRef key, int maxLength, ReadType type = ReadType::NORMAL,
 	                                        Optional<UID> debugID = Optional<UID>()) override {
 		if (recovering.isError()) throw recovering.getError();
 		if (!recovering.isReady()) return waitAndReadValuePrefix(this, key, maxLength);
@@ -210,8 +314,8 @@ public:
 
 	// If rowLimit>=0, reads first rows sorted ascending, otherwise reads last rows sorted descending
 	// The total size of the returned value (less the last entry) will be less than byteLimit
-	Future<Standalone<RangeResultRef>> readRange(KeyRangeRef keys, int rowLimit = 1 << 30,
-	                                             int byteLimit = 1 << 30) override {
+	Future<Standalone<RangeResultRef>> readRange(KeyRangeRef keys, int rowLimit = 1 << 30, int byteLimit = 1 << 30,
+	                                             ReadType type = ReadType::NORMAL) override {
 		if(recovering.isError()) throw recovering.getError();
 		if (!recovering.isReady()) return waitAndReadRange(this, keys, rowLimit, byteLimit);
 
@@ -271,7 +375,8 @@ private:
 		OpSnapshotAbort, // terminate an in progress snapshot in order to start a full snapshot
 		OpCommit, // only in log, not in queue
 		OpRollback, // only in log, not in queue
-		OpSnapshotItemDelta
+		OpSnapshotItemDelta,
+		OpSnapshotChunk // a run of snapshot items; see SnapshotChunkWriter
 	};
 
 	struct OpRef {
@@ -295,6 +400,7 @@ private:
 			numBytes = 0;
 			operations = Standalone<VectorRef<OpRef>>();
 			arenas.clear();
+			snapshotChunks.clear();
 		}
 
 		void rollback() { clear(); }
@@ -309,6 +415,25 @@ private:
 			queue_op(OpClearToEnd, fromKey, StringRef(), arena);
 		}
 
+		// Only queued during recovery: replaces everything in range with the items of a snapshot chunk, once decoded
+		void snapshot_chunk(KeyRangeRef range, Future<std::shared_ptr<SnapshotChunkItems>> items, const Arena* arena) {
+			queue_op(OpSnapshotChunk, range.begin, range.end, arena);
+			snapshotChunks.push_back(items);
+		}
+
+		int snapshotChunkCount() const { return snapshotChunks.size(); }
+
+		bool snapshotChunksReady() const {
+			for (auto& c : snapshotChunks) {
+				if (!c.isReady()) return false;
+			}
+			return true;
+		}
+
+		Future<Void> onSnapshotChunksDecoded() const { return waitForAll(snapshotChunks); }
+
+		SnapshotChunkItems const& snapshotChunk(int i) const { return *snapshotChunks[i].get(); }
+
 		void queue_op(OpType op, StringRef p1, StringRef p2, const Arena* arena) {
 			numBytes += p1.size() + p2.size() + sizeof(OpHeader) + sizeof(OpRef);
 
@@ -332,6 +457,7 @@ private:
 		Standalone<VectorRef<OpRef>> operations;
 		uint64_t numBytes;
 		std::vector<Arena> arenas;
+		std::vector<Future<std::shared_ptr<SnapshotChunkItems>>> snapshotChunks;
 	};
 	KeyValueStoreType type;
 	UID id;
@@ -366,9 +492,11 @@ private:
 
 	int64_t memoryLimit; // The upper limit on the memory used by the store (excluding, possibly, some clear operations)
 	std::vector<std::pair<KeyValueMapPair, uint64_t>> dataSets;
+	Reference<IThreadPool> recoveryThreads; // Decodes snapshot chunks during recovery, if KVS_MEM_RECOVERY_THREADS > 0
 
 	int64_t commit_queue(OpQueue& ops, bool log, bool sequential = false) {
 		int64_t total = 0, count = 0;
+		int snapshotChunk = 0;
 		IDiskQueue::location log_location = 0;
 
 		for (auto o = ops.begin(); o != ops.end(); ++o) {
@@ -393,6 +521,19 @@ private:
 					dataSets.clear();
 				}
 				data.erase(data.lower_bound(o->p1), data.end());
+			} else if (o->op == OpSnapshotChunk) {
+				ASSERT(!log);
+				if (sequential) {
+					data.insert(dataSets);
+					dataSets.clear();
+				}
+				data.erase(data.lower_bound(o->p1), data.lower_bound(o->p2));
+				SnapshotChunkItems const& items = ops.snapshotChunk(snapshotChunk++);
+				if constexpr (std::is_same<Container, IKeyValueContainer>::value) {
+					data.insert(items);
+				} else {
+					for (auto& item : items) data.insert(item.first.key, item.first.value);
+				}
 			} else
 				ASSERT(false);
 			if (log) log_location = log_op(o->op, o->p1, o->p2);
@@ -424,6 +565,40 @@ private:
 		return log->push(LiteralStringRef("\x01")); // Changes here should be reflected in OP_DISK_OVERHEAD
 	}
 
+	// Logs the items gathered in chunk as one op and empties it.  Returns the bytes logged beyond what chunk.add() returned.
+	int log_snapshot_chunk(SnapshotChunkWriter& chunk) {
+		ASSERT(!chunk.empty());
+		int overhead = chunk.lastKey.size() + OP_DISK_OVERHEAD;
+		log_op(OpSnapshotChunk, chunk.lastKeyRef(), StringRef(chunk.items));
+		chunk.reset();
+		return overhead;
+	}
+
+	Future<std::shared_ptr<SnapshotChunkItems>> decode_snapshot_chunk(StringRef chunk) {
+		const int elementBytes =
+		    std::is_same<Container, IKeyValueContainer>::value ? IKeyValueContainer::getElementBytes() : 0;
+		if (!recoveryThreads && SERVER_KNOBS->KVS_MEM_RECOVERY_THREADS > 0) {
+			if (g_network->isSimulated()) {
+				recoveryThreads = Reference<IThreadPool>(new DummyThreadPool());
+				recoveryThreads->addThread(new SnapshotChunkDecoder());
+			} else {
+				recoveryThreads = createGenericThreadPool();
+				for (int i = 0; i < SERVER_KNOBS->KVS_MEM_RECOVERY_THREADS; i++) {
+					recoveryThreads->addThread(new SnapshotChunkDecoder());
+				}
+			}
+		}
+		if (!recoveryThreads) {
+			auto items = std::make_shared<SnapshotChunkItems>();
+			decodeSnapshotChunk(chunk, elementBytes, *items);
+			return items;
+		}
+		auto decode = new SnapshotChunkDecoder::Decode(chunk, elementBytes);
+		Future<std::shared_ptr<SnapshotChunkItems>> result = decode->result.getFuture();
+		recoveryThreads->post(decode);
+		return result;
+	}
+
 	ACTOR static Future<Void> recover( KeyValueStoreMemory* self, bool exactRecovery ) {
 		loop {
 			// 'uncommitted' variables track something that might be rolled back by an OpRollback, and are copied into permanent variables
@@ -447,6 +622,11 @@ private:
 			state OpHeader h;
 			state Standalone<StringRef> lastSnapshotKey;
 
+			// Committed transactions that can't be applied until their snapshot chunks are decoded, oldest first
+			state std::deque<OpQueue> decodingQueues;
+			state int snapshotChunksDecoding = 0;
+			state int dbgSnapshotChunkCount = 0;
+
 			TraceEvent("KVSMemRecoveryStarted", self->id)
 				.detail("SnapshotEndLocation", uncommittedSnapshotEnd);
 
@@ -517,6 +697,15 @@ private:
 							uncommittedNextKey = keyAfter(p1);
 							++dbgSnapshotItemCount;
 							lastSnapshotKey = Key(p1, data.arena());
+						} else if (h.op == OpSnapshotChunk) { // run of snapshot data items ending at p1
+							Arena &dataArena = *(Arena *)&data.arena();
+							KeyRef chunkEnd = keyAfter(p1, dataArena);
+							KeyRef chunkBegin = std::min<KeyRef>(KeyRef(dataArena, uncommittedNextKey), chunkEnd);
+							recoveryQueue.snapshot_chunk(KeyRangeRef(chunkBegin, chunkEnd), self->decode_snapshot_chunk(p2), &data.arena());
+							++snapshotChunksDecoding;
+							uncommittedNextKey = Key(chunkEnd, data.arena());
+							++dbgSnapshotChunkCount;
+							lastSnapshotKey = Key(p1, data.arena());
 						} else if (h.op == OpSnapshotEnd || h.op == OpSnapshotAbort) { // snapshot complete
 							TraceEvent("RecSnapshotEnd", self->id)
 								.detail("NextKey", uncommittedNextKey)
@@ -541,12 +730,19 @@ private:
 						} else if (h.op == OpClearToEnd) { //clear all data from begin key to end
 							recoveryQueue.clear_to_end( p1, &data.arena() );
 						} else if (h.op == OpCommit) { // commit previous transaction
-							self->commit_queue(recoveryQueue, false);
+							if (decodingQueues.empty() && !recoveryQueue.snapshotChunkCount()) {
+								self->commit_queue(recoveryQueue, false);
+							} else {
+								// Keep reading ahead while the chunks decode; transactions are still applied in order
+								decodingQueues.push_back(std::move(recoveryQueue));
+								recoveryQueue.clear();
+							}
 							++dbgCommitCount;
 							self->recoveredSnapshotKey = uncommittedNextKey;
 							self->previousSnapshotEnd = uncommittedPrevSnapshotEnd;
 							self->currentSnapshotEnd = uncommittedSnapshotEnd;
 						} else if (h.op == OpRollback) { // rollback previous transaction
+							snapshotChunksDecoding -= recoveryQueue.snapshotChunkCount();
 							recoveryQueue.rollback();
 							TraceEvent("KVSMemRecSnapshotRollback", self->id)
 								.detail("NextKey", uncommittedNextKey);
@@ -563,9 +759,20 @@ private:
 							.detail("EndsAt", self->log->getNextReadLocation());
 					}
 
+					// Apply the decoded transactions, waiting for the oldest if too many chunks are outstanding
+					while (!decodingQueues.empty() &&
+					       (decodingQueues.front().snapshotChunksReady() ||
+					        snapshotChunksDecoding > SERVER_KNOBS->KVS_MEM_RECOVERY_CHUNKS_IN_FLIGHT)) {
+						wait(decodingQueues.front().onSnapshotChunksDecoded());
+						snapshotChunksDecoding -= decodingQueues.front().snapshotChunkCount();
+						self->commit_queue(decodingQueues.front(), false);
+						decodingQueues.pop_front();
+					}
+
 					if (loggingDelay.isReady()) {
 						TraceEvent("KVSMemRecoveryLogSnap", self->id)
 							.detail("SnapshotItems", dbgSnapshotItemCount)
+							.detail("SnapshotChunks", dbgSnapshotChunkCount)
 							.detail("SnapshotEnd", dbgSnapshotEndCount)
 							.detail("Mutations", dbgMutationCount)
 							.detail("Commits", dbgCommitCount)
@@ -576,6 +783,13 @@ private:
 					wait( yield() );
 				}
 
+				while (!decodingQueues.empty()) {
+					wait(decodingQueues.front().onSnapshotChunksDecoded());
+					self->commit_queue(decodingQueues.front(), false);
+					decodingQueues.pop_front();
+				}
+				self->recoveryThreads.clear();
+
 				if (zeroFillSize) {
 					if( exactRecovery ) {
 						TraceEvent(SevError, "KVSMemExpectedExact", self->id);
@@ -595,6 +809,7 @@ private:
 
 				TraceEvent("KVSMemRecovered", self->id)
 					.detail("SnapshotItems", dbgSnapshotItemCount)
+					.detail("SnapshotChunks", dbgSnapshotChunkCount)
 					.detail("SnapshotEnd", dbgSnapshotEndCount)
 					.detail("Mutations", dbgMutationCount)
 					.detail("Commits", dbgCommitCount)
@@ -624,12 +839,23 @@ private:
 
 		int count = 0;
 		int64_t snapshotSize = 0;
+		SnapshotChunkWriter chunk;
 		for (auto kv = snapshotData.begin(); kv != snapshotData.end(); ++kv) {
 			StringRef tempKey = kv.getKey(reserved_buffer);
-			log_op(OpSnapshotItem, tempKey, kv.getValue());
-			snapshotSize += tempKey.size() + kv.getValue().size() + OP_DISK_OVERHEAD;
+			if (SERVER_KNOBS->KVS_MEM_SNAPSHOT_CHUNK_BYTES > 0) {
+				snapshotSize += chunk.add(tempKey, kv.getValue());
+				if (chunk.items.size() >= SERVER_KNOBS->KVS_MEM_SNAPSHOT_CHUNK_BYTES) {
+					snapshotSize += log_snapshot_chunk(chunk);
+				}
+			} else {
+				log_op(OpSnapshotItem, tempKey, kv.getValue());
+				snapshotSize += tempKey.size() + kv.getValue().size() + OP_DISK_OVERHEAD;
+			}
 			++count;
 		}
+		if (!chunk.empty()) {
+			snapshotSize += log_snapshot_chunk(chunk);
+		}
 
 		TraceEvent("FullSnapshotEnd", id)
 		    .detail("PreviousSnapshotEndLoc", previousSnapshotEnd)
@@ -655,6 +881,10 @@ private:
 		state Key lastSnapshotKeyB = makeString(CLIENT_KNOBS->SYSTEM_KEY_SIZE_LIMIT);
 		state bool lastSnapshotKeyUsingA = true;
 
+		// With KVS_MEM_SNAPSHOT_CHUNK_BYTES, items are instead gathered into chunks, each of which is logged before the
+		// wait above so that a chunk never spans a change to the data
+		state SnapshotChunkWriter chunk;
+
 		TraceEvent("KVSMemStartingSnapshot", self->id).detail("StartKey", nextKey);
 
 		loop {
@@ -687,6 +917,10 @@ private:
 			loop {
 
 				if (next == self->data.end()) {
+					if (!chunk.empty()) {
+						snapshotTotalWrittenBytes += self->log_snapshot_chunk(chunk);
+					}
+
 					// After a snapshot end is logged, recovery may not see the last snapshot item logged before it so the 
 					// next snapshot item logged cannot be a delta.
 					useDelta = false;
@@ -724,6 +958,31 @@ private:
 						break;
 					}
 
+				} else if (SERVER_KNOBS->KVS_MEM_SNAPSHOT_CHUNK_BYTES > 0) {
+					KeyRef tempKey = next.getKey(self->reserved_buffer);
+					uint64_t opBytes = chunk.add(tempKey, next.getValue());
+					snapItems++;
+					snapshotBytes += opBytes;
+					snapshotTotalWrittenBytes += opBytes;
+
+					bool stopping = snapshotTotalWrittenBytes >= self->notifiedCommittedWriteBytes.get();
+					if (stopping) {
+						nextKey = Key(chunk.lastKeyRef());
+					}
+					if (stopping || chunk.items.size() >= SERVER_KNOBS->KVS_MEM_SNAPSHOT_CHUNK_BYTES) {
+						int overhead = self->log_snapshot_chunk(chunk);
+						snapshotBytes += overhead;
+						snapshotTotalWrittenBytes += overhead;
+					}
+
+					// If we're not stopping now, increment next
+					if (!stopping) {
+						++next;
+					} else {
+						// Otherwise, save state for continuing after the next wait and stop
+						nextKeyAfter = true;
+						break;
+					}
 				} else {
 					// destKey is whichever of the two last key buffers we should write to next.
 					Key &destKey = lastSnapshotKeyUsingA ? lastSnapshotKeyA : lastSnapshotKeyB;
@@ -855,3 +1114,34 @@ IKeyValueStore* keyValueStoreLogSystem( class IDiskQueue* queue, UID logID, int6
 	return new KeyValueStoreMemory<IKeyValueContainer>(queue, logID, memoryLimit, KeyValueStoreType::MEMORY,
 	                                                   disableSnapshot, replaceContent, exactRecovery);
 }
+
+TEST_CASE("/fdbserver/KeyValueStoreMemory/SnapshotChunk") {
+	std::set<std::string> keys;
+	int count = deterministicRandom()->randomInt(1, 1000);
+	while (keys.size() < count) {
+		// Few distinct bytes so that neighbouring keys often share long prefixes
+		std::string key;
+		int length = deterministicRandom()->randomInt(0, 300);
+		for (int i = 0; i < length; i++) key.push_back('a' + deterministicRandom()->randomInt(0, 3));
+		keys.insert(key);
+	}
+
+	SnapshotChunkWriter writer;
+	std::vector<std::pair<std::string, std::string>> expected;
+	for (auto& key : keys) {
+		std::string value = deterministicRandom()->randomAlphaNumeric(deterministicRandom()->randomInt(0, 200));
+		writer.add(StringRef(key), StringRef(value));
+		expected.emplace_back(key, value);
+	}
+	ASSERT(writer.count == count && writer.lastKeyRef() == StringRef(expected.back().first));
+
+	SnapshotChunkItems items;
+	decodeSnapshotChunk(StringRef(writer.items), IKeyValueContainer::getElementBytes(), items);
+	ASSERT(items.size() == count);
+	for (int i = 0; i < count; i++) {
+		ASSERT(items[i].first.key == StringRef(expected[i].first));
+		ASSERT(items[i].first.value == StringRef(expected[i].second));
+		ASSERT(items[i].second == items[i].first.arena.getSize() + IKeyValueContainer::getElementBytes());
+	}
+	return Void();
+}
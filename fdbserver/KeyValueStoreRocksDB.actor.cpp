@@ -4,12 +4,17 @@
 #include <rocksdb/db.h>
 #include <rocksdb/filter_policy.h>
 #include <rocksdb/options.h>
+#include <rocksdb/rate_limiter.h>
 #include <rocksdb/slice_transform.h>
+#include <rocksdb/statistics.h>
 #include <rocksdb/table.h>
 #include <rocksdb/utilities/table_properties_collectors.h>
 #include "flow/flow.h"
 #include "flow/IThreadPool.h"
 
+#include <atomic>
+#include <deque>
+
 #endif // SSD_ROCKSDB_EXPERIMENTAL
 
 #include "fdbserver/IKeyValueStore.h"
@@ -95,8 +100,10 @@ struct RocksDBKeyValueStore : IKeyValueStore {
 	struct Writer : IThreadPoolReceiver {
 		DB& db;
 		UID id;
+		std::atomic<uint64_t>& commitCount;
 
-		explicit Writer(DB& db, UID id) : db(db), id(id) {}
+		explicit Writer(DB& db, UID id, std::atomic<uint64_t>& commitCount)
+		  : db(db), id(id), commitCount(commitCount) {}
 
 		~Writer() override {
 			if (db) {
@@ -116,6 +123,8 @@ struct RocksDBKeyValueStore : IKeyValueStore {
 
 		struct OpenAction : TypedAction<Writer, OpenAction> {
 			std::string path;
+			std::shared_ptr<rocksdb::RateLimiter> rateLimiter;
+			std::shared_ptr<rocksdb::Statistics> statistics;
 			ThreadReturnPromise<Void> done;
 
 			double getTimeEstimate() const override { return SERVER_KNOBS->COMMIT_TIME_ESTIMATE; }
@@ -134,7 +143,10 @@ struct RocksDBKeyValueStore : IKeyValueStore {
 			std::vector<rocksdb::ColumnFamilyDescriptor> defaultCF = { rocksdb::ColumnFamilyDescriptor{
 				"default", getCFOptions() } };
 			std::vector<rocksdb::ColumnFamilyHandle*> handle;
-			auto status = rocksdb::DB::Open(getOptions(), a.path, defaultCF, &handle, &db);
+			auto options = getOptions();
+			options.rate_limiter = a.rateLimiter;
+			options.statistics = a.statistics;
+			auto status = rocksdb::DB::Open(options, a.path, defaultCF, &handle, &db);
 			if (!status.ok()) {
 				TraceEvent(SevError, "RocksDBError").detail("Error", status.ToString()).detail("Method", "Open");
 				a.done.sendError(statusToError(status));
@@ -176,6 +188,9 @@ struct RocksDBKeyValueStore : IKeyValueStore {
 				TraceEvent(SevError, "RocksDBError").detail("Error", s.ToString()).detail("Method", "Commit");
 				a.done.sendError(statusToError(s));
 			} else {
+				// Readers refresh their pooled iterators when they see this change, so it must happen before the
+				// commit is acknowledged.
+				++commitCount;
 				a.done.send(Void());
 				for (const auto& keyRange : deletes) {
 					auto begin = toSlice(keyRange.begin);
@@ -218,11 +233,45 @@ struct RocksDBKeyValueStore : IKeyValueStore {
 
 	struct Reader : IThreadPoolReceiver {
 		DB& db;
+		const std::atomic<uint64_t>& commitCount;
+
+		// Range reads reuse one iterator per reader thread instead of creating one per ReadRangeAction. The iterator
+		// reads through bounds which point at lowerBound and upperBound, so each read only has to update those, and it
+		// is refreshed whenever a commit has completed since it was created or last refreshed. An idle reader keeps at
+		// most one old version of the database pinned until its next range read.
+		std::unique_ptr<rocksdb::Iterator> iterator;
+		uint64_t iteratorCommitCount = 0;
+		Key lowerBoundKey, upperBoundKey;
+		rocksdb::Slice lowerBound, upperBound;
 
-		explicit Reader(DB& db) : db(db) {}
+		explicit Reader(DB& db, const std::atomic<uint64_t>& commitCount) : db(db), commitCount(commitCount) {}
 
 		void init() override {}
 
+		rocksdb::Iterator* getIterator(KeyRangeRef keys) {
+			lowerBoundKey = keys.begin;
+			upperBoundKey = keys.end;
+			lowerBound = toSlice(lowerBoundKey);
+			upperBound = toSlice(upperBoundKey);
+
+			// Read the commit count first so that a commit which lands during the refresh is not missed
+			uint64_t currentCommitCount = commitCount.load();
+			if (iterator && iteratorCommitCount != currentCommitCount && !iterator->Refresh().ok()) {
+				iterator.reset();
+			}
+			if (!iterator) {
+				auto options = getReadOptions();
+				// When using a prefix extractor, ensure that keys are returned in order even if they cross
+				// a prefix boundary.
+				options.auto_prefix_mode = (SERVER_KNOBS->ROCKSDB_PREFIX_LEN > 0);
+				options.iterate_lower_bound = &lowerBound;
+				options.iterate_upper_bound = &upperBound;
+				iterator.reset(db->NewIterator(options));
+			}
+			iteratorCommitCount = currentCommitCount;
+			return iterator.get();
+		}
+
 		struct ReadValueAction : TypedAction<Reader, ReadValueAction> {
 			Key key;
 			Optional<UID> debugID;
@@ -285,6 +334,47 @@ struct RocksDBKeyValueStore : IKeyValueStore {
 			}
 		}
 
+		// A batch of point reads, served by a single MultiGet so that RocksDB can share index and filter lookups across
+		// keys in the same blocks. Values are read into slices pinned in the block cache and copied once into the
+		// replies.
+		struct MultiGetAction : TypedAction<Reader, MultiGetAction> {
+			struct Get {
+				Key key;
+				int maxLength;
+				ThreadReturnPromise<Optional<Value>> result;
+				Get(KeyRef key, int maxLength) : key(key), maxLength(maxLength) {}
+			};
+			// A deque because the promises can't be moved
+			std::deque<Get> gets;
+			double getTimeEstimate() const override { return SERVER_KNOBS->READ_VALUE_TIME_ESTIMATE * gets.size(); }
+		};
+		void action(MultiGetAction& a) {
+			const size_t count = a.gets.size();
+			std::vector<rocksdb::Slice> keys;
+			keys.reserve(count);
+			for (const auto& get : a.gets) {
+				keys.push_back(toSlice(get.key));
+			}
+			std::vector<rocksdb::PinnableSlice> values(count);
+			std::vector<rocksdb::Status> statuses(count);
+			db->MultiGet(getReadOptions(), db->DefaultColumnFamily(), count, keys.data(), values.data(),
+			             statuses.data());
+			for (size_t i = 0; i < count; ++i) {
+				auto& get = a.gets[i];
+				if (statuses[i].ok()) {
+					get.result.send(Value(StringRef(reinterpret_cast<const uint8_t*>(values[i].data()),
+					                                std::min(values[i].size(), size_t(get.maxLength)))));
+				} else {
+					if (!statuses[i].IsNotFound()) {
+						TraceEvent(SevError, "RocksDBError")
+						    .detail("Error", statuses[i].ToString())
+						    .detail("Method", "MultiGet");
+					}
+					get.result.send(Optional<Value>());
+				}
+			}
+		}
+
 		struct ReadRangeAction : TypedAction<Reader, ReadRangeAction>, FastAllocated<ReadRangeAction> {
 			KeyRange keys;
 			int rowLimit, byteLimit;
@@ -296,17 +386,12 @@ struct RocksDBKeyValueStore : IKeyValueStore {
 			Standalone<RangeResultRef> result;
 			if (a.rowLimit == 0 || a.byteLimit == 0) {
 				a.result.send(result);
+				return;
 			}
 			int accumulatedBytes = 0;
 			rocksdb::Status s;
-			auto options = getReadOptions();
-			// When using a prefix extractor, ensure that keys are returned in order even if they cross
-			// a prefix boundary.
-			options.auto_prefix_mode = (SERVER_KNOBS->ROCKSDB_PREFIX_LEN > 0);
+			rocksdb::Iterator* cursor = getIterator(a.keys);
 			if (a.rowLimit >= 0) {
-				auto endSlice = toSlice(a.keys.end);
-				options.iterate_upper_bound = &endSlice;
-				auto cursor = std::unique_ptr<rocksdb::Iterator>(db->NewIterator(options));
 				cursor->Seek(toSlice(a.keys.begin));
 				while (cursor->Valid() && toStringRef(cursor->key()) < a.keys.end) {
 					KeyValueRef kv(toStringRef(cursor->key()), toStringRef(cursor->value()));
@@ -320,9 +405,6 @@ struct RocksDBKeyValueStore : IKeyValueStore {
 				}
 				s = cursor->status();
 			} else {
-				auto beginSlice = toSlice(a.keys.begin);
-				options.iterate_lower_bound = &beginSlice;
-				auto cursor = std::unique_ptr<rocksdb::Iterator>(db->NewIterator(options));
 				cursor->SeekForPrev(toSlice(a.keys.end));
 				if (cursor->Valid() && toStringRef(cursor->key()) == a.keys.end) {
 					cursor->Prev();
@@ -342,6 +424,7 @@ struct RocksDBKeyValueStore : IKeyValueStore {
 
 			if (!s.ok()) {
 				TraceEvent(SevError, "RocksDBError").detail("Error", s.ToString()).detail("Method", "ReadRange");
+				iterator.reset();
 			}
 			result.more =
 			    (result.size() == a.rowLimit) || (result.size() == -a.rowLimit) || (accumulatedBytes >= a.byteLimit);
@@ -357,19 +440,90 @@ struct RocksDBKeyValueStore : IKeyValueStore {
 	UID id;
 	Reference<IThreadPool> writeThread;
 	Reference<IThreadPool> readThreads;
+	// Fetch and low priority reads get their own reader threads so they cannot queue ahead of client reads
+	Reference<IThreadPool> fetchThreads;
 	Promise<Void> errorPromise;
 	Promise<Void> closePromise;
 	std::unique_ptr<rocksdb::WriteBatch> writeBatch;
+	// Number of commits written so far, used by readers to tell when their pooled iterators are stale
+	std::atomic<uint64_t> commitCount;
+	// Point reads which arrive in the same run loop iteration are collected here and served by one MultiGet
+	std::unique_ptr<Reader::MultiGetAction> multiGet;
+	Future<Void> multiGetFlush;
+	// Limits flush and compaction writes, and is lowered as the owner's durability lag grows. Null if disabled.
+	std::shared_ptr<rocksdb::RateLimiter> rateLimiter;
+	std::shared_ptr<rocksdb::Statistics> statistics;
+	Future<Void> metricsLogger;
 
 	explicit RocksDBKeyValueStore(const std::string& path, UID id)
 		: path(path)
 		, id(id)
+		, commitCount(0)
+		, statistics(rocksdb::CreateDBStatistics())
 	{
+		if (SERVER_KNOBS->ROCKSDB_BACKGROUND_WRITE_RATE_MAX > 0) {
+			rateLimiter.reset(rocksdb::NewGenericRateLimiter(SERVER_KNOBS->ROCKSDB_BACKGROUND_WRITE_RATE_MAX));
+		}
 		writeThread = createGenericThreadPool();
 		readThreads = createGenericThreadPool();
-		writeThread->addThread(new Writer(db, id));
+		fetchThreads = createGenericThreadPool();
+		writeThread->addThread(new Writer(db, id, commitCount));
 		for (unsigned i = 0; i < SERVER_KNOBS->ROCKSDB_READ_PARALLELISM; ++i) {
-			readThreads->addThread(new Reader(db));
+			readThreads->addThread(new Reader(db, commitCount));
+		}
+		for (unsigned i = 0; i < SERVER_KNOBS->ROCKSDB_FETCH_PARALLELISM; ++i) {
+			fetchThreads->addThread(new Reader(db, commitCount));
+		}
+	}
+
+	ACTOR static Future<Void> logMetrics(RocksDBKeyValueStore* self, Future<Void> opened) {
+		// Tickers are cumulative, so each event reports the change since the previous one
+		state std::vector<std::tuple<const char*, uint32_t, uint64_t>> tickerStats = {
+			{ "BlockCacheHits", rocksdb::BLOCK_CACHE_HIT, 0 },
+			{ "BlockCacheMisses", rocksdb::BLOCK_CACHE_MISS, 0 },
+			{ "BloomFilterUseful", rocksdb::BLOOM_FILTER_USEFUL, 0 },
+			{ "MemtableHits", rocksdb::MEMTABLE_HIT, 0 },
+			{ "MemtableMisses", rocksdb::MEMTABLE_MISS, 0 },
+			{ "BytesRead", rocksdb::BYTES_READ, 0 },
+			{ "BytesWritten", rocksdb::BYTES_WRITTEN, 0 },
+			{ "MultiGetCalls", rocksdb::NUMBER_MULTIGET_CALLS, 0 },
+			{ "MultiGetKeysRead", rocksdb::NUMBER_MULTIGET_KEYS_READ, 0 },
+			{ "IteratorsCreated", rocksdb::NO_ITERATOR_CREATED, 0 },
+			{ "FlushWriteBytes", rocksdb::FLUSH_WRITE_BYTES, 0 },
+			{ "CompactReadBytes", rocksdb::COMPACT_READ_BYTES, 0 },
+			{ "CompactWriteBytes", rocksdb::COMPACT_WRITE_BYTES, 0 },
+			{ "StallMicros", rocksdb::STALL_MICROS, 0 },
+		};
+		state std::vector<std::pair<const char*, std::string>> propertyStats = {
+			{ "NumImmutableMemtables", rocksdb::DB::Properties::kNumImmutableMemTable },
+			{ "MemtableBytes", rocksdb::DB::Properties::kCurSizeAllMemTables },
+			{ "EstimatedPendingCompactionBytes", rocksdb::DB::Properties::kEstimatePendingCompactionBytes },
+			{ "RunningCompactions", rocksdb::DB::Properties::kNumRunningCompactions },
+			{ "RunningFlushes", rocksdb::DB::Properties::kNumRunningFlushes },
+			{ "ActualDelayedWriteRate", rocksdb::DB::Properties::kActualDelayedWriteRate },
+			{ "IsWriteStopped", rocksdb::DB::Properties::kIsWriteStopped },
+			{ "BlockCacheUsage", rocksdb::DB::Properties::kBlockCacheUsage },
+			{ "EstimateLiveDataSize", rocksdb::DB::Properties::kEstimateLiveDataSize },
+		};
+
+		wait(opened);
+		loop {
+			wait(delay(SERVER_KNOBS->ROCKSDB_METRICS_DELAY));
+			TraceEvent e("RocksDBMetrics", self->id);
+			for (auto& t : tickerStats) {
+				uint64_t value = self->statistics->getTickerCount(std::get<1>(t));
+				e.detail(std::get<0>(t), value - std::get<2>(t));
+				std::get<2>(t) = value;
+			}
+			for (const auto& p : propertyStats) {
+				uint64_t value;
+				if (self->db->GetIntProperty(p.second, &value)) {
+					e.detail(p.first, value);
+				}
+			}
+			if (self->rateLimiter) {
+				e.detail("BackgroundWriteRateLimit", self->rateLimiter->GetBytesPerSecond());
+			}
 		}
 	}
 
@@ -378,7 +532,11 @@ struct RocksDBKeyValueStore : IKeyValueStore {
 	}
 
 	ACTOR static void doClose(RocksDBKeyValueStore* self, bool deleteOnClose) {
-		wait(self->readThreads->stop());
+		self->metricsLogger = Future<Void>();
+		if (self->multiGet) {
+			self->postMultiGet();
+		}
+		wait(self->readThreads->stop() && self->fetchThreads->stop());
 		auto a = new Writer::CloseAction(self->path, deleteOnClose);
 		auto f = a->done.getFuture();
 		self->writeThread->post(a);
@@ -406,8 +564,11 @@ struct RocksDBKeyValueStore : IKeyValueStore {
 	Future<Void> init() override {
 		std::unique_ptr<Writer::OpenAction> a(new Writer::OpenAction());
 		a->path = path;
+		a->rateLimiter = rateLimiter;
+		a->statistics = statistics;
 		auto res = a->done.getFuture();
 		writeThread->post(a.release());
+		metricsLogger = logMetrics(this, res);
 		return res;
 	}
 
@@ -438,24 +599,84 @@ struct RocksDBKeyValueStore : IKeyValueStore {
 		return res;
 	}
 
-	Future<Optional<Value>> readValue(KeyRef key, Optional<UID> debugID) override {
+	// Compaction gets its full write rate while the durability lag is small, and is scaled down towards
+	// ROCKSDB_BACKGROUND_WRITE_RATE_MIN as the lag approaches STORAGE_DURABILITY_LAG_SOFT_MAX so that commits get more
+	// of the disk.
+	void setDurabilityLag(Version lag) override {
+		if (!rateLimiter) {
+			return;
+		}
+		double fraction = std::min(1.0, std::max<double>(0, lag) / SERVER_KNOBS->STORAGE_DURABILITY_LAG_SOFT_MAX);
+		int64_t rate = SERVER_KNOBS->ROCKSDB_BACKGROUND_WRITE_RATE_MAX -
+		               fraction * (SERVER_KNOBS->ROCKSDB_BACKGROUND_WRITE_RATE_MAX -
+		                           std::min(SERVER_KNOBS->ROCKSDB_BACKGROUND_WRITE_RATE_MIN,
+		                                    SERVER_KNOBS->ROCKSDB_BACKGROUND_WRITE_RATE_MAX));
+		if (rate != rateLimiter->GetBytesPerSecond()) {
+			rateLimiter->SetBytesPerSecond(rate);
+		}
+	}
+
+	IThreadPool* readThreadsFor(ReadType type) {
+		return (type == ReadType::FETCH || type == ReadType::LOW) ? fetchThreads.getPtr() : readThreads.getPtr();
+	}
+
+	void postMultiGet() {
+		multiGetFlush = Future<Void>();
+		readThreads->post(multiGet.release());
+	}
+
+	ACTOR static Future<Void> flushMultiGet(RocksDBKeyValueStore* self) {
+		wait(delay(0));
+		self->readThreads->post(self->multiGet.release());
+		return Void();
+	}
+
+	// Adds a point read to the current MultiGet batch, starting a new one if needed. The batch is posted once it
+	// is full or at the end of the current run loop iteration, whichever comes first.
+	Future<Optional<Value>> batchedGet(KeyRef key, int maxLength) {
+		if (!multiGet) {
+			multiGet.reset(new Reader::MultiGetAction());
+			multiGetFlush = flushMultiGet(this);
+		}
+		multiGet->gets.emplace_back(key, maxLength);
+		auto res = multiGet->gets.back().result.getFuture();
+		if ((int)multiGet->gets.size() >= SERVER_KNOBS->ROCKSDB_MULTIGET_BATCH_SIZE) {
+			postMultiGet();
+		}
+		return res;
+	}
+
+	// Client and eager point reads without a debug ID are batched; the rest are read individually
+	bool shouldBatchGet(ReadType type, const Optional<UID>& debugID) const {
+		return SERVER_KNOBS->ROCKSDB_MULTIGET_BATCH_SIZE > 1 && !debugID.present() &&
+		       (type == ReadType::NORMAL || type == ReadType::EAGER);
+	}
+
+	Future<Optional<Value>> readValue(KeyRef key, ReadType type, Optional<UID> debugID) override {
+		if (shouldBatchGet(type, debugID)) {
+			return batchedGet(key, std::numeric_limits<int>::max());
+		}
 		auto a = new Reader::ReadValueAction(key, debugID);
 		auto res = a->result.getFuture();
-		readThreads->post(a);
+		readThreadsFor(type)->post(a);
 		return res;
 	}
 
-	Future<Optional<Value>> readValuePrefix(KeyRef key, int maxLength, Optional<UID> debugID) override {
+	Future<Optional<Value>> readValuePrefix(KeyRef key, int maxLength, ReadType type, Optional<UID> debugID) override {
+		if (shouldBatchGet(type, debugID)) {
+			return batchedGet(key, maxLength);
+		}
 		auto a = new Reader::ReadValuePrefixAction(key, maxLength, debugID);
 		auto res = a->result.getFuture();
-		readThreads->post(a);
+		readThreadsFor(type)->post(a);
 		return res;
 	}
 
-	Future<Standalone<RangeResultRef>> readRange(KeyRangeRef keys, int rowLimit, int byteLimit) override {
+	Future<Standalone<RangeResultRef>> readRange(KeyRangeRef keys, int rowLimit, int byteLimit,
+	                                             ReadType type) override {
 		auto a = new Reader::ReadRangeAction(keys, rowLimit, byteLimit);
 		auto res = a->result.getFuture();
-		readThreads->post(a);
+		readThreadsFor(type)->post(a);
 		return res;
 	}
 
@@ -523,6 +744,55 @@ TEST_CASE("fdbserver/KeyValueStoreRocksDB/Reopen") {
 	return Void();
 }
 
+TEST_CASE("fdbserver/KeyValueStoreRocksDB/BatchedReads") {
+	state const std::string rocksDBTestDir = "rocksdb-kvstore-batchedreads-test-db";
+	platform::eraseDirectoryRecursive(rocksDBTestDir);
+
+	state IKeyValueStore* kvStore = new RocksDBKeyValueStore(rocksDBTestDir, deterministicRandom()->randomUniqueID());
+	wait(kvStore->init());
+
+	state int i;
+	for (i = 0; i < 100; ++i) {
+		kvStore->set({ StringRef(format("key%03d", i)), StringRef(format("value%03d", i)) });
+	}
+	wait(kvStore->commit(false));
+
+	// Point reads issued together are served by a few MultiGets
+	state std::vector<Future<Optional<Value>>> reads;
+	for (i = 0; i < 100; ++i) {
+		reads.push_back(kvStore->readValue(StringRef(format("key%03d", i))));
+	}
+	reads.push_back(kvStore->readValuePrefix(LiteralStringRef("key042"), 3));
+	reads.push_back(kvStore->readValue(LiteralStringRef("missing")));
+	wait(waitForAll(reads));
+	for (i = 0; i < 100; ++i) {
+		ASSERT(reads[i].get() == Optional<Value>(StringRef(format("value%03d", i))));
+	}
+	ASSERT(reads[100].get() == Optional<Value>(LiteralStringRef("val")));
+	ASSERT(!reads[101].get().present());
+
+	// Range reads must see commits made after a reader's pooled iterator was created
+	state int pass;
+	for (pass = 0; pass < 3; ++pass) {
+		Standalone<RangeResultRef> forward =
+		    wait(kvStore->readRange(KeyRangeRef(LiteralStringRef("key010"), LiteralStringRef("key020"))));
+		ASSERT(forward.size() == 10 + pass && forward[0].key == LiteralStringRef("key010"));
+		Standalone<RangeResultRef> reverse =
+		    wait(kvStore->readRange(KeyRangeRef(LiteralStringRef("key010"), LiteralStringRef("key020")), -3));
+		ASSERT(reverse.size() == 3 && reverse.more && reverse[0].key == LiteralStringRef("key019"));
+
+		kvStore->set({ StringRef(format("key%03d.%d", 10, pass)), LiteralStringRef("new") });
+		wait(kvStore->commit(false));
+	}
+
+	Future<Void> closed = kvStore->onClosed();
+	kvStore->close();
+	wait(closed);
+
+	platform::eraseDirectoryRecursive(rocksDBTestDir);
+	return Void();
+}
+
 } // namespace
 
 #endif // SSD_ROCKSDB_EXPERIMENTAL
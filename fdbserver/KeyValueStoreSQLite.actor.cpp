@@ -1520,10 +1520,10 @@ public:
 	void clear(KeyRangeRef range, const Arena* arena = nullptr) override;
 	Future<Void> commit(bool sequential = false) override;
 
-	Future<Optional<Value>> readValue(KeyRef key, Optional<UID> debugID) override;
-	Future<Optional<Value>> readValuePrefix(KeyRef key, int maxLength, Optional<UID> debugID) override;
-	Future<Standalone<RangeResultRef>> readRange(KeyRangeRef keys, int rowLimit = 1 << 30,
-	                                             int byteLimit = 1 << 30) override;
+	Future<Optional<Value>> readValue(KeyRef key, ReadType type, Optional<UID> debugID) override;
+	Future<Optional<Value>> readValuePrefix(KeyRef key, int maxLength, ReadType type, Optional<UID> debugID) override;
+	Future<Standalone<RangeResultRef>> readRange(KeyRangeRef keys, int rowLimit = 1 << 30, int byteLimit = 1 << 30,
+	                                             ReadType type = ReadType::NORMAL) override;
 
 	KeyValueStoreSQLite(std::string const& filename, UID logID, KeyValueStoreType type, bool checkChecksums, bool checkIntegrity);
 	~KeyValueStoreSQLite() override;
@@ -1541,6 +1541,9 @@ private:
 	UID logID;
 	std::string filename;
 	Reference<IThreadPool> readThreads, writeThread;
+	// Limits how many fetch or low priority reads can be queued to readThreads at once, so that client reads are
+	// never stuck behind a long queue of background work
+	Reference<FlowLock> backgroundReads;
 	Promise<Void> stopped;
 	Future<Void> cleaning, logging, starting, stopOnErr;
 
@@ -2022,6 +2025,7 @@ KeyValueStoreSQLite::KeyValueStoreSQLite(std::string const& filename, UID id, Ke
 	  logID(id),
 	  readThreads(CoroThreadPool::createThreadPool()),
 	  writeThread(CoroThreadPool::createThreadPool()),
+	  backgroundReads(new FlowLock(SERVER_KNOBS->SQLITE_CONCURRENT_BACKGROUND_READS)),
 	  readsRequested(0), writesRequested(0), writesComplete(0), diskBytesUsed(0), freeListPages(0)
 {
 	TraceEvent(SevDebug, "KeyValueStoreSQLiteCreate")
@@ -2092,23 +2096,44 @@ Future<Void> KeyValueStoreSQLite::commit(bool sequential) {
 	writeThread->post(p);
 	return f;
 }
-Future<Optional<Value>> KeyValueStoreSQLite::readValue( KeyRef key, Optional<UID> debugID ) {
+// Posts a fetch or low priority read to the reader threads once a background read permit is available, and holds
+// the permit until the read completes
+ACTOR template <class T, class Action>
+static Future<T> postBackgroundRead(Reference<IThreadPool> readThreads, Reference<FlowLock> lock, Action* action) {
+	state std::unique_ptr<Action> p(action);
+	wait( lock->take(TaskPriority::LowPriorityRead) );
+	state FlowLock::Releaser releaser(*lock);
+	state Future<T> f = p->result.getFuture();
+	readThreads->post(p.release());
+	T result = wait(f);
+	return result;
+}
+static bool isBackgroundRead(IKeyValueStore::ReadType type) {
+	return type == IKeyValueStore::ReadType::FETCH || type == IKeyValueStore::ReadType::LOW;
+}
+Future<Optional<Value>> KeyValueStoreSQLite::readValue( KeyRef key, ReadType type, Optional<UID> debugID ) {
 	++readsRequested;
 	auto p = new Reader::ReadValueAction(key, debugID);
+	if (isBackgroundRead(type))
+		return postBackgroundRead<Optional<Value>>(readThreads, backgroundReads, p);
 	auto f = p->result.getFuture();
 	readThreads->post(p);
 	return f;
 }
-Future<Optional<Value>> KeyValueStoreSQLite::readValuePrefix( KeyRef key, int maxLength, Optional<UID> debugID ) {
+Future<Optional<Value>> KeyValueStoreSQLite::readValuePrefix( KeyRef key, int maxLength, ReadType type, Optional<UID> debugID ) {
 	++readsRequested;
 	auto p = new Reader::ReadValuePrefixAction(key, maxLength, debugID);
+	if (isBackgroundRead(type))
+		return postBackgroundRead<Optional<Value>>(readThreads, backgroundReads, p);
 	auto f = p->result.getFuture();
 	readThreads->post(p);
 	return f;
 }
-Future<Standalone<RangeResultRef>> KeyValueStoreSQLite::readRange( KeyRangeRef keys, int rowLimit, int byteLimit ) {
+Future<Standalone<RangeResultRef>> KeyValueStoreSQLite::readRange( KeyRangeRef keys, int rowLimit, int byteLimit, ReadType type ) {
 	++readsRequested;
 	auto p = new Reader::ReadRangeAction(keys, rowLimit, byteLimit);
+	if (isBackgroundRead(type))
+		return postBackgroundRead<Standalone<RangeResultRef>>(readThreads, backgroundReads, p);
 	auto f = p->result.getFuture();
 	readThreads->post(p);
 	return f;
@@ -79,10 +79,17 @@ void ServerKnobs::initialize(bool randomize, ClientKnobs* clientKnobs, bool isSi
 	init( DISK_QUEUE_ADAPTER_MAX_SWITCH_TIME,                    5.0 );
 	init( TLOG_SPILL_REFERENCE_MAX_PEEK_MEMORY_BYTES,            2e9 ); if ( randomize && BUGGIFY ) TLOG_SPILL_REFERENCE_MAX_PEEK_MEMORY_BYTES = 2e6;
 	init( TLOG_SPILL_REFERENCE_MAX_BATCHES_PER_PEEK,           100 ); if ( randomize && BUGGIFY ) TLOG_SPILL_REFERENCE_MAX_BATCHES_PER_PEEK = 1;
+	init( TLOG_SPILL_REFERENCE_MAX_INDEX_BYTES_PER_PEEK,     128<<10 ); if ( randomize && BUGGIFY ) TLOG_SPILL_REFERENCE_MAX_INDEX_BYTES_PER_PEEK = deterministicRandom()->randomInt(1, 4000);
+	init( TLOG_SPILLED_PEEK_CACHE_BYTES,                       10e6 ); if ( randomize && BUGGIFY ) TLOG_SPILLED_PEEK_CACHE_BYTES = deterministicRandom()->coinflip() ? 0 : 1e5;
 	init( TLOG_SPILL_REFERENCE_MAX_BYTES_PER_BATCH,           16<<10 ); if ( randomize && BUGGIFY ) TLOG_SPILL_REFERENCE_MAX_BYTES_PER_BATCH = 500;
+	init( TLOG_SPILL_INDEX_BLOCK_BYTES,                       64<<10 ); if ( randomize && BUGGIFY ) TLOG_SPILL_INDEX_BLOCK_BYTES = deterministicRandom()->randomInt(100, 2000);
+	init( TLOG_SPILL_INDEX_COMPACT_ROWS,                         100 ); if ( randomize && BUGGIFY ) TLOG_SPILL_INDEX_COMPACT_ROWS = 2;
 	init( DISK_QUEUE_FILE_EXTENSION_BYTES,                    10<<20 ); // BUGGIFYd per file within the DiskQueue
 	init( DISK_QUEUE_FILE_SHRINK_BYTES,                      100<<20 ); // BUGGIFYd per file within the DiskQueue
 	init( DISK_QUEUE_MAX_TRUNCATE_BYTES,                       2<<30 ); if ( randomize && BUGGIFY ) DISK_QUEUE_MAX_TRUNCATE_BYTES = 0;
+	init( DISK_QUEUE_STRIPES,                                      1 ); if ( randomize && BUGGIFY ) DISK_QUEUE_STRIPES = deterministicRandom()->randomInt(2, 5); // Simulation turns this back off for tests with disableNewDiskFormats, which downgrade
+	init( DISK_QUEUE_STRIPE_FOLDERS,                              "" );
+	init( DISK_QUEUE_GROUP_COMMIT,                             false ); if ( randomize && BUGGIFY ) DISK_QUEUE_GROUP_COMMIT = true;
 	init( TLOG_DEGRADED_DURATION,                                5.0 );
 	init( MAX_CACHE_VERSIONS,                                   10e6 );
 	init( TLOG_IGNORE_POP_AUTO_ENABLE_DELAY,                   300.0 );
@@ -280,6 +287,7 @@ void ServerKnobs::initialize(bool randomize, ClientKnobs* clientKnobs, bool isSi
 	init( SQLITE_CHUNK_SIZE_PAGES,                             25600 );  // 100MB
 	init( SQLITE_CHUNK_SIZE_PAGES_SIM,                          1024 );  // 4MB
 	init( SQLITE_READER_THREADS,                                  64 );  // number of read threads
+	init( SQLITE_CONCURRENT_BACKGROUND_READS,                     16 ); if( randomize && BUGGIFY ) SQLITE_CONCURRENT_BACKGROUND_READS = deterministicRandom()->randomInt(1, 4);
 	init( SQLITE_WRITE_WINDOW_SECONDS,                            -1 );
 	init( SQLITE_WRITE_WINDOW_LIMIT,                              -1 );
 	if( randomize && BUGGIFY ) {
@@ -332,11 +340,16 @@ void ServerKnobs::initialize(bool randomize, ClientKnobs* clientKnobs, bool isSi
 	// KeyValueStoreRocksDB
 	init( ROCKSDB_BACKGROUND_PARALLELISM,                          0 );
 	init( ROCKSDB_READ_PARALLELISM,                                4 );
+	init( ROCKSDB_FETCH_PARALLELISM,                               2 );
 	init( ROCKSDB_MEMTABLE_BYTES,                  512 * 1024 * 1024 );
 	init( ROCKSDB_UNSAFE_AUTO_FSYNC,                           false );
 	init( ROCKSDB_PERIODIC_COMPACTION_SECONDS,                     0 );
 	init( ROCKSDB_PREFIX_LEN,                                      0 );
 	init( ROCKSDB_BLOCK_CACHE_SIZE,                                0 );
+	init( ROCKSDB_MULTIGET_BATCH_SIZE,                            32 ); if( randomize && BUGGIFY ) ROCKSDB_MULTIGET_BATCH_SIZE = deterministicRandom()->randomInt(1, 4);
+	init( ROCKSDB_BACKGROUND_WRITE_RATE_MAX,       512 * 1024 * 1024 );
+	init( ROCKSDB_BACKGROUND_WRITE_RATE_MIN,        64 * 1024 * 1024 );
+	init( ROCKSDB_METRICS_DELAY,                                60.0 );
 
 	// Leader election
 	bool longLeaderElection = randomize && BUGGIFY;
@@ -426,6 +439,8 @@ void ServerKnobs::initialize(bool randomize, ClientKnobs* clientKnobs, bool isSi
 	init( SAMPLE_EXPIRATION_TIME,                                1.0 );
 	init( SAMPLE_POLL_TIME,                                      0.1 );
 	init( RESOLVER_STATE_MEMORY_LIMIT,                           1e6 );
+	init( RESOLVER_CONFLICT_THREADS,                               1 ); if( randomize && BUGGIFY ) RESOLVER_CONFLICT_THREADS = deterministicRandom()->randomInt(2, 5);
+	init( RESOLVER_CONFLICT_MIN_RANGES_PER_THREAD,              1000 ); if( randomize && BUGGIFY ) RESOLVER_CONFLICT_MIN_RANGES_PER_THREAD = 1;
 	init( LAST_LIMITED_RATIO,                                    2.0 );
 
 	// Backup Worker
@@ -578,6 +593,8 @@ void ServerKnobs::initialize(bool randomize, ClientKnobs* clientKnobs, bool isSi
 	init( FETCH_BLOCK_BYTES,                                     2e6 );
 	init( FETCH_KEYS_PARALLELISM_BYTES,                          4e6 ); if( randomize && BUGGIFY ) FETCH_KEYS_PARALLELISM_BYTES = 3e6;
 	init( FETCH_KEYS_LOWER_PRIORITY,                               0 );
+	init( RANGESTREAM_LIMIT_BYTES,                               2e6 ); if( randomize && BUGGIFY ) RANGESTREAM_LIMIT_BYTES = 1;
+	init( RANGESTREAM_BUFFERED_FRAGMENTS_LIMIT,                   20 );
 	init( BUGGIFY_BLOCK_BYTES,                                 10000 );
 	init( STORAGE_COMMIT_BYTES,                             10000000 ); if( randomize && BUGGIFY ) STORAGE_COMMIT_BYTES = 2000000;
 	init( STORAGE_DURABILITY_LAG_REJECT_THRESHOLD,              0.25 );
@@ -602,6 +619,9 @@ void ServerKnobs::initialize(bool randomize, ClientKnobs* clientKnobs, bool isSi
 	init( TAG_MEASUREMENT_INTERVAL,                        30.0 ); if( randomize && BUGGIFY ) TAG_MEASUREMENT_INTERVAL = 1.0;
 	init( READ_COST_BYTE_FACTOR,                          16384 ); if( randomize && BUGGIFY ) READ_COST_BYTE_FACTOR = 4096;
 	init( PREFIX_COMPRESS_KVS_MEM_SNAPSHOTS,                    true ); if( randomize && BUGGIFY ) PREFIX_COMPRESS_KVS_MEM_SNAPSHOTS = false;
+	init( KVS_MEM_SNAPSHOT_CHUNK_BYTES,                            0 ); if( randomize && BUGGIFY ) KVS_MEM_SNAPSHOT_CHUNK_BYTES = deterministicRandom()->coinflip() ? 1 : deterministicRandom()->randomInt(1, 1<<17); // Simulation turns this back off for tests with disableNewDiskFormats, which downgrade
+	init( KVS_MEM_RECOVERY_THREADS,                                4 ); if( randomize && BUGGIFY ) KVS_MEM_RECOVERY_THREADS = 0;
+	init( KVS_MEM_RECOVERY_CHUNKS_IN_FLIGHT,                     256 ); if( randomize && BUGGIFY ) KVS_MEM_RECOVERY_CHUNKS_IN_FLIGHT = 1;
 	init( REPORT_DD_METRICS,                                    true );
 	init( DD_METRICS_REPORT_INTERVAL,                           30.0 );
 	init( FETCH_KEYS_TOO_LONG_TIME_CRITERIA,                   300.0 );
@@ -701,7 +721,9 @@ void ServerKnobs::initialize(bool randomize, ClientKnobs* clientKnobs, bool isSi
 	init( FASTRESTORE_RATE_UPDATE_SECONDS,                       1.0 ); if( randomize && BUGGIFY ) { FASTRESTORE_RATE_UPDATE_SECONDS = deterministicRandom()->random01() < 0.5 ? 0.1 : 2;}
 
 	init( REDWOOD_DEFAULT_PAGE_SIZE,                            4096 );
+	init( REDWOOD_PAGE_CACHE_PROTECTED_FRACTION,                 0.8 ); if( randomize && BUGGIFY ) REDWOOD_PAGE_CACHE_PROTECTED_FRACTION = deterministicRandom()->random01();
 	init( REDWOOD_KVSTORE_CONCURRENT_READS,                       64 );
+	init( REDWOOD_KVSTORE_CONCURRENT_BACKGROUND_READS,            16 ); if( randomize && BUGGIFY ) REDWOOD_KVSTORE_CONCURRENT_BACKGROUND_READS = deterministicRandom()->randomInt(1, 4);
 	init( REDWOOD_COMMIT_CONCURRENT_READS,                        64 );
 	init( REDWOOD_PAGE_REBUILD_FILL_FACTOR,                     0.66 );
 	init( REDWOOD_LAZY_CLEAR_BATCH_SIZE_PAGES,                    10 );
@@ -78,10 +78,17 @@ public:
 	double DISK_QUEUE_ADAPTER_MAX_SWITCH_TIME;
 	int64_t TLOG_SPILL_REFERENCE_MAX_PEEK_MEMORY_BYTES;
 	int64_t TLOG_SPILL_REFERENCE_MAX_BATCHES_PER_PEEK;
+	int64_t TLOG_SPILL_REFERENCE_MAX_INDEX_BYTES_PER_PEEK; // A peek of data spilled by reference reads index rows until it has read at least this many bytes of them
+	int64_t TLOG_SPILLED_PEEK_CACHE_BYTES; // 0 disables caching the messages peeks read back from data spilled by reference.  Not counted against the TLog's memory limits, so keep it small
 	int64_t TLOG_SPILL_REFERENCE_MAX_BYTES_PER_BATCH;
+	int64_t TLOG_SPILL_INDEX_BLOCK_BYTES; // Rows of the spilled by reference index are compacted into blocks of up to this size
+	int TLOG_SPILL_INDEX_COMPACT_ROWS; // A tag's spilled by reference index is compacted after this many rows have been written to it
 	int64_t DISK_QUEUE_FILE_EXTENSION_BYTES; // When we grow the disk queue, by how many bytes should it grow?
 	int64_t DISK_QUEUE_FILE_SHRINK_BYTES; // When we shrink the disk queue, by how many bytes should it shrink?
 	int DISK_QUEUE_MAX_TRUNCATE_BYTES;  // A truncate larger than this will cause the file to be replaced instead.
+	int DISK_QUEUE_STRIPES; // A new disk queue stripes each of its two files across this many files
+	std::string DISK_QUEUE_STRIPE_FOLDERS; // Comma separated folders, usually on other devices, for the stripes after the first
+	bool DISK_QUEUE_GROUP_COMMIT; // Commits made while another is being written and synced are written and synced together after it.  Off until it shows a measured win over pipelined writes (see the DiskQueuePerf workload)
 	double TLOG_DEGRADED_DURATION;
 	int64_t MAX_CACHE_VERSIONS;
 	double TXS_POPPED_MAX_DELAY;
@@ -236,6 +243,7 @@ public:
 	int SQLITE_CHUNK_SIZE_PAGES;
 	int SQLITE_CHUNK_SIZE_PAGES_SIM;
 	int SQLITE_READER_THREADS;
+	int SQLITE_CONCURRENT_BACKGROUND_READS; // Max number of fetch or low priority reads queued to the reader threads at once
 	int SQLITE_WRITE_WINDOW_LIMIT;
 	double SQLITE_WRITE_WINDOW_SECONDS;
 
@@ -258,11 +266,16 @@ public:
 	// KeyValueStoreRocksDB
 	int ROCKSDB_BACKGROUND_PARALLELISM;
 	int ROCKSDB_READ_PARALLELISM;
+	int ROCKSDB_FETCH_PARALLELISM;
 	int64_t ROCKSDB_MEMTABLE_BYTES;
 	bool ROCKSDB_UNSAFE_AUTO_FSYNC;
 	int64_t ROCKSDB_PERIODIC_COMPACTION_SECONDS;
 	int ROCKSDB_PREFIX_LEN;
 	int64_t ROCKSDB_BLOCK_CACHE_SIZE;
+	int ROCKSDB_MULTIGET_BATCH_SIZE; // Max point reads served by one MultiGet, 1 to disable batching
+	int64_t ROCKSDB_BACKGROUND_WRITE_RATE_MAX; // Flush and compaction write rate limit in bytes/sec, 0 for unlimited
+	int64_t ROCKSDB_BACKGROUND_WRITE_RATE_MIN; // Limit when the storage server's durability lag reaches STORAGE_DURABILITY_LAG_SOFT_MAX
+	double ROCKSDB_METRICS_DELAY;
 
 	// Leader election
 	int MAX_NOTIFICATIONS;
@@ -344,6 +357,8 @@ public:
 	double SAMPLE_EXPIRATION_TIME;
 	double SAMPLE_POLL_TIME;
 	int64_t RESOLVER_STATE_MEMORY_LIMIT;
+	int RESOLVER_CONFLICT_THREADS;
+	int RESOLVER_CONFLICT_MIN_RANGES_PER_THREAD;
 
 	// Backup Worker
 	double BACKUP_TIMEOUT;  // master's reaction time for backup failure
@@ -498,6 +513,8 @@ public:
 	int FETCH_BLOCK_BYTES;
 	int FETCH_KEYS_PARALLELISM_BYTES;
 	int FETCH_KEYS_LOWER_PRIORITY;
+	int RANGESTREAM_LIMIT_BYTES;
+	int RANGESTREAM_BUFFERED_FRAGMENTS_LIMIT;
 	int BUGGIFY_BLOCK_BYTES;
 	double STORAGE_DURABILITY_LAG_REJECT_THRESHOLD;
 	double STORAGE_DURABILITY_LAG_MIN_RATE;
@@ -522,6 +539,9 @@ public:
 	double TAG_MEASUREMENT_INTERVAL;
 	int64_t READ_COST_BYTE_FACTOR;
 	bool PREFIX_COMPRESS_KVS_MEM_SNAPSHOTS;
+	int KVS_MEM_SNAPSHOT_CHUNK_BYTES; // 0 logs each snapshot item separately, which older versions can also recover
+	int KVS_MEM_RECOVERY_THREADS;
+	int KVS_MEM_RECOVERY_CHUNKS_IN_FLIGHT;
 	bool REPORT_DD_METRICS;
 	double DD_METRICS_REPORT_INTERVAL;
 	double FETCH_KEYS_TOO_LONG_TIME_CRITERIA;
@@ -625,7 +645,9 @@ public:
 	double FASTRESTORE_RATE_UPDATE_SECONDS; // how long to update appliers target write rate
 
 	int REDWOOD_DEFAULT_PAGE_SIZE;  // Page size for new Redwood files
+	double REDWOOD_PAGE_CACHE_PROTECTED_FRACTION; // Fraction of the page cache for pages hit more than once
 	int REDWOOD_KVSTORE_CONCURRENT_READS;  // Max number of simultaneous point or range reads in progress.
+	int REDWOOD_KVSTORE_CONCURRENT_BACKGROUND_READS; // Max number of those reads that may be fetch or low priority reads
 	int REDWOOD_COMMIT_CONCURRENT_READS;   // Max number of concurrent reads done to support commit operations
 	double REDWOOD_PAGE_REBUILD_FILL_FACTOR; // When rebuilding pages, start a new page after this capacity
 	int REDWOOD_LAZY_CLEAR_BATCH_SIZE_PAGES; // Number of pages to try to pop from the lazy delete queue and process at once
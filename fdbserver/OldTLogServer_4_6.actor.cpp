@@ -994,7 +994,9 @@ namespace oldTLog_4_6 {
 		reply.maxKnownVersion = logData->version.get();
 		reply.minKnownCommittedVersion = 0;
 		reply.onlySpilled = false;
-		reply.messages = messages.toValue();
+		Standalone<StringRef> replyMessages = messages.toValue();
+		reply.arena = replyMessages.arena();
+		reply.messages = replyMessages;
 		reply.end = endVersion;
 
 		//TraceEvent("TlogPeek", self->dbgid).detail("LogId", logData->logId).detail("EndVer", reply.end).detail("MsgBytes", reply.messages.expectedSize()).detail("ForAddress", req.reply.getEndpoint().getPrimaryAddress());
@@ -1266,7 +1266,9 @@ ACTOR Future<Void> tLogPeekMessages( TLogData* self, TLogPeekRequest req, Refere
 	TLogPeekReply reply;
 	reply.maxKnownVersion = logData->version.get();
 	reply.minKnownCommittedVersion = logData->minKnownCommittedVersion;
-	reply.messages = messages.toValue();
+	Standalone<StringRef> replyMessages = messages.toValue();
+	reply.arena = replyMessages.arena();
+	reply.messages = replyMessages;
 	reply.end = endVersion;
 	reply.onlySpilled = onlySpilled;
 
@@ -1359,7 +1359,8 @@ void setupSimulatedSystem(vector<Future<Void>>* systemActors, std::string baseFo
 }
 
 void checkTestConf(const char* testFile, int& extraDB, int& minimumReplication, int& minimumRegions,
-                   int& configureLocked, int& logAntiQuorum, bool& startIncompatibleProcess) {
+                   int& configureLocked, int& logAntiQuorum, bool& startIncompatibleProcess,
+                   bool& disableNewDiskFormats) {
 	std::ifstream ifs;
 	ifs.open(testFile, std::ifstream::in);
 	if (!ifs.good())
@@ -1402,6 +1403,9 @@ void checkTestConf(const char* testFile, int& extraDB, int& minimumReplication,
 		if (attrib == "logAntiQuorum") {
 			sscanf(value.c_str(), "%d", &logAntiQuorum);
 		}
+		if (attrib == "disableNewDiskFormats") {
+			disableNewDiskFormats = strcmp(value.c_str(), "true") == 0;
+		}
 	}
 
 	ifs.close();
@@ -1418,7 +1422,14 @@ ACTOR void setupAndRun(std::string dataFolder, const char *testFile, bool reboot
 	state int configureLocked = 0;
 	state int logAntiQuorum = -1;
 	state bool startIncompatibleProcess = false;
-	checkTestConf(testFile, extraDB, minimumReplication, minimumRegions, configureLocked, logAntiQuorum, startIncompatibleProcess);
+	state bool disableNewDiskFormats = false;
+	checkTestConf(testFile, extraDB, minimumReplication, minimumRegions, configureLocked, logAntiQuorum, startIncompatibleProcess,
+	              disableNewDiskFormats);
+	if (disableNewDiskFormats) {
+		// An older fdbserver will recover from the files this test leaves behind, so only write what it can read
+		globalServerKnobs->setKnob("kvs_mem_snapshot_chunk_bytes", "0");
+		globalServerKnobs->setKnob("disk_queue_stripes", "1");
+	}
 	g_simulator.hasDiffProtocolProcess = startIncompatibleProcess;
 	g_simulator.setDiffProtocol = false;
 
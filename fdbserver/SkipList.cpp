@@ -22,11 +22,15 @@
 #include <memory.h>
 #include <stdio.h>
 #include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
 #include <numeric>
 #include <string>
 #include <vector>
 
 #include "flow/Platform.h"
+#include "flow/ThreadPrimitives.h"
 #include "fdbrpc/fdbrpc.h"
 #include "fdbrpc/PerfMetric.h"
 #include "fdbclient/FDBTypes.h"
@@ -74,8 +78,21 @@ struct ReadConflictRange {
 	bool operator<(const ReadConflictRange& rhs) const { return compare(begin, rhs.begin) < 0; }
 };
 
+// Returns the first (up to) 8 bytes of the key as a big endian integer, zero padded. If the prefixes of two keys
+// differ, comparing them as integers orders the keys the same way as comparing the whole keys.
+static force_inline uint64_t keyPrefix(const uint8_t* key, int length) {
+	uint64_t prefix = 0;
+	if (length >= int(sizeof(prefix))) {
+		memcpy(&prefix, key, sizeof(prefix));
+	} else if (length > 0) {
+		memcpy(&prefix, key, length);
+	}
+	return bigEndian64(prefix);
+}
+
 struct KeyInfo {
 	StringRef key;
+	uint64_t prefix; // keyPrefix(key), so that most comparisons and radix passes don't have to touch the key itself
 	int* pIndex;
 	bool begin;
 	bool write;
@@ -83,7 +100,8 @@ struct KeyInfo {
 
 	KeyInfo() = default;
 	KeyInfo(StringRef key, bool begin, bool write, int transaction, int* pIndex)
-	  : key(key), begin(begin), write(write), transaction(transaction), pIndex(pIndex) {}
+	  : key(key), prefix(keyPrefix(key.begin(), key.size())), begin(begin), write(write), transaction(transaction),
+	    pIndex(pIndex) {}
 };
 
 force_inline int extra_ordering(const KeyInfo& ki) {
@@ -94,7 +112,11 @@ force_inline int extra_ordering(const KeyInfo& ki) {
 force_inline bool getCharacter(const KeyInfo& ki, int character, int& outputCharacter) {
 	// normal case
 	if (character < ki.key.size()) {
-		outputCharacter = 5 + ki.key.begin()[character];
+		if (character < int(sizeof(ki.prefix))) {
+			outputCharacter = 5 + uint8_t(ki.prefix >> (8 * (sizeof(ki.prefix) - 1 - character)));
+		} else {
+			outputCharacter = 5 + ki.key.begin()[character];
+		}
 		return false;
 	}
 
@@ -115,6 +137,8 @@ force_inline bool getCharacter(const KeyInfo& ki, int character, int& outputChar
 }
 
 bool operator<(const KeyInfo& lhs, const KeyInfo& rhs) {
+	if (lhs.prefix != rhs.prefix) return lhs.prefix < rhs.prefix;
+
 	int i = min(lhs.key.size(), rhs.key.size());
 	int c = memcmp(lhs.key.begin(), rhs.key.begin(), i);
 	if (c != 0) return c < 0;
@@ -297,6 +321,11 @@ private:
 	};
 
 	static force_inline bool less(const uint8_t* a, int aLen, const uint8_t* b, int bLen) {
+		// Most keys visited by a search differ from the search key within the first 8 bytes
+		uint64_t aPrefix = keyPrefix(a, aLen);
+		uint64_t bPrefix = keyPrefix(b, bLen);
+		if (aPrefix != bPrefix) return aPrefix < bPrefix;
+
 		int c = memcmp(a, b, min(aLen, bLen));
 		if (c < 0) return true;
 		if (c > 0) return false;
@@ -423,7 +452,10 @@ public:
 		}
 	}
 
-	void detectConflicts(ReadConflictRange* ranges, int count, bool* transactionConflictStatus) {
+	// If conflicts is not null, the indices of the conflicting ranges are appended to it instead of being recorded in
+	// transactionConflictStatus, so that disjoint sets of ranges can be checked concurrently.
+	void detectConflicts(ReadConflictRange* ranges, int count, bool* transactionConflictStatus,
+	                     std::vector<int>* conflicts = nullptr) {
 		const int M = 16;
 		int nextJob[M];
 		CheckMax inProgress[M];
@@ -432,7 +464,7 @@ public:
 		int started = min(M, count);
 		for (int i = 0; i < started; i++) {
 			inProgress[i].init(ranges[i], header, transactionConflictStatus, ranges[i].indexInTx,
-			                   ranges[i].conflictingKeyRange, ranges[i].cKRArena);
+			                   ranges[i].conflictingKeyRange, ranges[i].cKRArena, i, conflicts);
 			nextJob[i] = i + 1;
 		}
 		nextJob[started - 1] = 0;
@@ -449,7 +481,7 @@ public:
 				} else {
 					int temp = started++;
 					inProgress[job].init(ranges[temp], header, transactionConflictStatus, ranges[temp].indexInTx,
-					                     ranges[temp].conflictingKeyRange, ranges[temp].cKRArena);
+					                     ranges[temp].conflictingKeyRange, ranges[temp].cKRArena, temp, conflicts);
 				}
 			}
 			prevJob = job;
@@ -463,7 +495,6 @@ public:
 	//   partitions.  In between, operations on each partition must not touch any keys outside
 	//   the partition.  Specifically, the partition to the left of 'key' must not have a range
 	//	 [...,key) inserted, since that would insert an entry at 'key'.
-	// Note this function is not used.
 	void partition(StringRef* begin, int splitCount, SkipList* output) {
 		for (int i = splitCount - 1; i >= 0; i--) {
 			Finger f(header, begin[i]);
@@ -474,7 +505,6 @@ public:
 	}
 
 	// Concatenates multiple SkipList objects into one and stores in input[0].
-	// Note this function is not used.
 	void concatenate(SkipList* input, int count) {
 		std::vector<Finger> ends(count - 1);
 		for (int i = 0; i < ends.size(); i++) input[i].getEnd(ends[i]);
@@ -624,14 +654,18 @@ private:
 		int indexInTx;
 		VectorRef<int>* conflictingKeyRange; // nullptr if report_conflicting_keys is not enabled.
 		Arena* cKRArena; // nullptr if report_conflicting_keys is not enabled.
+		int rangeIndex;
+		std::vector<int>* conflicts; // If not null, conflicts are only recorded here (by rangeIndex)
 
 		void init(const ReadConflictRange& r, Node* header, bool* tCS, int indexInTx, VectorRef<int>* cKR,
-		          Arena* cKRArena) {
+		          Arena* cKRArena, int rangeIndex, std::vector<int>* conflicts) {
 			this->start.init(r.begin, header);
 			this->end.init(r.end, header);
 			this->version = r.version;
 			this->indexInTx = indexInTx;
 			this->cKRArena = cKRArena;
+			this->rangeIndex = rangeIndex;
+			this->conflicts = conflicts;
 			result = &tCS[r.transaction];
 			conflictingKeyRange = cKR;
 			this->state = 0;
@@ -639,6 +673,10 @@ private:
 
 		bool noConflict() const { return true; }
 		bool conflict() {
+			if (conflicts != nullptr) {
+				conflicts->push_back(rangeIndex);
+				return true;
+			}
 			*result = true;
 			if (conflictingKeyRange != nullptr) conflictingKeyRange->push_back(*cKRArena, indexInTx);
 			return true;
@@ -727,17 +765,124 @@ private:
 	}
 };
 
+// A fork-join group of threads which work on disjoint key partitions of a ConflictSet along with the calling thread.
+// The calling thread blocks until all partitions are done, so the ConflictSet is never touched by two batches at once.
+class ConflictSetWorkers : NonCopyable {
+public:
+	explicit ConflictSetWorkers(int threadCount) : work(nullptr), stopping(false) {
+		for (int i = 1; i < threadCount; i++) {
+			workers.emplace_back(new Worker(this, i));
+			workers.back()->handle = startThread(&ConflictSetWorkers::workerMain, workers.back().get());
+		}
+	}
+
+	~ConflictSetWorkers() {
+		stopping = true;
+		for (auto& w : workers) w->start.set();
+		for (auto& w : workers) waitThread(w->handle);
+	}
+
+	// The number of partitions which can be processed concurrently
+	int size() const { return workers.size() + 1; }
+
+	// Calls f(p) for each partition p in [0, count), with count <= size(), and returns when all calls have finished.
+	// Partition 0 runs on the calling thread.
+	void run(int count, std::function<void(int)> const& f) {
+		ASSERT(count <= size());
+		work = &f;
+		for (int p = 1; p < count; p++) workers[p - 1]->start.set();
+
+		Optional<Error> err;
+		try {
+			f(0);
+		} catch (Error& e) {
+			err = e;
+		}
+		// Each worker signals its own event: Event is a semaphore on some platforms but an auto-reset event on Windows,
+		// where several sets of one event before it is waited on would be lost.
+		for (int p = 1; p < count; p++) {
+			workers[p - 1]->done.block();
+		}
+		work = nullptr;
+
+		if (err.present()) throw err.get();
+		for (int p = 1; p < count; p++) {
+			if (workers[p - 1]->error.present()) {
+				Error e = workers[p - 1]->error.get();
+				workers[p - 1]->error = Optional<Error>();
+				throw e;
+			}
+		}
+	}
+
+private:
+	struct Worker {
+		ConflictSetWorkers* self;
+		int partition;
+		THREAD_HANDLE handle;
+		Event start, done;
+		Optional<Error> error;
+
+		Worker(ConflictSetWorkers* self, int partition) : self(self), partition(partition) {}
+	};
+
+	THREAD_FUNC workerMain(void* arg) {
+		Worker* w = (Worker*)arg;
+		while (true) {
+			w->start.block();
+			if (w->self->stopping) break;
+			try {
+				(*w->self->work)(w->partition);
+			} catch (Error& e) {
+				w->error = e;
+			} catch (...) {
+				w->error = unknown_error();
+			}
+			w->done.set();
+		}
+		THREAD_RETURN;
+	}
+
+	std::vector<std::unique_ptr<Worker>> workers;
+	std::function<void(int)> const* work;
+	std::atomic<bool> stopping;
+};
+
 struct ConflictSet {
-	ConflictSet() : oldestVersion(0), removalKey(makeString(0)) {}
+	ConflictSet(int threadCount, int minRangesPerThread)
+	  : oldestVersion(0), removalKey(makeString(0)), threadCount(std::max(threadCount, 1)),
+	    minRangesPerThread(std::max(minRangesPerThread, 1)) {
+		// Simulation is single threaded, so there the partitions are processed one after another
+		if (this->threadCount > 1 && !g_network->isSimulated()) {
+			workers = std::make_unique<ConflictSetWorkers>(this->threadCount);
+		}
+	}
 	~ConflictSet() {}
 
+	// Returns how many key partitions a batch with the given number of conflict ranges should be split into
+	int partitionsFor(int rangeCount) const {
+		return std::max(1, std::min(threadCount, rangeCount / minRangesPerThread));
+	}
+
+	// Calls f(p) for each partition p in [0, count)
+	void forEachPartition(int count, std::function<void(int)> const& f) {
+		if (workers) {
+			workers->run(count, f);
+		} else {
+			for (int p = 0; p < count; p++) f(p);
+		}
+	}
+
 	SkipList versionHistory;
 	Key removalKey;
 	Version oldestVersion;
+	int threadCount;
+	int minRangesPerThread;
+	std::unique_ptr<ConflictSetWorkers> workers;
 };
 
-ConflictSet* newConflictSet() {
-	return new ConflictSet;
+ConflictSet* newConflictSet(int threadCount, int minRangesPerThread) {
+	return new ConflictSet(threadCount, minRangesPerThread);
 }
 void clearConflictSet(ConflictSet* cs, Version v) {
 	SkipList(v).swap(cs->versionHistory);
@@ -892,8 +1037,31 @@ void ConflictBatch::detectConflicts(Version now, Version newOldestVersion, std::
 void ConflictBatch::checkReadConflictRanges() {
 	if (combinedReadConflictRanges.empty()) return;
 
-	cs->versionHistory.detectConflicts(&combinedReadConflictRanges[0], combinedReadConflictRanges.size(),
-	                                   transactionConflictStatus);
+	const int count = combinedReadConflictRanges.size();
+	const int partitions = cs->partitionsFor(count);
+	if (partitions == 1) {
+		cs->versionHistory.detectConflicts(&combinedReadConflictRanges[0], count, transactionConflictStatus);
+		return;
+	}
+
+	// The version history is only read here, so each partition checks a slice of the read ranges against all of it.
+	// Conflicts are collected per partition and applied afterwards, since slices can share transactions.
+	std::vector<std::vector<int>> conflicts(partitions);
+	cs->forEachPartition(partitions, [&](int p) {
+		int begin = int64_t(count) * p / partitions;
+		int end = int64_t(count) * (p + 1) / partitions;
+		cs->versionHistory.detectConflicts(&combinedReadConflictRanges[begin], end - begin, transactionConflictStatus,
+		                                   &conflicts[p]);
+		for (int& c : conflicts[p]) c += begin;
+	});
+
+	for (auto& partitionConflicts : conflicts) {
+		for (int c : partitionConflicts) {
+			const ReadConflictRange& r = combinedReadConflictRanges[c];
+			transactionConflictStatus[r.transaction] = true;
+			if (r.conflictingKeyRange != nullptr) r.conflictingKeyRange->push_back(*r.cKRArena, r.indexInTx);
+		}
+	}
 }
 
 void ConflictBatch::addConflictRanges(Version now, std::vector<std::pair<StringRef, StringRef>>::iterator begin,
@@ -920,7 +1088,39 @@ void ConflictBatch::addConflictRanges(Version now, std::vector<std::pair<StringR
 void ConflictBatch::mergeWriteConflictRanges(Version now) {
 	if (combinedWriteConflictRanges.empty()) return;
 
-	addConflictRanges(now, combinedWriteConflictRanges.begin(), combinedWriteConflictRanges.end(), &cs->versionHistory);
+	const int count = combinedWriteConflictRanges.size();
+	int partitions = cs->partitionsFor(count);
+
+	// combinedWriteConflictRanges is sorted and disjoint, so the version history can be split at the beginning of
+	// some of the ranges and each part updated independently. A range which ends exactly where the next one begins
+	// would insert the split key into the left part, so the split is moved past such ranges.
+	std::vector<int> firstRange = { 0 };
+	for (int p = 1; p < partitions; p++) {
+		int r = std::max<int>(int64_t(count) * p / partitions, firstRange.back() + 1);
+		while (r < count && combinedWriteConflictRanges[r - 1].second == combinedWriteConflictRanges[r].first) r++;
+		if (r >= count) break;
+		firstRange.push_back(r);
+	}
+	partitions = firstRange.size();
+	firstRange.push_back(count);
+
+	if (partitions == 1) {
+		addConflictRanges(now, combinedWriteConflictRanges.begin(), combinedWriteConflictRanges.end(),
+		                  &cs->versionHistory);
+		return;
+	}
+
+	std::vector<StringRef> splitKeys;
+	for (int p = 1; p < partitions; p++) splitKeys.push_back(combinedWriteConflictRanges[firstRange[p]].first);
+
+	std::vector<SkipList> parts(partitions);
+	cs->versionHistory.partition(&splitKeys[0], splitKeys.size(), &parts[0]);
+	cs->forEachPartition(partitions, [&](int p) {
+		addConflictRanges(now, combinedWriteConflictRanges.begin() + firstRange[p],
+		                  combinedWriteConflictRanges.begin() + firstRange[p + 1], &parts[p]);
+	});
+	parts[0].concatenate(&parts[0], partitions);
+	cs->versionHistory.swap(parts[0]);
 }
 
 void ConflictBatch::combineWriteConflictRanges() {
@@ -1100,4 +1300,34 @@ void skipListTest() {
 	}
 
 	printf("%d entries in version history\n", cs->versionHistory.count());
+
+	// Replaying the same batches against a conflict set partitioned across threads must give the same results
+	ConflictSet* partitioned = newConflictSet(4, 100);
+	start = timer();
+	version = 0;
+	for (const auto& data : testData) {
+		Arena buf;
+		ConflictBatch batch(partitioned);
+		for (int j = 0; j + readCount + writeCount <= data.size(); j += readCount + writeCount) {
+			CommitTransactionRef tr;
+			for (int k = 0; k < readCount; k++) {
+				KeyRangeRef r(buf, data[j + k]);
+				tr.read_conflict_ranges.push_back(buf, r);
+			}
+			for (int k = 0; k < writeCount; k++) {
+				KeyRangeRef r(buf, data[j + readCount + k]);
+				tr.write_conflict_ranges.push_back(buf, r);
+			}
+			tr.read_snapshot = version;
+			batch.addTransaction(tr);
+		}
+
+		std::vector<int> nonConflicting;
+		batch.detectConflicts(version + 50, version, nonConflicting);
+		ASSERT(nonConflicting == nonConflict[version]);
+		version++;
+	}
+	printf("Partitioned conflict set: %0.3f sec\n", timer() - start);
+	ASSERT(partitioned->versionHistory.count() == cs->versionHistory.count());
+	destroyConflictSet(partitioned);
 }
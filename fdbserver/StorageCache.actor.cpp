@@ -524,6 +524,51 @@ ACTOR Future<Void> getValueQ( StorageCacheData* data, GetValueRequest req ) {
 	return Void();
 };
 
+ACTOR Future<Void> getValuesQ( StorageCacheData* data, GetValuesRequest req ) {
+	try {
+		++data->counters.getValueQueries;
+		++data->counters.allQueries;
+
+		wait( delay(0, TaskPriority::DefaultEndpoint) );
+
+		if( req.debugID.present() )
+			g_traceBatch.addEvent("GetValueDebug", req.debugID.get().first(), "getValuesQ.DoRead");
+
+		state Version version = wait( waitForVersion( data, req.version ) );
+
+		// The keys are all read from memory without yielding, so the cached ranges cannot change underneath us
+		GetValuesReply reply;
+		reply.cached = true;
+		for (auto& key : req.keys) {
+			if (data->cachedRangeMap[key]->notAssigned()) {
+				throw wrong_shard_server();
+			} else if (!data->cachedRangeMap[key]->isReadable()) {
+				throw future_version();
+			}
+
+			auto i = data->data().at(version).lastLessOrEqual(key);
+			if (i && i->isValue() && i.key() == key) {
+				reply.data.push_back_deep(reply.arena, KeyValueRef(key, i->getValue()));
+				++data->counters.rowsQueried;
+				data->counters.bytesQueried += i->getValue().size();
+			}
+		}
+
+		if( req.debugID.present() )
+			g_traceBatch.addEvent("GetValueDebug", req.debugID.get().first(), "getValuesQ.AfterRead");
+
+		req.reply.send(reply);
+	} catch (Error& e) {
+		if(!canReplyWith(e))
+			throw;
+		req.reply.sendError(e);
+	}
+
+	++data->counters.finishedQueries;
+
+	return Void();
+}
+
 GetKeyValuesReply readRange(StorageCacheData* data, Version version, KeyRangeRef range, int limit, int* pLimitBytes) {
 	GetKeyValuesReply result;
 	StorageCacheData::VersionedData::ViewAtVersion view = data->data().at(version);
@@ -2071,6 +2116,17 @@ ACTOR Future<Void> storageCacheServer(StorageServerInterface ssi, uint16_t id, R
 		when (GetKeyValuesRequest req = waitNext(ssi.getKeyValues.getFuture()) ) {
 			actors.add(getKeyValues(&self, req));
 		}
+		when (GetValuesRequest req = waitNext(ssi.getValues.getFuture()) ) {
+			actors.add(getValuesQ(&self, req));
+		}
+		when (GetKeyValuesStreamRequest req = waitNext(ssi.getKeyValuesStream.getFuture()) ) {
+			// Range streams are only served by storage servers
+			req.reply.sendError(unsupported_operation());
+		}
+		when (GetMappedKeyValuesRequest req = waitNext(ssi.getMappedKeyValues.getFuture()) ) {
+			// Mapped range reads are only served by storage servers
+			req.reply.sendError(unsupported_operation());
+		}
 		when (GetShardStateRequest req = waitNext(ssi.getShardState.getFuture()) ) {
 			ASSERT(false);
 		}
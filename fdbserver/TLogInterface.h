@@ -158,7 +158,7 @@ struct VerUpdateRef {
 struct TLogPeekReply {
 	constexpr static FileIdentifier file_identifier = 11365689;
 	Arena arena;
-	StringRef messages;
+	ZeroCopyStringRef messages; // Sent from its arena rather than copied, so arena must own these bytes
 	Version end;
 	Optional<Version> popped;
 	Version maxKnownVersion;
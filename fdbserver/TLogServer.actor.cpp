@@ -241,6 +241,10 @@ static Key persistTagMessageRefsKey( UID id, Tag tag, Version version ) {
 	return wr.toValue();
 }
 
+static Version decodeTagMessageRefsKey( StringRef key ) {
+	return bigEndian64( BinaryReader::fromStringRef<Version>( key.substr( key.size() - sizeof(Version) ), Unversioned() ) );
+}
+
 static Key persistTagPoppedKey( UID id, Tag tag ) {
 	BinaryWriter wr(Unversioned());
 	wr.serializeBytes( persistTagPoppedKeys.begin );
@@ -289,6 +293,124 @@ struct SpilledData {
 	uint32_t mutationBytes = 0;
 };
 
+// The messages for one tag that a peek read back from data spilled by reference, covering the versions from begin up to
+// but not including end.  A later peek of the tag at any version in that range can be answered from it without reading
+// the disk queue again.
+struct SpilledPeekSegment : ReferenceCounted<SpilledPeekSegment> {
+	Version begin = 0;
+	Version end = 0;
+	bool earlyEnd = false; // The peek stopped at end because the reply was full, not because nothing more was spilled
+	Standalone<StringRef> messages;
+	std::vector<std::pair<Version, int>> versionOffsets; // Where each version's messages start in messages
+
+	int64_t bytes() const { return sizeof(*this) + messages.size() + versionOffsets.size() * sizeof(versionOffsets[0]); }
+
+	StringRef messagesFrom(Version version) const {
+		auto it = std::lower_bound(versionOffsets.begin(), versionOffsets.end(), version,
+		                           [](std::pair<Version, int> const& o, Version v) { return o.first < v; });
+		return it == versionOffsets.end() ? StringRef() : messages.substr(it->second);
+	}
+};
+
+// Holds up to TLOG_SPILLED_PEEK_CACHE_BYTES of SpilledPeekSegments, evicting the oldest first, so that several peekers
+// catching up on the same tag don't each read the same spilled data from disk.  While a segment is being read, peeks
+// of the same tag at the same version wait for it rather than reading it again.
+class SpilledPeekCache {
+public:
+	explicit SpilledPeekCache(int64_t maxBytes = SERVER_KNOBS->TLOG_SPILLED_PEEK_CACHE_BYTES)
+	  : maxBytes(maxBytes), bytes(0) {}
+
+	// Returns the segment, possibly still being read, that may answer a peek of tag at begin, or an invalid future
+	Future<Reference<SpilledPeekSegment>> get(UID logId, Tag tag, Version begin) {
+		forgetFailedReads();
+		auto tagSegments = segments.find(std::make_pair(logId, tag));
+		if (tagSegments == segments.end()) return Future<Reference<SpilledPeekSegment>>();
+		auto it = tagSegments->second.upper_bound(begin);
+		if (it == tagSegments->second.begin()) return Future<Reference<SpilledPeekSegment>>();
+		--it;
+		if (it->second.isError()) {
+			// The peek reading it failed or was cancelled
+			tagSegments->second.erase(it);
+			if (tagSegments->second.empty()) segments.erase(tagSegments);
+			return Future<Reference<SpilledPeekSegment>>();
+		}
+		if (!it->second.isReady()) {
+			return it->first == begin ? it->second : Future<Reference<SpilledPeekSegment>>();
+		}
+		return begin < it->second.get()->end ? it->second : Future<Reference<SpilledPeekSegment>>();
+	}
+
+	// Records that a peek of tag is reading the segment starting at begin.  If the peek fails, is cancelled or keeps
+	// nothing, segment is broken and the record is dropped by a later call.
+	void reading(UID logId, Tag tag, Version begin, Future<Reference<SpilledPeekSegment>> segment) {
+		forgetFailedReads();
+		segments[std::make_pair(logId, tag)][begin] = segment;
+		pending.push_back(PendingRead{ std::make_pair(logId, tag), begin, segment });
+	}
+
+	// Charges a segment passed to reading() once it has been read, and evicts the oldest segments if over budget
+	void add(UID logId, Tag tag, Reference<SpilledPeekSegment> segment) {
+		bytes += segment->bytes();
+		order.emplace_back(std::make_pair(logId, tag), segment);
+		while (bytes > maxBytes && !order.empty()) {
+			TEST(true); // TLog spilled peek cache evicting a segment
+			Reference<SpilledPeekSegment> oldest = order.front().second;
+			auto tagSegments = segments.find(order.front().first);
+			if (tagSegments != segments.end()) {
+				// It may already have been replaced by a newer read of the same versions
+				auto it = tagSegments->second.find(oldest->begin);
+				if (it != tagSegments->second.end() && it->second.isReady() && !it->second.isError() &&
+				    it->second.get() == oldest) {
+					tagSegments->second.erase(it);
+					if (tagSegments->second.empty()) segments.erase(tagSegments);
+				}
+			}
+			bytes -= oldest->bytes();
+			order.pop_front();
+		}
+	}
+
+	int64_t getBytes() const { return bytes; }
+
+private:
+	struct PendingRead {
+		std::pair<UID, Tag> key;
+		Version begin;
+		Future<Reference<SpilledPeekSegment>> segment;
+	};
+
+	std::map<std::pair<UID, Tag>, std::map<Version, Future<Reference<SpilledPeekSegment>>>> segments;
+	std::deque<std::pair<std::pair<UID, Tag>, Reference<SpilledPeekSegment>>> order; // Oldest first
+	std::vector<PendingRead> pending; // Reads passed to reading() that had not finished when last looked at
+	int64_t maxBytes;
+	int64_t bytes;
+
+	// Drops the records of reads that ended without a segment.  A read that succeeded is charged by add() instead.
+	// There are never more pending reads than peeks in progress, so this is cheap.
+	void forgetFailedReads() {
+		for (int i = 0; i < pending.size();) {
+			PendingRead& p = pending[i];
+			if (!p.segment.isReady()) {
+				i++;
+				continue;
+			}
+			if (p.segment.isError()) {
+				auto tagSegments = segments.find(p.key);
+				if (tagSegments != segments.end()) {
+					// It may already have been replaced by a newer read of the same versions
+					auto it = tagSegments->second.find(p.begin);
+					if (it != tagSegments->second.end() && it->second.isReady() && it->second.isError()) {
+						tagSegments->second.erase(it);
+						if (tagSegments->second.empty()) segments.erase(tagSegments);
+					}
+				}
+			}
+			std::swap(p, pending.back());
+			pending.pop_back();
+		}
+	}
+};
+
 struct TLogData : NonCopyable {
 	AsyncTrigger newLogData;
 	// A process has only 1 SharedTLog, which holds data for multiple logs, so that it obeys its assigned memory limit.
@@ -336,6 +458,7 @@ struct TLogData : NonCopyable {
 
 	WorkerCache<TLogInterface> tlogCache;
 	FlowLock peekMemoryLimiter;
+	SpilledPeekCache spilledPeekCache;
 
 	PromiseStream<Future<Void>> sharedActors;
 	Promise<Void> terminated;
@@ -386,15 +509,18 @@ struct LogData : NonCopyable, public ReferenceCounted<LogData> {
 		Version versionForPoppedLocation;  // `poppedLocation` was calculated at this popped version
 		IDiskQueue::location poppedLocation;  // The location of the earliest commit with data for this tag.
 		bool unpoppedRecovered;
+		int spillIndexRowsWritten;  // Rows of the spilled by reference index written since it was last compacted
+		Version spillIndexCompactedVersion;  // Index rows keyed at or below this version need no more compacting
 		Tag tag;
 
-		TagData( Tag tag, Version popped, IDiskQueue::location poppedLocation, bool nothingPersistent, bool poppedRecently, bool unpoppedRecovered ) : tag(tag), nothingPersistent(nothingPersistent), poppedRecently(poppedRecently), popped(popped), persistentPopped(0), versionForPoppedLocation(0), poppedLocation(poppedLocation), unpoppedRecovered(unpoppedRecovered) {}
+		TagData( Tag tag, Version popped, IDiskQueue::location poppedLocation, bool nothingPersistent, bool poppedRecently, bool unpoppedRecovered ) : tag(tag), nothingPersistent(nothingPersistent), poppedRecently(poppedRecently), popped(popped), persistentPopped(0), versionForPoppedLocation(0), poppedLocation(poppedLocation), unpoppedRecovered(unpoppedRecovered), spillIndexRowsWritten(0), spillIndexCompactedVersion(0) {}
 
 		TagData(TagData&& r) noexcept
 		  : versionMessages(std::move(r.versionMessages)), nothingPersistent(r.nothingPersistent),
 		    poppedRecently(r.poppedRecently), popped(r.popped), persistentPopped(r.persistentPopped),
 		    versionForPoppedLocation(r.versionForPoppedLocation), poppedLocation(r.poppedLocation), tag(r.tag),
-		    unpoppedRecovered(r.unpoppedRecovered) {}
+		    unpoppedRecovered(r.unpoppedRecovered), spillIndexRowsWritten(r.spillIndexRowsWritten),
+		    spillIndexCompactedVersion(r.spillIndexCompactedVersion) {}
 		void operator=(TagData&& r) noexcept {
 			versionMessages = std::move(r.versionMessages);
 			nothingPersistent = r.nothingPersistent;
@@ -405,6 +531,8 @@ struct LogData : NonCopyable, public ReferenceCounted<LogData> {
 			poppedLocation = r.poppedLocation;
 			tag = r.tag;
 			unpoppedRecovered = r.unpoppedRecovered;
+			spillIndexRowsWritten = r.spillIndexRowsWritten;
+			spillIndexCompactedVersion = r.spillIndexCompactedVersion;
 		}
 
 		// Erase messages not needed to update *from* versions >= before (thus, messages with toversion <= before)
@@ -507,6 +635,8 @@ struct LogData : NonCopyable, public ReferenceCounted<LogData> {
 	CounterCollection cc;
 	Counter bytesInput;
 	Counter bytesDurable;
+	Counter spilledPeekCacheHits;
+	Counter spilledPeekCacheMisses;
 
 	UID logId;
 	ProtocolVersion protocolVersion;
@@ -578,7 +708,7 @@ struct LogData : NonCopyable, public ReferenceCounted<LogData> {
 
 	explicit LogData(TLogData* tLogData, TLogInterface interf, Tag remoteTag, bool isPrimary, int logRouterTags, int txsTags, UID recruitmentID, ProtocolVersion protocolVersion, TLogSpillType logSpillType, std::vector<Tag> tags, std::string context) 
 			: tLogData(tLogData), knownCommittedVersion(0), logId(interf.id()),
-			  cc("TLog", interf.id().toString()), bytesInput("BytesInput", cc), bytesDurable("BytesDurable", cc), remoteTag(remoteTag), isPrimary(isPrimary), logRouterTags(logRouterTags), txsTags(txsTags), recruitmentID(recruitmentID), protocolVersion(protocolVersion), logSpillType(logSpillType),
+			  cc("TLog", interf.id().toString()), bytesInput("BytesInput", cc), bytesDurable("BytesDurable", cc), spilledPeekCacheHits("SpilledPeekCacheHits", cc), spilledPeekCacheMisses("SpilledPeekCacheMisses", cc), remoteTag(remoteTag), isPrimary(isPrimary), logRouterTags(logRouterTags), txsTags(txsTags), recruitmentID(recruitmentID), protocolVersion(protocolVersion), logSpillType(logSpillType),
 			  logSystem(new AsyncVar<Reference<ILogSystem>>()), logRouterPoppedVersion(0), durableKnownCommittedVersion(0), minKnownCommittedVersion(0), queuePoppedVersion(0), allTags(tags.begin(), tags.end()), terminated(tLogData->terminated.getFuture()),
 			  minPoppedTagVersion(0), minPoppedTag(invalidTag),
 			// These are initialized differently on init() or recovery
@@ -619,6 +749,7 @@ struct LogData : NonCopyable, public ReferenceCounted<LogData> {
 		specialCounter(cc, "QueueDiskBytesTotal", [tLogData](){ return tLogData->rawPersistentQueue->getStorageBytes().total; });
 		specialCounter(cc, "PeekMemoryReserved", [tLogData]() { return tLogData->peekMemoryLimiter.activePermits(); });
 		specialCounter(cc, "PeekMemoryRequestsStalled", [tLogData]() { return tLogData->peekMemoryLimiter.waiters(); });
+		specialCounter(cc, "SpilledPeekCacheBytes", [tLogData]() { return tLogData->spilledPeekCache.getBytes(); });
 		specialCounter(cc, "Generation", [this]() { return this->recoveryCount; });
 	}
 
@@ -880,6 +1011,92 @@ ACTOR Future<Void> popDiskQueue( TLogData* self, Reference<LogData> logData ) {
 	return Void();
 }
 
+// Rewrites runs of consecutive rows of a tag's spilled by reference index, as read by compactSpillIndex, into blocks of
+// up to TLOG_SPILL_INDEX_BLOCK_BYTES.  A block is keyed by the last version in it, like the rows it replaces, so the keys
+// stay version fences: the first row at or after a version holds it, and a peek reads one block for what took many rows.
+static void rewriteSpillIndexBlocks( TLogData* self, Reference<LogData> logData, Reference<LogData::TagData> data, Standalone<RangeResultRef> const& kvrefs ) {
+	const int64_t maxBlockBytes = SERVER_KNOBS->TLOG_SPILL_INDEX_BLOCK_BYTES;
+	std::vector<SpilledData> block;
+	int blockRows = 0;
+	int64_t blockBytes = 0;
+	Version firstVersion = 0, lastVersion = 0;
+
+	auto writeBlock = [&]() {
+		if (blockRows > 1) {
+			BinaryWriter wr( AssumeVersion(logData->protocolVersion) );
+			wr << uint32_t(block.size());
+			for (const SpilledData& sd : block) {
+				wr << sd;
+			}
+			self->persistentData->clear( KeyRangeRef(
+						persistTagMessageRefsKey( logData->logId, data->tag, firstVersion ),
+						persistTagMessageRefsKey( logData->logId, data->tag, lastVersion ) ) );
+			self->persistentData->set( KeyValueRef( persistTagMessageRefsKey( logData->logId, data->tag, lastVersion ), wr.toValue() ) );
+		}
+		block.clear();
+		blockRows = 0;
+		blockBytes = 0;
+	};
+
+	for (const KeyValueRef& kv : kvrefs) {
+		const Version version = decodeTagMessageRefsKey(kv.key);
+		if (version < data->persistentPopped) continue;  // Cleared since it was read
+
+		const int64_t rowBytes = kv.value.size() - sizeof(uint32_t);
+		if (blockRows && blockBytes + rowBytes > maxBlockBytes) {
+			writeBlock();
+		}
+		if (!blockRows) {
+			firstVersion = version;
+		}
+		VectorRef<SpilledData> spilledData;
+		BinaryReader r(kv.value, AssumeVersion(logData->protocolVersion));
+		r >> spilledData;
+		block.insert(block.end(), spilledData.begin(), spilledData.end());
+		blockRows++;
+		blockBytes += rowBytes;
+		lastVersion = version;
+	}
+
+	// A block that is not yet half full is merged again with the rows written after it
+	const bool tailFull = blockBytes * 2 >= maxBlockBytes;
+	const Version tailBegin = firstVersion;
+	const Version tailEnd = lastVersion;
+	const bool anyRows = blockRows > 0;
+	writeBlock();
+	if (anyRows) {
+		data->spillIndexCompactedVersion = tailFull ? tailEnd : tailBegin - 1;
+	}
+}
+
+static bool shouldCompactSpillIndex( Reference<LogData> logData, Reference<LogData::TagData> data ) {
+	return logData->shouldSpillByReference(data->tag) && !data->nothingPersistent &&
+	       data->spillIndexRowsWritten >= SERVER_KNOBS->TLOG_SPILL_INDEX_COMPACT_ROWS;
+}
+
+// Reads the durable rows of a tag's spilled by reference index that compactSpillIndex merges
+static Future<Standalone<RangeResultRef>> readSpillIndexRows( TLogData* self, Reference<LogData> logData, Reference<LogData::TagData> data ) {
+	Version begin = std::max(data->persistentPopped, data->spillIndexCompactedVersion + 1);
+	return self->persistentData->readRange(KeyRangeRef(
+			persistTagMessageRefsKey(logData->logId, data->tag, begin),
+			persistTagMessageRefsKey(logData->logId, data->tag, logData->persistentDataVersion + 1)),
+		SERVER_KNOBS->TLOG_SPILL_INDEX_COMPACT_ROWS * 2);
+}
+
+// updatePersistentData writes a row to the spilled by reference index of a tag for every batch of versions it spills,
+// which over a long outage of the tag's storage servers adds up to a great many small rows.  Every so often, merge the
+// rows that are already durable into blocks.
+ACTOR Future<Void> compactSpillIndex( TLogData* self, Reference<LogData> logData, Reference<LogData::TagData> data, Future<Standalone<RangeResultRef>> rows ) {
+	Standalone<RangeResultRef> kvrefs = wait(rows);
+
+	TEST(kvrefs.size() > 1);  // TLog compacting spill index rows
+	rewriteSpillIndexBlocks(self, logData, data, kvrefs);
+	if (kvrefs.size() < SERVER_KNOBS->TLOG_SPILL_INDEX_COMPACT_ROWS * 2) {
+		data->spillIndexRowsWritten = 0;
+	}
+	return Void();
+}
+
 ACTOR Future<Void> updatePersistentData( TLogData* self, Reference<LogData> logData, Version newPersistentDataVersion ) {
 	state BinaryWriter wr( Unversioned() );
 	// PERSIST: Changes self->persistentDataVersion and writes and commits the relevant changes
@@ -897,6 +1114,17 @@ ACTOR Future<Void> updatePersistentData( TLogData* self, Reference<LogData> logD
 	state int tagLocality = 0;
 	state int tagId = 0;
 
+	// Read the index rows of every tag that is due for compaction at once, rather than one tag at a time below.  Rows
+	// popped in the meantime are skipped when they are rewritten.
+	state std::map<Tag, Future<Standalone<RangeResultRef>>> spillIndexReads;
+	for (const auto& tags : logData->tag_data) {
+		for (const auto& tagData : tags) {
+			if (tagData && shouldCompactSpillIndex(logData, tagData)) {
+				spillIndexReads[tagData->tag] = readSpillIndexRows(self, logData, tagData);
+			}
+		}
+	}
+
 	for(tagLocality = 0; tagLocality < logData->tag_data.size(); tagLocality++) {
 		for(tagId = 0; tagId < logData->tag_data[tagLocality].size(); tagId++) {
 			state Reference<LogData::TagData> tagData = logData->tag_data[tagLocality][tagId];
@@ -905,6 +1133,10 @@ ACTOR Future<Void> updatePersistentData( TLogData* self, Reference<LogData> logD
 				state Version currentVersion = 0;
 				// Clear recently popped versions from persistentData if necessary
 				updatePersistentPopped( self, logData, tagData );
+				auto spillIndexRead = spillIndexReads.find(tagData->tag);
+				if (spillIndexRead != spillIndexReads.end() && shouldCompactSpillIndex(logData, tagData)) {
+					wait( compactSpillIndex( self, logData, tagData, spillIndexRead->second ) );
+				}
 				state Version lastVersion = std::numeric_limits<Version>::min();
 				state IDiskQueue::location firstLocation = std::numeric_limits<IDiskQueue::location>::max();
 				// Transfer unpopped messages with version numbers less than newPersistentDataVersion to persistentData
@@ -948,6 +1180,7 @@ ACTOR Future<Void> updatePersistentData( TLogData* self, Reference<LogData> logD
 							*(uint32_t*)wr.getData() = refSpilledTagCount;
 							self->persistentData->set( KeyValueRef( persistTagMessageRefsKey( logData->logId, tagData->tag, lastVersion ), wr.toValue() ) );
 							tagData->poppedLocation = std::min(tagData->poppedLocation, firstLocation);
+							tagData->spillIndexRowsWritten++;
 							refSpilledTagCount = 0;
 							wr = BinaryWriter( AssumeVersion(logData->protocolVersion) );
 							wr << uint32_t(0);
@@ -964,6 +1197,7 @@ ACTOR Future<Void> updatePersistentData( TLogData* self, Reference<LogData> logD
 					*(uint32_t*)wr.getData() = refSpilledTagCount;
 					self->persistentData->set( KeyValueRef( persistTagMessageRefsKey( logData->logId, tagData->tag, lastVersion ), wr.toValue() ) );
 					tagData->poppedLocation = std::min(tagData->poppedLocation, firstLocation);
+					tagData->spillIndexRowsWritten++;
 				}
 
 				wait(yield(TaskPriority::UpdateStorage));
@@ -1614,88 +1848,143 @@ ACTOR Future<Void> tLogPeekMessages( TLogData* self, TLogPeekRequest req, Refere
 				messages.serializeBytes( messages2.toValue() );
 			}
 		} else {
-			// FIXME: Limit to approximately DESIRED_TOTATL_BYTES somehow.
-			Standalone<RangeResultRef> kvrefs = wait(
-					self->persistentData->readRange(KeyRangeRef(
-							persistTagMessageRefsKey(logData->logId, req.tag, req.begin),
-							persistTagMessageRefsKey(logData->logId, req.tag, logData->persistentDataDurableVersion + 1)),
-						  SERVER_KNOBS->TLOG_SPILL_REFERENCE_MAX_BATCHES_PER_PEEK+1));
-
-			//TraceEvent("TLogPeekResults", self->dbgid).detail("ForAddress", req.reply.getEndpoint().getPrimaryAddress()).detail("Tag1Results", s1).detail("Tag2Results", s2).detail("Tag1ResultsLim", kv1.size()).detail("Tag2ResultsLim", kv2.size()).detail("Tag1ResultsLast", kv1.size() ? kv1[0].key : "").detail("Tag2ResultsLast", kv2.size() ? kv2[0].key : "").detail("Limited", limited).detail("NextEpoch", next_pos.epoch).detail("NextSeq", next_pos.sequence).detail("NowEpoch", self->epoch()).detail("NowSeq", self->sequence.getNextSequence());
-
-			state std::vector<std::pair<IDiskQueue::location, IDiskQueue::location>> commitLocations;
-			state bool earlyEnd = false;
-			uint32_t mutationBytes = 0;
-			state uint64_t commitBytes = 0;
-			state Version firstVersion = std::numeric_limits<Version>::max();
-			for (int i = 0; i < kvrefs.size() && i < SERVER_KNOBS->TLOG_SPILL_REFERENCE_MAX_BATCHES_PER_PEEK; i++) {
-				auto& kv = kvrefs[i];
-				VectorRef<SpilledData> spilledData;
-				BinaryReader r(kv.value, AssumeVersion(logData->protocolVersion));
-				r >> spilledData;
-				for (const SpilledData& sd : spilledData) {
-					if (mutationBytes >= SERVER_KNOBS->DESIRED_TOTAL_BYTES) {
-						earlyEnd = true;
-						break;
+			// Everything spilled is read up to spilledEnd, where the messages from memory above begin
+			state Version spilledEnd = logData->persistentDataDurableVersion + 1;
+			state Reference<SpilledPeekSegment> cachedSegment;
+			state Promise<Reference<SpilledPeekSegment>> segmentRead;
+			if (SERVER_KNOBS->TLOG_SPILLED_PEEK_CACHE_BYTES > 0) {
+				state Future<Reference<SpilledPeekSegment>> cached =
+				    self->spilledPeekCache.get(logData->logId, req.tag, req.begin);
+				if (cached.isValid()) {
+					TEST(!cached.isReady()); // TLog spilled peek waiting for another peek's read of the same versions
+					try {
+						Reference<SpilledPeekSegment> segment = wait(cached);
+						if (segment->begin <= req.begin && req.begin < segment->end &&
+						    (segment->earlyEnd || segment->end == spilledEnd)) {
+							cachedSegment = segment;
+						}
+					} catch (Error& e) {
+						// The peek that was reading it failed, so read it here instead
+						if (e.code() == error_code_actor_cancelled) throw;
+						TEST(true); // TLog spilled peek reading again after another peek's read failed
 					}
-					if (sd.version >= req.begin) {
-						firstVersion = std::min(firstVersion, sd.version);
-						const IDiskQueue::location end = sd.start.lo + sd.length;
-						commitLocations.emplace_back(sd.start, end);
-						// This isn't perfect, because we aren't accounting for page boundaries, but should be
-						// close enough.
-						commitBytes += sd.length;
-						mutationBytes += sd.mutationBytes;
+				}
+				if (cachedSegment) {
+					TEST(true); // TLog spilled peek answered from the cache
+					++logData->spilledPeekCacheHits;
+				} else {
+					++logData->spilledPeekCacheMisses;
+					self->spilledPeekCache.reading(logData->logId, req.tag, req.begin, segmentRead.getFuture());
+				}
+			}
+
+			if (cachedSegment) {
+				messages.serializeBytes(cachedSegment->messagesFrom(req.begin));
+				if (cachedSegment->earlyEnd) {
+					endVersion = cachedSegment->end;
+					onlySpilled = true;
+				} else {
+					messages.serializeBytes( messages2.toValue() );
+				}
+			} else {
+				// Index rows may be compacted blocks of up to TLOG_SPILL_INDEX_BLOCK_BYTES, so bound the read by bytes as
+				// well as by rows.
+				Standalone<RangeResultRef> kvrefs = wait(
+						self->persistentData->readRange(KeyRangeRef(
+								persistTagMessageRefsKey(logData->logId, req.tag, req.begin),
+								persistTagMessageRefsKey(logData->logId, req.tag, spilledEnd)),
+							  SERVER_KNOBS->TLOG_SPILL_REFERENCE_MAX_BATCHES_PER_PEEK+1,
+							  SERVER_KNOBS->TLOG_SPILL_REFERENCE_MAX_INDEX_BYTES_PER_PEEK));
+
+				//TraceEvent("TLogPeekResults", self->dbgid).detail("ForAddress", req.reply.getEndpoint().getPrimaryAddress()).detail("Tag1Results", s1).detail("Tag2Results", s2).detail("Tag1ResultsLim", kv1.size()).detail("Tag2ResultsLim", kv2.size()).detail("Tag1ResultsLast", kv1.size() ? kv1[0].key : "").detail("Tag2ResultsLast", kv2.size() ? kv2[0].key : "").detail("Limited", limited).detail("NextEpoch", next_pos.epoch).detail("NextSeq", next_pos.sequence).detail("NowEpoch", self->epoch()).detail("NowSeq", self->sequence.getNextSequence());
+
+				state std::vector<std::pair<IDiskQueue::location, IDiskQueue::location>> commitLocations;
+				state bool earlyEnd = false;
+				uint32_t mutationBytes = 0;
+				state uint64_t commitBytes = 0;
+				state Version firstVersion = std::numeric_limits<Version>::max();
+				for (int i = 0; i < kvrefs.size() && i < SERVER_KNOBS->TLOG_SPILL_REFERENCE_MAX_BATCHES_PER_PEEK; i++) {
+					auto& kv = kvrefs[i];
+					VectorRef<SpilledData> spilledData;
+					BinaryReader r(kv.value, AssumeVersion(logData->protocolVersion));
+					r >> spilledData;
+					for (const SpilledData& sd : spilledData) {
+						if (mutationBytes >= SERVER_KNOBS->DESIRED_TOTAL_BYTES) {
+							earlyEnd = true;
+							break;
+						}
+						if (sd.version >= req.begin) {
+							firstVersion = std::min(firstVersion, sd.version);
+							const IDiskQueue::location end = sd.start.lo + sd.length;
+							commitLocations.emplace_back(sd.start, end);
+							// This isn't perfect, because we aren't accounting for page boundaries, but should be
+							// close enough.
+							commitBytes += sd.length;
+							mutationBytes += sd.mutationBytes;
+						}
 					}
+					if (earlyEnd) break;
 				}
-				if (earlyEnd) break;
-			}
-			earlyEnd = earlyEnd || (kvrefs.size() >= SERVER_KNOBS->TLOG_SPILL_REFERENCE_MAX_BATCHES_PER_PEEK+1);
-			wait( self->peekMemoryLimiter.take(TaskPriority::TLogSpilledPeekReply, commitBytes) );
-			state FlowLock::Releaser memoryReservation(self->peekMemoryLimiter, commitBytes);
-			state std::vector<Future<Standalone<StringRef>>> messageReads;
-			messageReads.reserve( commitLocations.size() );
-			for (const auto& pair : commitLocations) {
-				messageReads.push_back( self->rawPersistentQueue->read(pair.first, pair.second, CheckHashes::YES ) );
-			}
-			commitLocations.clear();
-			wait( waitForAll( messageReads ) );
-
-			state Version lastRefMessageVersion = 0;
-			state int index = 0;
-			loop {
-				if (index >= messageReads.size()) break;
-				Standalone<StringRef> queueEntryData = messageReads[index].get();
-				uint8_t valid;
-				const uint32_t length = *(uint32_t*)queueEntryData.begin();
-				queueEntryData = queueEntryData.substr( 4, queueEntryData.size() - 4);
-				BinaryReader rd( queueEntryData, IncludeVersion() );
-				state TLogQueueEntry entry;
-				rd >> entry >> valid;
-				ASSERT( valid == 0x01 );
-				ASSERT( length + sizeof(valid) == queueEntryData.size() );
-
-				messages << VERSION_HEADER << entry.version;
-
-				std::vector<StringRef> rawMessages =
-				    wait(parseMessagesForTag(entry.messages, req.tag, logData->logRouterTags));
-				for (const StringRef& msg : rawMessages) {
-					messages.serializeBytes(msg);
-					DEBUG_TAGS_AND_MESSAGE("TLogPeekFromDisk", entry.version, msg).detail("UID", self->dbgid).detail("LogId", logData->logId).detail("PeekTag", req.tag);
+				earlyEnd = earlyEnd || kvrefs.more || (kvrefs.size() >= SERVER_KNOBS->TLOG_SPILL_REFERENCE_MAX_BATCHES_PER_PEEK+1);
+				wait( self->peekMemoryLimiter.take(TaskPriority::TLogSpilledPeekReply, commitBytes) );
+				state FlowLock::Releaser memoryReservation(self->peekMemoryLimiter, commitBytes);
+				state std::vector<Future<Standalone<StringRef>>> messageReads;
+				messageReads.reserve( commitLocations.size() );
+				for (const auto& pair : commitLocations) {
+					messageReads.push_back( self->rawPersistentQueue->read(pair.first, pair.second, CheckHashes::YES ) );
 				}
+				commitLocations.clear();
+				wait( waitForAll( messageReads ) );
+
+				state Version lastRefMessageVersion = 0;
+				state std::vector<std::pair<Version, int>> versionOffsets;
+				state int index = 0;
+				loop {
+					if (index >= messageReads.size()) break;
+					Standalone<StringRef> queueEntryData = messageReads[index].get();
+					uint8_t valid;
+					const uint32_t length = *(uint32_t*)queueEntryData.begin();
+					queueEntryData = queueEntryData.substr( 4, queueEntryData.size() - 4);
+					BinaryReader rd( queueEntryData, IncludeVersion() );
+					state TLogQueueEntry entry;
+					rd >> entry >> valid;
+					ASSERT( valid == 0x01 );
+					ASSERT( length + sizeof(valid) == queueEntryData.size() );
+
+					versionOffsets.emplace_back(entry.version, messages.getLength());
+					messages << VERSION_HEADER << entry.version;
+
+					std::vector<StringRef> rawMessages =
+					    wait(parseMessagesForTag(entry.messages, req.tag, logData->logRouterTags));
+					for (const StringRef& msg : rawMessages) {
+						messages.serializeBytes(msg);
+						DEBUG_TAGS_AND_MESSAGE("TLogPeekFromDisk", entry.version, msg).detail("UID", self->dbgid).detail("LogId", logData->logId).detail("PeekTag", req.tag);
+					}
 
-				lastRefMessageVersion = entry.version;
-				index++;
-			}
+					lastRefMessageVersion = entry.version;
+					index++;
+				}
 
-			messageReads.clear();
-			memoryReservation.release();
+				messageReads.clear();
+				memoryReservation.release();
+
+				if (SERVER_KNOBS->TLOG_SPILLED_PEEK_CACHE_BYTES > 0 && (!earlyEnd || lastRefMessageVersion >= req.begin)) {
+					auto segment = makeReference<SpilledPeekSegment>();
+					segment->begin = req.begin;
+					segment->end = earlyEnd ? lastRefMessageVersion + 1 : spilledEnd;
+					segment->earlyEnd = earlyEnd;
+					segment->messages = messages.toValue();
+					segment->versionOffsets = std::move(versionOffsets);
+					segmentRead.send(segment);
+					self->spilledPeekCache.add(logData->logId, req.tag, segment);
+				}
 
-			if (earlyEnd) {
-				endVersion = lastRefMessageVersion + 1;
-				onlySpilled = true;
-			} else {
-				messages.serializeBytes( messages2.toValue() );
+				if (earlyEnd) {
+					endVersion = lastRefMessageVersion + 1;
+					onlySpilled = true;
+				} else {
+					messages.serializeBytes( messages2.toValue() );
+				}
 			}
 		}
 	} else {
@@ -1711,7 +2000,9 @@ ACTOR Future<Void> tLogPeekMessages( TLogData* self, TLogPeekRequest req, Refere
 	TLogPeekReply reply;
 	reply.maxKnownVersion = logData->version.get();
 	reply.minKnownCommittedVersion = logData->minKnownCommittedVersion;
-	reply.messages = messages.toValue();
+	Standalone<StringRef> replyMessages = messages.toValue();
+	reply.arena = replyMessages.arena();
+	reply.messages = replyMessages;
 	reply.end = endVersion;
 	reply.onlySpilled = onlySpilled;
 
@@ -3077,3 +3368,125 @@ TEST_CASE("/fdbserver/tlogserver/VersionMessagesOverheadFactor" ) {
 
 	return Void();
 }
+
+// Builds a peek reply the way tLogPeekMessages does, from a writer that is freed when this returns
+ACTOR static Future<TLogPeekReply> peekReplyForTest(std::string contents) {
+	state BinaryWriter messages(Unversioned());
+	messages.serializeBytes(StringRef(contents));
+	wait(delay(0));
+
+	TLogPeekReply reply;
+	Standalone<StringRef> replyMessages = messages.toValue();
+	reply.arena = replyMessages.arena();
+	reply.messages = replyMessages;
+	reply.end = 1;
+	return reply;
+}
+
+TEST_CASE("/fdbserver/tlogserver/PeekReplyOwnsMessages") {
+	state std::string contents = deterministicRandom()->randomAlphaNumeric(deterministicRandom()->randomInt(8 << 10, 100 << 10));
+	state PacketBuffer* first = PacketBuffer::create();
+	state const uint8_t* messagesBegin;
+	state int length;
+	{
+		TLogPeekReply reply = wait(peekReplyForTest(contents));
+		ASSERT(reply.arena.getSize() >= reply.messages.size());
+		messagesBegin = reply.messages.begin();
+
+		PacketWriter wr(first, nullptr, AssumeVersion(g_network->protocolVersion()));
+		wr.setZeroCopyMinBytes(8 << 10);
+		SerializeSource<ErrorOr<EnsureTable<TLogPeekReply>>>(ErrorOr<EnsureTable<TLogPeekReply>>(reply)).serializePacketWriter(wr);
+		wr.finish();
+		length = wr.size();
+	}
+
+	// Only the packet keeps the messages alive now, as when FlowTransport sends it later
+	wait(delay(0));
+	Arena arena;
+	uint8_t* flat = new (arena) uint8_t[length];
+	bool referenced = false;
+	int n = 0;
+	for (PacketBuffer* pb = first; pb;) {
+		referenced = referenced || (pb->isReference() && pb->data() == messagesBegin);
+		memcpy(flat + n, pb->data(), pb->bytes_written);
+		n += pb->bytes_written;
+		PacketBuffer* next = pb->nextPacketBuffer();
+		pb->delref();
+		pb = next;
+	}
+	ASSERT(referenced && n == length);
+
+	ErrorOr<EnsureTable<TLogPeekReply>> out;
+	ObjectReader reader(flat, AssumeVersion(g_network->protocolVersion()));
+	reader.deserialize(out);
+	ASSERT(out.present() && out.get().asUnderlyingType().messages == StringRef(contents));
+	return Void();
+}
+
+static Reference<SpilledPeekSegment> spilledPeekSegmentForTest(Version begin, Version end) {
+	auto segment = makeReference<SpilledPeekSegment>();
+	segment->begin = begin;
+	segment->end = end;
+	segment->messages = StringRef(std::string(100, 'x'));
+	return segment;
+}
+
+TEST_CASE("/fdbserver/tlogserver/SpilledPeekCache") {
+	const UID logId = deterministicRandom()->randomUniqueID();
+	const Tag tag(tagLocalityLogRouter, 1);
+	const int64_t segmentBytes = spilledPeekSegmentForTest(0, 1)->bytes();
+	SpilledPeekCache cache(2 * segmentBytes + segmentBytes / 2);
+	ASSERT(!cache.get(logId, tag, 10).isValid());
+
+	// A peek of the same versions waits for the read in progress, but one of later versions doesn't
+	Promise<Reference<SpilledPeekSegment>> first;
+	cache.reading(logId, tag, 10, first.getFuture());
+	Future<Reference<SpilledPeekSegment>> waiting = cache.get(logId, tag, 10);
+	ASSERT(waiting.isValid() && !waiting.isReady());
+	ASSERT(!cache.get(logId, tag, 11).isValid());
+	ASSERT(cache.getBytes() == 0);
+
+	Reference<SpilledPeekSegment> a = spilledPeekSegmentForTest(10, 20);
+	first.send(a);
+	cache.add(logId, tag, a);
+	ASSERT(waiting.isReady() && waiting.get() == a);
+	ASSERT(cache.get(logId, tag, 15).get() == a);
+	ASSERT(!cache.get(logId, tag, 20).isValid());
+	ASSERT(cache.getBytes() == segmentBytes);
+
+	// A read that fails after a newer read of the same versions replaced it leaves the newer one in place
+	Promise<Reference<SpilledPeekSegment>> failed;
+	Promise<Reference<SpilledPeekSegment>> replacement;
+	cache.reading(logId, tag, 30, failed.getFuture());
+	cache.reading(logId, tag, 30, replacement.getFuture());
+	failed.sendError(io_error());
+	Future<Reference<SpilledPeekSegment>> pending = cache.get(logId, tag, 30);
+	ASSERT(pending.isValid() && !pending.isReady());
+	replacement.sendError(io_error());
+	ASSERT(!cache.get(logId, tag, 30).isValid());
+	ASSERT(cache.get(logId, tag, 15).get() == a);
+
+	// Evicting a segment that a newer read superseded keeps the newer one
+	Promise<Reference<SpilledPeekSegment>> newer;
+	cache.reading(logId, tag, 10, newer.getFuture());
+	Reference<SpilledPeekSegment> b = spilledPeekSegmentForTest(10, 25);
+	newer.send(b);
+	cache.add(logId, tag, b);
+	ASSERT(cache.getBytes() == 2 * segmentBytes);
+
+	Reference<SpilledPeekSegment> c = spilledPeekSegmentForTest(40, 50);
+	cache.reading(logId, tag, 40, c);
+	cache.add(logId, tag, c);
+	ASSERT(cache.getBytes() == 2 * segmentBytes);
+	ASSERT(cache.get(logId, tag, 15).get() == b);
+	ASSERT(cache.get(logId, tag, 45).get() == c);
+
+	Reference<SpilledPeekSegment> d = spilledPeekSegmentForTest(60, 70);
+	cache.reading(logId, tag, 60, d);
+	cache.add(logId, tag, d);
+	ASSERT(cache.getBytes() == 2 * segmentBytes);
+	ASSERT(!cache.get(logId, tag, 15).isValid());
+	ASSERT(cache.get(logId, tag, 45).get() == c);
+	ASSERT(cache.get(logId, tag, 65).get() == d);
+	return Void();
+}
@@ -772,6 +772,7 @@ struct RedwoodMetrics {
 	struct Level {
 		unsigned int pageRead;
 		unsigned int pageReadExt;
+		unsigned int pageReadCached;
 		unsigned int pageBuild;
 		unsigned int pageBuildExt;
 		unsigned int pageCommitStart;
@@ -808,6 +809,7 @@ struct RedwoodMetrics {
 	unsigned int pagerRemapSkip;
 	unsigned int pagerCacheHit;
 	unsigned int pagerCacheMiss;
+	unsigned int pagerCachePromote;
 	unsigned int pagerProbeHit;
 	unsigned int pagerProbeMiss;
 	unsigned int pagerEvictUnhit;
@@ -851,6 +853,7 @@ struct RedwoodMetrics {
 			                                               { "PagerDiskRead", pagerDiskRead },
 			                                               { "PagerCacheHit", pagerCacheHit },
 			                                               { "PagerCacheMiss", pagerCacheMiss },
+			                                               { "PagerCachePromote", pagerCachePromote },
 			                                               { "", 0 },
 			                                               { "PagerProbeHit", pagerProbeHit },
 			                                               { "PagerProbeMiss", pagerProbeMiss },
@@ -891,6 +894,7 @@ struct RedwoodMetrics {
 				{ "", 0 },
 				{ "PageRead", level.pageRead },
 				{ "PageReadExt", level.pageReadExt },
+				{ "PageReadCached", level.pageReadCached },
 				{ "PageCommitStart", level.pageCommitStart },
 				{ "", 0 },
 				{ "LazyClearInt", level.lazyClearRequeue },
@@ -979,21 +983,26 @@ template <class IndexType, class ObjectType>
 class ObjectCache : NonCopyable {
 
 	struct Entry : public boost::intrusive::list_base_hook<> {
-		Entry() : hits(0) {}
+		Entry() : hits(0), isProtected(false) {}
 		IndexType index;
 		ObjectType item;
 		int hits;
+		bool isProtected; // Which eviction order the entry is in
 	};
 
 	typedef std::unordered_map<IndexType, Entry> CacheT;
 	typedef boost::intrusive::list<Entry> EvictionOrderT;
 
 public:
-	ObjectCache(int sizeLimit = 1) : sizeLimit(sizeLimit) {}
+	// The cache is a segmented LRU.  New entries start in the probationary segment and are only moved to the protected
+	// segment when they are hit again, so a single pass over many objects (such as a large range read) can only evict
+	// other probationary entries and not the frequently used ones (such as upper level BTree nodes).
+	ObjectCache(int sizeLimit = 1) { setSizeLimit(sizeLimit); }
 
 	void setSizeLimit(int n) {
 		ASSERT(n > 0);
 		sizeLimit = n;
+		protectedSizeLimit = std::max<int64_t>(1, n * SERVER_KNOBS->REDWOOD_PAGE_CACHE_PROTECTED_FRACTION);
 	}
 
 	// Get the object for i if it exists, else return nullptr.
@@ -1010,21 +1019,35 @@ public:
 	}
 
 	// Get the object for i or create a new one.
-	// After a get(), the object for i is the last in evictionOrder.
-	// If noHit is set, do not consider this access to be cache hit if the object is present
+	// After a get(), the object for i is the last in its eviction order.
+	// If noHit is set, do not consider this access to be cache hit if the object is present, and do not promote it
 	// If noMiss is set, do not consider this access to be a cache miss if the object is not present
 	ObjectType& get(const IndexType& index, bool noHit = false, bool noMiss = false) {
 		Entry& entry = cache[index];
 
-		// If entry is linked into evictionOrder then move it to the back of the order
+		// If entry is linked into an eviction order then move it to the back of the protected order
 		if (entry.is_linked()) {
 			if (!noHit) {
 				++entry.hits;
 				++g_redwoodMetrics.pagerCacheHit;
 
-				// Move the entry to the back of the eviction order
-				evictionOrder.erase(evictionOrder.iterator_to(entry));
-				evictionOrder.push_back(entry);
+				if (entry.isProtected) {
+					protectedOrder.erase(protectedOrder.iterator_to(entry));
+					protectedOrder.push_back(entry);
+				} else {
+					++g_redwoodMetrics.pagerCachePromote;
+					probationOrder.erase(probationOrder.iterator_to(entry));
+					entry.isProtected = true;
+					protectedOrder.push_back(entry);
+
+					// Demote the least recently used protected entry to make room
+					if ((int64_t)protectedOrder.size() > protectedSizeLimit) {
+						Entry& toDemote = protectedOrder.front();
+						protectedOrder.pop_front();
+						toDemote.isProtected = false;
+						probationOrder.push_back(toDemote);
+					}
+				}
 			}
 		} else {
 			if (!noMiss) {
@@ -1033,28 +1056,33 @@ public:
 			// Finish initializing entry
 			entry.index = index;
 			entry.hits = 0;
-			// Insert the newly created Entry at the back of the eviction order
-			evictionOrder.push_back(entry);
+			entry.isProtected = false;
+			// Insert the newly created Entry at the back of the probationary order
+			probationOrder.push_back(entry);
 
 			// While the cache is too big, evict the oldest entry until the oldest entry can't be evicted.
+			// Probationary entries are evicted first.
 			while (cache.size() > sizeLimit) {
-				Entry& toEvict = evictionOrder.front();
-
 				// It's critical that we do not evict the item we just added because it would cause the reference
 				// returned to be invalid.  An eviction could happen with a no-hit access to a cache resident page
 				// that is currently evictable and exists in the oversized portion of the cache eviction order due
 				// to previously failed evictions.
-				if (&entry == &toEvict) {
-					debug_printf("Cannot evict target index %s\n", toString(index).c_str());
-					break;
+				EvictionOrderT* order = &probationOrder;
+				if (&probationOrder.front() == &entry) {
+					if (protectedOrder.empty()) {
+						debug_printf("Cannot evict target index %s\n", toString(index).c_str());
+						break;
+					}
+					order = &protectedOrder;
 				}
+				Entry& toEvict = order->front();
 
 				debug_printf("Trying to evict %s to make room for %s\n", toString(toEvict.index).c_str(),
 				             toString(index).c_str());
 
 				if (!toEvict.item.evictable()) {
-					evictionOrder.erase(evictionOrder.iterator_to(toEvict));
-					evictionOrder.push_back(toEvict);
+					order->erase(order->iterator_to(toEvict));
+					order->push_back(toEvict);
 					++g_redwoodMetrics.pagerEvictFail;
 					break;
 				} else {
@@ -1063,7 +1091,7 @@ public:
 					}
 					debug_printf("Evicting %s to make room for %s\n", toString(toEvict.index).c_str(),
 					             toString(index).c_str());
-					evictionOrder.pop_front();
+					order->pop_front();
 					cache.erase(toEvict.index);
 				}
 			}
@@ -1083,7 +1111,8 @@ public:
 		// structures so we know for sure that no page will become unevictable
 		// after it is either evictable or onEvictable() is ready.
 		cache.swap(self->cache);
-		evictionOrder.swap(self->evictionOrder);
+		evictionOrder.splice(evictionOrder.end(), self->probationOrder);
+		evictionOrder.splice(evictionOrder.end(), self->protectedOrder);
 
 		state typename EvictionOrderT::iterator i = evictionOrder.begin();
 		state typename EvictionOrderT::iterator iEnd = evictionOrder.begin();
@@ -1102,17 +1131,19 @@ public:
 	}
 
 	Future<Void> clear() {
-		ASSERT(evictionOrder.size() == cache.size());
+		ASSERT(count() == cache.size());
 		return clear_impl(this);
 	}
 
-	int count() const { return evictionOrder.size(); }
+	int count() const { return probationOrder.size() + protectedOrder.size(); }
 
 private:
 	int64_t sizeLimit;
+	int64_t protectedSizeLimit;
 
 	CacheT cache;
-	EvictionOrderT evictionOrder;
+	EvictionOrderT probationOrder;
+	EvictionOrderT protectedOrder;
 };
 
 ACTOR template <class T>
@@ -3897,7 +3928,7 @@ private:
 	ACTOR static Future<Reference<const IPage>> readPage(Reference<IPagerSnapshot> snapshot, BTreePageIDRef id,
 	                                                     const RedwoodRecordRef* lowerBound,
 	                                                     const RedwoodRecordRef* upperBound,
-	                                                     bool forLazyClear = false) {
+	                                                     bool forLazyClear = false, bool noHit = false) {
 		if (!forLazyClear) {
 			debug_printf("readPage() op=read %s @%" PRId64 " lower=%s upper=%s\n", toString(id).c_str(),
 			             snapshot->getVersion(), lowerBound->toString(false).c_str(),
@@ -3910,15 +3941,19 @@ private:
 		wait(yield());
 
 		state Reference<const IPage> page;
+		state bool cached = false;
 
 		if (id.size() == 1) {
-			Reference<const IPage> p = wait(snapshot->getPhysicalPage(id.front(), !forLazyClear, false));
+			Future<Reference<const IPage>> read = snapshot->getPhysicalPage(id.front(), !forLazyClear, noHit);
+			// Cache hits are counted by level so that internal and leaf page cache behavior can be told apart
+			cached = read.isReady();
+			Reference<const IPage> p = wait(read);
 			page = p;
 		} else {
 			ASSERT(!id.empty());
 			std::vector<Future<Reference<const IPage>>> reads;
 			for (auto& pageID : id) {
-				reads.push_back(snapshot->getPhysicalPage(pageID, !forLazyClear, false));
+				reads.push_back(snapshot->getPhysicalPage(pageID, !forLazyClear, noHit));
 			}
 			std::vector<Reference<const IPage>> pages = wait(getAll(reads));
 			// TODO:  Cache reconstituted super pages somehow, perhaps with help from the Pager.
@@ -3930,6 +3965,7 @@ private:
 		auto& metrics = g_redwoodMetrics.level(pTreePage->height);
 		metrics.pageRead += 1;
 		metrics.pageReadExt += (id.size() - 1);
+		metrics.pageReadCached += cached ? 1 : 0;
 
 		if (!forLazyClear && page->userData == nullptr) {
 			debug_printf("readPage() Creating Reader for %s @%" PRId64 " lower=%s upper=%s\n", toString(id).c_str(),
@@ -5251,6 +5287,8 @@ public:
 		std::unordered_map<LogicalPageID, Reference<const IPage>> pages;
 		VersionedBTree* btree;
 		bool valid;
+		// Page reads will not count as cache hits or promote pages in the pager's cache
+		bool noHit;
 
 		struct PathEntry {
 			BTreePage* btPage;
@@ -5300,7 +5338,8 @@ public:
 				return Void();
 			}
 
-			return map(readPage(pager, id, &lowerBound, &upperBound), [this, &page, id](Reference<const IPage> p) {
+			return map(readPage(pager, id, &lowerBound, &upperBound, false, noHit),
+			           [this, &page, id](Reference<const IPage> p) {
 				page = p;
 				path.push_back(arena, { (BTreePage*)p->begin(), getCursor(p) });
 				return Void();
@@ -5315,9 +5354,11 @@ public:
 			return pushPage(id, rec, next.getOrUpperBound());
 		}
 
-		Future<Void> init(VersionedBTree* btree_in, Reference<IPagerSnapshot> pager_in, BTreePageIDRef root) {
+		Future<Void> init(VersionedBTree* btree_in, Reference<IPagerSnapshot> pager_in, BTreePageIDRef root,
+		                  bool noHit_in = false) {
 			btree = btree_in;
 			pager = pager_in;
+			noHit = noHit_in;
 			path.reserve(arena, 6);
 			valid = false;
 			return pushPage(root, dbBegin, dbEnd);
@@ -5474,7 +5515,9 @@ public:
 		Future<Void> movePrev() { return move_impl(this, false); }
 	};
 
-	Future<Void> initBTreeCursor(BTreeCursor* cursor, Version snapshotVersion) {
+	// If noHit is set, the cursor's page reads will not promote pages in the page cache, which is meant for
+	// background scans that would otherwise push the foreground working set out of the cache.
+	Future<Void> initBTreeCursor(BTreeCursor* cursor, Version snapshotVersion, bool noHit = false) {
 		// Only committed versions can be read.
 		ASSERT(snapshotVersion <= m_lastCommittedVersion);
 		Reference<IPagerSnapshot> snapshot = m_pager->getReadSnapshot(snapshotVersion);
@@ -5482,7 +5525,7 @@ public:
 		// This is a ref because snapshot will continue to hold the metakey value memory
 		KeyRef m = snapshot->getMetaKey();
 
-		return cursor->init(this, snapshot, ((MetaKey*)m.begin())->root.get());
+		return cursor->init(this, snapshot, ((MetaKey*)m.begin())->root.get(), noHit);
 	}
 
 	// Cursor is for reading and interating over user visible KV pairs at a specific version
@@ -5692,7 +5735,8 @@ RedwoodRecordRef VersionedBTree::dbEnd(LiteralStringRef("\xff\xff\xff\xff\xff"))
 class KeyValueStoreRedwoodUnversioned : public IKeyValueStore {
 public:
 	KeyValueStoreRedwoodUnversioned(std::string filePrefix, UID logID)
-	  : m_filePrefix(filePrefix), m_concurrentReads(new FlowLock(SERVER_KNOBS->REDWOOD_KVSTORE_CONCURRENT_READS)) {
+	  : m_filePrefix(filePrefix), m_concurrentReads(new FlowLock(SERVER_KNOBS->REDWOOD_KVSTORE_CONCURRENT_READS)),
+	    m_concurrentBackgroundReads(new FlowLock(SERVER_KNOBS->REDWOOD_KVSTORE_CONCURRENT_BACKGROUND_READS)) {
 		// TODO: This constructor should really just take an IVersionedStore
 
 		int pageSize = BUGGIFY ? deterministicRandom()->randomInt(1000, 4096*4) : SERVER_KNOBS->REDWOOD_DEFAULT_PAGE_SIZE;
@@ -5765,16 +5809,28 @@ public:
 		m_tree->set(keyValue);
 	}
 
-	Future<Standalone<RangeResultRef>> readRange(KeyRangeRef keys, int rowLimit = 1 << 30,
-	                                             int byteLimit = 1 << 30) override {
+	Future<Standalone<RangeResultRef>> readRange(KeyRangeRef keys, int rowLimit = 1 << 30, int byteLimit = 1 << 30,
+	                                             ReadType type = ReadType::NORMAL) override {
 		debug_printf("READRANGE %s\n", printable(keys).c_str());
-		return catchError(readRange_impl(this, keys, rowLimit, byteLimit));
+		return catchError(readRange_impl(this, keys, rowLimit, byteLimit, type));
 	}
 
+	// Fetch and low priority reads must first take a background read permit, so they can never hold more than
+	// REDWOOD_KVSTORE_CONCURRENT_BACKGROUND_READS of the general read permits, and they do not promote the pages
+	// they touch in the page cache.
+	static bool isBackgroundRead(ReadType type) { return type == ReadType::FETCH || type == ReadType::LOW; }
+
 	ACTOR static Future<Standalone<RangeResultRef>> readRange_impl(KeyValueStoreRedwoodUnversioned* self, KeyRange keys,
-	                                                               int rowLimit, int byteLimit) {
+	                                                               int rowLimit, int byteLimit, ReadType type) {
+		state bool background = isBackgroundRead(type);
 		state VersionedBTree::BTreeCursor cur;
-		wait(self->m_tree->initBTreeCursor(&cur, self->m_tree->getLastCommittedVersion()));
+		wait(self->m_tree->initBTreeCursor(&cur, self->m_tree->getLastCommittedVersion(), background));
+
+		state Reference<FlowLock> backgroundLock = self->m_concurrentBackgroundReads;
+		if (background) {
+			wait(backgroundLock->take(TaskPriority::LowPriorityRead));
+		}
+		state FlowLock::Releaser backgroundReleaser(*backgroundLock, background ? 1 : 0);
 
 		state Reference<FlowLock> readLock = self->m_concurrentReads;
 		wait(readLock->take());
@@ -5853,9 +5909,16 @@ public:
 	}
 
 	ACTOR static Future<Optional<Value>> readValue_impl(KeyValueStoreRedwoodUnversioned* self, Key key,
-	                                                    Optional<UID> debugID) {
+	                                                    ReadType type, Optional<UID> debugID) {
+		state bool background = isBackgroundRead(type);
 		state VersionedBTree::BTreeCursor cur;
-		wait(self->m_tree->initBTreeCursor(&cur, self->m_tree->getLastCommittedVersion()));
+		wait(self->m_tree->initBTreeCursor(&cur, self->m_tree->getLastCommittedVersion(), background));
+
+		state Reference<FlowLock> backgroundLock = self->m_concurrentBackgroundReads;
+		if (background) {
+			wait(backgroundLock->take(TaskPriority::LowPriorityRead));
+		}
+		state FlowLock::Releaser backgroundReleaser(*backgroundLock, background ? 1 : 0);
 
 		state Reference<FlowLock> readLock = self->m_concurrentReads;
 		wait(readLock->take());
@@ -5869,14 +5932,22 @@ public:
 		return Optional<Value>();
 	}
 
-	Future<Optional<Value>> readValue(KeyRef key, Optional<UID> debugID = Optional<UID>()) override {
-		return catchError(readValue_impl(this, key, debugID));
+	Future<Optional<Value>> readValue(KeyRef key, ReadType type = ReadType::NORMAL,
+	                                  Optional<UID> debugID = Optional<UID>()) override {
+		return catchError(readValue_impl(this, key, type, debugID));
 	}
 
 	ACTOR static Future<Optional<Value>> readValuePrefix_impl(KeyValueStoreRedwoodUnversioned* self, Key key,
-	                                                          int maxLength, Optional<UID> debugID) {
+	                                                          int maxLength, ReadType type, Optional<UID> debugID) {
+		state bool background = isBackgroundRead(type);
 		state VersionedBTree::BTreeCursor cur;
-		wait(self->m_tree->initBTreeCursor(&cur, self->m_tree->getLastCommittedVersion()));
+		wait(self->m_tree->initBTreeCursor(&cur, self->m_tree->getLastCommittedVersion(), background));
+
+		state Reference<FlowLock> backgroundLock = self->m_concurrentBackgroundReads;
+		if (background) {
+			wait(backgroundLock->take(TaskPriority::LowPriorityRead));
+		}
+		state FlowLock::Releaser backgroundReleaser(*backgroundLock, background ? 1 : 0);
 
 		state Reference<FlowLock> readLock = self->m_concurrentReads;
 		wait(readLock->take());
@@ -5893,9 +5964,9 @@ public:
 		return Optional<Value>();
 	}
 
-	Future<Optional<Value>> readValuePrefix(KeyRef key, int maxLength,
+	Future<Optional<Value>> readValuePrefix(KeyRef key, int maxLength, ReadType type = ReadType::NORMAL,
 	                                        Optional<UID> debugID = Optional<UID>()) override {
-		return catchError(readValuePrefix_impl(this, key, maxLength, debugID));
+		return catchError(readValuePrefix_impl(this, key, maxLength, type, debugID));
 	}
 
 	~KeyValueStoreRedwoodUnversioned() override{};
@@ -5907,6 +5978,7 @@ private:
 	Promise<Void> m_closed;
 	Promise<Void> m_error;
 	Reference<FlowLock> m_concurrentReads;
+	Reference<FlowLock> m_concurrentBackgroundReads;
 
 	template <typename T>
 	inline Future<T> catchError(Future<T> f) {
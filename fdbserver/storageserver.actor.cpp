@@ -33,6 +33,7 @@
 #include "flow/IndexedSet.h"
 #include "flow/SystemMonitor.h"
 #include "flow/Tracing.h"
+#include "flow/UnitTest.h"
 #include "flow/Util.h"
 #include "fdbclient/Atomic.h"
 #include "fdbclient/DatabaseContext.h"
@@ -42,6 +43,7 @@
 #include "fdbclient/Notified.h"
 #include "fdbclient/StatusClient.h"
 #include "fdbclient/SystemData.h"
+#include "fdbclient/Tuple.h"
 #include "fdbclient/VersionedMap.h"
 #include "fdbserver/FDBExecHelper.actor.h"
 #include "fdbserver/IKeyValueStore.h"
@@ -79,6 +81,8 @@ inline bool canReplyWith(Error e) {
 		case error_code_wrong_shard_server:
 		case error_code_process_behind:
 		case error_code_watch_cancelled:
+		case error_code_mapper_bad_index:
+		case error_code_invalid_tuple_data_type:
 		//case error_code_all_alternatives_failed:
 			return true;
 		default:
@@ -169,12 +173,13 @@ struct StorageServerDisk {
 	Future<Void> getError() { return storage->getError(); }
 	Future<Void> init() { return storage->init(); }
 	Future<Void> commit() { return storage->commit(); }
+	void setDurabilityLag(Version lag) { storage->setDurabilityLag(lag); }
 
 	// SOMEDAY: Put readNextKeyInclusive in IKeyValueStore
-	Future<Key> readNextKeyInclusive( KeyRef key ) { return readFirstKey(storage, KeyRangeRef(key, allKeys.end)); }
-	Future<Optional<Value>> readValue( KeyRef key, Optional<UID> debugID = Optional<UID>() ) { return storage->readValue(key, debugID); }
-	Future<Optional<Value>> readValuePrefix( KeyRef key, int maxLength, Optional<UID> debugID = Optional<UID>() ) { return storage->readValuePrefix(key, maxLength, debugID); }
-	Future<Standalone<RangeResultRef>> readRange( KeyRangeRef keys, int rowLimit = 1<<30, int byteLimit = 1<<30 ) { return storage->readRange(keys, rowLimit, byteLimit); }
+	Future<Key> readNextKeyInclusive( KeyRef key, IKeyValueStore::ReadType type = IKeyValueStore::ReadType::NORMAL ) { return readFirstKey(storage, KeyRangeRef(key, allKeys.end), type); }
+	Future<Optional<Value>> readValue( KeyRef key, IKeyValueStore::ReadType type = IKeyValueStore::ReadType::NORMAL, Optional<UID> debugID = Optional<UID>() ) { return storage->readValue(key, type, debugID); }
+	Future<Optional<Value>> readValuePrefix( KeyRef key, int maxLength, IKeyValueStore::ReadType type = IKeyValueStore::ReadType::NORMAL, Optional<UID> debugID = Optional<UID>() ) { return storage->readValuePrefix(key, maxLength, type, debugID); }
+	Future<Standalone<RangeResultRef>> readRange( KeyRangeRef keys, int rowLimit = 1<<30, int byteLimit = 1<<30, IKeyValueStore::ReadType type = IKeyValueStore::ReadType::NORMAL ) { return storage->readRange(keys, rowLimit, byteLimit, type); }
 
 	KeyValueStoreType getKeyValueStoreType() const { return storage->getType(); }
 	StorageBytes getStorageBytes() const { return storage->getStorageBytes(); }
@@ -186,8 +191,8 @@ private:
 
 	void writeMutations(const VectorRef<MutationRef>& mutations, Version debugVersion, const char* debugContext);
 
-	ACTOR static Future<Key> readFirstKey( IKeyValueStore* storage, KeyRangeRef range ) {
-		Standalone<RangeResultRef> r = wait( storage->readRange( range, 1 ) );
+	ACTOR static Future<Key> readFirstKey( IKeyValueStore* storage, KeyRangeRef range, IKeyValueStore::ReadType type ) {
+		Standalone<RangeResultRef> r = wait( storage->readRange( range, 1, 1<<30, type ) );
 		if (r.size()) return r[0].key;
 		else return range.end;
 	}
@@ -608,7 +613,7 @@ public:
 
 	struct Counters {
 		CounterCollection cc;
-		Counter allQueries, getKeyQueries, getValueQueries, getRangeQueries, finishedQueries, lowPriorityQueries, rowsQueried, bytesQueried, watchQueries, emptyQueries;
+		Counter allQueries, getKeyQueries, getValueQueries, getValuesQueries, getRangeQueries, getRangeStreamQueries, getMappedRangeQueries, finishedQueries, lowPriorityQueries, rowsQueried, bytesQueried, watchQueries, emptyQueries;
 		Counter bytesInput, bytesDurable, bytesFetched,
 			mutationBytes;  // Like bytesInput but without MVCC accounting
 		Counter sampledBytesCleared;
@@ -625,7 +630,10 @@ public:
 			: cc("StorageServer", self->thisServerID.toString()),
 			getKeyQueries("GetKeyQueries", cc),
 			getValueQueries("GetValueQueries",cc),
+			getValuesQueries("GetValuesQueries",cc),
 			getRangeQueries("GetRangeQueries", cc),
+			getRangeStreamQueries("GetRangeStreamQueries", cc),
+			getMappedRangeQueries("GetMappedRangeQueries", cc),
 			allQueries("QueryQueue", cc),
 			finishedQueries("FinishedQueries", cc),
 			lowPriorityQueries("LowPriorityQueries", cc),
@@ -806,6 +814,11 @@ public:
 		promise.sendError(err);
 	}
 
+	template <class Reply>
+	static void sendErrorWithPenalty(const ReplyPromiseStream<Reply>& stream, const Error& err, double) {
+		stream.sendError(err);
+	}
+
 	template<class Request>
 	bool shouldRead(const Request& request) {
 		auto rate = currentRate();
@@ -1073,7 +1086,7 @@ ACTOR Future<Void> getValueQ( StorageServer* data, GetValueRequest req ) {
 			path = 1;
 		} else if (!i || !i->isClearTo() || i->getEndKey() <= req.key) {
 			path = 2;
-			Optional<Value> vv = wait( data->storage.readValue( req.key, req.debugID ) );
+			Optional<Value> vv = wait( data->storage.readValue( req.key, IKeyValueStore::ReadType::NORMAL, req.debugID ) );
 			// Validate that while we were reading the data we didn't lose the version or shard
 			if (version < data->storageVersion()) {
 				TEST(true); // transaction_too_old after readValue
@@ -1142,6 +1155,113 @@ ACTOR Future<Void> getValueQ( StorageServer* data, GetValueRequest req ) {
 	return Void();
 };
 
+// Serves several point reads at one version with a single reply.  Values which are not in the versioned data are all
+// read from the storage engine concurrently, so that an engine which batches point reads can serve them together.
+ACTOR Future<Void> getValuesQ( StorageServer* data, GetValuesRequest req ) {
+	state int64_t resultSize = 0;
+	Span span("SS:getValues"_loc, { req.spanContext });
+
+	try {
+		++data->counters.getValuesQueries;
+		++data->counters.allQueries;
+		++data->readQueueSizeMetric;
+		data->maxQueryQueue = std::max<int>( data->maxQueryQueue, data->counters.allQueries.getValue() - data->counters.finishedQueries.getValue());
+
+		// Active load balancing runs at a very high priority (to obtain accurate queue lengths)
+		// so we need to downgrade here
+		wait( data->getQueryDelay() );
+
+		if( req.debugID.present() )
+			g_traceBatch.addEvent("GetValueDebug", req.debugID.get().first(), "getValuesQ.DoRead");
+
+		state Version version = wait( waitForVersion( data, req.version, req.spanContext ) );
+		if( req.debugID.present() )
+			g_traceBatch.addEvent("GetValueDebug", req.debugID.get().first(), "getValuesQ.AfterVersion");
+
+		state uint64_t changeCounter = data->shardChangeCounter;
+		state std::vector<Optional<Value>> values(req.keys.size());
+		state std::vector<Future<Optional<Value>>> reads(req.keys.size());
+		state bool readStorage = false;
+
+		for (int k = 0; k < req.keys.size(); k++) {
+			const KeyRef& key = req.keys[k];
+			if (!data->shards[key]->isReadable()) {
+				throw wrong_shard_server();
+			}
+
+			auto i = data->data().at(version).lastLessOrEqual(key);
+			if (i && i->isValue() && i.key() == key) {
+				values[k] = (Value)i->getValue();
+			} else if (!i || !i->isClearTo() || i->getEndKey() <= key) {
+				reads[k] = data->storage.readValue( key, IKeyValueStore::ReadType::NORMAL, req.debugID );
+				readStorage = true;
+			}
+		}
+
+		if (readStorage) {
+			wait( waitForAll(reads) );
+			// Validate that while we were reading the data we didn't lose the version or shard
+			if (version < data->storageVersion()) {
+				TEST(true); // transaction_too_old after readValue in getValuesQ
+				throw transaction_too_old();
+			}
+		}
+
+		GetValuesReply reply;
+		for (int k = 0; k < req.keys.size(); k++) {
+			const KeyRef& key = req.keys[k];
+			if (reads[k].isValid()) {
+				data->checkChangeCounter(changeCounter, key);
+				values[k] = reads[k].get();
+			}
+
+			if (values[k].present()) {
+				reply.data.push_back_deep(reply.arena, KeyValueRef(key, values[k].get()));
+				++data->counters.rowsQueried;
+				resultSize += values[k].get().size();
+			} else {
+				++data->counters.emptyQueries;
+			}
+
+			if (SERVER_KNOBS->READ_SAMPLING_ENABLED) {
+				// If the read yields no value, randomly sample the empty read.
+				int64_t bytesReadPerKSecond =
+				    values[k].present() ? std::max((int64_t)(key.size() + values[k].get().size()), SERVER_KNOBS->EMPTY_READ_PENALTY)
+				                        : SERVER_KNOBS->EMPTY_READ_PENALTY;
+				data->metrics.notifyBytesReadPerKSecond(key, bytesReadPerKSecond);
+			}
+
+			// Check if any of the desired keys might be cached
+			reply.cached = reply.cached || data->cachedRangeMap[key];
+		}
+		data->counters.bytesQueried += resultSize;
+
+		if( req.debugID.present() )
+			g_traceBatch.addEvent("GetValueDebug", req.debugID.get().first(), "getValuesQ.AfterRead");
+
+		reply.penalty = data->getPenalty();
+		req.reply.send(reply);
+	} catch (Error& e) {
+		if(!canReplyWith(e))
+			throw;
+		data->sendErrorWithPenalty(req.reply, e, data->getPenalty());
+	}
+
+	data->transactionTagCounter.addRequest(req.tags, resultSize);
+
+	++data->counters.finishedQueries;
+	--data->readQueueSizeMetric;
+
+	double duration = g_network->timer() - req.requestTime();
+	data->counters.readLatencySample.addMeasurement(duration);
+	if(data->latencyBandConfig.present()) {
+		int maxReadBytes = data->latencyBandConfig.get().readConfig.maxReadBytes.orDefault(std::numeric_limits<int>::max());
+		data->counters.readLatencyBands.addMeasurement(duration, resultSize > maxReadBytes);
+	}
+
+	return Void();
+}
+
 // Pessimistic estimate the number of overhead bytes used by each
 // watch. Watch key references are stored in an AsyncMap<Key,bool>, and actors
 // must be kept alive until the watch is finished.
@@ -1372,7 +1492,7 @@ void merge( Arena& arena, VectorRef<KeyValueRef, VecSerStrategy::String>& output
 
 // If limit>=0, it returns the first rows in the range (sorted ascending), otherwise the last rows (sorted descending).
 // readRange has O(|result|) + O(log |data|) cost
-ACTOR Future<GetKeyValuesReply> readRange( StorageServer* data, Version version, KeyRange range, int limit, int* pLimitBytes, SpanID parentSpan ) {
+ACTOR Future<GetKeyValuesReply> readRange( StorageServer* data, Version version, KeyRange range, int limit, int* pLimitBytes, SpanID parentSpan, IKeyValueStore::ReadType type = IKeyValueStore::ReadType::NORMAL ) {
 	state GetKeyValuesReply result;
 	state StorageServer::VersionedData::ViewAtVersion view = data->data().at(version);
 	state StorageServer::VersionedData::iterator vCurrent = view.end();
@@ -1438,7 +1558,7 @@ ACTOR Future<GetKeyValuesReply> readRange( StorageServer* data, Version version,
 			// Read the data on disk up to vCurrent (or the end of the range)
 			readEnd = vCurrent ? std::min( vCurrent.key(), range.end ) : range.end;
 			Standalone<RangeResultRef> atStorageVersion = wait(
-				data->storage.readRange( KeyRangeRef(readBegin, readEnd), limit, *pLimitBytes ) );
+				data->storage.readRange( KeyRangeRef(readBegin, readEnd), limit, *pLimitBytes, type ) );
 
 			ASSERT( atStorageVersion.size() <= limit );
 			if (data->storageVersion() > version) throw transaction_too_old();
@@ -1508,7 +1628,7 @@ ACTOR Future<GetKeyValuesReply> readRange( StorageServer* data, Version version,
 
 			readBegin = vCurrent ? std::max(vCurrent->isClearTo() ? vCurrent->getEndKey() : vCurrent.key(), range.begin) : range.begin;
 			Standalone<RangeResultRef> atStorageVersion =
-			    wait(data->storage.readRange(KeyRangeRef(readBegin, readEnd), limit, *pLimitBytes));
+			    wait(data->storage.readRange(KeyRangeRef(readBegin, readEnd), limit, *pLimitBytes, type));
 
 			ASSERT(atStorageVersion.size() <= -limit);
 			if (data->storageVersion() > version) throw transaction_too_old();
@@ -1552,7 +1672,7 @@ ACTOR Future<GetKeyValuesReply> readRange( StorageServer* data, Version version,
 //	return sel.getKey() >= range.begin && (sel.isBackward() ? sel.getKey() <= range.end : sel.getKey() < range.end);
 //}
 
-ACTOR Future<Key> findKey( StorageServer* data, KeySelectorRef sel, Version version, KeyRange range, int* pOffset, SpanID parentSpan)
+ACTOR Future<Key> findKey( StorageServer* data, KeySelectorRef sel, Version version, KeyRange range, int* pOffset, SpanID parentSpan, IKeyValueStore::ReadType type = IKeyValueStore::ReadType::NORMAL)
 // Attempts to find the key indicated by sel in the data at version, within range.
 // Precondition: selectorInRange(sel, range)
 // If it is found, offset is set to 0 and a key is returned which falls inside range.
@@ -1581,7 +1701,7 @@ ACTOR Future<Key> findKey( StorageServer* data, KeySelectorRef sel, Version vers
 	state GetKeyValuesReply rep = wait(
 	    readRange(data, version,
 	              forward ? KeyRangeRef(sel.getKey(), range.end) : KeyRangeRef(range.begin, keyAfter(sel.getKey())),
-	              (distance + skipEqualKey) * sign, &maxBytes, span.context));
+	              (distance + skipEqualKey) * sign, &maxBytes, span.context, type));
 	state bool more = rep.more && rep.data.size() != distance + skipEqualKey;
 
 	//If we get only one result in the reverse direction as a result of the data being too large, we could get stuck in a loop
@@ -1589,7 +1709,7 @@ ACTOR Future<Key> findKey( StorageServer* data, KeySelectorRef sel, Version vers
 		TEST(true); //Reverse key selector returned only one result in range read
 		maxBytes = std::numeric_limits<int>::max();
 		GetKeyValuesReply rep2 =
-		    wait(readRange(data, version, KeyRangeRef(range.begin, keyAfter(sel.getKey())), -2, &maxBytes, span.context));
+		    wait(readRange(data, version, KeyRangeRef(range.begin, keyAfter(sel.getKey())), -2, &maxBytes, span.context, type));
 		rep = rep2;
 		more = rep.more && rep.data.size() != distance + skipEqualKey;
 		ASSERT(rep.data.size() == 2 || !more);
@@ -1650,6 +1770,7 @@ ACTOR Future<Void> getKeyValuesQ( StorageServer* data, GetKeyValuesRequest req )
 {
 	state Span span("SS:getKeyValues"_loc, { req.spanContext });
 	state int64_t resultSize = 0;
+	state IKeyValueStore::ReadType type = req.isFetchKeys ? IKeyValueStore::ReadType::FETCH : IKeyValueStore::ReadType::NORMAL;
 
 	++data->counters.getRangeQueries;
 	++data->counters.allQueries;
@@ -1687,10 +1808,10 @@ ACTOR Future<Void> getKeyValuesQ( StorageServer* data, GetKeyValuesRequest req )
 		state int offset2;
 		state Future<Key> fBegin = req.begin.isFirstGreaterOrEqual()
 		                               ? Future<Key>(req.begin.getKey())
-		                               : findKey(data, req.begin, version, shard, &offset1, span.context);
+		                               : findKey(data, req.begin, version, shard, &offset1, span.context, type);
 		state Future<Key> fEnd = req.end.isFirstGreaterOrEqual()
 		                             ? Future<Key>(req.end.getKey())
-		                             : findKey(data, req.end, version, shard, &offset2, span.context);
+		                             : findKey(data, req.end, version, shard, &offset2, span.context, type);
 		state Key begin = wait(fBegin);
 		state Key end = wait(fEnd);
 		if( req.debugID.present() )
@@ -1724,7 +1845,7 @@ ACTOR Future<Void> getKeyValuesQ( StorageServer* data, GetKeyValuesRequest req )
 		} else {
 			state int remainingLimitBytes = req.limitBytes;
 
-			GetKeyValuesReply _r = wait( readRange(data, version, KeyRangeRef(begin, end), req.limit, &remainingLimitBytes, span.context) );
+			GetKeyValuesReply _r = wait( readRange(data, version, KeyRangeRef(begin, end), req.limit, &remainingLimitBytes, span.context, type) );
 			GetKeyValuesReply r = _r;
 
 			if( req.debugID.present() )
@@ -1788,6 +1909,359 @@ ACTOR Future<Void> getKeyValuesQ( StorageServer* data, GetKeyValuesRequest req )
 	return Void();
 }
 
+// Returns the key which mapper maps kv to.  Each string element of mapper of the form "{K[n]}" or "{V[n]}" is replaced
+// by the n-th element of kv.key or kv.value unpacked as a Tuple, and every other element is copied unchanged.
+Key constructMappedKey( KeyValueRef kv, Tuple const& mapper ) {
+	Optional<Tuple> keyTuple, valueTuple;
+	Tuple mappedKey;
+	for (size_t i = 0; i < mapper.size(); i++) {
+		Tuple::ElementType type = mapper.getType(i);
+		if (type == Tuple::BYTES || type == Tuple::UTF8) {
+			Standalone<StringRef> element = mapper.getString(i);
+			bool fromKey = element.startsWith(LiteralStringRef("{K["));
+			bool fromValue = element.startsWith(LiteralStringRef("{V["));
+			if ((fromKey || fromValue) && element.endsWith(LiteralStringRef("]}"))) {
+				StringRef digits = element.substr(3, element.size() - 5);
+				if (digits.size() == 0 || digits.size() > 9) throw mapper_bad_index();
+				size_t index = 0;
+				for (uint8_t c : digits) {
+					if (c < '0' || c > '9') throw mapper_bad_index();
+					index = index * 10 + (c - '0');
+				}
+
+				if (fromKey && !keyTuple.present()) keyTuple = Tuple::unpack(kv.key);
+				if (fromValue && !valueTuple.present()) valueTuple = Tuple::unpack(kv.value);
+				const Tuple& source = fromKey ? keyTuple.get() : valueTuple.get();
+				if (index >= source.size()) throw mapper_bad_index();
+				mappedKey.append(source.subTuple(index, index + 1));
+				continue;
+			}
+		}
+		mappedKey.append(mapper.subTuple(i, i + 1));
+	}
+	return mappedKey.getDataAsStandalone();
+}
+
+TEST_CASE("/fdbserver/storageserver/constructMappedKey") {
+	Key key = Tuple().append(LiteralStringRef("index")).append(LiteralStringRef("blue")).append(LiteralStringRef("pk1")).getDataAsStandalone();
+	Value value = Tuple().append((int64_t)42).getDataAsStandalone();
+	KeyValueRef kv(key, value);
+
+	{
+		Tuple mapper = Tuple().append(LiteralStringRef("records")).append(LiteralStringRef("{K[2]}")).append(LiteralStringRef("{V[0]}")).append(LiteralStringRef("{K}"));
+		Key expected = Tuple().append(LiteralStringRef("records")).append(LiteralStringRef("pk1")).append((int64_t)42).append(LiteralStringRef("{K}")).getDataAsStandalone();
+		ASSERT(constructMappedKey(kv, mapper) == expected);
+	}
+
+	for (StringRef bad : { LiteralStringRef("{K[3]}"), LiteralStringRef("{V[1]}"), LiteralStringRef("{K[]}"), LiteralStringRef("{K[x]}") }) {
+		Tuple mapper = Tuple().append(LiteralStringRef("records")).append(bad);
+		try {
+			constructMappedKey(kv, mapper);
+			ASSERT(false);
+		} catch (Error& e) {
+			ASSERT(e.code() == error_code_mapper_bad_index);
+		}
+	}
+
+	return Void();
+}
+
+ACTOR Future<Void> getMappedKeyValuesQ( StorageServer* data, GetMappedKeyValuesRequest req )
+// Reads the key-value pairs in req.keys as getKeyValuesQ does, and then the value of the mapped key of each of them which
+// is readable on this server, so that an index and the records it refers to can be read in one round trip.  Mapped keys
+// in shards this server does not have are returned with mappedLocal false, for the client to read.
+{
+	state Span span("SS:getMappedKeyValues"_loc, { req.spanContext });
+	state int64_t resultSize = 0;
+
+	++data->counters.getMappedRangeQueries;
+	++data->counters.allQueries;
+	++data->readQueueSizeMetric;
+	data->maxQueryQueue = std::max<int>( data->maxQueryQueue, data->counters.allQueries.getValue() - data->counters.finishedQueries.getValue());
+
+	// Active load balancing runs at a very high priority (to obtain accurate queue lengths)
+	// so we need to downgrade here
+	wait( data->getQueryDelay() );
+
+	try {
+		if( req.debugID.present() )
+			g_traceBatch.addEvent("TransactionDebug", req.debugID.get().first(), "storageserver.getMappedKeyValues.Before");
+		state Version version = wait( waitForVersion( data, req.version, span.context ) );
+
+		state uint64_t changeCounter = data->shardChangeCounter;
+		state KeyRange shard = getShardKeyRange( data, firstGreaterOrEqual(req.keys.begin) );
+		if ( !shard.contains(req.keys) ) {
+			throw wrong_shard_server();
+		}
+
+		state Tuple mapper = Tuple::unpack(req.mapper);
+		state int remainingLimitBytes = req.limitBytes;
+		GetKeyValuesReply _r = wait( readRange(data, version, req.keys, req.limit, &remainingLimitBytes, span.context) );
+		state GetKeyValuesReply r = _r;
+		data->checkChangeCounter( changeCounter, req.keys );
+
+		if( req.debugID.present() )
+			g_traceBatch.addEvent("TransactionDebug", req.debugID.get().first(), "storageserver.getMappedKeyValues.AfterReadRange");
+
+		state GetMappedKeyValuesReply reply;
+		// Rows that are not read from storage get a ready future, as waitForAll() needs every one to be valid
+		state std::vector<Future<Optional<Value>>> reads(r.data.size(), Future<Optional<Value>>(Optional<Value>()));
+		state bool readStorage = false;
+
+		reply.arena.dependsOn(r.arena);
+		reply.data.resize(reply.arena, r.data.size());
+		for (int i = 0; i < r.data.size(); i++) {
+			MappedKeyValueRef& m = reply.data[i];
+			m.kv = r.data[i];
+			m.mappedKey = KeyRef(reply.arena, constructMappedKey(r.data[i], mapper));
+			m.mappedLocal = data->shards[m.mappedKey]->isReadable();
+			if (!m.mappedLocal) {
+				continue;
+			}
+
+			auto v = data->data().at(version).lastLessOrEqual(m.mappedKey);
+			if (v && v->isValue() && v.key() == m.mappedKey) {
+				m.mappedValue = ValueRef(reply.arena, v->getValue());
+			} else if (!v || !v->isClearTo() || v->getEndKey() <= m.mappedKey) {
+				reads[i] = data->storage.readValue( m.mappedKey, IKeyValueStore::ReadType::NORMAL, req.debugID );
+				readStorage = true;
+			}
+		}
+
+		if (readStorage) {
+			wait( waitForAll(reads) );
+			// Validate that while we were reading the data we didn't lose the version or shard
+			if (version < data->storageVersion()) {
+				TEST(true); // transaction_too_old after readValue in getMappedKeyValuesQ
+				throw transaction_too_old();
+			}
+		}
+
+		// The mapped keys and values count against the byte limit along with the index rows, so the reply stops after
+		// the row which reaches it even though readRange only charged for the index rows
+		int64_t totalByteSize = 0;
+		int64_t chargedBytes = 0;
+		int rows = 0;
+		while (rows < reply.data.size()) {
+			MappedKeyValueRef& m = reply.data[rows];
+			totalByteSize += m.kv.expectedSize();
+			if (m.mappedLocal) {
+				data->checkChangeCounter(changeCounter, m.mappedKey);
+				if (reads[rows].get().present()) {
+					m.mappedValue = ValueRef(reply.arena, reads[rows].get().get());
+				}
+
+				if (SERVER_KNOBS->READ_SAMPLING_ENABLED) {
+					// If the read yields no value, randomly sample the empty read.
+					int64_t bytesReadPerKSecond =
+					    m.mappedValue.present() ? std::max((int64_t)(m.mappedKey.size() + m.mappedValue.get().size()), SERVER_KNOBS->EMPTY_READ_PENALTY)
+					                            : SERVER_KNOBS->EMPTY_READ_PENALTY;
+					data->metrics.notifyBytesReadPerKSecond(m.mappedKey, bytesReadPerKSecond);
+				}
+				resultSize += m.mappedValue.present() ? m.mappedValue.get().size() : 0;
+			}
+
+			++rows;
+			chargedBytes += sizeof(KeyValueRef) + m.expectedSize();
+			if (chargedBytes >= req.limitBytes) {
+				break;
+			}
+		}
+		bool truncated = rows < reply.data.size();
+		if (truncated) {
+			TEST(true); // Mapped values reached the byte limit of a mapped range read
+			reply.data.resize(reply.arena, rows);
+		}
+
+		// As in getKeyValuesQ, the cost of the range read is billed to the start key and end key of the range.
+		if (totalByteSize > 0 && SERVER_KNOBS->READ_SAMPLING_ENABLED) {
+			int64_t bytesReadPerKSecond = std::max(totalByteSize, SERVER_KNOBS->EMPTY_READ_PENALTY) / 2;
+			data->metrics.notifyBytesReadPerKSecond(r.data[0].key, bytesReadPerKSecond);
+			data->metrics.notifyBytesReadPerKSecond(r.data[r.data.size() - 1].key, bytesReadPerKSecond);
+		}
+
+		if( req.debugID.present() )
+			g_traceBatch.addEvent("TransactionDebug", req.debugID.get().first(), "storageserver.getMappedKeyValues.Send");
+
+		reply.version = r.version;
+		reply.more = r.more || truncated;
+		reply.cached = r.cached;
+		reply.penalty = data->getPenalty();
+		req.reply.send( reply );
+
+		resultSize += req.limitBytes - remainingLimitBytes;
+		data->counters.bytesQueried += resultSize;
+		data->counters.rowsQueried += reply.data.size();
+		if(reply.data.size() == 0) {
+			++data->counters.emptyQueries;
+		}
+	} catch (Error& e) {
+		if(!canReplyWith(e))
+			throw;
+		data->sendErrorWithPenalty(req.reply, e, data->getPenalty());
+	}
+
+	data->transactionTagCounter.addRequest(req.tags, resultSize);
+	++data->counters.finishedQueries;
+	--data->readQueueSizeMetric;
+
+	double duration = g_network->timer() - req.requestTime();
+	data->counters.readLatencySample.addMeasurement(duration);
+	if(data->latencyBandConfig.present()) {
+		int maxReadBytes = data->latencyBandConfig.get().readConfig.maxReadBytes.orDefault(std::numeric_limits<int>::max());
+		data->counters.readLatencyBands.addMeasurement(duration, resultSize > maxReadBytes);
+	}
+
+	return Void();
+}
+
+ACTOR Future<Void> getKeyValuesStreamQ( StorageServer* data, GetKeyValuesStreamRequest req )
+// Throws a wrong_shard_server if the keys in the request or result depend on data outside this server OR if a large selector offset prevents
+// all data from being read in one range read
+// Unlike getKeyValuesQ, the result is sent back as a series of fragments of at most RANGESTREAM_LIMIT_BYTES each, and the
+// stream is ended with end_of_stream once the limits are reached or the range is exhausted
+{
+	state Span span("SS:getKeyValuesStream"_loc, { req.spanContext });
+	state int64_t resultSize = 0;
+	state IKeyValueStore::ReadType type = req.isFetchKeys ? IKeyValueStore::ReadType::FETCH : IKeyValueStore::ReadType::NORMAL;
+	state double startTime = g_network->timer();
+
+	req.reply.setByteLimit(SERVER_KNOBS->RANGESTREAM_LIMIT_BYTES * SERVER_KNOBS->RANGESTREAM_BUFFERED_FRAGMENTS_LIMIT);
+	++data->counters.getRangeStreamQueries;
+	++data->counters.allQueries;
+	++data->readQueueSizeMetric;
+	data->maxQueryQueue = std::max<int>( data->maxQueryQueue, data->counters.allQueries.getValue() - data->counters.finishedQueries.getValue());
+
+	// Active load balancing runs at a very high priority (to obtain accurate queue lengths)
+	// so we need to downgrade here
+	if (SERVER_KNOBS->FETCH_KEYS_LOWER_PRIORITY && req.isFetchKeys) {
+		wait( delay(0, TaskPriority::FetchKeys) );
+	} else {
+		wait( delay(0, TaskPriority::DefaultEndpoint) );
+	}
+
+	try {
+		if( req.debugID.present() )
+			g_traceBatch.addEvent("TransactionDebug", req.debugID.get().first(), "storageserver.getKeyValuesStream.Before");
+		state Version version = wait( waitForVersion( data, req.version, span.context ) );
+
+		state uint64_t changeCounter = data->shardChangeCounter;
+		state KeyRange shard = getShardKeyRange( data, req.begin );
+
+		if( req.debugID.present() )
+			g_traceBatch.addEvent("TransactionDebug", req.debugID.get().first(), "storageserver.getKeyValuesStream.AfterVersion");
+
+		if ( !selectorInRange(req.end, shard) && !(req.end.isFirstGreaterOrEqual() && req.end.getKey() == shard.end) ) {
+			throw wrong_shard_server();
+		}
+
+		state int offset1;
+		state int offset2;
+		state Future<Key> fBegin = req.begin.isFirstGreaterOrEqual()
+		                               ? Future<Key>(req.begin.getKey())
+		                               : findKey(data, req.begin, version, shard, &offset1, span.context, type);
+		state Future<Key> fEnd = req.end.isFirstGreaterOrEqual()
+		                             ? Future<Key>(req.end.getKey())
+		                             : findKey(data, req.end, version, shard, &offset2, span.context, type);
+		state Key begin = wait(fBegin);
+		state Key end = wait(fEnd);
+		if( req.debugID.present() )
+			g_traceBatch.addEvent("TransactionDebug", req.debugID.get().first(), "storageserver.getKeyValuesStream.AfterKeys");
+
+		// See getKeyValuesQ for why offsets of zero and one are acceptable
+		if ((offset1 && offset1!=1) || (offset2 && offset2!=1)) {
+			TEST(true);  // wrong_shard_server due to offset in rangeStream
+			throw wrong_shard_server();
+		}
+
+		if (begin >= end) {
+			if( req.debugID.present() )
+				g_traceBatch.addEvent("TransactionDebug", req.debugID.get().first(), "storageserver.getKeyValuesStream.Send");
+
+			GetKeyValuesStreamReply none;
+			none.version = version;
+			none.more = false;
+
+			data->checkChangeCounter( changeCounter, KeyRangeRef( std::min<KeyRef>(req.begin.getKey(), req.end.getKey()), std::max<KeyRef>(req.begin.getKey(), req.end.getKey()) ) );
+			req.reply.send( none );
+			req.reply.sendError( end_of_stream() );
+		} else {
+			loop {
+				wait( req.reply.onReady() );
+				state int byteLimit = std::min(req.limitBytes, SERVER_KNOBS->RANGESTREAM_LIMIT_BYTES);
+				state int remainingLimitBytes = byteLimit;
+
+				GetKeyValuesReply _r = wait( readRange(data, version, KeyRangeRef(begin, end), req.limit, &remainingLimitBytes, span.context, type) );
+				state GetKeyValuesStreamReply r = _r;
+
+				if( req.debugID.present() )
+					g_traceBatch.addEvent("TransactionDebug", req.debugID.get().first(), "storageserver.getKeyValuesStream.AfterReadRange");
+				data->checkChangeCounter( changeCounter, KeyRangeRef( std::min<KeyRef>(begin, std::min<KeyRef>(req.begin.getKey(), req.end.getKey())), std::max<KeyRef>(end, std::max<KeyRef>(req.begin.getKey(), req.end.getKey())) ) );
+				if (EXPENSIVE_VALIDATION) {
+					for (int i = 0; i < r.data.size(); i++)
+						ASSERT(r.data[i].key >= begin && r.data[i].key < end);
+					ASSERT(r.data.size() <= std::abs(req.limit));
+				}
+
+				// For performance concerns, the cost of a range read is billed to the start key and end key of the range.
+				int64_t totalByteSize = 0;
+				for (int i = 0; i < r.data.size(); i++) {
+					totalByteSize += r.data[i].expectedSize();
+				}
+				if (totalByteSize > 0 && SERVER_KNOBS->READ_SAMPLING_ENABLED) {
+					int64_t bytesReadPerKSecond = std::max(totalByteSize, SERVER_KNOBS->EMPTY_READ_PENALTY) / 2;
+					data->metrics.notifyBytesReadPerKSecond(r.data[0].key, bytesReadPerKSecond);
+					data->metrics.notifyBytesReadPerKSecond(r.data[r.data.size() - 1].key, bytesReadPerKSecond);
+				}
+
+				int fragmentSize = byteLimit - remainingLimitBytes;
+				resultSize += fragmentSize;
+				req.limitBytes -= fragmentSize;
+				data->counters.bytesQueried += fragmentSize;
+				data->counters.rowsQueried += r.data.size();
+				if(r.data.size() == 0) {
+					++data->counters.emptyQueries;
+				}
+
+				if (r.data.size()) {
+					if (req.limit >= 0) {
+						begin = keyAfter(r.data.back().key);
+						req.limit -= r.data.size();
+					} else {
+						end = r.data.back().key;
+						req.limit += r.data.size();
+					}
+				}
+
+				bool finished = !r.more || req.limit == 0 || req.limitBytes <= 0;
+				req.reply.send( r );
+
+				if (finished) {
+					req.reply.sendError( end_of_stream() );
+					break;
+				}
+			}
+		}
+	} catch (Error& e) {
+		if (e.code() == error_code_operation_obsolete) {
+			// The client has gone away or closed the stream, so there is no one to reply to
+		} else {
+			if(!canReplyWith(e))
+				throw;
+			data->sendErrorWithPenalty(req.reply, e, data->getPenalty());
+		}
+	}
+
+	data->transactionTagCounter.addRequest(req.tags, resultSize);
+	++data->counters.finishedQueries;
+	--data->readQueueSizeMetric;
+
+	double duration = g_network->timer() - startTime;
+	data->counters.readLatencySample.addMeasurement(duration);
+
+	return Void();
+}
+
 ACTOR Future<Void> getKeyQ( StorageServer* data, GetKeyRequest req ) {
 	state Span span("SS:getKey"_loc, { req.spanContext });
 	state int64_t resultSize = 0;
@@ -1897,13 +2371,13 @@ ACTOR Future<Void> doEagerReads( StorageServer* data, UpdateEagerReadInfo* eager
 
 	vector<Future<Key>> keyEnd( eager->keyBegin.size() );
 	for(int i=0; i<keyEnd.size(); i++)
-		keyEnd[i] = data->storage.readNextKeyInclusive( eager->keyBegin[i] );
+		keyEnd[i] = data->storage.readNextKeyInclusive( eager->keyBegin[i], IKeyValueStore::ReadType::EAGER );
 
 	state Future<vector<Key>> futureKeyEnds = getAll(keyEnd);
 
 	vector<Future<Optional<Value>>> value( eager->keys.size() );
 	for(int i=0; i<value.size(); i++)
-		value[i] = data->storage.readValuePrefix( eager->keys[i].first, eager->keys[i].second );
+		value[i] = data->storage.readValuePrefix( eager->keys[i].first, eager->keys[i].second, IKeyValueStore::ReadType::EAGER );
 
 	state Future<vector<Optional<Value>>> futureValues = getAll(value);
 	state vector<Key> keyEndVal = wait( futureKeyEnds );
@@ -3306,6 +3780,7 @@ ACTOR Future<Void> updateStorage(StorageServer* data) {
 		if (startOldestVersion != newOldestVersion) data->storage.makeVersionDurable(newOldestVersion);
 
 		debug_advanceMaxCommittedVersion(data->thisServerID, newOldestVersion);
+		data->storage.setDurabilityLag(data->version.get() - data->durableVersion.get());
 		state Future<Void> durable = data->storage.commit();
 		state Future<Void> durableDelay = Void();
 
@@ -3959,6 +4434,17 @@ ACTOR Future<Void> serveGetValueRequests( StorageServer* self, FutureStream<GetV
 	}
 }
 
+ACTOR Future<Void> serveGetValuesRequests( StorageServer* self, FutureStream<GetValuesRequest> getValues ) {
+	loop {
+		GetValuesRequest req = waitNext(getValues);
+		// Warning: This code is executed at extremely high priority (TaskPriority::LoadBalancedEndpoint), so downgrade before doing real work
+		if( req.debugID.present() )
+			g_traceBatch.addEvent("GetValueDebug", req.debugID.get().first(), "storageServer.received");
+
+		self->actors.add(self->readGuard(req, getValuesQ));
+	}
+}
+
 ACTOR Future<Void> serveGetKeyValuesRequests( StorageServer* self, FutureStream<GetKeyValuesRequest> getKeyValues ) {
 	loop {
 		GetKeyValuesRequest req = waitNext(getKeyValues);
@@ -3967,6 +4453,22 @@ ACTOR Future<Void> serveGetKeyValuesRequests( StorageServer* self, FutureStream<
 	}
 }
 
+ACTOR Future<Void> serveGetKeyValuesStreamRequests( StorageServer* self, FutureStream<GetKeyValuesStreamRequest> getKeyValuesStream ) {
+	loop {
+		GetKeyValuesStreamRequest req = waitNext(getKeyValuesStream);
+		// Warning: This code is executed at extremely high priority (TaskPriority::LoadBalancedEndpoint), so downgrade before doing real work
+		self->actors.add(self->readGuard(req, getKeyValuesStreamQ));
+	}
+}
+
+ACTOR Future<Void> serveGetMappedKeyValuesRequests( StorageServer* self, FutureStream<GetMappedKeyValuesRequest> getMappedKeyValues ) {
+	loop {
+		GetMappedKeyValuesRequest req = waitNext(getMappedKeyValues);
+		// Warning: This code is executed at extremely high priority (TaskPriority::LoadBalancedEndpoint), so downgrade before doing real work
+		self->actors.add(self->readGuard(req, getMappedKeyValuesQ));
+	}
+}
+
 ACTOR Future<Void> serveGetKeyRequests( StorageServer* self, FutureStream<GetKeyRequest> getKey ) {
 	loop {
 		GetKeyRequest req = waitNext(getKey);
@@ -4116,7 +4618,10 @@ ACTOR Future<Void> storageServerCore( StorageServer* self, StorageServerInterfac
 	self->actors.add(logLongByteSampleRecovery(self->byteSampleRecovery));
 	self->actors.add(checkBehind(self));
 	self->actors.add(serveGetValueRequests(self, ssi.getValue.getFuture()));
+	self->actors.add(serveGetValuesRequests(self, ssi.getValues.getFuture()));
 	self->actors.add(serveGetKeyValuesRequests(self, ssi.getKeyValues.getFuture()));
+	self->actors.add(serveGetKeyValuesStreamRequests(self, ssi.getKeyValuesStream.getFuture()));
+	self->actors.add(serveGetMappedKeyValuesRequests(self, ssi.getMappedKeyValues.getFuture()));
 	self->actors.add(serveGetKeyRequests(self, ssi.getKey.getFuture()));
 	self->actors.add(serveWatchValueRequests(self, ssi.watchValue.getFuture()));
 	self->actors.add(traceRole(Role::STORAGE_SERVER, ssi.id()));
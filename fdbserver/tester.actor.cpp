@@ -914,6 +914,9 @@ std::map<std::string, std::function<void(const std::string&)>> testSpecGlobalKey
 		}},
 	{"startIncompatibleProcess", [](const std::string& value) {
 			TraceEvent("TestParserTest").detail("ParsedStartIncompatibleProcess", value);
+		}},
+	{"disableNewDiskFormats", [](const std::string& value) {
+			TraceEvent("TestParserTest").detail("ParsedDisableNewDiskFormats", value);
 		}}
 };
 
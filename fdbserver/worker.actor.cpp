@@ -710,6 +710,9 @@ ACTOR Future<Void> storageServerRollbackRebooter( Future<Void> prevStorageServer
 		DUMPTOKEN(recruited.splitMetrics);
 		DUMPTOKEN(recruited.getReadHotRanges);
 		DUMPTOKEN(recruited.getRangeSplitPoints);
+		DUMPTOKEN(recruited.getKeyValuesStream);
+		DUMPTOKEN(recruited.getValues);
+		DUMPTOKEN(recruited.getMappedKeyValues);
 		DUMPTOKEN(recruited.getStorageMetrics);
 		DUMPTOKEN(recruited.waitFailure);
 		DUMPTOKEN(recruited.getQueuingMetrics);
@@ -1042,6 +1045,9 @@ ACTOR Future<Void> workerServer(
 				DUMPTOKEN(recruited.splitMetrics);
 				DUMPTOKEN(recruited.getReadHotRanges);
 				DUMPTOKEN(recruited.getRangeSplitPoints);
+				DUMPTOKEN(recruited.getKeyValuesStream);
+				DUMPTOKEN(recruited.getValues);
+				DUMPTOKEN(recruited.getMappedKeyValues);
 				DUMPTOKEN(recruited.getStorageMetrics);
 				DUMPTOKEN(recruited.waitFailure);
 				DUMPTOKEN(recruited.getQueuingMetrics);
@@ -1354,6 +1360,9 @@ ACTOR Future<Void> workerServer(
 					DUMPTOKEN(recruited.splitMetrics);
 					DUMPTOKEN(recruited.getReadHotRanges);
 					DUMPTOKEN(recruited.getRangeSplitPoints);
+					DUMPTOKEN(recruited.getKeyValuesStream);
+					DUMPTOKEN(recruited.getValues);
+					DUMPTOKEN(recruited.getMappedKeyValues);
 					DUMPTOKEN(recruited.getStorageMetrics);
 					DUMPTOKEN(recruited.waitFailure);
 					DUMPTOKEN(recruited.getQueuingMetrics);
@@ -0,0 +1,126 @@
+/*
+ * DiskQueuePerf.actor.cpp
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2020 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fdbrpc/ContinuousSample.h"
+#include "fdbserver/IDiskQueue.h"
+#include "fdbserver/workloads/workloads.actor.h"
+#include "flow/actorcompiler.h"  // This must be the last #include.
+
+// Measures DiskQueue commit latency and throughput with a number of concurrent committers, the way a TLog pushes
+// and commits each version batch.  Run it with --knob_disk_queue_group_commit=0 and =1 to compare.
+struct DiskQueuePerfWorkload : TestWorkload {
+	bool enabled;
+	double testDuration;
+	int committers, bytesPerCommit;
+	std::string filename;
+	PerfIntCounter commits, bytesCommitted;
+	ContinuousSample<double> commitLatency;
+
+	IDiskQueue* queue;
+
+	DiskQueuePerfWorkload(WorkloadContext const& wcx)
+	  : TestWorkload(wcx), commits("Commits"), bytesCommitted("BytesCommitted"), commitLatency(10000),
+	    queue(nullptr) {
+		enabled = !clientId; // only do this on the "first" client
+		testDuration = getOption(options, LiteralStringRef("testDuration"), 10.0);
+		committers = getOption(options, LiteralStringRef("committers"), 8);
+		bytesPerCommit = getOption(options, LiteralStringRef("bytesPerCommit"), 10000);
+		filename = getOption(options, LiteralStringRef("filename"), Value()).toString();
+	}
+
+	std::string description() const override { return "DiskQueuePerf"; }
+	Future<Void> setup(Database const& cx) override { return Void(); }
+	Future<Void> start(Database const& cx) override {
+		if (enabled) return run(this);
+		return Void();
+	}
+	Future<bool> check(Database const& cx) override { return true; }
+
+	void getMetrics(vector<PerfMetric>& m) override {
+		m.push_back(commits.getMetric());
+		m.push_back(bytesCommitted.getMetric());
+		m.push_back(PerfMetric("Commits/sec", commits.getValue() / testDuration, false));
+		m.push_back(PerfMetric("MB/sec", bytesCommitted.getValue() / testDuration / 1e6, false));
+		m.push_back(PerfMetric("Mean Commit Latency (ms)", 1000.0 * commitLatency.mean(), true));
+		m.push_back(PerfMetric("Median Commit Latency (ms)", 1000.0 * commitLatency.median(), true));
+		m.push_back(PerfMetric("99% Commit Latency (ms)", 1000.0 * commitLatency.percentile(0.99), true));
+		m.push_back(PerfMetric("Max Commit Latency (ms)", 1000.0 * commitLatency.max(), true));
+	}
+
+	ACTOR static Future<Void> committer(DiskQueuePerfWorkload* self, Standalone<StringRef> payload, double stopAt) {
+		while (now() < stopAt) {
+			state IDiskQueue::location pushed = self->queue->push(payload);
+			state double begin = timer();
+			wait(self->queue->commit());
+			self->commitLatency.addSample(timer() - begin);
+			++self->commits;
+			self->bytesCommitted += payload.size();
+			// Everything up to our push is durable, so it can be popped to keep the files from growing
+			self->queue->pop(pushed);
+		}
+		return Void();
+	}
+
+	ACTOR static Future<Void> run(DiskQueuePerfWorkload* self) {
+		state UID id = deterministicRandom()->randomUniqueID();
+		state std::string fn = self->filename.size() ? self->filename : id.toString();
+		self->queue = openDiskQueue(fn, "fdq", id, DiskQueueVersion::V1);
+
+		state Error err;
+		try {
+			bool recovered = wait(self->queue->initializeRecovery(0));
+			while (!recovered) {
+				Standalone<StringRef> data = wait(self->queue->readNext(1 << 20));
+				recovered = data.size() < (1 << 20);
+			}
+
+			state Standalone<StringRef> payload = makeString(self->bytesPerCommit);
+			memset(mutateString(payload), '.', payload.size());
+
+			state double stopAt = now() + self->testDuration;
+			state vector<Future<Void>> actors;
+			for (int i = 0; i < self->committers; i++) actors.push_back(committer(self, payload, stopAt));
+			choose {
+				when(wait(waitForAll(actors))) {}
+				when(wait(self->queue->getError())) { ASSERT(false); }
+			}
+		} catch (Error& e) {
+			err = e;
+		}
+
+		TraceEvent("DiskQueuePerfDone", id)
+		    .detail("Commits", self->commits.getValue())
+		    .detail("Bytes", self->bytesCommitted.getValue())
+		    .detail("MedianLatency", self->commitLatency.median());
+
+		Future<Void> closed = self->queue->onClosed();
+		if (self->filename.size())
+			self->queue->close();
+		else
+			self->queue->dispose();
+		self->queue = nullptr;
+		wait(closed);
+
+		if (err.code() != invalid_error_code) throw err;
+		return Void();
+	}
+};
+
+WorkloadFactory<DiskQueuePerfWorkload> DiskQueuePerfWorkloadFactory("DiskQueuePerf");
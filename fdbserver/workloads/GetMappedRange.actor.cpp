@@ -0,0 +1,207 @@
+/*
+ * GetMappedRange.actor.cpp
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2020 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fdbclient/NativeAPI.actor.h"
+#include "fdbclient/Tuple.h"
+#include "fdbserver/workloads/workloads.actor.h"
+#include "flow/actorcompiler.h" // This must be the last #include.
+
+// Checks Transaction::getMappedRange against the index range and record values read with getRange and get at the same
+// read version.  The index maps a color and a primary key to nothing, and the mapper turns each index key into the key
+// of its record, some of which do not exist.  Records are kept apart from the index, and shard moves in the test spec
+// often put them on other storage servers than the index.  Records are also rewritten and cleared while the reads run,
+// so that a reply mixes records read from storage, records still in the storage server's memory and records that live
+// elsewhere.
+struct GetMappedRangeWorkload : TestWorkload {
+	int recordCount, colors, maxValueBytes;
+	double testDuration, missingRecordProbability, updateInterval;
+	PerfIntCounter comparisons, rowsCompared, updates;
+	bool success;
+
+	GetMappedRangeWorkload(WorkloadContext const& wcx)
+	  : TestWorkload(wcx), comparisons("Comparisons"), rowsCompared("RowsCompared"), updates("Updates"),
+	    success(true) {
+		testDuration = getOption(options, LiteralStringRef("testDuration"), 30.0);
+		recordCount = getOption(options, LiteralStringRef("recordCount"), 1000);
+		colors = getOption(options, LiteralStringRef("colors"), 5);
+		maxValueBytes = getOption(options, LiteralStringRef("maxValueBytes"), 5000);
+		missingRecordProbability = getOption(options, LiteralStringRef("missingRecordProbability"), 0.1);
+		updateInterval = getOption(options, LiteralStringRef("updateInterval"), 0.1);
+	}
+
+	std::string description() const override { return "GetMappedRange"; }
+
+	Future<Void> setup(Database const& cx) override {
+		if (clientId) {
+			return Void();
+		}
+		return _setup(cx, this);
+	}
+
+	Future<Void> start(Database const& cx) override { return timeout(_start(cx, this), testDuration, Void()); }
+
+	Future<bool> check(Database const& cx) override { return success; }
+
+	void getMetrics(vector<PerfMetric>& m) override {
+		m.push_back(comparisons.getMetric());
+		m.push_back(rowsCompared.getMetric());
+		m.push_back(updates.getMetric());
+	}
+
+	static std::string primaryKey(int n) { return format("%08d", n); }
+
+	static Key recordKey(std::string const& pk) {
+		return Tuple().append(LiteralStringRef("GetMappedRange")).append(LiteralStringRef("record")).append(pk).getDataAsStandalone();
+	}
+
+	static Key indexKey(int64_t color, std::string const& pk) {
+		return Tuple().append(LiteralStringRef("GetMappedRange")).append(LiteralStringRef("index")).append(color).append(pk).getDataAsStandalone();
+	}
+
+	static KeyRange indexRange(int64_t color) {
+		Key prefix = Tuple().append(LiteralStringRef("GetMappedRange")).append(LiteralStringRef("index")).append(color).getDataAsStandalone();
+		return KeyRangeRef(prefix, strinc(prefix));
+	}
+
+	static Key mapper() {
+		return Tuple().append(LiteralStringRef("GetMappedRange")).append(LiteralStringRef("record")).append(LiteralStringRef("{K[3]}")).getDataAsStandalone();
+	}
+
+	ACTOR static Future<Void> _setup(Database cx, GetMappedRangeWorkload* self) {
+		state int i = 0;
+		while (i < self->recordCount) {
+			state Transaction tr(cx);
+			state int batchEnd = std::min(self->recordCount, i + 100);
+			loop {
+				try {
+					for (int j = i; j < batchEnd; j++) {
+						std::string pk = primaryKey(j);
+						tr.set(indexKey(j % self->colors, pk), Value());
+						if (deterministicRandom()->random01() >= self->missingRecordProbability) {
+							tr.set(recordKey(pk),
+							       Value(std::string(deterministicRandom()->randomInt(0, self->maxValueBytes + 1), 'r')));
+						}
+					}
+					wait(tr.commit());
+					break;
+				} catch (Error& e) {
+					wait(tr.onError(e));
+				}
+			}
+			i = batchEnd;
+		}
+		return Void();
+	}
+
+	ACTOR static Future<Void> compareOnce(Database cx, GetMappedRangeWorkload* self) {
+		state Transaction tr(cx);
+		loop {
+			state KeyRange range = indexRange(deterministicRandom()->randomInt(0, self->colors));
+			state bool reverse = deterministicRandom()->coinflip();
+			state GetRangeLimits limits;
+			if (deterministicRandom()->coinflip()) {
+				limits.rows = deterministicRandom()->randomInt(1, self->recordCount / self->colors + 2);
+			}
+			state bool byteLimited = deterministicRandom()->coinflip();
+			if (byteLimited) {
+				limits.bytes = deterministicRandom()->randomInt(1, self->recordCount * self->maxValueBytes / self->colors / 4 + 2);
+			}
+
+			try {
+				state Standalone<MappedRangeResultRef> mapped = wait(tr.getMappedRange(range, mapper(), limits, false, reverse));
+				state Standalone<RangeResultRef> index =
+				    wait(tr.getRange(range, GetRangeLimits(GetRangeLimits::ROW_LIMIT_UNLIMITED), false, reverse));
+
+				state std::vector<Future<Optional<Value>>> records;
+				for (const auto& m : mapped) {
+					records.push_back(tr.get(m.mappedKey));
+				}
+				wait(waitForAll(records));
+
+				// Without a byte limit the row limit alone decides how many index rows are returned.  A byte limit,
+				// which also counts the mapped values, may stop the read earlier but never before it is reached.
+				int expectedRows = limits.hasRowLimit() ? std::min(limits.rows, index.size()) : index.size();
+				bool ok = byteLimited ? mapped.size() <= expectedRows : mapped.size() == expectedRows;
+				for (int i = 0; ok && i < mapped.size(); i++) {
+					const MappedKeyValueRef& m = mapped[i];
+					const Optional<Value>& record = records[i].get();
+					ok = m.kv == index[i] && m.mappedKey == recordKey(Tuple::unpack(m.kv.key).getString(3).toString()) &&
+					     m.mappedValue.present() == record.present() &&
+					     (!record.present() || m.mappedValue.get() == record.get());
+				}
+				if (ok && byteLimited && mapped.size() < expectedRows) {
+					GetRangeLimits remaining = limits;
+					for (const auto& m : mapped) {
+						remaining.decrement(m);
+					}
+					ok = remaining.isReached();
+				}
+				if (!ok) {
+					TraceEvent(SevError, "GetMappedRangeMismatch")
+					    .detail("Begin", range.begin)
+					    .detail("End", range.end)
+					    .detail("Reverse", reverse)
+					    .detail("RowLimit", limits.rows)
+					    .detail("ByteLimit", limits.bytes)
+					    .detail("MappedRows", mapped.size())
+					    .detail("IndexRows", index.size());
+					self->success = false;
+				}
+				++self->comparisons;
+				self->rowsCompared += mapped.size();
+				return Void();
+			} catch (Error& e) {
+				wait(tr.onError(e));
+			}
+		}
+	}
+
+	// Rewrites or clears a few random records at a time
+	ACTOR static Future<Void> updater(Database cx, GetMappedRangeWorkload* self) {
+		loop {
+			state Transaction tr(cx);
+			loop {
+				try {
+					for (int j = 0; j < 10; j++) {
+						Key key = recordKey(primaryKey(deterministicRandom()->randomInt(0, self->recordCount)));
+						if (deterministicRandom()->random01() < self->missingRecordProbability) {
+							tr.clear(key);
+						} else {
+							tr.set(key, Value(std::string(deterministicRandom()->randomInt(0, self->maxValueBytes + 1), 'u')));
+						}
+					}
+					wait(tr.commit());
+					++self->updates;
+					break;
+				} catch (Error& e) {
+					wait(tr.onError(e));
+				}
+			}
+			wait(delay(self->updateInterval * deterministicRandom()->random01()));
+		}
+	}
+
+	ACTOR static Future<Void> _start(Database cx, GetMappedRangeWorkload* self) {
+		state Future<Void> updates = updater(cx, self);
+		loop { wait(compareOnce(cx, self)); }
+	}
+};
+
+WorkloadFactory<GetMappedRangeWorkload> GetMappedRangeWorkloadFactory("GetMappedRange");
@@ -0,0 +1,197 @@
+/*
+ * GetRangeStream.actor.cpp
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2020 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fdbclient/NativeAPI.actor.h"
+#include "fdbserver/workloads/workloads.actor.h"
+#include "flow/actorcompiler.h" // This must be the last #include.
+
+// Checks that Transaction::getRangeStream returns the same rows as Transaction::getRange at the same read version,
+// including when the reader consumes the stream slowly (so that the storage server has to wait for acknowledgements)
+// and when the reader gives up on the stream partway through.
+struct GetRangeStreamWorkload : TestWorkload {
+	int nodeCount, maxValueBytes;
+	double testDuration;
+	double slowReaderProbability, cancelProbability;
+	Key keyPrefix;
+	PerfIntCounter comparisons, cancelled, slowReads;
+	bool success;
+
+	GetRangeStreamWorkload(WorkloadContext const& wcx)
+	  : TestWorkload(wcx), comparisons("Comparisons"), cancelled("Cancelled"), slowReads("SlowReads"),
+	    success(true) {
+		testDuration = getOption(options, LiteralStringRef("testDuration"), 30.0);
+		nodeCount = getOption(options, LiteralStringRef("nodeCount"), 2000);
+		maxValueBytes = getOption(options, LiteralStringRef("maxValueBytes"), 2000);
+		slowReaderProbability = getOption(options, LiteralStringRef("slowReaderProbability"), 0.2);
+		cancelProbability = getOption(options, LiteralStringRef("cancelProbability"), 0.2);
+		keyPrefix = getOption(options, LiteralStringRef("keyPrefix"), LiteralStringRef("GetRangeStream/"));
+	}
+
+	std::string description() const override { return "GetRangeStream"; }
+
+	Future<Void> setup(Database const& cx) override {
+		if (clientId) {
+			return Void();
+		}
+		return _setup(cx, this);
+	}
+
+	Future<Void> start(Database const& cx) override { return timeout(_start(cx, this), testDuration, Void()); }
+
+	Future<bool> check(Database const& cx) override { return success; }
+
+	void getMetrics(vector<PerfMetric>& m) override {
+		m.push_back(comparisons.getMetric());
+		m.push_back(cancelled.getMetric());
+		m.push_back(slowReads.getMetric());
+	}
+
+	Key keyForIndex(int n) const { return keyPrefix.withSuffix(format("%08d", n)); }
+
+	ACTOR static Future<Void> _setup(Database cx, GetRangeStreamWorkload* self) {
+		state int i = 0;
+		while (i < self->nodeCount) {
+			state Transaction tr(cx);
+			state int batchEnd = std::min(self->nodeCount, i + 100);
+			loop {
+				try {
+					for (int j = i; j < batchEnd; j++) {
+						tr.set(self->keyForIndex(j),
+						       Value(std::string(deterministicRandom()->randomInt(0, self->maxValueBytes + 1), 'v')));
+					}
+					wait(tr.commit());
+					break;
+				} catch (Error& e) {
+					wait(tr.onError(e));
+				}
+			}
+			i = batchEnd;
+		}
+		return Void();
+	}
+
+	// Reads the whole stream into one result, consuming it slowly if asked to
+	ACTOR static Future<Standalone<RangeResultRef>> readStream(PromiseStream<Standalone<RangeResultRef>> results,
+	                                                          Future<Void> stream, bool slow) {
+		state Standalone<RangeResultRef> all;
+		try {
+			loop {
+				Standalone<RangeResultRef> fragment = waitNext(results.getFuture());
+				all.arena().dependsOn(fragment.arena());
+				all.append(all.arena(), fragment.begin(), fragment.size());
+				if (slow) {
+					wait(delay(deterministicRandom()->random01() * 0.1));
+				}
+			}
+		} catch (Error& e) {
+			if (e.code() != error_code_end_of_stream) {
+				throw;
+			}
+		}
+		wait(stream);
+		return all;
+	}
+
+	ACTOR static Future<Void> compareOnce(Database cx, GetRangeStreamWorkload* self) {
+		state Transaction tr(cx);
+		loop {
+			state int a = deterministicRandom()->randomInt(0, self->nodeCount + 1);
+			state int b = deterministicRandom()->randomInt(0, self->nodeCount + 1);
+			state KeyRange range = KeyRangeRef(self->keyForIndex(std::min(a, b)), self->keyForIndex(std::max(a, b)));
+			state bool reverse = deterministicRandom()->coinflip();
+			state bool slow = deterministicRandom()->random01() < self->slowReaderProbability;
+			state bool cancel = deterministicRandom()->random01() < self->cancelProbability;
+			state GetRangeLimits limits;
+			if (deterministicRandom()->coinflip()) {
+				limits.rows = deterministicRandom()->randomInt(1, self->nodeCount + 1);
+			}
+			state bool byteLimited = deterministicRandom()->coinflip();
+			if (byteLimited) {
+				limits.bytes = deterministicRandom()->randomInt(1, self->nodeCount * self->maxValueBytes / 4 + 2);
+			}
+
+			try {
+				state PromiseStream<Standalone<RangeResultRef>> results;
+				state Future<Void> stream = tr.getRangeStream(results, range, limits, false, reverse);
+
+				if (cancel) {
+					// Read a fragment or two and then abandon the stream; the storage server must stop sending
+					state int fragments = deterministicRandom()->randomInt(0, 3);
+					try {
+						while (fragments-- > 0) {
+							Standalone<RangeResultRef> fragment = waitNext(results.getFuture());
+							wait(delay(deterministicRandom()->random01() * 0.1));
+						}
+					} catch (Error& e) {
+						if (e.code() != error_code_end_of_stream) {
+							throw;
+						}
+					}
+					stream = Future<Void>();
+					++self->cancelled;
+					return Void();
+				}
+
+				state Standalone<RangeResultRef> streamed = wait(readStream(results, stream, slow));
+				// An unlimited read of the same range at the same version, from which the limits are applied here
+				state Standalone<RangeResultRef> expected =
+				    wait(tr.getRange(range, GetRangeLimits(GetRangeLimits::ROW_LIMIT_UNLIMITED), false, reverse));
+				if (slow) {
+					++self->slowReads;
+				}
+
+				// With no byte limit the rows delivered are exactly the rows allowed by the row limit.  The byte
+				// limit is only a lower bound on what is returned, so with one the stream must be a prefix of the
+				// range that stops no earlier than the limit.
+				int expectedRows = limits.hasRowLimit() ? std::min(limits.rows, expected.size()) : expected.size();
+				bool ok = byteLimited ? streamed.size() <= expectedRows : streamed.size() == expectedRows;
+				for (int i = 0; ok && i < streamed.size(); i++) {
+					ok = streamed[i] == expected[i];
+				}
+				if (ok && byteLimited && streamed.size() < expectedRows) {
+					GetRangeLimits remaining = limits;
+					remaining.decrement(streamed);
+					ok = remaining.isReached();
+				}
+				if (!ok) {
+					TraceEvent(SevError, "GetRangeStreamMismatch")
+					    .detail("Begin", range.begin)
+					    .detail("End", range.end)
+					    .detail("Reverse", reverse)
+					    .detail("RowLimit", limits.rows)
+					    .detail("ByteLimit", limits.bytes)
+					    .detail("StreamedRows", streamed.size())
+					    .detail("ExpectedRows", expected.size());
+					self->success = false;
+				}
+				++self->comparisons;
+				return Void();
+			} catch (Error& e) {
+				wait(tr.onError(e));
+			}
+		}
+	}
+
+	ACTOR static Future<Void> _start(Database cx, GetRangeStreamWorkload* self) {
+		loop { wait(compareOnce(cx, self)); }
+	}
+};
+
+WorkloadFactory<GetRangeStreamWorkload> GetRangeStreamWorkloadFactory("GetRangeStream");
@@ -300,10 +300,17 @@ ArenaBlock* ArenaBlock::create(int dataSize, Reference<ArenaBlock>& next) {
 			b->tinySize = b->tinyUsed = NOT_TINY;
 			b->bigUsed = sizeof(ArenaBlock);
 		} else {
+			if (reqSize <= LargeBlockAllocator::MAX_SIZE) {
+				// The rest of the size class is usable by the arena
+				reqSize = LargeBlockAllocator::roundUp(reqSize);
+				b = (ArenaBlock*)LargeBlockAllocator::allocate(reqSize);
+			} else {
+				b = (ArenaBlock*)new uint8_t[reqSize];
+			}
 #ifdef ALLOC_INSTRUMENTATION
+			// The same size that destroyLeaf() releases
 			allocInstr["ArenaHugeKB"].alloc((reqSize + 1023) >> 10);
 #endif
-			b = (ArenaBlock*)new uint8_t[reqSize];
 			b->tinySize = b->tinyUsed = NOT_TINY;
 			b->bigSize = reqSize;
 			b->bigUsed = sizeof(ArenaBlock);
@@ -311,7 +318,7 @@ ArenaBlock* ArenaBlock::create(int dataSize, Reference<ArenaBlock>& next) {
 			if (FLOW_KNOBS && g_allocation_tracing_disabled == 0 &&
 			    nondeterministicRandom()->random01() < (reqSize / FLOW_KNOBS->HUGE_ARENA_LOGGING_BYTES)) {
 				++g_allocation_tracing_disabled;
-				hugeArenaSample(reqSize);
+				if (hugeArenaSample(b, reqSize)) b->tinyUsed = HUGE_SAMPLED;
 				--g_allocation_tracing_disabled;
 			}
 			g_hugeArenaMemory.fetch_add(reqSize);
@@ -400,7 +407,12 @@ void ArenaBlock::destroyLeaf() {
 			allocInstr["ArenaHugeKB"].dealloc((bigSize + 1023) >> 10);
 #endif
 			g_hugeArenaMemory.fetch_sub(bigSize);
-			delete[](uint8_t*) this;
+			if (tinyUsed == HUGE_SAMPLED) hugeArenaRelease(this);
+			if (bigSize <= LargeBlockAllocator::MAX_SIZE) {
+				LargeBlockAllocator::release(this, bigSize);
+			} else {
+				delete[](uint8_t*) this;
+			}
 		}
 	}
 }
@@ -559,3 +571,30 @@ TEST_CASE("/flow/Arena/SmallVectorRef10") {
 	testVectorLike<SmallVectorRef10Proxy>();
 	return Void();
 }
+
+TEST_CASE("/flow/Arena/largeBlocks") {
+	int prev = LargeBlockAllocator::roundUp(LargeBlockAllocator::MIN_SIZE + 1);
+	for (int size = LargeBlockAllocator::MIN_SIZE + 1; size <= LargeBlockAllocator::MAX_SIZE; size++) {
+		int c = LargeBlockAllocator::roundUp(size);
+		ASSERT(c >= size && c <= size + size / 4 && c >= prev);
+		ASSERT(LargeBlockAllocator::roundUp(c) == c);
+		prev = c;
+	}
+	ASSERT(LargeBlockAllocator::roundUp(LargeBlockAllocator::MAX_SIZE) == LargeBlockAllocator::MAX_SIZE);
+
+	std::vector<Standalone<StringRef>> live;
+	for (int i = 0; i < 1000; i++) {
+		if (live.size() && deterministicRandom()->coinflip()) {
+			std::swap(live[deterministicRandom()->randomInt(0, live.size())], live.back());
+			StringRef s = live.back();
+			for (int j = 0; j < s.size(); j++) ASSERT(s[j] == uint8_t(s.size() + j));
+			live.pop_back();
+		} else {
+			int size = deterministicRandom()->randomInt(1, 2 * LargeBlockAllocator::MAX_SIZE);
+			Standalone<StringRef> s = makeString(size);
+			for (int j = 0; j < size; j++) mutateString(s)[j] = uint8_t(size + j);
+			live.push_back(s);
+		}
+	}
+	return Void();
+}
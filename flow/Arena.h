@@ -127,7 +127,9 @@ template<>
 struct scalar_traits<Arena> : std::true_type {
 	constexpr static size_t size = 0;
 	template <class Context>
-	static void save(uint8_t*, const Arena&, Context&) {}
+	static void save(uint8_t*, const Arena& arena, Context& context) {
+		context.addArena(arena);
+	}
 	// Context is an arbitrary type that is plumbed by reference throughout
 	// the load call tree.
 	template <class Context>
@@ -148,10 +150,11 @@ struct ArenaBlock : NonCopyable, ThreadSafeReferenceCounted<ArenaBlock>
 		LARGE = 8193 // If size == used == LARGE, then use hugeSize, hugeUsed
 	};
 
-	enum { NOT_TINY = 255, TINY_HEADER = 6 };
+	enum { NOT_TINY = 255, TINY_HEADER = 6, HUGE_SAMPLED = 254 };
 
 	// int32_t referenceCount;	  // 4 bytes (in ThreadSafeReferenceCounted)
 	uint8_t tinySize, tinyUsed;   // If these == NOT_TINY, use bigSize, bigUsed instead
+	                              // (except that tinyUsed == HUGE_SAMPLED marks a huge block passed to hugeArenaSample)
 	// if tinySize != NOT_TINY, following variables aren't used
 	uint32_t bigSize, bigUsed;	  // include block header
 	uint32_t nextBlockOffset;
@@ -682,6 +685,31 @@ struct dynamic_size_traits<StringRef> : std::true_type {
 	}
 };
 
+// A StringRef member of a message whose bytes are owned by the message's own Arena and are not changed once the
+// message is sent.  FlowTransport may send a long one straight from that arena instead of copying it into the packet
+// (see ZERO_COPY_SEND_MIN_BYTES), so only use it for fields where both of those hold.
+struct ZeroCopyStringRef : StringRef {
+	ZeroCopyStringRef() {}
+	ZeroCopyStringRef(StringRef const& s) : StringRef(s) {}
+};
+
+template <class Archive>
+inline void load( Archive& ar, ZeroCopyStringRef& value ) {
+	load(ar, static_cast<StringRef&>(value));
+}
+template <class Archive>
+inline void save( Archive& ar, const ZeroCopyStringRef& value ) {
+	save(ar, static_cast<const StringRef&>(value));
+}
+
+template <>
+struct dynamic_size_traits<ZeroCopyStringRef> : dynamic_size_traits<StringRef> {
+	template <class Context>
+	static void save(uint8_t* out, const StringRef& t, Context& context) {
+		if (!context.trySaveZeroCopy(out, t)) std::copy(t.begin(), t.end(), out);
+	}
+};
+
 inline bool operator==(const StringRef& lhs, const StringRef& rhs) {
 	if (lhs.size() == 0 && rhs.size() == 0) {
 		return true;
@@ -26,9 +26,12 @@
 #include "flow/Knobs.h"
 #include "flow/crc32c.h"
 #include "flow/flow.h"
+#include "flow/UnitTest.h"
 
+#include <algorithm>
 #include <atomic>
 #include <cstdint>
+#include <mutex>
 #include <unordered_map>
 
 //#ifdef WIN32
@@ -39,7 +42,9 @@
 
 #ifdef __linux__
 #include <sys/mman.h>
+#include <sys/syscall.h>
 #include <linux/mman.h>
+#include <unistd.h>
 #endif
 
 #ifdef __FreeBSD__
@@ -118,21 +123,203 @@ void setFastAllocatorThreadInitFunction(ThreadInitFunction f) {
 
 std::atomic<int64_t> g_hugeArenaMemory(0);
 
+namespace {
+
+struct HugeArenaSite {
+	int count = 0; // Sampled allocations since the last time this was logged
+	int64_t size = 0; // Their total size
+	int64_t liveBytes = 0; // Estimated bytes allocated here and not yet freed
+};
+
 double hugeArenaLastLogged = 0;
-std::map<std::string, std::pair<int,int>> hugeArenaTraces;
-
-void hugeArenaSample(int size) {
-	if(TraceEvent::isNetworkThread()) {
-		auto& info = hugeArenaTraces[platform::get_backtrace()];
-		info.first++;
-		info.second+=size;
-		if(now() - hugeArenaLastLogged > FLOW_KNOBS->HUGE_ARENA_LOGGING_INTERVAL) {
-			for(auto& it : hugeArenaTraces) {
-				TraceEvent("HugeArenaSample").detail("Count", it.second.first).detail("Size", it.second.second).detail("Backtrace", it.first);
+std::map<std::string, HugeArenaSite> hugeArenaTraces;
+// Each sampled block stands for HUGE_ARENA_LOGGING_BYTES (or its own size, if larger) of huge arena allocations
+std::unordered_map<void*, std::pair<HugeArenaSite*, int64_t>> hugeArenaLiveSamples;
+std::mutex hugeArenaMutex; // Sampled blocks may be freed on any thread
+
+} // namespace
+
+bool hugeArenaSample(void* block, int size) {
+	if(!TraceEvent::isNetworkThread()) return false;
+
+	std::unique_lock<std::mutex> lock(hugeArenaMutex);
+	auto& info = hugeArenaTraces[platform::get_backtrace()];
+	int64_t weight = std::max<int64_t>(size, FLOW_KNOBS->HUGE_ARENA_LOGGING_BYTES);
+	info.count++;
+	info.size += size;
+	info.liveBytes += weight;
+	hugeArenaLiveSamples[block] = std::make_pair(&info, weight);
+
+	if(now() - hugeArenaLastLogged > FLOW_KNOBS->HUGE_ARENA_LOGGING_INTERVAL) {
+		for(auto it = hugeArenaTraces.begin(); it != hugeArenaTraces.end();) {
+			TraceEvent("HugeArenaSample").detail("Count", it->second.count).detail("Size", it->second.size).detail("LiveBytes", it->second.liveBytes).detail("Backtrace", it->first);
+			if(it->second.liveBytes) {
+				it->second.count = 0;
+				it->second.size = 0;
+				++it;
+			} else {
+				it = hugeArenaTraces.erase(it);
 			}
-			hugeArenaLastLogged = now();
-			hugeArenaTraces.clear();
 		}
+		hugeArenaLastLogged = now();
+	}
+	return true;
+}
+
+void hugeArenaRelease(void* block) {
+	std::unique_lock<std::mutex> lock(hugeArenaMutex);
+	auto it = hugeArenaLiveSamples.find(block);
+	ASSERT(it != hugeArenaLiveSamples.end());
+	it->second.first->liveBytes -= it->second.second;
+	hugeArenaLiveSamples.erase(it);
+}
+
+namespace {
+
+struct LargeBlockDepot {
+	CRITICAL_SECTION mutex;
+	void* freelist[LargeBlockAllocator::CLASSES] = {}; // Linked through the first word of each block
+	int count[LargeBlockAllocator::CLASSES] = {};
+	int64_t unusedBytes = 0;
+	std::atomic<int64_t> totalMemory;
+	LargeBlockDepot() : totalMemory(0) { InitializeCriticalSection(&mutex); }
+};
+
+LargeBlockDepot* largeBlockDepot() {
+	static LargeBlockDepot* depot = new LargeBlockDepot();
+	return depot;
+}
+
+struct LargeBlockMagazines {
+	void* freelist[LargeBlockAllocator::CLASSES];
+	int count[LargeBlockAllocator::CLASSES];
+};
+INIT_SEG thread_local LargeBlockMagazines largeBlockMagazines;
+
+// Free bytes each thread may hold per class, and that the depot may hold in all
+constexpr int LARGE_BLOCK_MAGAZINE_BYTES = 512 << 10;
+constexpr int64_t LARGE_BLOCK_DEPOT_BYTES = 64 << 20;
+
+int magazineCapacity(int size) {
+	return std::max(1, LARGE_BLOCK_MAGAZINE_BYTES / size);
+}
+
+void*& nextBlock(void* block) {
+	return *(void**)block;
+}
+
+} // namespace
+
+int LargeBlockAllocator::classIndex(int size) {
+	ASSERT(size > MIN_SIZE && size <= MAX_SIZE);
+	int log = 63 - clzll(size - 1); // 2^log < size <= 2^(log+1)
+	int quarter = (size + (1 << (log - 2)) - 1) >> (log - 2); // 5 to 8
+	return (log - 13) * 4 + quarter - 5;
+}
+
+int LargeBlockAllocator::roundUp(int size) {
+	return classSize(classIndex(size));
+}
+
+void* LargeBlockAllocator::allocate(int size) {
+	int c = classIndex(size);
+	ASSERT(classSize(c) == size);
+#if VALGRIND
+	if (valgrindPrecise()) return new uint8_t[size];
+#endif
+	auto& thr = largeBlockMagazines;
+	if (!thr.freelist[c]) {
+		// Refill half a magazine from the depot
+		LargeBlockDepot* depot = largeBlockDepot();
+		EnterCriticalSection(&depot->mutex);
+		int n = std::min(depot->count[c], (magazineCapacity(size) + 1) / 2);
+		for (int i = 0; i < n; i++) {
+			void* b = depot->freelist[c];
+			depot->freelist[c] = nextBlock(b);
+			nextBlock(b) = thr.freelist[c];
+			thr.freelist[c] = b;
+		}
+		depot->count[c] -= n;
+		depot->unusedBytes -= (int64_t)n * size;
+		LeaveCriticalSection(&depot->mutex);
+		thr.count[c] = n;
+	}
+	if (thr.freelist[c]) {
+		void* b = thr.freelist[c];
+		thr.freelist[c] = nextBlock(b);
+		--thr.count[c];
+		return b;
+	}
+	largeBlockDepot()->totalMemory.fetch_add(size);
+	return new uint8_t[size];
+}
+
+void LargeBlockAllocator::release(void* ptr, int size) {
+	int c = classIndex(size);
+#if VALGRIND
+	if (valgrindPrecise()) {
+		delete[](uint8_t*) ptr;
+		return;
+	}
+#endif
+	auto& thr = largeBlockMagazines;
+	const int capacity = magazineCapacity(size);
+	if (thr.count[c] == capacity) {
+		// Spill half the magazine, or the whole of it if capacity is 1, to the depot; whatever doesn't fit is freed
+		int n = (capacity + 1) / 2;
+		void* spill = thr.freelist[c];
+		void* last = spill;
+		for (int i = 1; i < n; i++) last = nextBlock(last);
+		thr.freelist[c] = nextBlock(last);
+		thr.count[c] -= n;
+
+		LargeBlockDepot* depot = largeBlockDepot();
+		EnterCriticalSection(&depot->mutex);
+		int keep = std::min<int64_t>(n, std::max<int64_t>(0, LARGE_BLOCK_DEPOT_BYTES - depot->unusedBytes) / size);
+		for (int i = 0; i < keep; i++) {
+			void* b = spill;
+			spill = nextBlock(b);
+			nextBlock(b) = depot->freelist[c];
+			depot->freelist[c] = b;
+		}
+		depot->count[c] += keep;
+		depot->unusedBytes += (int64_t)keep * size;
+		LeaveCriticalSection(&depot->mutex);
+
+		for (int i = keep; i < n; i++) {
+			void* b = spill;
+			spill = nextBlock(b);
+			delete[](uint8_t*) b;
+		}
+		depot->totalMemory.fetch_sub((int64_t)(n - keep) * size);
+	}
+	nextBlock(ptr) = thr.freelist[c];
+	thr.freelist[c] = ptr;
+	++thr.count[c];
+}
+
+int64_t LargeBlockAllocator::getTotalMemory() {
+	return largeBlockDepot()->totalMemory.load();
+}
+
+int64_t LargeBlockAllocator::getApproximateMemoryUnused() {
+	LargeBlockDepot* depot = largeBlockDepot();
+	EnterCriticalSection(&depot->mutex);
+	int64_t unused = depot->unusedBytes;
+	LeaveCriticalSection(&depot->mutex);
+	return unused;
+}
+
+void LargeBlockAllocator::releaseThreadMagazines() {
+	auto& thr = largeBlockMagazines;
+	for (int c = 0; c < CLASSES; c++) {
+		while (thr.freelist[c]) {
+			void* b = thr.freelist[c];
+			thr.freelist[c] = nextBlock(b);
+			delete[](uint8_t*) b;
+			largeBlockDepot()->totalMemory.fetch_sub(classSize(c));
+		}
+		thr.count[c] = 0;
 	}
 }
 
@@ -240,16 +427,57 @@ void recordDeallocation( void *ptr ) {
 #endif
 }
 
+namespace {
+
+// Free magazines are pooled per NUMA node, so that a thread is handed back memory that was first touched on its own
+// node.  Machines with more nodes than this share pools between them.
+constexpr int FAST_ALLOCATOR_NODES = 8;
+// Full magazines a node's pool can pass between threads without taking its mutex.  In a client the network thread
+// allocates most of what ThreadSafeTransaction callback threads free, and vice versa, so magazines flow steadily
+// between them.
+constexpr int FAST_ALLOCATOR_HANDOFF_SLOTS = 4;
+// The most free objects releaseIdleFastAllocatorMemory() sorts in one call, across all sizes.  This bounds how long it
+// holds up the thread that calls it (the network thread, from the system monitor), its temporary memory and the time
+// it keeps magazines out of the pools.  Idle magazines it does not get to are left for later calls.
+constexpr int FAST_ALLOCATOR_MAX_IDLE_OBJECTS = 1 << 16;
+
+int currentNumaNode() {
+#ifdef __linux__
+	unsigned cpu, node;
+	if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) {
+		return node % FAST_ALLOCATOR_NODES;
+	}
+#endif
+	return 0;
+}
+
+} // namespace
+
 template <int Size>
 struct FastAllocator<Size>::GlobalData {
-	CRITICAL_SECTION mutex;
-	std::vector<void*> magazines;   // These magazines are always exactly magazine_size ("full")
-	std::vector<std::pair<int, void*>> partial_magazines;  // Magazines that are not "full" and their counts.  Only created by releaseThreadMagazines().
+	struct alignas(64) Node {
+		std::atomic<void*> handoff[FAST_ALLOCATOR_HANDOFF_SLOTS]; // Each is a full magazine or nullptr
+		CRITICAL_SECTION mutex;
+		std::vector<void*> magazines;   // These magazines are always exactly magazine_size ("full").  The oldest are at the front.
+		std::vector<std::pair<int, void*>> partial_magazines;  // Magazines that are not "full" and their counts.  Only created by releaseThreadMagazines() and releaseIdleMemory().
+		long long partialMagazineUnallocatedMemory;
+		size_t idleMagazines; // The fewest magazines there have been since the last releaseIdleMemory()
+		Node() : partialMagazineUnallocatedMemory(0), idleMagazines(0) {
+			for (auto& slot : handoff) slot = nullptr;
+			InitializeCriticalSection(&mutex);
+		}
+	};
+	Node nodes[FAST_ALLOCATOR_NODES];
+
+	CRITICAL_SECTION blockMutex;
+	std::vector<void*> blocks; // Every block of magazine_size objects obtained from the system allocator
+	size_t sortedBlocks; // blocks[0, sortedBlocks) are in address order
+	std::vector<void*> decommittedBlocks; // Blocks whose pages releaseIdleMemory() gave back to the OS
+
 	std::atomic<long long> totalMemory;
-	long long partialMagazineUnallocatedMemory;
 	std::atomic<long long> activeThreads;
-	GlobalData() : totalMemory(0), partialMagazineUnallocatedMemory(0), activeThreads(0) {
-		InitializeCriticalSection(&mutex);
+	GlobalData() : sortedBlocks(0), totalMemory(0), activeThreads(0) {
+		InitializeCriticalSection(&blockMutex);
 	}
 };
 
@@ -261,10 +489,15 @@ long long FastAllocator<Size>::getTotalMemory() {
 // This does not include memory held by various threads that's available for allocation
 template <int Size>
 long long FastAllocator<Size>::getApproximateMemoryUnused() {
-	EnterCriticalSection(&globalData()->mutex);
-	long long unused =
-	    globalData()->magazines.size() * magazine_size * Size + globalData()->partialMagazineUnallocatedMemory;
-	LeaveCriticalSection(&globalData()->mutex);
+	long long unused = 0;
+	for (auto& node : globalData()->nodes) {
+		for (auto& slot : node.handoff) {
+			if (slot.load(std::memory_order_relaxed)) unused += magazine_size * Size;
+		}
+		EnterCriticalSection(&node.mutex);
+		unused += node.magazines.size() * magazine_size * Size + node.partialMagazineUnallocatedMemory;
+		LeaveCriticalSection(&node.mutex);
+	}
 	return unused;
 }
 
@@ -456,6 +689,7 @@ void FastAllocator<Size>::initThread() {
 	threadData.freelist = nullptr;
 	threadData.alternate = nullptr;
 	threadData.count = 0;
+	threadData.node = currentNumaNode();
 }
 
 template <int Size>
@@ -463,32 +697,61 @@ void FastAllocator<Size>::getMagazine() {
 	ASSERT(threadInitialized);
 	ASSERT(!threadData.freelist && !threadData.alternate && threadData.count == 0);
 
-	EnterCriticalSection(&globalData()->mutex);
-	if (globalData()->magazines.size()) {
-		void* m = globalData()->magazines.back();
-		globalData()->magazines.pop_back();
-		LeaveCriticalSection(&globalData()->mutex);
-		threadData.freelist = m;
-		threadData.count = magazine_size;
-		return;
-	} else if (globalData()->partial_magazines.size()) {
-		std::pair<int, void*> p = globalData()->partial_magazines.back();
-		globalData()->partial_magazines.pop_back();
-		globalData()->partialMagazineUnallocatedMemory -= p.first * Size;
-		LeaveCriticalSection(&globalData()->mutex);
-		threadData.freelist = p.second;
-		threadData.count = p.first;
+	// Take a free magazine from this thread's node if there is one, and otherwise from the other nodes
+	GlobalData* data = globalData();
+	for (int i = 0; i < FAST_ALLOCATOR_NODES; i++) {
+		auto& node = data->nodes[(threadData.node + i) % FAST_ALLOCATOR_NODES];
+		for (auto& slot : node.handoff) {
+			if (slot.load(std::memory_order_relaxed)) {
+				void* m = slot.exchange(nullptr, std::memory_order_acquire);
+				if (m) {
+					threadData.freelist = m;
+					threadData.count = magazine_size;
+					return;
+				}
+			}
+		}
+
+		EnterCriticalSection(&node.mutex);
+		if (node.magazines.size()) {
+			void* m = node.magazines.back();
+			node.magazines.pop_back();
+			node.idleMagazines = std::min(node.idleMagazines, node.magazines.size());
+			LeaveCriticalSection(&node.mutex);
+			threadData.freelist = m;
+			threadData.count = magazine_size;
+			return;
+		} else if (node.partial_magazines.size()) {
+			std::pair<int, void*> p = node.partial_magazines.back();
+			node.partial_magazines.pop_back();
+			node.partialMagazineUnallocatedMemory -= p.first * Size;
+			LeaveCriticalSection(&node.mutex);
+			threadData.freelist = p.second;
+			threadData.count = p.first;
+			return;
+		}
+		LeaveCriticalSection(&node.mutex);
+	}
+	data->totalMemory.fetch_add(magazine_size * Size);
+
+	// Reuse a block whose pages were given back to the OS before mapping a new one
+	void** block = nullptr;
+	EnterCriticalSection(&data->blockMutex);
+	if (data->decommittedBlocks.size()) {
+		block = (void**)data->decommittedBlocks.back();
+		data->decommittedBlocks.pop_back();
+	}
+	LeaveCriticalSection(&data->blockMutex);
+	if (block) {
+		buildMagazine(block);
 		return;
 	}
-	globalData()->totalMemory.fetch_add(magazine_size * Size);
-	LeaveCriticalSection(&globalData()->mutex);
 
 	// Allocate a new page of data from the system allocator
 	#ifdef ALLOC_INSTRUMENTATION
 	interlockedIncrement(&pageCount);
 	#endif
 
-	void** block = nullptr;
 #if FAST_ALLOCATOR_DEBUG
 #ifdef WIN32
 	static int alt = 0; alt++;
@@ -513,6 +776,14 @@ void FastAllocator<Size>::getMagazine() {
 	block = (void **)::allocate(magazine_size * Size, false);
 #endif
 
+	EnterCriticalSection(&data->blockMutex);
+	data->blocks.push_back(block);
+	LeaveCriticalSection(&data->blockMutex);
+	buildMagazine(block);
+}
+
+template <int Size>
+void FastAllocator<Size>::buildMagazine(void** block) {
 	//void** block = new void*[ magazine_size * PSize ];
 	for(int i=0; i<magazine_size-1; i++) {
 		block[i*PSize+1] = block[i*PSize] = &block[(i+1)*PSize];
@@ -527,9 +798,17 @@ void FastAllocator<Size>::getMagazine() {
 template <int Size>
 void FastAllocator<Size>::releaseMagazine(void* mag) {
 	ASSERT(threadInitialized);
-	EnterCriticalSection(&globalData()->mutex);
-	globalData()->magazines.push_back(mag);
-	LeaveCriticalSection(&globalData()->mutex);
+	auto& node = globalData()->nodes[threadData.node];
+	for (auto& slot : node.handoff) {
+		void* empty = nullptr;
+		if (!slot.load(std::memory_order_relaxed) &&
+		    slot.compare_exchange_strong(empty, mag, std::memory_order_release, std::memory_order_relaxed)) {
+			return;
+		}
+	}
+	EnterCriticalSection(&node.mutex);
+	node.magazines.push_back(mag);
+	LeaveCriticalSection(&node.mutex);
 }
 template <int Size>
 void FastAllocator<Size>::releaseThreadMagazines() {
@@ -537,19 +816,20 @@ void FastAllocator<Size>::releaseThreadMagazines() {
 		threadInitialized = false;
 		ThreadData& thr = threadData;
 
-		EnterCriticalSection(&globalData()->mutex);
+		auto& node = globalData()->nodes[thr.node];
+		EnterCriticalSection(&node.mutex);
 		if (thr.freelist || thr.alternate) {
 			if (thr.freelist) {
 				ASSERT(thr.count > 0 && thr.count <= magazine_size);
-				globalData()->partial_magazines.push_back( std::make_pair(thr.count, thr.freelist) );
-				globalData()->partialMagazineUnallocatedMemory += thr.count * Size;
+				node.partial_magazines.push_back( std::make_pair(thr.count, thr.freelist) );
+				node.partialMagazineUnallocatedMemory += thr.count * Size;
 			}
 			if (thr.alternate) {
-				globalData()->magazines.push_back(thr.alternate);
+				node.magazines.push_back(thr.alternate);
 			}
 		}
 		globalData()->activeThreads.fetch_add(-1);
-		LeaveCriticalSection(&globalData()->mutex);
+		LeaveCriticalSection(&node.mutex);
 
 		thr.count = 0;
 		thr.alternate = nullptr;
@@ -557,6 +837,114 @@ void FastAllocator<Size>::releaseThreadMagazines() {
 	}
 }
 
+template <int Size>
+int64_t FastAllocator<Size>::releaseIdleMemory(int& objectBudget) {
+#if defined(__linux__) && !FAST_ALLOCATOR_DEBUG && !defined(USE_GPERFTOOLS)
+#if VALGRIND
+	if (valgrindPrecise()) {
+		return 0;
+	}
+#endif
+	GlobalData* data = globalData();
+	const size_t blockBytes = magazine_size * Size;
+	std::vector<void*> blocks;
+	int64_t released = 0;
+
+	for (auto& node : data->nodes) {
+		// Take out the magazines that no thread has needed since the last call.  getMagazine() takes from the back, so
+		// those are the ones at the front.  Whatever is left counts as idle from now on, and will be taken by the
+		// next call if no thread needs it in the meantime.
+		std::vector<void*> idle;
+		EnterCriticalSection(&node.mutex);
+		size_t n = std::min<size_t>(node.idleMagazines, objectBudget / magazine_size);
+		idle.assign(node.magazines.begin(), node.magazines.begin() + n);
+		node.magazines.erase(node.magazines.begin(), node.magazines.begin() + n);
+		node.idleMagazines = node.magazines.size();
+		LeaveCriticalSection(&node.mutex);
+		if (idle.empty()) continue;
+		objectBudget -= idle.size() * magazine_size;
+
+		if (blocks.empty()) {
+			EnterCriticalSection(&data->blockMutex);
+			// Blocks are only ever added, so only those added since the last call need sorting
+			std::sort(data->blocks.begin() + data->sortedBlocks, data->blocks.end());
+			std::inplace_merge(data->blocks.begin(), data->blocks.begin() + data->sortedBlocks, data->blocks.end());
+			data->sortedBlocks = data->blocks.size();
+			blocks = data->blocks;
+			LeaveCriticalSection(&data->blockMutex);
+		}
+
+		std::vector<void*> objects;
+		objects.reserve(idle.size() * magazine_size);
+		for (void* m : idle) {
+			for (void* p = m; p;) {
+				objects.push_back(p);
+#if VALGRIND
+				VALGRIND_MAKE_MEM_DEFINED(p, sizeof(void*));
+#endif
+				p = *(void**)p;
+			}
+		}
+		std::sort(objects.begin(), objects.end());
+
+		// A block all of whose objects are idle has nothing live in it, and its pages can go back to the OS.  The free
+		// objects of every other block are regrouped into magazines in address order.
+		std::vector<void*> decommitted;
+		std::vector<void*> keep;
+		auto o = objects.begin();
+		for (void* b : blocks) {
+			auto begin = std::lower_bound(o, objects.end(), b);
+			auto end = std::lower_bound(begin, objects.end(), (void*)((uint8_t*)b + blockBytes));
+			keep.insert(keep.end(), o, begin);
+			if (end - begin == magazine_size) {
+				madvise(b, blockBytes, MADV_DONTNEED);
+				decommitted.push_back(b);
+			} else {
+				keep.insert(keep.end(), begin, end);
+			}
+			o = end;
+		}
+		keep.insert(keep.end(), o, objects.end());
+
+		std::vector<void*> magazines;
+		std::pair<int, void*> partial(0, nullptr);
+		for (size_t i = 0; i < keep.size(); i += magazine_size) {
+			size_t count = std::min<size_t>(magazine_size, keep.size() - i);
+			for (size_t j = i; j < i + count; j++) {
+				*(void**)keep[j] = j + 1 < i + count ? keep[j + 1] : nullptr;
+			}
+			if (count == magazine_size) {
+				magazines.push_back(keep[i]);
+			} else {
+				partial = std::make_pair((int)count, keep[i]);
+			}
+		}
+
+		// The regrouped magazines go to the back, where they are handed out first, so that the blocks that are still
+		// in use fill up before the idle ones are touched again.  Like any other magazine put back in the pool, they
+		// have to sit unused for a full interval before they count as idle again.
+		EnterCriticalSection(&node.mutex);
+		node.magazines.insert(node.magazines.end(), magazines.begin(), magazines.end());
+		if (partial.second) {
+			node.partial_magazines.push_back(partial);
+			node.partialMagazineUnallocatedMemory += partial.first * Size;
+		}
+		LeaveCriticalSection(&node.mutex);
+
+		if (decommitted.size()) {
+			EnterCriticalSection(&data->blockMutex);
+			data->decommittedBlocks.insert(data->decommittedBlocks.end(), decommitted.begin(), decommitted.end());
+			LeaveCriticalSection(&data->blockMutex);
+			data->totalMemory.fetch_sub(decommitted.size() * blockBytes);
+			released += decommitted.size() * blockBytes;
+		}
+	}
+	return released;
+#else
+	return 0;
+#endif
+}
+
 void releaseAllThreadMagazines() {
 	FastAllocator<16>::releaseThreadMagazines();
 	FastAllocator<32>::releaseThreadMagazines();
@@ -570,6 +958,7 @@ void releaseAllThreadMagazines() {
 	FastAllocator<4096>::releaseThreadMagazines();
 	FastAllocator<8192>::releaseThreadMagazines();
 	FastAllocator<16384>::releaseThreadMagazines();
+	LargeBlockAllocator::releaseThreadMagazines();
 }
 
 int64_t getTotalUnusedAllocatedMemory() {
@@ -587,10 +976,32 @@ int64_t getTotalUnusedAllocatedMemory() {
 	unusedMemory += FastAllocator<4096>::getApproximateMemoryUnused();
 	unusedMemory += FastAllocator<8192>::getApproximateMemoryUnused();
 	unusedMemory += FastAllocator<16384>::getApproximateMemoryUnused();
+	unusedMemory += LargeBlockAllocator::getApproximateMemoryUnused();
 
 	return unusedMemory;
 }
 
+int64_t releaseIdleFastAllocatorMemory() {
+	static int64_t (*const releaseIdle[])(int&) = {
+		FastAllocator<16>::releaseIdleMemory,   FastAllocator<32>::releaseIdleMemory,
+		FastAllocator<64>::releaseIdleMemory,   FastAllocator<96>::releaseIdleMemory,
+		FastAllocator<128>::releaseIdleMemory,  FastAllocator<256>::releaseIdleMemory,
+		FastAllocator<512>::releaseIdleMemory,  FastAllocator<1024>::releaseIdleMemory,
+		FastAllocator<2048>::releaseIdleMemory, FastAllocator<4096>::releaseIdleMemory,
+		FastAllocator<8192>::releaseIdleMemory, FastAllocator<16384>::releaseIdleMemory,
+	};
+	constexpr int sizes = sizeof(releaseIdle) / sizeof(releaseIdle[0]);
+	// Start with a different size each call, so that no size is starved of the budget
+	static int first = 0;
+	int budget = FAST_ALLOCATOR_MAX_IDLE_OBJECTS;
+	int64_t released = 0;
+	for (int i = 0; i < sizes && budget > 0; i++) {
+		released += releaseIdle[(first + i) % sizes](budget);
+	}
+	first = (first + 1) % sizes;
+	return released;
+}
+
 template class FastAllocator<16>;
 template class FastAllocator<32>;
 template class FastAllocator<64>;
@@ -603,3 +1014,28 @@ template class FastAllocator<2048>;
 template class FastAllocator<4096>;
 template class FastAllocator<8192>;
 template class FastAllocator<16384>;
+
+TEST_CASE("/flow/FastAllocator/releaseIdleMemory") {
+	// Fill and free enough blocks that some are sure to hold nothing but idle objects
+	std::vector<void*> objects(1 << 17);
+	for (auto& p : objects) p = FastAllocator<64>::allocate();
+	for (auto p : objects) FastAllocator<64>::release(p);
+
+	// The first call only releases what was idle before the test began, after which everything in the pools is idle
+	int budget = std::numeric_limits<int>::max();
+	FastAllocator<64>::releaseIdleMemory(budget);
+	long long total = FastAllocator<64>::getTotalMemory();
+	int64_t released = FastAllocator<64>::releaseIdleMemory(budget);
+	ASSERT(FastAllocator<64>::getTotalMemory() == total - released);
+#if defined(__linux__) && !FAST_ALLOCATOR_DEBUG && !defined(USE_GPERFTOOLS) && !VALGRIND
+	ASSERT(released > 0);
+#endif
+
+	// Released blocks are reused, and must come back as a working freelist
+	for (auto& p : objects) {
+		p = FastAllocator<64>::allocate();
+		memset(p, 0xab, 64);
+	}
+	for (auto p : objects) FastAllocator<64>::release(p);
+	return Void();
+}
@@ -116,6 +116,11 @@ public:
 
 	static void releaseThreadMagazines();
 
+	// Returns to the OS the pages of blocks whose objects have all sat in the global pools since the previous call,
+	// and returns the number of bytes released.  The blocks stay mapped and are reused before asking the system
+	// allocator for more.  Looks at no more than objectBudget idle objects, and deducts the number it looked at.
+	static int64_t releaseIdleMemory(int& objectBudget);
+
 #ifdef ALLOC_INSTRUMENTATION
 	static volatile int32_t pageCount;
 #endif
@@ -133,6 +138,7 @@ private:
 		void* freelist;
 		int count;		  // there are count items on freelist
 		void* alternate;  // alternate is either a full magazine, or an empty one
+		int node;         // The NUMA node this thread was on when it first allocated, whose pool it uses
 	};
 	static thread_local ThreadData threadData;
 	static thread_local bool threadInitialized;
@@ -152,13 +158,47 @@ private:
 
 	static void initThread();
 	static void getMagazine();
+	static void buildMagazine(void** block);
 	static void releaseMagazine(void*);
 };
 
+// Allocates blocks of more than 8KB and up to 1MB, rounded up to size classes spaced four to a doubling.  Each thread
+// keeps a magazine of free blocks per class; a full magazine spills half its blocks to a shared depot of bounded size,
+// and blocks the depot has no room for go back to malloc.  Recycling blocks of a few fixed sizes keeps big, short-lived
+// arenas (fetchKeys batches, peek replies) from fragmenting the heap.
+class LargeBlockAllocator {
+public:
+	static constexpr int MIN_SIZE = 8 << 10; // Exclusive
+	static constexpr int MAX_SIZE = 1 << 20;
+	static constexpr int CLASSES = 28;
+
+	// The size of the class that size falls in, for MIN_SIZE < size <= MAX_SIZE
+	static int roundUp(int size);
+
+	// size must be a class size
+	[[nodiscard]] static void* allocate(int size);
+	static void release(void* ptr, int size);
+
+	static int64_t getTotalMemory(); // Blocks allocated from malloc, whether in use or not
+	static int64_t getApproximateMemoryUnused(); // Blocks in the depot.  Does not include blocks held by threads.
+
+	static void releaseThreadMagazines();
+
+	LargeBlockAllocator() = delete;
+
+private:
+	static int classIndex(int size);
+	static int classSize(int index) { return (index % 4 + 5) << (index / 4 + 11); }
+};
+
 extern std::atomic<int64_t> g_hugeArenaMemory;
-void hugeArenaSample(int size);
+// Samples the call site of a huge arena allocation.  Returns true if the block was recorded, in which case
+// hugeArenaRelease() must be called when it is freed.
+bool hugeArenaSample(void* block, int size);
+void hugeArenaRelease(void* block);
 void releaseAllThreadMagazines();
 int64_t getTotalUnusedAllocatedMemory();
+int64_t releaseIdleFastAllocatorMemory(); // FastAllocator<Size>::releaseIdleMemory() for every Size, within a bounded budget
 void setFastAllocatorThreadInitFunction( void (*)() );  // The given function will be called at least once in each thread that allocates from a FastAllocator.  Currently just one such function is tracked.
 
 inline constexpr int nextFastAllocatedSize(int x) {
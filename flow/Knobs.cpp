@@ -59,6 +59,7 @@ void FlowKnobs::initialize(bool randomize, bool isSimulated) {
 
 	init( RANDOMSEED_RETRY_LIMIT,                                4 );
 	init( FAST_ALLOC_LOGGING_BYTES,                           10e6 );
+	init( FAST_ALLOC_RELEASE_IDLE_MEMORY,                    false ); // Give FastAllocator blocks that sat unused between system monitor intervals back to the OS
 	init( HUGE_ARENA_LOGGING_BYTES,                          100e6 );
 	init( HUGE_ARENA_LOGGING_INTERVAL,                         5.0 );
 
@@ -134,6 +135,11 @@ void FlowKnobs::initialize(bool randomize, bool isSimulated) {
 	init( PAGE_WRITE_CHECKSUM_HISTORY,                           0 ); if( randomize && BUGGIFY ) PAGE_WRITE_CHECKSUM_HISTORY = 10000000;
 	init( DISABLE_POSIX_KERNEL_AIO,                              0 );
 
+	//AsyncFileIOUring
+	init( ENABLE_IO_URING,                                       0 );
+	init( IO_URING_QUEUE_DEPTH,                                256 );
+	init( IO_URING_REGISTERED_FILES,                           256 );
+
 	//AsyncFileNonDurable
 	init( MAX_PRIOR_MODIFICATION_DELAY,                        1.0 ); if( randomize && BUGGIFY ) MAX_PRIOR_MODIFICATION_DELAY = 10.0;
 
@@ -154,7 +160,8 @@ void FlowKnobs::initialize(bool randomize, bool isSimulated) {
 	init( TSC_YIELD_TIME,                                  1000000 );
 	init( MIN_LOGGED_PRIORITY_BUSY_FRACTION,                  0.05 );
 	init( CERT_FILE_MAX_SIZE,                      5 * 1024 * 1024 );
-	init( READY_QUEUE_RESERVED_SIZE,                          8192 );
+	init( READY_QUEUE_RESERVED_SIZE,                          8192 ); // Deprecated; no longer used
+	init( TIMER_WHEEL_TICK,                                  0.001 );
 
 	//Network
 	init( PACKET_LIMIT,                                  100LL<<20 );
@@ -165,6 +172,10 @@ void FlowKnobs::initialize(bool randomize, bool isSimulated) {
 	init( MIN_PACKET_BUFFER_FREE_BYTES,                        256 );
 	init( FLOW_TCP_NODELAY,                                      1 );
 	init( FLOW_TCP_QUICKACK,                                     0 );
+	init( ENABLE_NETWORK_COMPRESSION,                        false ); if( randomize && BUGGIFY ) ENABLE_NETWORK_COMPRESSION = true;
+	init( NETWORK_COMPRESSION_MIN_BYTES,                  4 * 1024 ); if( randomize && BUGGIFY ) NETWORK_COMPRESSION_MIN_BYTES = 1;
+	init( NETWORK_COMPRESSION_BATCH_BYTES,             1024 * 1024 ); if( randomize && BUGGIFY ) NETWORK_COMPRESSION_BATCH_BYTES = deterministicRandom()->randomInt(100, 64 * 1024);
+	init( ZERO_COPY_SEND_MIN_BYTES,                       8 * 1024 ); if( randomize && BUGGIFY ) ZERO_COPY_SEND_MIN_BYTES = 1;
 
 	//Sim2
 	init( MIN_OPEN_TIME,                                    0.0002 );
@@ -233,6 +244,11 @@ void FlowKnobs::initialize(bool randomize, bool isSimulated) {
 	init( BASIC_LOAD_BALANCE_MIN_CPU,                         0.05 ); //do not adjust LB probabilities if the proxies are less than 5% utilized
 	init( BASIC_LOAD_BALANCE_BUCKETS,                           40 ); //proxies bin recent GRV requests into 40 time bins
 	init( BASIC_LOAD_BALANCE_COMPUTE_PRECISION,              10000 ); //determines how much of the LB usage is holding the CPU usage of the proxy
+	init( LOAD_BALANCE_ADAPTIVE,                             false ); if( randomize && BUGGIFY ) LOAD_BALANCE_ADAPTIVE = true; // pick between two random alternatives by tail latency, and hedge at a latency percentile
+	init( LOAD_BALANCE_LATENCY_HALF_LIFE,                      5.0 );
+	init( LOAD_BALANCE_MIN_LATENCY_SAMPLES,                   10.0 ); // fewer decayed samples than this fall back to the last latency and the fixed second request time
+	init( LOAD_BALANCE_SELECTION_PERCENTILE,                  0.99 );
+	init( LOAD_BALANCE_HEDGE_PERCENTILE,                      0.95 ); if( randomize && BUGGIFY ) LOAD_BALANCE_HEDGE_PERCENTILE = 0.5;
 
 	// Health Monitor
 	init( FAILURE_DETECTION_DELAY,                             4.0 ); if( randomize && BUGGIFY ) FAILURE_DETECTION_DELAY = 1.0;
@@ -67,6 +67,7 @@ public:
 
 	int RANDOMSEED_RETRY_LIMIT;
 	double FAST_ALLOC_LOGGING_BYTES;
+	bool FAST_ALLOC_RELEASE_IDLE_MEMORY;
 	double HUGE_ARENA_LOGGING_BYTES;
 	double HUGE_ARENA_LOGGING_INTERVAL;
 
@@ -147,6 +148,11 @@ public:
 	int PAGE_WRITE_CHECKSUM_HISTORY;
 	int DISABLE_POSIX_KERNEL_AIO;
 
+	//AsyncFileIOUring
+	int ENABLE_IO_URING;
+	int IO_URING_QUEUE_DEPTH;
+	int IO_URING_REGISTERED_FILES;
+
 	//AsyncFileNonDurable
 	double MAX_PRIOR_MODIFICATION_DELAY;
 
@@ -168,7 +174,8 @@ public:
 	int64_t REACTOR_FLAGS;
 	double MIN_LOGGED_PRIORITY_BUSY_FRACTION;
 	int CERT_FILE_MAX_SIZE;
-	int READY_QUEUE_RESERVED_SIZE;
+	int READY_QUEUE_RESERVED_SIZE; // Deprecated: the ready queue is no longer a reserved heap.  Kept so that setting it is not an error.
+	double TIMER_WHEEL_TICK; // Resolution of the Net2 timer wheel; timers due within the current tick are ordered exactly
 
 	//Network
 	int64_t PACKET_LIMIT;
@@ -179,6 +186,10 @@ public:
 	int MIN_PACKET_BUFFER_FREE_BYTES;
 	int FLOW_TCP_NODELAY;
 	int FLOW_TCP_QUICKACK;
+	bool ENABLE_NETWORK_COMPRESSION; // Compress to peers that also advertise LZ4 support
+	int NETWORK_COMPRESSION_MIN_BYTES; // Unsent bytes below this are sent raw
+	int NETWORK_COMPRESSION_BATCH_BYTES; // Most uncompressed bytes in one compressed frame; larger packets are sent raw
+	int ZERO_COPY_SEND_MIN_BYTES; // ZeroCopyStringRef fields at least this long are sent from their arenas rather than copied; 0 disables
 
 	//Sim2
 	//FIMXE: more parameters could be factored out
@@ -248,6 +259,11 @@ public:
 	int BASIC_LOAD_BALANCE_COMPUTE_PRECISION;
 	double BASIC_LOAD_BALANCE_MIN_REQUESTS;
 	double BASIC_LOAD_BALANCE_MIN_CPU;
+	bool LOAD_BALANCE_ADAPTIVE;
+	double LOAD_BALANCE_LATENCY_HALF_LIFE;
+	double LOAD_BALANCE_MIN_LATENCY_SAMPLES;
+	double LOAD_BALANCE_SELECTION_PERCENTILE;
+	double LOAD_BALANCE_HEDGE_PERCENTILE;
 
 	// Health Monitor
 	int FAILURE_DETECTION_DELAY;
@@ -37,7 +37,9 @@
 #include "flow/IThreadPool.h"
 
 #include "flow/ActorCollection.h"
+#include "flow/Deque.h"
 #include "flow/ThreadSafeQueue.h"
+#include "flow/TimerWheel.h"
 #include "flow/ThreadHelper.actor.h"
 #include "flow/TDMetric.actor.h"
 #include "flow/AsioReactor.h"
@@ -120,13 +122,90 @@ struct OrderedTask {
 	bool operator < (OrderedTask const& rhs) const { return priority < rhs.priority; }
 };
 
+// Tasks ready to run, highest taskID first and FIFO within a taskID.  There are only a few dozen distinct TaskPriority
+// values, sparse in [0, 2^PRIORITY_BITS), so each gets a bucket the first time it is used.  A bitmap of the non-empty
+// buckets, summarized by three smaller bitmaps, finds the highest one with four count-leading-zeros, where a heap
+// over every queued task would need O(log n) comparisons for each push and pop.
 template <class T>
-class ReadyQueue : public std::priority_queue<T, std::vector<T>>
-{
+class ReadyQueue : NonCopyable {
 public:
-	typedef typename std::priority_queue<T, std::vector<T>>::size_type size_type;
-	ReadyQueue(size_type capacity = 0) { reserve(capacity); };
-	void reserve(size_type capacity) { this->c.reserve(capacity); } 
+	ReadyQueue() : count(0), topPriority(-1), summary3(0) {
+		memset(summary0, 0, sizeof(summary0));
+		memset(summary1, 0, sizeof(summary1));
+		memset(summary2, 0, sizeof(summary2));
+	}
+
+	bool empty() const { return !count; }
+	size_t size() const { return count; }
+
+	T const& top() const { return bucket(topPriority).front(); }
+
+	void push(T const& t) {
+		const int p = static_cast<int>(t.taskID);
+		ASSERT(p >= 0 && p < (1 << PRIORITY_BITS));
+		auto& page = pages[p >> PAGE_BITS];
+		if (!page) page.reset(new Deque<T>[1 << PAGE_BITS]);
+		Deque<T>& b = page[p & ((1 << PAGE_BITS) - 1)];
+		if (b.empty()) markNonEmpty(p);
+		b.push_back(t);
+		++count;
+		topPriority = std::max(topPriority, p);
+	}
+
+	void pop() {
+		Deque<T>& b = bucket(topPriority);
+		b.pop_front();
+		--count;
+		if (b.empty()) {
+			markEmpty(topPriority);
+			topPriority = count ? highestNonEmpty() : -1;
+		}
+	}
+
+	void clear() {
+		for (auto& page : pages) page.reset();
+		memset(summary0, 0, sizeof(summary0));
+		memset(summary1, 0, sizeof(summary1));
+		memset(summary2, 0, sizeof(summary2));
+		summary3 = 0;
+		count = 0;
+		topPriority = -1;
+	}
+
+private:
+	static constexpr int PRIORITY_BITS = 20;  // Enough for TaskPriority::Max
+	static constexpr int PAGE_BITS = 8;
+
+	size_t count;
+	int topPriority;  // -1 when empty
+	uint64_t summary0[1 << (PRIORITY_BITS - 6)];  // Bit p is set when bucket p is non-empty
+	uint64_t summary1[1 << (PRIORITY_BITS - 12)];  // Bit i is set when summary0[i] is non-zero, and so on
+	uint64_t summary2[1 << (PRIORITY_BITS - 18)];
+	uint64_t summary3;
+	std::unique_ptr<Deque<T>[]> pages[1 << (PRIORITY_BITS - PAGE_BITS)];
+
+	Deque<T>& bucket(int p) const { return pages[p >> PAGE_BITS][p & ((1 << PAGE_BITS) - 1)]; }
+
+	void markNonEmpty(int p) {
+		summary0[p >> 6] |= uint64_t(1) << (p & 63);
+		summary1[p >> 12] |= uint64_t(1) << ((p >> 6) & 63);
+		summary2[p >> 18] |= uint64_t(1) << ((p >> 12) & 63);
+		summary3 |= uint64_t(1) << (p >> 18);
+	}
+
+	void markEmpty(int p) {
+		if (summary0[p >> 6] &= ~(uint64_t(1) << (p & 63))) return;
+		if (summary1[p >> 12] &= ~(uint64_t(1) << ((p >> 6) & 63))) return;
+		if (summary2[p >> 18] &= ~(uint64_t(1) << ((p >> 12) & 63))) return;
+		summary3 &= ~(uint64_t(1) << (p >> 18));
+	}
+
+	int highestNonEmpty() const {
+		int i = 63 - clzll(summary3);
+		i = (i << 6) + 63 - clzll(summary2[i]);
+		i = (i << 6) + 63 - clzll(summary1[i]);
+		return (i << 6) + 63 - clzll(summary0[i]);
+	}
 };
 
 
@@ -232,14 +311,15 @@ public:
 		DelayedTask(double at, int64_t priority, TaskPriority taskID, Task* task) : at(at), OrderedTask(priority, taskID, task) {}
 		bool operator < (DelayedTask const& rhs) const { return at > rhs.at; } // Ordering is reversed for priority_queue
 	};
-	std::priority_queue<DelayedTask, std::vector<DelayedTask>> timers;
+	std::priority_queue<DelayedTask, std::vector<DelayedTask>> timers;  // Due within the current timer wheel tick
+	TimerWheel timerWheel;  // DelayTasks due later
 
 	void checkForSlowTask(int64_t tscBegin, int64_t tscEnd, double duration, TaskPriority priority);
 	bool check_yield(TaskPriority taskId, int64_t tscNow);
 	void processThreadReady();
 	void trackAtPriority( TaskPriority priority, double now );
 	void stopImmediately() {
-		stopped=true; decltype(ready) _1; ready.swap(_1); decltype(timers) _2; timers.swap(_2);
+		stopped=true; ready.clear(); decltype(timers) _2; timers.swap(_2); timerWheel.clear();
 	}
 
 	Future<Void> timeOffsetLogger;
@@ -350,14 +430,14 @@ public:
 		closeSocket();
 	}
 
-	explicit Connection( boost::asio::io_service& io_service )
-		: id(nondeterministicRandom()->randomUniqueID()), socket(io_service)
+	explicit Connection( Net2* net )
+		: net(net), id(nondeterministicRandom()->randomUniqueID()), socket(net->reactor.ios)
 	{
 	}
 
 	// This is not part of the IConnection interface, because it is wrapped by INetwork::connect()
-	ACTOR static Future<Reference<IConnection>> connect( boost::asio::io_service* ios, NetworkAddress addr ) {
-		state Reference<Connection> self( new Connection(*ios) );
+	ACTOR static Future<Reference<IConnection>> connect( Net2* net, NetworkAddress addr ) {
+		state Reference<Connection> self( new Connection(net) );
 
 		self->peer_address = addr;
 		try {
@@ -388,7 +468,7 @@ public:
 
 	// returns when write() can write at least one byte
 	Future<Void> onWritable() override {
-		++g_net2->countWriteProbes;
+		++net->countWriteProbes;
 		BindPromise p("N2_WriteProbeError", id);
 		auto f = p.getFuture();
 		socket.async_write_some( boost::asio::null_buffers(), std::move(p) );
@@ -397,7 +477,7 @@ public:
 
 	// returns when read() can read at least one byte
 	Future<Void> onReadable() override {
-		++g_net2->countReadProbes;
+		++net->countReadProbes;
 		BindPromise p("N2_ReadProbeError", id);
 		auto f = p.getFuture();
 		socket.async_read_some( boost::asio::null_buffers(), std::move(p) );
@@ -407,14 +487,14 @@ public:
 	// Reads as many bytes as possible from the read buffer into [begin,end) and returns the number of bytes read (might be 0)
 	int read( uint8_t* begin, uint8_t* end ) override {
 		boost::system::error_code err;
-		++g_net2->countReads;
+		++net->countReads;
 		size_t toRead = end-begin;
 		size_t size = socket.read_some( boost::asio::mutable_buffers_1(begin, toRead), err );
-		g_net2->bytesReceived += size;
+		net->bytesReceived += size;
 		//TraceEvent("ConnRead", this->id).detail("Bytes", size);
 		if (err) {
 			if (err == boost::asio::error::would_block) {
-				++g_net2->countWouldBlock;
+				++net->countWouldBlock;
 				return 0;
 			}
 			onReadError(err);
@@ -428,7 +508,7 @@ public:
 	// Writes as many bytes as possible from the given SendBuffer chain into the write buffer and returns the number of bytes written (might be 0)
 	int write( SendBuffer const* data, int limit ) override {
 		boost::system::error_code err;
-		++g_net2->countWrites;
+		++net->countWrites;
 
 		size_t sent = socket.write_some( boost::iterator_range<SendBufferIterator>(SendBufferIterator(data, limit), SendBufferIterator()), err );
 
@@ -444,7 +524,7 @@ public:
 			ASSERT(notEmpty);
 
 			if (err == boost::asio::error::would_block) {
-				++g_net2->countWouldBlock;
+				++net->countWouldBlock;
 				return 0;
 			}
 			onWriteError(err);
@@ -461,6 +541,7 @@ public:
 
 	tcp::socket& getSocket() { return socket; }
 private:
+	Net2* net;  // Counts this connection's I/O in its metrics
 	UID id;
 	tcp::socket socket;
 	NetworkAddress peer_address;
@@ -530,15 +611,16 @@ public:
 };
 
 class UDPSocket : public IUDPSocket, ReferenceCounted<UDPSocket> {
+	Net2* net;
 	UID id;
 	Optional<NetworkAddress> toAddress;
 	udp::socket socket;
 	bool isPublic = false;
 
 public:
-	ACTOR static Future<Reference<IUDPSocket>> connect(boost::asio::io_service* io_service,
+	ACTOR static Future<Reference<IUDPSocket>> connect(Net2* net,
 	                                                   Optional<NetworkAddress> toAddress, bool isV6) {
-		state Reference<UDPSocket> self(new UDPSocket(*io_service, toAddress, isV6));
+		state Reference<UDPSocket> self(new UDPSocket(net, toAddress, isV6));
 		ASSERT(!toAddress.present() || toAddress.get().ip.isV6() == isV6);
 		if (!toAddress.present()) {
 			return self;
@@ -563,39 +645,39 @@ public:
 	void close() override { closeSocket(); }
 
 	Future<int> receive(uint8_t* begin, uint8_t* end) override {
-		++g_net2->countUDPReads;
+		++net->countUDPReads;
 		ReadPromise p("N2_UDPReadError", id);
 		auto res = p.getFuture();
 		socket.async_receive(boost::asio::mutable_buffer(begin, end - begin), std::move(p));
 		return fmap(
-		    [](int bytes) {
-			    g_net2->udpBytesReceived += bytes;
+		    [net = net](int bytes) {
+			    net->udpBytesReceived += bytes;
 			    return bytes;
 		    },
 		    res);
 	}
 
 	Future<int> receiveFrom(uint8_t* begin, uint8_t* end, NetworkAddress* sender) override {
-		++g_net2->countUDPReads;
+		++net->countUDPReads;
 		ReadPromise p("N2_UDPReadFromError", id);
 		p.getEndpoint() = std::make_shared<udp::endpoint>();
 		auto endpoint = p.getEndpoint().get();
 		auto res = p.getFuture();
 		socket.async_receive_from(boost::asio::mutable_buffer(begin, end - begin), *endpoint, std::move(p));
 		return fmap(
-		    [endpoint, sender](int bytes) {
+		    [net = net, endpoint, sender](int bytes) {
 			    if (sender) {
 				    sender->port = endpoint->port();
 				    sender->ip = toIPAddress(endpoint->address());
 			    }
-			    g_net2->udpBytesReceived += bytes;
+			    net->udpBytesReceived += bytes;
 			    return bytes;
 		    },
 		    res);
 	}
 
 	Future<int> send(uint8_t const* begin, uint8_t const* end) override {
-		++g_net2->countUDPWrites;
+		++net->countUDPWrites;
 		ReadPromise p("N2_UDPWriteError", id);
 		auto res = p.getFuture();
 		socket.async_send(boost::asio::const_buffer(begin, end - begin), std::move(p));
@@ -603,7 +685,7 @@ public:
 	}
 
 	Future<int> sendTo(uint8_t const* begin, uint8_t const* end, NetworkAddress const& peer) override {
-		++g_net2->countUDPWrites;
+		++net->countUDPWrites;
 		ReadPromise p("N2_UDPWriteError", id);
 		auto res = p.getFuture();
 		udp::endpoint toEndpoint = udpEndpoint(peer);
@@ -643,8 +725,8 @@ public:
 	}
 
 private:
-	UDPSocket(boost::asio::io_service& io_service, Optional<NetworkAddress> toAddress, bool isV6)
-	  : id(nondeterministicRandom()->randomUniqueID()), socket(io_service, isV6 ? udp::v6() : udp::v4()) {
+	UDPSocket(Net2* net, Optional<NetworkAddress> toAddress, bool isV6)
+	  : net(net), id(nondeterministicRandom()->randomUniqueID()), socket(net->reactor.ios, isV6 ? udp::v6() : udp::v4()) {
 	}
 
 	void closeSocket() {
@@ -679,13 +761,13 @@ private:
 };
 
 class Listener final : public IListener, ReferenceCounted<Listener> {
-	boost::asio::io_context& io_service;
+	Net2* net;
 	NetworkAddress listenAddress;
 	tcp::acceptor acceptor;
 
 public:
-	Listener( boost::asio::io_context& io_service, NetworkAddress listenAddress )
-		: io_service(io_service), listenAddress(listenAddress), acceptor( io_service, tcpEndpoint( listenAddress ) )
+	Listener( Net2* net, NetworkAddress listenAddress )
+		: net(net), listenAddress(listenAddress), acceptor( net->reactor.ios, tcpEndpoint( listenAddress ) )
 	{
 		platform::setCloseOnExec(acceptor.native_handle());
 	}
@@ -702,7 +784,7 @@ public:
 
 private:
 	ACTOR static Future<Reference<IConnection>> doAccept( Listener* self ) {
-		state Reference<Connection> conn( new Connection( self->io_service ) );
+		state Reference<Connection> conn( new Connection( self->net ) );
 		state tcp::acceptor::endpoint_type peer_endpoint;
 		try {
 			BindPromise p("N2_AcceptError", UID());
@@ -774,13 +856,13 @@ public:
 		closeSocket();
 	}
 
-	explicit SSLConnection( boost::asio::io_service& io_service, Reference<ReferencedObject<boost::asio::ssl::context>> context )
-		: id(nondeterministicRandom()->randomUniqueID()), socket(io_service), ssl_sock(socket, context->mutate()), sslContext(context)
+	explicit SSLConnection( Net2* net, Reference<ReferencedObject<boost::asio::ssl::context>> context )
+		: net(net), id(nondeterministicRandom()->randomUniqueID()), socket(net->reactor.ios), ssl_sock(socket, context->mutate()), sslContext(context)
 	{
 	}
 
 	// This is not part of the IConnection interface, because it is wrapped by INetwork::connect()
-	ACTOR static Future<Reference<IConnection>> connect( boost::asio::io_service* ios, Reference<ReferencedObject<boost::asio::ssl::context>> context, NetworkAddress addr ) {
+	ACTOR static Future<Reference<IConnection>> connect( Net2* net, Reference<ReferencedObject<boost::asio::ssl::context>> context, NetworkAddress addr ) {
 		std::pair<IPAddress,uint16_t> peerIP = std::make_pair(addr.ip, addr.port);
 		auto iter(g_network->networkInfo.serverTLSConnectionThrottler.find(peerIP));
 		if(iter != g_network->networkInfo.serverTLSConnectionThrottler.end()) {
@@ -795,7 +877,7 @@ public:
 			}
 		}
 		
-		state Reference<SSLConnection> self( new SSLConnection(*ios, context) );
+		state Reference<SSLConnection> self( new SSLConnection(net, context) );
 		self->peer_address = addr;
 		
 		try {
@@ -827,11 +909,11 @@ public:
 			Future<Void> onHandshook;
 
 			// If the background handshakers are not all busy, use one
-			if(N2::g_net2->sslPoolHandshakesInProgress < N2::g_net2->sslHandshakerThreadsStarted) {
-				holder = Hold(&N2::g_net2->sslPoolHandshakesInProgress);
+			if(self->net->sslPoolHandshakesInProgress < self->net->sslHandshakerThreadsStarted) {
+				holder = Hold(&self->net->sslPoolHandshakesInProgress);
 				auto handshake = new SSLHandshakerThread::Handshake(self->ssl_sock, boost::asio::ssl::stream_base::server);
 				onHandshook = handshake->done.getFuture();
-				N2::g_net2->sslHandshakerPool->post(handshake);
+				self->net->sslHandshakerPool->post(handshake);
 			}
 			else {
 				// Otherwise use flow network thread
@@ -904,11 +986,11 @@ public:
 		try {
 			Future<Void> onHandshook;
 			// If the background handshakers are not all busy, use one
-			if(N2::g_net2->sslPoolHandshakesInProgress < N2::g_net2->sslHandshakerThreadsStarted) {
-				holder = Hold(&N2::g_net2->sslPoolHandshakesInProgress);
+			if(self->net->sslPoolHandshakesInProgress < self->net->sslHandshakerThreadsStarted) {
+				holder = Hold(&self->net->sslPoolHandshakesInProgress);
 				auto handshake = new SSLHandshakerThread::Handshake(self->ssl_sock, boost::asio::ssl::stream_base::client);
 				onHandshook = handshake->done.getFuture();
-				N2::g_net2->sslHandshakerPool->post(handshake);
+				self->net->sslHandshakerPool->post(handshake);
 			}
 			else {
 				// Otherwise use flow network thread
@@ -962,7 +1044,7 @@ public:
 
 	// returns when write() can write at least one byte
 	Future<Void> onWritable() override {
-		++g_net2->countWriteProbes;
+		++net->countWriteProbes;
 		BindPromise p("N2_WriteProbeError", id);
 		auto f = p.getFuture();
 		socket.async_write_some( boost::asio::null_buffers(), std::move(p) );
@@ -971,7 +1053,7 @@ public:
 
 	// returns when read() can read at least one byte
 	Future<Void> onReadable() override {
-		++g_net2->countReadProbes;
+		++net->countReadProbes;
 		BindPromise p("N2_ReadProbeError", id);
 		auto f = p.getFuture();
 		socket.async_read_some( boost::asio::null_buffers(), std::move(p) );
@@ -981,14 +1063,14 @@ public:
 	// Reads as many bytes as possible from the read buffer into [begin,end) and returns the number of bytes read (might be 0)
 	int read( uint8_t* begin, uint8_t* end ) override {
 		boost::system::error_code err;
-		++g_net2->countReads;
+		++net->countReads;
 		size_t toRead = end-begin;
 		size_t size = ssl_sock.read_some( boost::asio::mutable_buffers_1(begin, toRead), err );
-		g_net2->bytesReceived += size;
+		net->bytesReceived += size;
 		//TraceEvent("ConnRead", this->id).detail("Bytes", size);
 		if (err) {
 			if (err == boost::asio::error::would_block) {
-				++g_net2->countWouldBlock;
+				++net->countWouldBlock;
 				return 0;
 			}
 			onReadError(err);
@@ -1006,7 +1088,7 @@ public:
 		limit = std::min(limit, 2016);
 #endif
 		boost::system::error_code err;
-		++g_net2->countWrites;
+		++net->countWrites;
 
 		size_t sent = ssl_sock.write_some( boost::iterator_range<SendBufferIterator>(SendBufferIterator(data, limit), SendBufferIterator()), err );
 
@@ -1022,7 +1104,7 @@ public:
 			ASSERT(notEmpty);
 
 			if (err == boost::asio::error::would_block) {
-				++g_net2->countWouldBlock;
+				++net->countWouldBlock;
 				return 0;
 			}
 			onWriteError(err);
@@ -1041,6 +1123,7 @@ public:
 
 	ssl_socket& getSSLSocket() { return ssl_sock; }
 private:
+	Net2* net;  // Counts this connection's I/O in its metrics and owns the thread pools it may use
 	UID id;
 	tcp::socket socket;
 	ssl_socket ssl_sock;
@@ -1074,14 +1157,14 @@ private:
 };
 
 class SSLListener final : public IListener, ReferenceCounted<SSLListener> {
-	boost::asio::io_context& io_service;
+	Net2* net;
 	NetworkAddress listenAddress;
 	tcp::acceptor acceptor;
 	AsyncVar<Reference<ReferencedObject<boost::asio::ssl::context>>> *contextVar;
 
 public:
-	SSLListener( boost::asio::io_context& io_service, AsyncVar<Reference<ReferencedObject<boost::asio::ssl::context>>>* contextVar, NetworkAddress listenAddress )
-		: io_service(io_service), listenAddress(listenAddress), acceptor( io_service, tcpEndpoint( listenAddress ) ), contextVar(contextVar)
+	SSLListener( Net2* net, AsyncVar<Reference<ReferencedObject<boost::asio::ssl::context>>>* contextVar, NetworkAddress listenAddress )
+		: net(net), listenAddress(listenAddress), acceptor( net->reactor.ios, tcpEndpoint( listenAddress ) ), contextVar(contextVar)
 	{
 		platform::setCloseOnExec(acceptor.native_handle());
 	}
@@ -1098,7 +1181,7 @@ public:
 
 private:
 	ACTOR static Future<Reference<IConnection>> doAccept( SSLListener* self ) {
-		state Reference<SSLConnection> conn( new SSLConnection( self->io_service, self->contextVar->get() ) );
+		state Reference<SSLConnection> conn( new SSLConnection( self->net, self->contextVar->get() ) );
 		state tcp::acceptor::endpoint_type peer_endpoint;
 		try {
 			BindPromise p("N2_AcceptError", UID());
@@ -1129,6 +1212,33 @@ struct PromiseTask : public Task, public FastAllocated<PromiseTask> {
 	}
 };
 
+// The Future returned by delay(), which is also the task that sets it.  While it waits in the timer wheel, dropping
+// every reference to the future removes it from the wheel, so abandoned timeouts cost nothing further.
+struct DelayTask final : SAV<Void>, Task, TimerWheelEntry, FastAllocated<DelayTask> {
+	using FastAllocated<DelayTask>::operator new;
+	using FastAllocated<DelayTask>::operator delete;
+
+	Net2* net;
+	double at;
+	int64_t priority;
+	TaskPriority taskID;
+
+	DelayTask(Net2* net, double at, int64_t priority, TaskPriority taskID)
+	  : SAV<Void>(1, 1), net(net), at(at), priority(priority), taskID(taskID) {}
+
+	void operator()() override { sendAndDelPromiseRef(Void()); }
+
+	void cancel() override {
+		// Once out of the wheel the task is already queued to run, and will find no one waiting for it
+		if (inWheel()) {
+			net->timerWheel.remove(this);
+			delPromiseRef();
+		}
+	}
+
+	void destroy() override { delete this; }
+};
+
 // 5MB for loading files into memory
 
 Net2::Net2(const TLSConfig& tlsConfig, bool useThreadPool, bool useMetrics)
@@ -1137,7 +1247,7 @@ Net2::Net2(const TLSConfig& tlsConfig, bool useThreadPool, bool useMetrics)
 	  reactor(this),
 	  stopped(false),
 	  tasksIssued(0),
-	  ready(FLOW_KNOBS->READY_QUEUE_RESERVED_SIZE),
+	  timerWheel(FLOW_KNOBS->TIMER_WHEEL_TICK, timer_monotonic()),
 	  // Until run() is called, yield() will always yield
 	  tscBegin(0), tscEnd(0), taskBegin(0), currentTaskID(TaskPriority::DefaultYield),
 	  numYields(0),
@@ -1395,8 +1505,12 @@ void Net2::run() {
 		if (b) {
 			sleepTime = 1e99;
 			double sleepStart = timer_monotonic();
+			double nextTimer = timerWheel.nextDue();
 			if (!timers.empty()) {
-				sleepTime = timers.top().at - sleepStart;  // + 500e-6?
+				nextTimer = std::min(nextTimer, timers.top().at);
+			}
+			if (nextTimer < 1e99) {
+				sleepTime = nextTimer - sleepStart;  // + 500e-6?
 			}
 			if (sleepTime > 0) {
 #if defined(__linux__)
@@ -1427,6 +1541,11 @@ void Net2::run() {
 		if ((now-nnow) > FLOW_KNOBS->SLOW_LOOP_CUTOFF && nondeterministicRandom()->random01() < (now-nnow)*FLOW_KNOBS->SLOW_LOOP_SAMPLING_RATE)
 			TraceEvent("SomewhatSlowRunLoopTop").detail("Elapsed", now - nnow);
 
+		timerWheel.advance(now, [this](TimerWheelEntry* e) {
+			DelayTask* t = static_cast<DelayTask*>(e);
+			timers.push(DelayedTask(t->at, t->priority, t->taskID, t));
+		});
+
 		int numTimers = 0;
 		while (!timers.empty() && timers.top().at < now) {
 			++numTimers;
@@ -1629,7 +1748,7 @@ bool Net2::check_yield( TaskPriority taskID, int64_t tscNow ) {
 	processThreadReady();
 
 	if (taskID == TaskPriority::DefaultYield) taskID = currentTaskID;
-	if (!ready.empty() && ready.top().priority > int64_t(taskID)<<32)  {
+	if (!ready.empty() && ready.top().taskID > taskID)  {
 		return true;
 	}
 
@@ -1675,9 +1794,11 @@ Future<Void> Net2::delay( double seconds, TaskPriority taskId ) {
 		return Never();
 
 	double at = now() + seconds;
-	PromiseTask* t = new PromiseTask;
-	this->timers.push( DelayedTask( at, (int64_t(taskId)<<32)-(++tasksIssued), taskId, t ) );
-	return t->promise.getFuture();
+	DelayTask* t = new DelayTask( this, at, (int64_t(taskId)<<32)-(++tasksIssued), taskId );
+	if (!timerWheel.insert(t, at)) {
+		this->timers.push( DelayedTask( at, t->priority, taskId, t ) );
+	}
+	return Future<Void>(t);
 }
 
 void Net2::onMainThread(Promise<Void>&& signal, TaskPriority taskID) {
@@ -1703,11 +1824,11 @@ Future< Reference<IConnection> > Net2::connect( NetworkAddress toAddr, const std
 #ifndef TLS_DISABLED
 	initTLS(ETLSInitState::CONNECT);
 	if ( toAddr.isTLS() ) {
-		return SSLConnection::connect(&this->reactor.ios, this->sslContextVar.get(), toAddr);
+		return SSLConnection::connect(this, this->sslContextVar.get(), toAddr);
 	}
 #endif
 
-	return Connection::connect(&this->reactor.ios, toAddr);
+	return Connection::connect(this, toAddr);
 }
 
 Future<Reference<IConnection>> Net2::connectExternal(NetworkAddress toAddr, const std::string &host) {
@@ -1754,11 +1875,11 @@ ACTOR static Future<std::vector<NetworkAddress>> resolveTCPEndpoint_impl( Net2 *
 }
 
 Future<Reference<IUDPSocket>> Net2::createUDPSocket(NetworkAddress toAddr) {
-	return UDPSocket::connect(&reactor.ios, toAddr, toAddr.ip.isV6());
+	return UDPSocket::connect(this, toAddr, toAddr.ip.isV6());
 }
 
 Future<Reference<IUDPSocket>> Net2::createUDPSocket(bool isV6) {
-	return UDPSocket::connect(&reactor.ios, Optional<NetworkAddress>(), isV6);
+	return UDPSocket::connect(this, Optional<NetworkAddress>(), isV6);
 }
 
 Future<std::vector<NetworkAddress>> Net2::resolveTCPEndpoint( const std::string &host, const std::string &service) {
@@ -1795,10 +1916,10 @@ Reference<IListener> Net2::listen( NetworkAddress localAddr ) {
 #ifndef TLS_DISABLED
 		initTLS(ETLSInitState::LISTEN);
 		if ( localAddr.isTLS() ) {
-			return Reference<IListener>(new SSLListener( reactor.ios, &this->sslContextVar, localAddr ));
+			return Reference<IListener>(new SSLListener( this, &this->sslContextVar, localAddr ));
 		}
 #endif
-		return Reference<IListener>( new Listener( reactor.ios, localAddr ) );
+		return Reference<IListener>( new Listener( this, localAddr ) );
 	} catch (boost::system::system_error const& e) {
 		Error x;
 		if(e.code().value() == EADDRINUSE)
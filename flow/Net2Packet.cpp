@@ -19,11 +19,13 @@
  */
 
 #include "flow/Net2Packet.h"
+#include "flow/UnitTest.h"
 
 void PacketWriter::init(PacketBuffer* buf, ReliablePacket* reliable) {
 	this->buffer = buf;
 	this->reliable = reliable;
 	this->length = 0;
+	this->zeroCopyMinBytes = 0;
 	length -= buffer->bytes_written;
 	if (reliable) {
 		reliable->buffer = buffer; buffer->addref();
@@ -54,11 +56,15 @@ void PacketWriter::serializeBytesAcrossBoundary(const void* data, int bytes) {
 }
 
 void PacketWriter::nextBuffer(size_t size) {
+	appendBuffer(PacketBuffer::create(size));
+}
+
+void PacketWriter::appendBuffer(PacketBuffer* pb) {
 	auto last_buffer_bytes_written = buffer->bytes_written;
 	length += last_buffer_bytes_written;
 
-	buffer->next = PacketBuffer::create(size);
-	buffer = buffer->nextPacketBuffer();
+	buffer->next = pb;
+	buffer = pb;
 
 	if (reliable) {
 		reliable->end = last_buffer_bytes_written;
@@ -69,6 +75,23 @@ void PacketWriter::nextBuffer(size_t size) {
 	}
 }
 
+// Replaces the bytes.size() bytes at out, which must have been written to the current buffer, with a buffer that
+// refers to bytes, followed by a buffer that refers to the rest of the current buffer.  Neither has room for more
+// data, so whatever is written next starts a new buffer.
+void PacketWriter::splice(uint8_t* out, StringRef bytes, Arena const& arena) {
+	uint8_t* end = buffer->data() + buffer->bytes_written;
+	uint8_t* rest = out + bytes.size();
+	// A string's length always comes just before it, so no buffer is left empty
+	ASSERT(out > buffer->data() && rest <= end);
+
+	PacketBuffer* owner = buffer;
+	owner->bytes_written = out - owner->data();
+	appendBuffer(PacketBuffer::reference(bytes, arena));
+	if (rest != end) {
+		appendBuffer(PacketBuffer::reference(StringRef(rest, end - rest), Arena(), owner));
+	}
+}
+
 // Adds exactly bytes of unwritten length to the buffer, possibly across packet buffer boundaries,
 // and initializes buf to point to the packet buffer(s) that contain the unwritten space
 void PacketWriter::writeAhead( int bytes, struct SplitBuffer* buf ) {
@@ -211,3 +234,111 @@ void ReliablePacketList::discardAll() {
 	while (reliable.next != &reliable)
 		reliable.next->remove();
 }
+
+namespace {
+
+struct ZeroCopyTestMessage {
+	constexpr static FileIdentifier file_identifier = 9853172;
+	Arena arena;
+	ZeroCopyStringRef small, large;
+	StringRef copied;
+
+	template <class Ar>
+	void serialize(Ar& ar) {
+		serializer(ar, small, large, copied, arena);
+	}
+};
+
+struct ZeroCopyTestMessageNoArena {
+	constexpr static FileIdentifier file_identifier = 9853173;
+	ZeroCopyStringRef large;
+
+	template <class Ar>
+	void serialize(Ar& ar) {
+		serializer(ar, large);
+	}
+};
+
+} // namespace
+
+TEST_CASE("/flow/PacketWriter/zeroCopy") {
+	Arena arena;
+	std::string small = deterministicRandom()->randomAlphaNumeric(deterministicRandom()->randomInt(0, 100));
+	std::string large = deterministicRandom()->randomAlphaNumeric(deterministicRandom()->randomInt(100, 100000));
+	std::string copied = deterministicRandom()->randomAlphaNumeric(deterministicRandom()->randomInt(100, 100000));
+	const uint8_t* largeBegin;
+	const uint8_t* copiedBegin;
+	PacketBuffer* first = PacketBuffer::create();
+	first->bytes_written = deterministicRandom()->randomInt(0, first->size());
+	int begin = first->bytes_written;
+	ReliablePacket* rp = new ReliablePacket;
+	int length;
+	{
+		ZeroCopyTestMessage msg;
+		msg.small = StringRef(msg.arena, small);
+		msg.large = StringRef(msg.arena, large);
+		msg.copied = StringRef(msg.arena, copied);
+		largeBegin = msg.large.begin();
+		copiedBegin = msg.copied.begin();
+		PacketWriter wr(first, rp, AssumeVersion(g_network->protocolVersion()));
+		wr.setZeroCopyMinBytes(100);
+		SerializeSource<ZeroCopyTestMessage>(msg).serializePacketWriter(wr);
+		wr.finish();
+		length = wr.size();
+	}
+
+	// Only the buffers keep msg's arena alive now
+	bool referenced = false;
+	uint8_t* flat = new (arena) uint8_t[length];
+	int n = 0;
+	for (PacketBuffer* pb = first; pb; pb = pb->nextPacketBuffer()) {
+		referenced = referenced || (pb->isReference() && pb->data() == largeBegin);
+		// Only fields that opt in are sent from the arena
+		ASSERT(!pb->isReference() || pb->data() != copiedBegin);
+		int skip = pb == first ? begin : 0;
+		memcpy(flat + n, pb->data() + skip, pb->bytes_written - skip);
+		n += pb->bytes_written - skip;
+	}
+	ASSERT(referenced && n == length);
+
+	n = 0;
+	for (ReliablePacket* c = rp; c; c = c->cont) {
+		ASSERT(!memcmp(flat + n, c->buffer->data() + c->begin, c->end - c->begin));
+		n += c->end - c->begin;
+	}
+	ASSERT(n == length);
+
+	ZeroCopyTestMessage out;
+	ObjectReader reader(flat, AssumeVersion(g_network->protocolVersion()));
+	reader.deserialize(out);
+	ASSERT(out.small == StringRef(small) && out.large == StringRef(large) && out.copied == StringRef(copied));
+
+	for (ReliablePacket* c = rp; c;) {
+		ReliablePacket* next = c->cont;
+		c->buffer->delref();
+		delete c;
+		c = next;
+	}
+	for (PacketBuffer* pb = first; pb;) {
+		PacketBuffer* next = pb->nextPacketBuffer();
+		pb->delref();
+		pb = next;
+	}
+
+	// Without an arena to keep them alive the bytes are copied after all
+	ZeroCopyTestMessageNoArena noArena;
+	noArena.large = StringRef(large);
+	first = PacketBuffer::create();
+	PacketWriter wr(first, nullptr, AssumeVersion(g_network->protocolVersion()));
+	wr.setZeroCopyMinBytes(100);
+	SerializeSource<ZeroCopyTestMessageNoArena>(noArena).serializePacketWriter(wr);
+	wr.finish();
+	for (PacketBuffer* pb = first; pb;) {
+		ASSERT(!pb->isReference());
+		PacketBuffer* next = pb->nextPacketBuffer();
+		pb->delref();
+		pb = next;
+	}
+
+	return Void();
+}
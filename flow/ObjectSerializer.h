@@ -57,12 +57,14 @@ struct SaveContext {
 
 	ProtocolVersion protocolVersion() const { return ar->protocolVersion(); }
 
-	void addArena(Arena& arena) {}
+	void addArena(const Arena& arena) { ar->addArena(arena); }
 
 	uint8_t* allocate(size_t s) {
 		return allocator(s);
 	}
 
+	bool trySaveZeroCopy(uint8_t* out, const StringRef& s) { return ar->trySaveZeroCopy(out, s); }
+
 	SaveContext& context() { return *this; }
 };
 
@@ -79,6 +81,17 @@ public:
 	void deserialize(FileIdentifier file_identifier, Items&... items) {
 		const uint8_t* data = static_cast<ReaderImpl*>(this)->data();
 		LoadContext<ReaderImpl> context(static_cast<ReaderImpl*>(this));
+		checkFileIdentifier(file_identifier);
+		load_members(data, context, items...);
+	}
+
+	template <class Item>
+	void deserialize(Item& item) {
+		deserialize(FileIdentifierFor<Item>::value, item);
+	}
+
+	void checkFileIdentifier(FileIdentifier file_identifier) {
+		const uint8_t* data = static_cast<ReaderImpl*>(this)->data();
 		if(read_file_identifier(data) != file_identifier) {
 			// Some file identifiers are changed in 7.0, so file identifier mismatches
 			// are expected during a downgrade from 7.0 to 6.3
@@ -94,12 +107,6 @@ public:
 				ASSERT(false);
 			}
 		}
-		load_members(data, context, items...);
-	}
-
-	template <class Item>
-	void deserialize(Item& item) {
-		deserialize(FileIdentifierFor<Item>::value, item);
 	}
 };
 
@@ -156,6 +163,64 @@ private:
 	Arena _arena;
 };
 
+// A message written by ObjectWriter whose members, as listed by T::serialize(), are each decoded only when first asked
+// for.  Like ArenaObjectReader, strings are not copied out of the message, which the arena has to keep alive.  Suits a
+// receiver that looks at a few fields of a big message, e.g. to route it, before deciding whether it needs the rest.
+//
+// serialize() runs (with a visitor that loads one member) on each first access, so a type whose serialize() does more
+// than list its members while deserializing should be read with materialize().
+template <class T>
+class ObjectView {
+public:
+	template <class VersionOptions>
+	ObjectView(Arena const& arena, const StringRef& input, VersionOptions vo) : reader(arena, input, vo) {
+		static_assert(detail::expect_serialize_member<T> && !serialize_raw<T>::value,
+		              "ObjectView needs a type that serializes as a table");
+		reader.checkFileIdentifier(FileIdentifierFor<T>::value);
+		table = detail::first_member_location(reader.data());
+	}
+
+	// The member of T that field points to, e.g. view.get(&CommitTransactionRequest::flags)
+	template <class Member>
+	const Member& get(Member T::*field) {
+		Member& member = object.*field;
+		if (!complete) {
+			load(&member);
+		}
+		return member;
+	}
+
+	// The whole object, as ArenaObjectReader::deserialize() would have produced it
+	T& materialize() {
+		if (!complete) {
+			load(nullptr);
+			complete = true;
+		}
+		return object;
+	}
+
+	Arena& arena() { return reader.arena(); }
+	ProtocolVersion protocolVersion() const { return reader.protocolVersion(); }
+
+private:
+	ArenaObjectReader reader;
+	const uint8_t* table;
+	T object;
+	uint64_t loaded = 0; // Positions among the members of object that have been loaded, of the first 64
+	bool complete = false;
+
+	void load(const void* member) {
+		LoadContext<ArenaObjectReader> context(&reader);
+		detail::LoadSelectedMember<LoadContext<ArenaObjectReader>> fun(table, member, loaded, context);
+		if constexpr (serializable_traits<T>::value) {
+			serializable_traits<T>::serialize(fun, object);
+		} else {
+			object.serialize(fun);
+		}
+		loaded |= fun.loaded;
+	}
+};
+
 class ObjectWriter {
 	friend struct _IncludeVersion;
 	bool writeProtocolVersion = false;
@@ -196,6 +261,15 @@ public:
 		SaveContext<ObjectWriter, decltype(allocator)> context(this, allocator);
 		save_members(context, file_identifier, items...);
 		ASSERT(allocations == 1);
+		if (!zeroCopyRefs.empty()) {
+			if (!hasZeroCopyArena) {
+				// Nothing would keep the bytes alive after serialize() returns, so copy them after all
+				for (auto& r : zeroCopyRefs) std::copy(r.bytes.begin(), r.bytes.end(), r.out);
+				zeroCopyRefs.clear();
+			}
+			std::sort(zeroCopyRefs.begin(), zeroCopyRefs.end(),
+			          [](ZeroCopyRef const& a, ZeroCopyRef const& b) { return a.out < b.out; });
+		}
 	}
 
 	template <class Item>
@@ -225,11 +299,52 @@ public:
 		ASSERT(mProtocolVersion.isValid());
 	}
 
+	// A ZeroCopyStringRef that serialize() left out of the output.  The caller must send bytes in place of the
+	// bytes.size() bytes at out, and may do so until zeroCopyArena() is released.
+	struct ZeroCopyRef {
+		uint8_t* out;
+		StringRef bytes;
+	};
+
+	// Lets serialize() leave ZeroCopyStringRefs of at least minBytes out of the output instead of copying them,
+	// provided the object has an Arena (or is a Standalone) to keep them alive.  Plain StringRefs are always copied,
+	// since nothing guarantees that the object's arena owns them.  minBytes of 0 disables it.
+	void setZeroCopyMinBytes(int minBytes) { zeroCopyMinBytes = minBytes; }
+
+	// The ZeroCopyStringRefs left out by serialize(), in the order of their positions in the output
+	std::vector<ZeroCopyRef> const& getZeroCopyRefs() const { return zeroCopyRefs; }
+	// Depends on every arena of the serialized object
+	Arena const& zeroCopyArena() const { return zeroCopyKeepAlive; }
+
+	void addArena(const Arena& a) {
+		// Only arenas seen while writing (after the output has been allocated) are kept
+		if (!zeroCopyMinBytes || !data) return;
+		if (!hasZeroCopyArena) {
+			zeroCopyKeepAlive = a;
+			hasZeroCopyArena = true;
+		} else {
+			Arena both;
+			both.dependsOn(zeroCopyKeepAlive);
+			both.dependsOn(a);
+			zeroCopyKeepAlive = both;
+		}
+	}
+
+	bool trySaveZeroCopy(uint8_t* out, const StringRef& s) {
+		if (!zeroCopyMinBytes || s.size() < zeroCopyMinBytes) return false;
+		zeroCopyRefs.push_back(ZeroCopyRef{ out, s });
+		return true;
+	}
+
 private:
 	Arena arena;
 	std::function<uint8_t*(size_t)> customAllocator;
 	uint8_t* data = nullptr;
 	int size = 0;
+	int zeroCopyMinBytes = 0;
+	std::vector<ZeroCopyRef> zeroCopyRefs;
+	Arena zeroCopyKeepAlive;
+	bool hasZeroCopyArena = false;
 };
 
 // this special case is needed - the code expects
@@ -248,6 +363,7 @@ struct LoadSaveHelper<Standalone<T>, Context> : Context {
 
 	template <class Writer>
 	RelativeOffset save(const Standalone<T>& member, Writer& writer, const VTableSet* vtables) {
+		this->addArena(member.arena());
 		return helper.save(member.contents(), writer, vtables);
 	}
 
@@ -40,6 +40,13 @@ void initializeSystemMonitorMachineState(SystemMonitorMachineState machineState)
 void systemMonitor() {
 	static StatisticsState statState = StatisticsState();
 	customSystemMonitor("ProcessMetrics", &statState, true );
+
+	if (FLOW_KNOBS->FAST_ALLOC_RELEASE_IDLE_MEMORY) {
+		int64_t released = releaseIdleFastAllocatorMemory();
+		if (released) {
+			TraceEvent("FastAllocatorReleasedIdleMemory").detail("Bytes", released);
+		}
+	}
 }
 
 SystemStatistics getSystemStatistics() {
@@ -141,6 +148,8 @@ SystemStatistics customSystemMonitor(std::string eventName, StatisticsState *sta
 			    .DETAILALLOCATORMEMUSAGE(4096)
 			    .DETAILALLOCATORMEMUSAGE(8192)
 			    .detail("HugeArenaMemory", g_hugeArenaMemory.load())
+			    .detail("TotalMemoryLargeBlocks", LargeBlockAllocator::getTotalMemory())
+			    .detail("ApproximateUnusedMemoryLargeBlocks", LargeBlockAllocator::getApproximateMemoryUnused())
 			    .detail("DCID", machineState.dcId)
 			    .detail("ZoneID", machineState.zoneId)
 			    .detail("MachineID", machineState.machineId);
@@ -0,0 +1,94 @@
+/*
+ * TimerWheel.cpp
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2020 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flow/UnitTest.h"
+#include "flow/TimerWheel.h"
+
+namespace {
+struct TestTimer : TimerWheelEntry {
+	double at = 0;
+	bool due = false;
+};
+} // namespace
+
+TEST_CASE("/flow/TimerWheel/simple") {
+	TimerWheel wheel(1.0, 0.5);
+	TestTimer a, b, c;
+	ASSERT(!wheel.insert(&a, 0.9));  // Already in the current tick
+	ASSERT(wheel.insert(&b, 3.5));
+	ASSERT(wheel.insert(&c, 1000.0));
+	ASSERT(wheel.size() == 2 && wheel.nextDue() == 3.0);
+
+	std::vector<TimerWheelEntry*> due;
+	auto onDue = [&due](TimerWheelEntry* e) { due.push_back(e); };
+	wheel.advance(2.9, onDue);
+	ASSERT(due.empty());
+	wheel.advance(3.0, onDue);
+	ASSERT(due.size() == 1 && due[0] == &b && !b.inWheel());
+
+	wheel.remove(&c);
+	ASSERT(!c.inWheel() && wheel.size() == 0 && wheel.nextDue() == std::numeric_limits<double>::infinity());
+	wheel.advance(2000.0, onDue);
+	ASSERT(due.size() == 1);
+	return Void();
+}
+
+TEST_CASE("/flow/TimerWheel/random") {
+	// Spans every level and the overflow list, with random removals and random steps of time
+	const int count = 1000;
+	std::vector<TestTimer> timers(count);
+	TimerWheel wheel(1.0, 0);
+	double now = 0;
+	int inWheel = 0;
+	for (auto& t : timers) {
+		t.at = std::ldexp(deterministicRandom()->random01(), deterministicRandom()->randomInt(0, 36));
+		t.due = !wheel.insert(&t, t.at);
+		if (!t.due) inWheel++;
+	}
+	ASSERT(wheel.size() == inWheel);
+
+	auto onDue = [&](TimerWheelEntry* e) {
+		TestTimer* t = static_cast<TestTimer*>(e);
+		ASSERT(!t->due && std::floor(t->at) <= now);
+		t->due = true;
+		inWheel--;
+	};
+	while (wheel.size()) {
+		double next = wheel.nextDue();
+		for (auto& t : timers) {
+			ASSERT(t.due || std::floor(t.at) >= next);
+		}
+		if (deterministicRandom()->random01() < 0.1) {
+			TestTimer& t = timers[deterministicRandom()->randomInt(0, count)];
+			if (t.inWheel()) {
+				wheel.remove(&t);
+				t.due = true;
+				inWheel--;
+			}
+		}
+		now = deterministicRandom()->coinflip() ? next : now + std::ldexp(1.0, deterministicRandom()->randomInt(0, 34));
+		wheel.advance(now, onDue);
+		ASSERT(wheel.size() == inWheel);
+		for (auto& t : timers) {
+			ASSERT(t.due || std::floor(t.at) > now);
+		}
+	}
+	return Void();
+}
@@ -0,0 +1,205 @@
+/*
+ * TimerWheel.h
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2020 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FLOW_TIMERWHEEL_H
+#define FLOW_TIMERWHEEL_H
+#pragma once
+
+#include "flow/Platform.h"
+#include "flow/Error.h"
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+// An intrusive link in a TimerWheel.  The wheel only orders timers to the granularity of a tick; when a timer's tick
+// arrives it is handed back to the owner (see TimerWheel::advance), which orders it exactly among the timers due soon.
+struct TimerWheelEntry {
+	TimerWheelEntry* prev = nullptr;  // nullptr when not in a wheel
+	TimerWheelEntry* next = nullptr;
+	int64_t tick = 0;
+	int16_t level = 0;
+	int16_t slot = 0;
+
+	bool inWheel() const { return prev != nullptr; }
+};
+
+// A hierarchical timing wheel (Varghese and Lauck) of LEVELS levels of SLOTS slots.  Level 0 slots are one tick wide,
+// and each slot of level L covers a whole rotation of level L-1.  Inserting and removing a timer are O(1); a timer
+// is moved down a level at most LEVELS-1 times before it is due.  Timers further out than the wheel spans wait in an
+// overflow list, which is redistributed each time the top level completes a rotation.
+class TimerWheel {
+public:
+	static constexpr int LEVEL_BITS = 8;
+	static constexpr int SLOTS = 1 << LEVEL_BITS;
+	static constexpr int LEVELS = 4;
+	static constexpr int OVERFLOW_LEVEL = LEVELS;
+
+	TimerWheel(double tickSeconds, double now) : tickSeconds(tickSeconds), currentTick(toTick(now)), count(0) {
+		for (int l = 0; l <= LEVELS; l++) {
+			for (int s = 0; s < SLOTS; s++) {
+				slots[l][s].prev = slots[l][s].next = &slots[l][s];
+			}
+			levelCount[l] = 0;
+		}
+		memset(occupied, 0, sizeof(occupied));
+	}
+	TimerWheel(TimerWheel const&) = delete;
+	void operator=(TimerWheel const&) = delete;
+
+	int64_t toTick(double t) const { return (int64_t)std::floor(t / tickSeconds); }
+	double tickToTime(int64_t tick) const { return tick * tickSeconds; }
+
+	// Files e to be handed back once time reaches the start of the tick containing `at`.  Returns false, without
+	// inserting, if that tick has already arrived.
+	bool insert(TimerWheelEntry* e, double at) {
+		ASSERT(!e->inWheel());
+		e->tick = toTick(at);
+		if (e->tick <= currentTick) return false;
+		place(e);
+		return true;
+	}
+
+	void remove(TimerWheelEntry* e) {
+		ASSERT(e->inWheel());
+		unlink(e);
+	}
+
+	// Advances the wheel to the tick containing now, calling onDue(e) for each timer whose tick has arrived
+	template <class F>
+	void advance(double now, F const& onDue) {
+		const int64_t target = toTick(now);
+		while (currentTick < target) {
+			// Skip straight to the next tick at which there is anything to do
+			currentTick = std::min(target, nextEvent());
+			cascade();
+			TimerWheelEntry* head = &slots[0][currentTick & (SLOTS - 1)];
+			while (head->next != head) {
+				TimerWheelEntry* e = head->next;
+				unlink(e);
+				onDue(e);
+			}
+		}
+	}
+
+	// A lower bound on the time at which advance() will next hand back a timer, or +infinity if there are none
+	double nextDue() const {
+		if (!size()) return std::numeric_limits<double>::infinity();
+		return tickToTime(nextEvent());
+	}
+
+	// Timers in the wheel, including the overflow list
+	int size() const { return count + levelCount[OVERFLOW_LEVEL]; }
+
+	// Forgets every timer without handing any back
+	void clear() {
+		for (int l = 0; l <= LEVELS; l++) {
+			for (int s = 0; s < SLOTS; s++) {
+				TimerWheelEntry* head = &slots[l][s];
+				while (head->next != head) unlink(head->next);
+			}
+		}
+	}
+
+private:
+	double tickSeconds;
+	int64_t currentTick;  // Every timer for this tick or earlier has been handed back
+	int count;  // Timers in levels [0, LEVELS)
+	int levelCount[LEVELS + 1];
+	uint64_t occupied[LEVELS + 1][SLOTS / 64];
+	TimerWheelEntry slots[LEVELS + 1][SLOTS];  // Sentinels of circular lists; level LEVELS only uses slot 0
+
+	static int64_t roundUp(int64_t tick, int bits) { return ((tick + (int64_t(1) << bits) - 1) >> bits) << bits; }
+
+	void place(TimerWheelEntry* e) {
+		int level = 0;
+		while (level < LEVELS && (e->tick >> (LEVEL_BITS * (level + 1))) != (currentTick >> (LEVEL_BITS * (level + 1))))
+			level++;
+		int slot = level < LEVELS ? (e->tick >> (LEVEL_BITS * level)) & (SLOTS - 1) : 0;
+		TimerWheelEntry* head = &slots[level][slot];
+		e->level = level;
+		e->slot = slot;
+		e->prev = head->prev;
+		e->next = head;
+		head->prev->next = e;
+		head->prev = e;
+		occupied[level][slot / 64] |= uint64_t(1) << (slot % 64);
+		++levelCount[level];
+		if (level < LEVELS) ++count;
+	}
+
+	void unlink(TimerWheelEntry* e) {
+		e->prev->next = e->next;
+		e->next->prev = e->prev;
+		TimerWheelEntry* head = &slots[e->level][e->slot];
+		if (head->next == head) occupied[e->level][e->slot / 64] &= ~(uint64_t(1) << (e->slot % 64));
+		--levelCount[e->level];
+		if (e->level < LEVELS) --count;
+		e->prev = e->next = nullptr;
+	}
+
+	// The first tick after currentTick at which a timer is handed back or cascaded.  Timers in level L are all in slots
+	// after the cursor of level L's current rotation, and every higher level cascades only once that rotation ends, so
+	// it is the start of the first occupied slot of the lowest occupied level.
+	int64_t nextEvent() const {
+		int level = 0;
+		while (level < LEVELS && !levelCount[level]) level++;
+		if (level == LEVELS) return roundUp(currentTick + 1, LEVELS * LEVEL_BITS);
+
+		const int shift = level * LEVEL_BITS;
+		const int64_t cursor = currentTick >> shift;
+		for (int s = (cursor & (SLOTS - 1)) + 1; s < SLOTS;) {
+			uint64_t bits = occupied[level][s / 64] >> (s % 64);
+			if (bits) return ((cursor & ~int64_t(SLOTS - 1)) + s + ctzll(bits)) << shift;
+			s = (s / 64 + 1) * 64;
+		}
+		ASSERT(false);
+		return roundUp(currentTick + 1, shift + LEVEL_BITS);
+	}
+
+	// Re-files the timers of each higher level slot whose span begins at currentTick, highest level first
+	void cascade() {
+		if (!(currentTick & ((int64_t(1) << (LEVELS * LEVEL_BITS)) - 1))) redistribute(&slots[OVERFLOW_LEVEL][0]);
+		for (int level = LEVELS - 1; level > 0; level--) {
+			if (currentTick & ((int64_t(1) << (level * LEVEL_BITS)) - 1)) continue;
+			redistribute(&slots[level][(currentTick >> (level * LEVEL_BITS)) & (SLOTS - 1)]);
+		}
+	}
+
+	void redistribute(TimerWheelEntry* head) {
+		TimerWheelEntry* e = head->next;
+		if (e == head) return;
+		// Detach the whole list first, since an entry may land back in this same slot
+		TimerWheelEntry* last = head->prev;
+		int16_t level = e->level, slot = e->slot;
+		head->prev = head->next = head;
+		occupied[level][slot / 64] &= ~(uint64_t(1) << (slot % 64));
+		last->next = nullptr;
+		while (e) {
+			TimerWheelEntry* next = e->next;
+			--levelCount[level];
+			if (level < LEVELS) --count;
+			e->prev = e->next = nullptr;
+			place(e);
+			e = next;
+		}
+	}
+};
+
+#endif
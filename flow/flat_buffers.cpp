@@ -562,4 +562,55 @@ TEST_CASE("/flow/FlatBuffers/EmptyPreSerVectorRefs") {
 	return Void();
 }
 
+struct ViewedMessage {
+	constexpr static FileIdentifier file_identifier = 9283411;
+	int64_t version = 0;
+	StringRef key;
+	std::variant<int, std::string> routing;
+	VectorRef<StringRef> values;
+	Table3 nested;
+	::Arena arena;
+	template <class Archiver>
+	void serialize(Archiver& ar) {
+		serializer(ar, version, key, routing, values, nested, arena);
+	}
+};
+
+TEST_CASE("/flow/FlatBuffers/ObjectView") {
+	ViewedMessage in;
+	in.version = deterministicRandom()->randomInt64(0, 1e12);
+	in.key = StringRef(in.arena, StringRef(deterministicRandom()->randomAlphaNumeric(deterministicRandom()->randomInt(0, 100))));
+	if (deterministicRandom()->coinflip()) {
+		in.routing = deterministicRandom()->randomInt(0, 1000);
+	} else {
+		in.routing = deterministicRandom()->randomAlphaNumeric(10);
+	}
+	for (int i = deterministicRandom()->randomInt(0, 10); i > 0; i--) {
+		in.values.push_back(in.arena, StringRef(in.arena, StringRef(deterministicRandom()->randomAlphaNumeric(i))));
+	}
+	in.nested.m_n = deterministicRandom()->randomInt64(0, 1e12);
+	Standalone<StringRef> msg = ObjectWriter::toValue(in, Unversioned());
+
+	// Fields are decoded one at a time, in any order, and strings are not copied out of the message
+	ObjectView<ViewedMessage> view(msg.arena(), msg, Unversioned());
+	if (deterministicRandom()->coinflip()) {
+		ASSERT(view.get(&ViewedMessage::nested).m_n == in.nested.m_n);
+	}
+	const StringRef& key = view.get(&ViewedMessage::key);
+	ASSERT(key == in.key);
+	ASSERT(key.size() == 0 || (key.begin() >= msg.begin() && key.end() <= msg.end()));
+	ASSERT(view.get(&ViewedMessage::version) == in.version);
+	ASSERT(view.get(&ViewedMessage::routing) == in.routing);
+	ASSERT(view.get(&ViewedMessage::version) == in.version);
+
+	ViewedMessage& out = view.materialize();
+	ASSERT(out.version == in.version && out.key == in.key && out.routing == in.routing);
+	ASSERT(out.values.size() == in.values.size());
+	for (int i = 0; i < in.values.size(); i++) {
+		ASSERT(out.values[i] == in.values[i]);
+	}
+	ASSERT(out.nested.m_n == in.nested.m_n);
+	return Void();
+}
+
 } // namespace unit_tests
@@ -948,6 +948,77 @@ private:
 	bool field_present() { return i < vtable_length && vtable[i] >= 4; }
 };
 
+// The number of vtable entries a member of a table takes up
+template <class Member>
+constexpr int vtable_slots() {
+	if constexpr (is_vector_of_union_like<Member> || is_union_like<Member>) {
+		return 2;
+	} else if constexpr (_SizeOf<Member>::size == 0) {
+		return 0;
+	} else {
+		return 1;
+	}
+}
+
+// Stands in for SerializeFun to load just one of the members a table's serialize() lists, identified by its address,
+// leaving the rest untouched.  If selected is nullptr every member is loaded instead.  Members whose position is set
+// in skip are not loaded (again).
+template <class Context>
+struct LoadSelectedMember : Context {
+	static constexpr bool isDeserializing = true;
+	static constexpr bool isSerializing = false;
+	static constexpr bool is_fb_visitor = true;
+
+	const uint8_t* current; // Where the offset to the table is, or nullptr if the table is absent
+	const void* selected;
+	uint64_t skip;
+	uint64_t loaded = 0; // Positions of the members loaded by this call, of the first 64
+
+	LoadSelectedMember(const uint8_t* current, const void* selected, uint64_t skip, Context& context)
+	  : Context(context), current(current), selected(selected), skip(skip) {}
+
+	template <class... Args>
+	void operator()(Args&... members) {
+		if (sizeof...(Args) == 0 || !current) {
+			return;
+		}
+		const uint8_t* message = current + interpret_as<uint32_t>(current);
+		int32_t vtable_offset = interpret_as<int32_t>(message);
+		const uint16_t* vtable = reinterpret_cast<const uint16_t*>(message - vtable_offset);
+		int i = 0;
+		uint16_t vtable_length = vtable[i++] / sizeof(uint16_t);
+		uint16_t table_length = vtable[i++];
+		LoadMember<Context> loadMember{ vtable, message, vtable_length, table_length, i, this->context() };
+		int position = 0;
+		bool done = false;
+		for_each(
+		    [&](auto& member) {
+			    using Member = std::decay_t<decltype(member)>;
+			    bool wanted = !done && (selected ? (const void*)&member == selected : true) &&
+			                  !(position < 64 && (skip >> position & 1));
+			    if (wanted) {
+				    loadMember(member);
+				    if (position < 64) loaded |= uint64_t(1) << position;
+				    done = selected != nullptr;
+			    } else {
+				    i += vtable_slots<Member>();
+			    }
+			    ++position;
+		    },
+		    members...);
+	}
+};
+
+// Where the offset to the table of the first object saved by save_members() is, or nullptr if it is absent
+inline const uint8_t* first_member_location(const uint8_t* in) {
+	const uint8_t* root = in + interpret_as<uint32_t>(in);
+	const uint16_t* vtable = reinterpret_cast<const uint16_t*>(root - interpret_as<int32_t>(root));
+	if (vtable[0] / sizeof(uint16_t) <= 2 || vtable[2] < 4) {
+		return nullptr;
+	}
+	return root + vtable[2];
+}
+
 template <size_t i>
 struct int_type {
 	static constexpr int value = i;
@@ -1054,6 +1125,9 @@ struct LoadSaveHelper : Context {
 		std::array<uint8_t, size> result = {};
 		if constexpr (size > 0) {
 			scalar_traits<U>::save(&result[0], message, this->context());
+		} else {
+			// Nothing is written, but the context still sees the member (e.g. an Arena to keep alive)
+			scalar_traits<U>::save(nullptr, message, this->context());
 		}
 		return result;
 	}
@@ -580,7 +580,10 @@ struct NotifiedQueue : private SingleCallback<T>, FastAllocated<NotifiedQueue<T>
 	bool isError() const { return queue.empty() && error.isValid(); }  // the *next* thing queued is an error
 	uint32_t size() const { return queue.size(); }
 
-	T pop() {
+	// True if the next value sent will be passed directly to a waiting callback rather than queued for pop()
+	bool shouldFireImmediately() const { return SingleCallback<T>::next != this; }
+
+	virtual T pop() {
 		if (queue.empty()) {
 			if (error.isValid()) throw error;
 			throw internal_error();
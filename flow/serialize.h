@@ -740,6 +740,21 @@ private:
 		static_assert(sizeof(PacketBuffer) == PACKET_BUFFER_OVERHEAD);
 	}
 
+	// What keeps the bytes of a buffer made by reference() alive.  It follows the header in place of the data.
+	struct Referent {
+		Arena arena;
+		PacketBuffer* buffer;
+	};
+
+	PacketBuffer(uint8_t* data, size_t size) : reference_count(1), size_(size), enqueue_time(g_network->now()) {
+		next = nullptr;
+		bytes_written = size;
+		bytes_sent = 0;
+		_data = data;
+	}
+
+	Referent* referent() { return reinterpret_cast<Referent*>(this + 1); }
+
 public:
 	static PacketBuffer* create(size_t size = 0) {
 		size = std::max(size, PACKET_BUFFER_MIN_SIZE - PACKET_BUFFER_OVERHEAD);
@@ -749,11 +764,26 @@ public:
 		uint8_t* mem = new uint8_t[size + PACKET_BUFFER_OVERHEAD];
 		return new (mem) PacketBuffer{ size };
 	}
+	// A full buffer whose data is bytes, owned by arena or (if given) by the buffer keepAlive, rather than a copy
+	static PacketBuffer* reference(StringRef bytes, Arena const& arena, PacketBuffer* keepAlive = nullptr) {
+		uint8_t* mem = new uint8_t[PACKET_BUFFER_OVERHEAD + sizeof(Referent)];
+		PacketBuffer* pb = new (mem) PacketBuffer{ const_cast<uint8_t*>(bytes.begin()), (size_t)bytes.size() };
+		new (pb->referent()) Referent{ arena, keepAlive };
+		if (keepAlive) keepAlive->addref();
+		return pb;
+	}
+	bool isReference() const { return _data != reinterpret_cast<const uint8_t*>(this + 1); }
+
 	PacketBuffer* nextPacketBuffer() { return static_cast<PacketBuffer*>(next); }
 	void addref() { ++reference_count; }
 	void delref() {
 		if (!--reference_count) {
-			if (size_ == PACKET_BUFFER_MIN_SIZE - PACKET_BUFFER_OVERHEAD) {
+			if (isReference()) {
+				PacketBuffer* keepAlive = referent()->buffer;
+				referent()->~Referent();
+				delete[] reinterpret_cast<uint8_t*>(this);
+				if (keepAlive) keepAlive->delref();
+			} else if (size_ == PACKET_BUFFER_MIN_SIZE - PACKET_BUFFER_OVERHEAD) {
 				FastAllocator<PACKET_BUFFER_MIN_SIZE>::release(this);
 			} else {
 				delete[] this;
@@ -805,9 +835,16 @@ struct PacketWriter {
 	ProtocolVersion protocolVersion() const { return m_protocolVersion; }
 	void setProtocolVersion(ProtocolVersion pv) { m_protocolVersion = pv; }
 
+	// Serialized ZeroCopyStringRefs of at least this many bytes are sent from their arenas instead of copied; 0 disables
+	void setZeroCopyMinBytes(int minBytes) { zeroCopyMinBytes = minBytes; }
+
 private:
+	int zeroCopyMinBytes;
+
 	void serializeBytesAcrossBoundary(const void* data, int bytes);
 	void nextBuffer(size_t size = 0 /* downstream it will default to at least 4k minus some padding */);
+	void appendBuffer(PacketBuffer* pb);
+	void splice(uint8_t* out, StringRef bytes, Arena const& arena);
 	uint8_t* writeBytes(size_t size) {
 		if (size > buffer->bytes_unwritten()) {
 			nextBuffer(size);
@@ -834,7 +871,11 @@ struct MakeSerializeSource : ISerializeSource {
 	using value_type = V;
 	void serializePacketWriter(PacketWriter& w) const override {
 		ObjectWriter writer([&](size_t size) { return w.writeBytes(size); }, AssumeVersion(w.protocolVersion()));
+		writer.setZeroCopyMinBytes(w.zeroCopyMinBytes);
 		writer.serialize(get()); // Writes directly into buffer supplied by |w|
+		for (auto& r : writer.getZeroCopyRefs()) {
+			w.splice(r.out, r.bytes, writer.zeroCopyArena());
+		}
 	}
 	virtual value_type const& get() const = 0;
 };
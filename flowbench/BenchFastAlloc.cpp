@@ -0,0 +1,90 @@
+/*
+ * BenchFastAlloc.cpp
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2020 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "benchmark/benchmark.h"
+
+#include "flow/FastAlloc.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Objects allocated and freed on the same thread, which never leave the thread's own magazines
+template <int Size>
+static void bench_fast_alloc_same_thread(benchmark::State& state) {
+	std::vector<void*> objects(state.range(0));
+	while (state.KeepRunning()) {
+		for (auto& p : objects) p = FastAllocator<Size>::allocate();
+		for (auto p : objects) FastAllocator<Size>::release(p);
+	}
+	state.SetItemsProcessed(static_cast<long>(state.iterations() * state.range(0)));
+}
+
+// Objects allocated on one thread and freed on another, as replies allocated on a client's network thread are freed by
+// ThreadSafeTransaction callback threads.  Every magazine the consumer fills goes back to the global pool, and the
+// producer has to take a new one from it after each magazine's worth of allocations.
+template <int Size>
+static void bench_fast_alloc_cross_thread(benchmark::State& state) {
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::deque<std::vector<void*>> batches;
+	bool done = false;
+
+	std::thread consumer([&] {
+		for (;;) {
+			std::vector<void*> batch;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				cv.wait(lock, [&] { return done || !batches.empty(); });
+				if (batches.empty()) break;
+				batch = std::move(batches.front());
+				batches.pop_front();
+			}
+			cv.notify_all();
+			for (auto p : batch) FastAllocator<Size>::release(p);
+		}
+		FastAllocator<Size>::releaseThreadMagazines();
+	});
+
+	while (state.KeepRunning()) {
+		std::vector<void*> batch(state.range(0));
+		for (auto& p : batch) p = FastAllocator<Size>::allocate();
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			cv.wait(lock, [&] { return batches.size() < 4; });
+			batches.push_back(std::move(batch));
+		}
+		cv.notify_all();
+	}
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		done = true;
+	}
+	cv.notify_all();
+	consumer.join();
+	state.SetItemsProcessed(static_cast<long>(state.iterations() * state.range(0)));
+}
+
+BENCHMARK_TEMPLATE(bench_fast_alloc_same_thread, 64)->Range(1 << 8, 1 << 14)->ReportAggregatesOnly(true);
+BENCHMARK_TEMPLATE(bench_fast_alloc_same_thread, 1024)->Range(1 << 8, 1 << 14)->ReportAggregatesOnly(true);
+BENCHMARK_TEMPLATE(bench_fast_alloc_cross_thread, 64)->Range(1 << 8, 1 << 14)->UseRealTime()->ReportAggregatesOnly(true);
+BENCHMARK_TEMPLATE(bench_fast_alloc_cross_thread, 1024)->Range(1 << 8, 1 << 14)->UseRealTime()->ReportAggregatesOnly(true);
@@ -0,0 +1,96 @@
+/*
+ * BenchRunLoop.actor.cpp
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2020 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "benchmark/benchmark.h"
+
+#include "flow/flow.h"
+#include "flow/ThreadHelper.actor.h"
+#include "flow/genericactors.actor.h"
+#include "flow/network.h"
+
+#include "flow/actorcompiler.h" // This must be the last #include.
+
+static const TaskPriority benchPriorities[] = { TaskPriority::ReadSocket,      TaskPriority::DefaultPromiseEndpoint,
+	                                            TaskPriority::DefaultDelay,    TaskPriority::DefaultYield,
+	                                            TaskPriority::DefaultEndpoint, TaskPriority::Low };
+
+// Queues state.range(0) tasks, spread over state.range(1) priorities, and runs them all through the run loop
+ACTOR static Future<Void> benchReadyQueueActor(benchmark::State* benchState) {
+	state int tasks = benchState->range(0);
+	state int priorities = benchState->range(1);
+	state std::vector<Future<Void>> futures;
+	futures.reserve(tasks);
+	while (benchState->KeepRunning()) {
+		for (int i = 0; i < tasks; ++i) {
+			futures.push_back(delay(0, benchPriorities[i % priorities]));
+		}
+		wait(waitForAll(futures));
+		futures.clear();
+	}
+	benchState->SetItemsProcessed(tasks * static_cast<long>(benchState->iterations()));
+	return Void();
+}
+
+static void bench_ready_queue(benchmark::State& benchState) {
+	onMainThread([&benchState]() { return benchReadyQueueActor(&benchState); }).blockUntilReady();
+}
+
+// Each yield() is a check of the ready queue, and the occasional real yield a trip through it
+ACTOR static Future<Void> benchYieldActor(benchmark::State* benchState) {
+	while (benchState->KeepRunning()) {
+		wait(yield());
+	}
+	benchState->SetItemsProcessed(static_cast<long>(benchState->iterations()));
+	return Void();
+}
+
+static void bench_yield(benchmark::State& benchState) {
+	onMainThread([&benchState]() { return benchYieldActor(&benchState); }).blockUntilReady();
+}
+
+ACTOR static Future<Void> waitAndReply(Future<Void> request, Promise<Void> reply) {
+	wait(request);
+	reply.send(Void());
+	return Void();
+}
+
+// A Promise::send that wakes an actor, which replies with a Promise::send of its own
+ACTOR static Future<Void> benchPromiseSendActor(benchmark::State* benchState) {
+	state Promise<Void> request;
+	state Promise<Void> reply;
+	state Future<Void> responder;
+	while (benchState->KeepRunning()) {
+		request = Promise<Void>();
+		reply = Promise<Void>();
+		responder = waitAndReply(request.getFuture(), reply);
+		request.send(Void());
+		wait(reply.getFuture());
+	}
+	benchState->SetItemsProcessed(static_cast<long>(benchState->iterations()));
+	return Void();
+}
+
+static void bench_promise_send(benchmark::State& benchState) {
+	onMainThread([&benchState]() { return benchPromiseSendActor(&benchState); }).blockUntilReady();
+}
+
+BENCHMARK(bench_ready_queue)->Ranges({ { 1, 1 << 16 }, { 1, 6 } })->ReportAggregatesOnly(true);
+BENCHMARK(bench_yield)->ReportAggregatesOnly(true);
+BENCHMARK(bench_promise_send)->ReportAggregatesOnly(true);
@@ -20,7 +20,11 @@
 
 #include "benchmark/benchmark.h"
 
+#include "flow/IRandom.h"
 #include "flow/Platform.h"
+#include "flow/TimerWheel.h"
+
+#include <queue>
 
 static void bench_timer(benchmark::State& state) {
 	while (state.KeepRunning()) {
@@ -38,5 +42,102 @@ static void bench_timer_monotonic(benchmark::State& state) {
 	state.SetItemsProcessed(static_cast<long>(state.iterations()));
 }
 
+namespace {
+
+struct BenchTimerEntry : TimerWheelEntry {
+	double at;
+};
+
+struct HeapTimer {
+	double at;
+	BenchTimerEntry* entry;
+	bool operator<(HeapTimer const& rhs) const { return at > rhs.at; }
+};
+
+// Arms state.range(0) timeouts of up to 10 seconds, a tick of 1ms apart, as a busy process would have outstanding
+std::vector<BenchTimerEntry> makeTimers(benchmark::State& state) {
+	std::vector<BenchTimerEntry> timers(state.range(0));
+	for (auto& t : timers) {
+		t.at = 1.0 + deterministicRandom()->random01() * 10.0;
+	}
+	return timers;
+}
+
+} // namespace
+
+// Arming a timeout that is cancelled before it fires, the usual fate of timeoutError() and load balancing backups.
+// A heap cannot remove the cancelled timer, so it costs a push and, once it expires, a pop.
+static void bench_timer_wheel_cancel(benchmark::State& state) {
+	auto timers = makeTimers(state);
+	TimerWheel wheel(0.001, 0);
+	for (auto& t : timers) {
+		wheel.insert(&t, t.at);
+	}
+	BenchTimerEntry timeout;
+	while (state.KeepRunning()) {
+		wheel.insert(&timeout, 5.0);
+		wheel.remove(&timeout);
+	}
+	state.SetItemsProcessed(static_cast<long>(state.iterations()));
+}
+
+static void bench_timer_heap_cancel(benchmark::State& state) {
+	auto timers = makeTimers(state);
+	std::priority_queue<HeapTimer, std::vector<HeapTimer>> heap;
+	for (auto& t : timers) {
+		heap.push(HeapTimer{ t.at, &t });
+	}
+	BenchTimerEntry timeout;
+	while (state.KeepRunning()) {
+		heap.push(HeapTimer{ 0.5, &timeout });
+		heap.pop();
+	}
+	state.SetItemsProcessed(static_cast<long>(state.iterations()));
+}
+
+// Arming state.range(0) timers and running them all to expiry, one 1ms run loop iteration at a time
+static void bench_timer_wheel_expire(benchmark::State& state) {
+	auto timers = makeTimers(state);
+	while (state.KeepRunning()) {
+		TimerWheel wheel(0.001, 0);
+		std::priority_queue<HeapTimer, std::vector<HeapTimer>> due;
+		for (auto& t : timers) {
+			wheel.insert(&t, t.at);
+		}
+		for (double now = 0; wheel.size() || !due.empty(); now += 0.001) {
+			wheel.advance(now, [&due](TimerWheelEntry* e) {
+				BenchTimerEntry* t = static_cast<BenchTimerEntry*>(e);
+				due.push(HeapTimer{ t->at, t });
+			});
+			while (!due.empty() && due.top().at < now) {
+				benchmark::DoNotOptimize(due.top().entry);
+				due.pop();
+			}
+		}
+	}
+	state.SetItemsProcessed(static_cast<long>(state.iterations() * state.range(0)));
+}
+
+static void bench_timer_heap_expire(benchmark::State& state) {
+	auto timers = makeTimers(state);
+	while (state.KeepRunning()) {
+		std::priority_queue<HeapTimer, std::vector<HeapTimer>> heap;
+		for (auto& t : timers) {
+			heap.push(HeapTimer{ t.at, &t });
+		}
+		for (double now = 0; !heap.empty(); now += 0.001) {
+			while (!heap.empty() && heap.top().at < now) {
+				benchmark::DoNotOptimize(heap.top().entry);
+				heap.pop();
+			}
+		}
+	}
+	state.SetItemsProcessed(static_cast<long>(state.iterations() * state.range(0)));
+}
+
 BENCHMARK(bench_timer)->ReportAggregatesOnly(true);
 BENCHMARK(bench_timer_monotonic)->ReportAggregatesOnly(true);
+BENCHMARK(bench_timer_wheel_cancel)->RangeMultiplier(16)->Range(1 << 10, 1 << 18)->ReportAggregatesOnly(true);
+BENCHMARK(bench_timer_heap_cancel)->RangeMultiplier(16)->Range(1 << 10, 1 << 18)->ReportAggregatesOnly(true);
+BENCHMARK(bench_timer_wheel_expire)->RangeMultiplier(16)->Range(1 << 10, 1 << 18)->ReportAggregatesOnly(true);
+BENCHMARK(bench_timer_heap_expire)->RangeMultiplier(16)->Range(1 << 10, 1 << 18)->ReportAggregatesOnly(true);